@@ -0,0 +1,36 @@
+#pragma once
+#include <memory>
+#include <optional>
+#include <string>
+#include <booksource/chapterstore.h>
+#include <booksource/ruledata.h>
+
+/**
+ * 大变量保存在磁盘上的规则数据：小变量仍在variableMap中，大变量（不少于10000字符）写入共享的段文件
+ * 内存中只有段文件的索引，getBigVariable()时才从映射中读取并解压，书架上有很多书时内存占用不随大变量增长
+ * 段文件与章节正文的格式相同（见ChapterStore），以 所有者 + 变量名 为key，多个DiskRuleData可以共享同一个
+ */
+class DiskRuleData : public RuleData {
+public:
+    /**
+     * @param store 保存大变量的段文件
+     * @param owner 所有者，如书籍地址或者书源的getKey()，区分不同书的同名变量
+     */
+    DiskRuleData(std::shared_ptr<ChapterStore> store, std::string owner);
+
+    ~DiskRuleData() override = default;
+
+    void putBigVariable(const std::string &key, const std::optional<std::string> &value) override;
+
+    std::optional<std::string> getBigVariable(const std::string &key) const override;
+
+    const std::string &getOwner() const {
+        return owner;
+    }
+
+private:
+    std::string storeKey(const std::string &key) const;
+
+    std::shared_ptr<ChapterStore> store;
+    std::string owner;
+};
@@ -0,0 +1,192 @@
+#pragma once
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include <booksource/chaptercolumns.h>
+#include <booksource/data.h>
+
+/**
+ * 书架数据库：书籍（Book）、搜索结果（SearchBook）与目录（BookChapter）保存在一个只追加的文件中
+ * 1. 每次写入是一个带校验和的事务帧，一批修改（如整本书的目录）要么全部生效要么全部丢弃，写入中断的帧在打开时截掉
+ * 2. 目录按index排列保存为定长记录的数组加字符串堆，打开时只记录每本书的目录位置，
+ *    读取时通过mmap定位，按index范围只解码需要的章节；书籍与搜索结果较少，打开时全部读入内存
+ * 3. 书籍与搜索结果按bookUrl、origin与(name, author)索引，与阅读(Legado)的数据库查询对应
+ * 4. 被替换与删除的数据超过一定比例时整理文件
+ * 线程安全，读取可以同时进行
+ */
+class BookShelf {
+public:
+    struct Options {
+        bool sync = false;                   // 每次写入后是否等待数据写入磁盘
+        double compactRatio = 0.5;           // 失效数据占文件的比例超过该值时自动整理
+        size_t compactMinSize = 1024 * 1024; // 文件小于该值时不自动整理
+    };
+
+    /**
+     * 一批修改，由write()在一个事务中写入，按加入的顺序生效
+     */
+    class Batch {
+    public:
+        Batch &putBook(const Book &book);
+
+        // 同时删除书籍的目录
+        Batch &removeBook(const std::string &bookUrl);
+
+        // 替换书籍的整个目录，章节按index排列后保存
+        Batch &putChapters(const std::string &bookUrl, const std::vector<BookChapter> &chapters);
+
+        Batch &putChapters(const std::string &bookUrl, const ChapterList &chapters);
+
+        Batch &putSearchBook(const SearchBook &searchBook);
+
+        Batch &removeSearchBook(const std::string &bookUrl);
+
+        bool empty() const {
+            return count == 0;
+        }
+
+    private:
+        friend class BookShelf;
+        std::string data;
+        uint32_t count = 0;
+    };
+
+    /**
+     * 打开或者创建数据库文件
+     * @throws std::runtime_error 文件无法打开或者不是书架数据库
+     */
+    BookShelf(std::string file, Options options);
+
+    explicit BookShelf(std::string file) : BookShelf(std::move(file), Options()) {
+    }
+
+    ~BookShelf();
+
+    BookShelf(const BookShelf &) = delete;
+
+    BookShelf &operator=(const BookShelf &) = delete;
+
+    /**
+     * @throws std::runtime_error 写入失败，此时数据库不变
+     */
+    void write(const Batch &batch);
+
+    void putBook(const Book &book);
+
+    void removeBook(const std::string &bookUrl);
+
+    void putChapters(const std::string &bookUrl, const std::vector<BookChapter> &chapters);
+
+    void putChapters(const std::string &bookUrl, const ChapterList &chapters);
+
+    void putSearchBook(const SearchBook &searchBook);
+
+    std::optional<Book> getBook(const std::string &bookUrl);
+
+    // 全部书籍，按bookUrl排列
+    std::vector<Book> getBooks();
+
+    std::vector<Book> getBooksByOrigin(const std::string &origin);
+
+    std::vector<Book> getBooks(const std::string &name, const std::string &author);
+
+    size_t bookCount();
+
+    std::optional<SearchBook> getSearchBook(const std::string &bookUrl);
+
+    std::vector<SearchBook> getSearchBooksByOrigin(const std::string &origin);
+
+    // 换源时同名同作者的搜索结果
+    std::vector<SearchBook> getSearchBooks(const std::string &name, const std::string &author);
+
+    size_t chapterCount(const std::string &bookUrl);
+
+    // index在[from, to)之间的章节
+    std::vector<BookChapter> getChapters(const std::string &bookUrl, int from = 0, int to = INT_MAX);
+
+    std::optional<BookChapter> getChapter(const std::string &bookUrl, int index);
+
+    // 整个目录，字符串直接从记录复制到目录的字符串区，不为每个章节生成BookChapter
+    ChapterList getChapterList(const std::string &bookUrl);
+
+    // 数据库文件当前的字节数
+    size_t fileSize();
+
+    // 被替换与删除的数据的字节数
+    size_t garbageSize();
+
+    /**
+     * 整理文件：只保留有效的数据
+     * @throws std::runtime_error 写入失败，此时原文件不变
+     */
+    void compact();
+
+private:
+    struct Mapping;
+
+    // 按bookUrl保存，按origin与(name, author)索引
+    template<typename T>
+    struct Table {
+        std::unordered_map<std::string, std::pair<T, uint32_t> > rows; // bookUrl -> (数据, 记录的字节数)
+        std::set<std::pair<std::string, std::string> > byOrigin;
+        std::set<std::tuple<std::string, std::string, std::string> > byNameAuthor;
+
+        // 返回被替换的记录的字节数
+        uint32_t put(T row, uint32_t size);
+
+        uint32_t remove(const std::string &bookUrl);
+
+        std::vector<T> withOrigin(const std::string &origin) const;
+
+        std::vector<T> withNameAuthor(const std::string &name, const std::string &author) const;
+    };
+
+    // 一本书的目录在文件中的位置
+    struct ChapterBlock {
+        uint64_t op;       // 操作在文件中的位置
+        uint32_t length;   // 操作的字节数
+        uint64_t records;  // 记录数组的位置，其后为字符串堆
+        uint32_t count;
+        uint32_t heapSize;
+    };
+
+    void open();
+
+    void close();
+
+    // 依次执行文件中的事务帧，返回有效部分的长度
+    uint64_t replay();
+
+    // 执行一帧中的操作，offset为ops在文件中的位置
+    void apply(std::string_view ops, uint32_t count, uint64_t offset);
+
+    std::shared_ptr<const Mapping> mappingFor(uint64_t end);
+
+    // 写入一帧，返回ops在文件中的位置
+    uint64_t appendFrame(int writeFd, uint64_t &writeEnd, std::string_view ops, uint32_t count) const;
+
+    BookChapter decodeChapter(const Mapping &mapping, const ChapterBlock &block, uint32_t i) const;
+
+    void compactLocked();
+
+    const std::string file;
+    const Options options;
+
+    std::shared_mutex mutex;
+    std::mutex mappingMutex; // 共享锁下可能需要重新映射
+    int fd = -1;
+    uint64_t end = 0;
+    uint64_t garbage = 0;
+    std::shared_ptr<const Mapping> mapping;
+    Table<Book> books;
+    Table<SearchBook> searchBooks;
+    std::unordered_map<std::string, ChapterBlock> chapters;
+};
@@ -0,0 +1,220 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <booksource/ruledata.h>
+
+/**
+ * 按列保存的目录：index与标志各为一个数组，url与标题保存在同一个字符串区中，以偏移量引用
+ * baseUrl与bookUrl在一个目录中通常只有一两个不同的值，只保存一次；较少使用的字段（tag、start等）单独保存
+ * 每个章节只有几十字节且没有单独的内存分配，遍历、查找与序列化都在连续的内存上进行
+ * 需要完整的BookChapter时通过 operator[] 的视图按需生成
+ */
+class ChapterList {
+public:
+    // 字符串区中的一段
+    struct StringRef {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    // 常用字段，其中的字符串在push_back()时复制到字符串区
+    struct Fields {
+        int index = 0;
+        std::string_view url;
+        std::string_view title;
+        std::string_view baseUrl;
+        std::string_view bookUrl;
+        bool isVolume = false;
+        bool isVip = false;
+        bool isPay = false;
+    };
+
+    // 一个章节的只读视图，字符串指向列表的字符串区，列表修改后失效
+    class View {
+    public:
+        View(const ChapterList *list, const size_t position) : list(list), position(position) {
+        }
+
+        int index() const {
+            return list->indexes[position];
+        }
+
+        std::string_view url() const {
+            return list->string(list->urls[position]);
+        }
+
+        std::string_view title() const {
+            return list->string(list->titles[position]);
+        }
+
+        std::string_view baseUrl() const {
+            return list->string(list->shared[list->baseUrls[position]]);
+        }
+
+        std::string_view bookUrl() const {
+            return list->string(list->shared[list->bookUrls[position]]);
+        }
+
+        bool isVolume() const {
+            return list->flags[position] & Volume;
+        }
+
+        bool isVip() const {
+            return list->flags[position] & Vip;
+        }
+
+        bool isPay() const {
+            return list->flags[position] & Pay;
+        }
+
+        // 是否有常用字段以外的内容，如tag、start、变量等
+        bool hasExtra() const {
+            return list->flags[position] & Extra;
+        }
+
+        // 生成完整的章节
+        BookChapter toChapter() const;
+
+    private:
+        const ChapterList *list;
+        size_t position;
+    };
+
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = View;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = View;
+
+        Iterator() = default;
+
+        Iterator(const ChapterList *list, const size_t position) : list(list), position(position) {
+        }
+
+        View operator*() const {
+            return {list, position};
+        }
+
+        Iterator &operator++() {
+            position++;
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            const Iterator it = *this;
+            position++;
+            return it;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return position == other.position;
+        }
+
+    private:
+        const ChapterList *list = nullptr;
+        size_t position = 0;
+    };
+
+    ChapterList() = default;
+
+    explicit ChapterList(const std::vector<BookChapter> &chapters);
+
+    void push_back(const BookChapter &chapter);
+
+    void push_back(const Fields &fields);
+
+    /**
+     * @param chapters 章节数
+     * @param bytes 字符串区的字节数
+     */
+    void reserve(size_t chapters, size_t bytes);
+
+    size_t size() const {
+        return indexes.size();
+    }
+
+    bool empty() const {
+        return indexes.empty();
+    }
+
+    View operator[](const size_t position) const {
+        return {this, position};
+    }
+
+    Iterator begin() const {
+        return {this, 0};
+    }
+
+    Iterator end() const {
+        return {this, size()};
+    }
+
+    std::vector<BookChapter> toChapters() const;
+
+    // url为该值的第一个章节的位置
+    std::optional<size_t> find(std::string_view url) const;
+
+    // 标题包含keyword的章节的位置
+    std::vector<size_t> search(std::string_view keyword) const;
+
+    // 占用的内存（字节）
+    size_t memoryUsage() const;
+
+private:
+    enum Flag : uint8_t {
+        Volume = 1,
+        Vip = 2,
+        Pay = 4,
+        Extra = 8
+    };
+
+    // 较少使用的字段
+    struct Extras {
+        std::optional<std::string> resourceUrl;
+        std::optional<std::string> tag;
+        std::optional<std::string> wordCount;
+        std::optional<long> start;
+        std::optional<long> end;
+        std::optional<std::string> startFragmentId;
+        std::optional<std::string> endFragmentId;
+        std::optional<std::string> variable;
+        std::optional<std::string> titleMD5;
+    };
+
+    // 以string_view查找sharedIds
+    struct StringHash {
+        using is_transparent = void;
+
+        size_t operator()(const std::string_view s) const {
+            return std::hash<std::string_view>()(s);
+        }
+    };
+
+    std::string_view string(const StringRef ref) const {
+        return {arena.data() + ref.offset, ref.size};
+    }
+
+    StringRef add(std::string_view s);
+
+    // baseUrl与bookUrl在shared中的序号
+    uint32_t addShared(std::string_view s);
+
+    std::vector<int32_t> indexes;
+    std::vector<uint8_t> flags;
+    std::vector<StringRef> urls;
+    std::vector<StringRef> titles;
+    std::vector<uint32_t> baseUrls;
+    std::vector<uint32_t> bookUrls;
+    std::string arena;
+    std::vector<StringRef> shared;
+    std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<> > sharedIds;
+    std::vector<std::pair<uint32_t, Extras> > extras; // 按位置排列
+};
@@ -0,0 +1,168 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <booksource/chaptercolumns.h>
+#include <booksource/data.h>
+#include <booksource/rule.h>
+#include <booksource/threadpool.h>
+
+/**
+ * 目录解析，对应阅读(Legado)的BookChapterList
+ * 目录分为多页时按nextTocUrl规则获取其余的目录页：
+ * 1. 第一页的nextTocUrl只有一个地址时逐页串联下载，直到没有下一页或者地址已经访问过
+ * 2. 第一页的nextTocUrl有多个地址时，这些页面一起下载并解析，不再获取它们的下一页
+ */
+namespace BookChapterList {
+    /**
+     * 目录的指纹：按目录顺序的每个章节的url与标题的64位哈希，以及最后一个章节所在的目录页
+     * 每个章节只占24字节，用于增量刷新时判断章节是否已知，不需要保留完整的章节列表
+     */
+    class TocFingerprint {
+    public:
+        TocFingerprint() = default;
+
+        /**
+         * @param chapters 按目录顺序排列
+         * @param pageList 目录页是否由第一页的nextTocUrl一次列出，而不是逐页串联
+         */
+        explicit TocFingerprint(const std::vector<BookChapter> &chapters, bool pageList = false);
+
+        explicit TocFingerprint(const ChapterList &chapters, bool pageList = false);
+
+        size_t size() const {
+            return titles.size();
+        }
+
+        bool empty() const {
+            return titles.empty();
+        }
+
+        // url对应章节在目录中的序号，不是已知的章节时返回 std::nullopt
+        std::optional<size_t> find(const std::string &url) const;
+
+        // 序号为index的章节的标题是否为title
+        bool sameTitle(size_t index, const std::string &title) const;
+
+        // 最后一个章节所在的目录页
+        const std::string &lastPageUrl() const {
+            return lastPage;
+        }
+
+        bool isPageList() const {
+            return pageList;
+        }
+
+        // 在最后追加章节
+        void append(const std::vector<BookChapter> &chapters);
+
+        void append(const ChapterList &chapters);
+
+        static uint64_t hash(std::string_view s);
+
+    private:
+        // url、title与baseUrl由 get 取出，BookChapter与ChapterList::View共用
+        template<typename Chapters, typename Get>
+        void append(const Chapters &chapters, Get get);
+
+        std::vector<uint64_t> titles;
+        std::vector<std::pair<uint64_t, uint32_t> > sorted; // (url的哈希, 序号)，按哈希排序
+        std::string lastPage;
+        bool pageList = false;
+    };
+
+    // 增量刷新的结果
+    struct TocUpdate {
+        // incremental为 true 时只有新增的章节，否则为完整的目录
+        std::vector<BookChapter> chapters;
+        bool incremental = true;
+    };
+
+    // 目录中每一个章节的字段规则，只拆分一次
+    struct ChapterItemRules {
+        std::vector<SourceRule> name;
+        std::vector<SourceRule> url;
+        std::vector<SourceRule> isVolume;
+        std::vector<SourceRule> isVip;
+        std::vector<SourceRule> isPay;
+        std::vector<SourceRule> updateTime;
+        std::vector<SourceRule> nextTocUrl;
+
+        ChapterItemRules(AnalyzeRule &analyzeRule, const TocRule &tocRule);
+    };
+
+    // 规则结果表示的布尔值，空、"null"、"false"、"no"、"not"、"0"（不区分大小写）为 false
+    bool isTrue(const std::string &value);
+
+    // 当前内容上nextTocUrl规则的结果，去掉了与当前页相同的地址
+    std::vector<std::string> nextTocUrls(AnalyzeRule &analyzeRule, const ChapterItemRules &itemRules,
+                                         const std::string &redirectUrl);
+
+    // 在列表中的一项上执行章节规则，标题为空时返回 std::nullopt；index为该项在当前页中的序号
+    std::optional<BookChapter> analyzeItem(
+        const Book &book,
+        AnalyzeRule &analyzeRule,
+        const ChapterItemRules &itemRules,
+        const RuleContent &item,
+        size_t index,
+        const std::string &baseUrl,
+        const std::string &redirectUrl
+    );
+
+    // 下一页目录的地址，在解析当前页的章节之前调用，可以在解析的同时开始下载下一页
+    using NextUrlHandler = std::function<void(const std::vector<std::string> &nextUrls)>;
+
+    /**
+     * 解析一页目录，itemRules需要在setContent()之后拆分，规则的模式取决于内容是否为json
+     * @param onNextUrls 不为空时获取nextTocUrl规则的结果，去掉了与当前页相同的地址
+     * @return 章节的index还没有设置
+     */
+    std::vector<BookChapter> analyzePage(
+        const Book &book,
+        AnalyzeRule &analyzeRule,
+        const std::string &listRule,
+        const ChapterItemRules &itemRules,
+        const std::string &baseUrl,
+        const std::string &redirectUrl,
+        const std::string &body,
+        const NextUrlHandler &onNextUrls = nullptr
+    );
+
+    /**
+     * 解析目录，结果按阅读顺序排列，按url去重，index为在目录中的序号
+     * 同时更新书籍的最新章节、章节总数与新章节数量
+     * @param baseUrl 目录页地址
+     * @param redirectUrl 重定向后的目录页地址
+     * @param body 目录页内容
+     * @param pool 不为空时，多个目录页在线程池中并发下载与解析；串联的目录页在解析当前页的同时下载下一页。
+     *             不能在pool的线程中调用
+     * @param fingerprint 不为空时写入结果的指纹，用于之后的增量刷新
+     */
+    std::vector<BookChapter> analyzeChapterList(
+        BookSource &bookSource,
+        Book &book,
+        RuleData &ruleData,
+        const std::string &baseUrl,
+        const std::string &redirectUrl,
+        const std::optional<std::string> &body,
+        ThreadPool *pool = nullptr,
+        TocFingerprint *fingerprint = nullptr
+    );
+
+    /**
+     * 增量刷新目录，只解析新增的章节，结果的index从已知章节的数量开始
+     * 正序的目录从上次最后一个章节所在的目录页开始，从最后一项向前解析，遇到已知的章节时停止，
+     * 然后继续下载之后新增的目录页，整页都是已知章节时停止；倒序的目录从第一页开始向后解析，遇到已知的章节时停止
+     * 找不到已知的章节、已知的最新章节标题改变或者书籍设置为倒序显示目录时，按analyzeChapterList()完整刷新
+     * 只处理在目录最后追加的章节，已有章节的删除与调整需要完整刷新
+     * @param fingerprint 上次刷新的目录指纹，刷新后更新为新的目录
+     */
+    TocUpdate updateChapterList(
+        BookSource &bookSource,
+        Book &book,
+        RuleData &ruleData,
+        TocFingerprint &fingerprint,
+        ThreadPool *pool = nullptr
+    );
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <booksource/ruledata.h>
+
+/**
+ * 章节正文的本地存储：每本书一个只追加的段文件，每一章一条压缩后的记录
+ * 1. 打开时扫描记录头建立 url哈希 -> 记录 的索引，读取时通过mmap直接定位并解压，不需要读取整个文件
+ * 2. 写入前几章后用它们训练一个字典（各章共有的片段），之后的章节以字典为前缀压缩，单章也能有较高的压缩率
+ * 3. 重新下载的章节追加新记录，旧记录失效；失效部分超过一定比例时整理（compact）文件，
+ *    同时用字典重新压缩训练字典之前写入的章节
+ * 4. 写入中断留下的不完整记录在下次打开时截掉
+ * 线程安全，解压在锁外进行
+ */
+class ChapterStore {
+public:
+    struct Options {
+        size_t dictionaryChapters = 8;       // 用前几章训练字典
+        size_t dictionarySize = 16 * 1024;   // 字典的最大字节数
+        double compactRatio = 0.5;           // 失效记录占文件的比例超过该值时自动整理
+        size_t compactMinSize = 64 * 1024;   // 文件小于该值时不自动整理
+    };
+
+    // 一章的记录信息
+    struct ChapterInfo {
+        int index;
+        std::string url;
+        size_t size;           // 正文的字节数
+        size_t compressedSize;
+    };
+
+    /**
+     * 打开或者创建段文件
+     * @throws std::runtime_error 文件无法打开或者不是段文件
+     */
+    ChapterStore(std::string file, Options options);
+
+    explicit ChapterStore(std::string file) : ChapterStore(std::move(file), Options()) {
+    }
+
+    ~ChapterStore();
+
+    ChapterStore(const ChapterStore &) = delete;
+
+    ChapterStore &operator=(const ChapterStore &) = delete;
+
+    /**
+     * 一本书的段文件名，由书籍地址的哈希得到
+     */
+    static std::string fileName(const std::string &bookUrl);
+
+    /**
+     * 保存一章的正文，已经保存过的章节（url相同）被替换
+     * @throws std::runtime_error 写入失败
+     */
+    void put(const BookChapter &chapter, std::string_view content);
+
+    // url可以是任意的字符串，用于保存章节以外的内容（见DiskRuleData）
+    void put(const std::string &url, int index, std::string_view content);
+
+    // 没有保存或者记录损坏时返回 std::nullopt
+    std::optional<std::string> get(const BookChapter &chapter);
+
+    std::optional<std::string> get(const std::string &url);
+
+    bool contains(const std::string &url);
+
+    // 删除一章，没有保存时返回 false
+    bool remove(const std::string &url);
+
+    // 已保存的章节数
+    size_t size();
+
+    // 已保存的章节，按index排列
+    std::vector<ChapterInfo> chapters();
+
+    // 段文件当前的字节数
+    size_t fileSize();
+
+    // 失效记录的字节数
+    size_t garbageSize();
+
+    bool hasDictionary();
+
+    /**
+     * 整理文件：只保留有效的记录并按index排列，训练字典之前写入的章节用字典重新压缩
+     * @throws std::runtime_error 写入失败，此时原文件不变
+     */
+    void compact();
+
+private:
+    struct Mapping;
+
+    struct Entry {
+        uint64_t offset;     // 记录头在文件中的位置
+        uint32_t length;     // 整条记录的字节数
+        int32_t index;
+        uint32_t rawSize;
+        uint32_t compressedSize;
+        uint8_t flags;
+    };
+
+    void open();
+
+    void close();
+
+    // 扫描记录建立索引，返回有效部分的长度
+    uint64_t scan(const Mapping &mapping);
+
+    // 映射覆盖end之前的内容
+    std::shared_ptr<const Mapping> mappingFor(uint64_t end);
+
+    std::optional<std::string> read(const Entry &entry, const std::shared_ptr<const Mapping> &mapping,
+                                    const std::shared_ptr<const std::string> &dict) const;
+
+    void append(const std::string &record);
+
+    // 章节数达到dictionaryChapters时训练并写入字典
+    void trainDictionary();
+
+    void compactLocked();
+
+    const std::string file;
+    const Options options;
+
+    std::mutex mutex;
+    int fd = -1;
+    uint64_t end = 0;     // 文件有效部分的长度，新记录写在这里
+    uint64_t garbage = 0;
+    std::shared_ptr<const Mapping> mapping;
+    std::shared_ptr<const std::string> dict;
+    bool trained = false; // 已经写入字典记录（字典可能为空）
+    std::unordered_map<uint64_t, Entry> entries; // url的哈希 -> 最新的记录
+};
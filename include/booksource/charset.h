@@ -0,0 +1,117 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <optional>
+
+/**
+ * 字符集检测与转码
+ * 网页内容统一转为 UTF-8 后再交给规则解析；请求参数则按书源指定的字符集进行编码
+ */
+namespace Charset {
+
+    enum class Encoding {
+        UTF8, GBK, GB18030, Big5, UTF16LE, UTF16BE
+    };
+
+    /**
+     * 根据字符集名称获取对应的编码，名称不区分大小写，如："gbk"、"GB2312"、"utf-8"
+     * @return 不支持的字符集返回 std::nullopt
+     */
+    std::optional<Encoding> fromName(std::string_view name);
+
+    // 编码对应的规范名称，如："UTF-8"、"GBK"
+    const char *name(Encoding encoding);
+
+    /**
+     * 从 Content-Type 中解析字符集，如：text/html; charset=gbk
+     */
+    std::optional<Encoding> fromContentType(std::string_view contentType);
+
+    /**
+     * 根据 BOM 判断编码
+     * @param bomLength 输出 BOM 的字节数
+     */
+    std::optional<Encoding> fromBom(std::string_view data, size_t &bomLength);
+
+    /**
+     * 从 html 的 <meta charset="xx"> 或者 <meta http-equiv="Content-Type" content="...; charset=xx">
+     * 中解析字符集，只扫描前 4KB 内容
+     */
+    std::optional<Encoding> fromMeta(std::string_view html);
+
+    // 检查是否为合法的 UTF-8 字节序列
+    bool isValidUtf8(std::string_view data);
+
+    /**
+     * 检测响应内容的编码，优先级：指定的字符集 > BOM > Content-Type > meta标签
+     * 全部缺失时，若内容不是合法的 UTF-8 则按 GB18030 处理，否则为 UTF-8
+     */
+    Encoding detect(
+        std::string_view body,
+        std::string_view contentType = {},
+        const std::optional<std::string> &charset = std::nullopt
+    );
+
+    /**
+     * 将给定编码的字节转为 UTF-8，无法解码的字节替换为 U+FFFD，BOM 会被去除
+     */
+    std::string toUtf8(std::string_view data, Encoding encoding);
+
+    /**
+     * 分段转码，用于边下载边解析
+     * 编码的确定顺序与 detect() 相同；只能由 meta 标签或者内容本身确定编码时，先缓存前 4KB 的内容
+     * 每次只转换到最后一个小于 0x40 的非数字字节（如 '<'、'>'、'"'、空白）为止，
+     * 这些字节不会出现在 GBK、GB18030、Big5、UTF-8 多字节字符的中间，剩余的字节留到下一段
+     */
+    class StreamDecoder {
+    public:
+        explicit StreamDecoder(std::string_view contentType = {}, const std::optional<std::string> &charset = std::nullopt);
+
+        // 追加一段原始字节，返回可以转换的部分，编码尚未确定时返回空字符串
+        std::string feed(std::string_view data);
+
+        // 内容结束，返回剩余的部分
+        std::string finish();
+
+        /**
+         * 编码是根据前 4KB 推测的 UTF-8，但之后出现了不合法的 UTF-8 字节，
+         * 此时 detect() 对完整内容的结果为 GB18030，已经转换的内容与完整转码的结果不同
+         */
+        bool mismatched() const {
+            return mismatch;
+        }
+
+        // UTF-16 不能按字节分段转换
+        bool supported() const {
+            return !encoding || (*encoding != Encoding::UTF16LE && *encoding != Encoding::UTF16BE);
+        }
+
+    private:
+        std::string contentType;
+        std::optional<Encoding> encoding;
+        bool guessed = false;
+        bool mismatch = false;
+        std::string pending;
+
+        // 确定编码，还需要更多内容时返回false
+        bool resolve(bool eof);
+
+        std::string convert(size_t length);
+    };
+
+    /**
+     * 将 UTF-8 字符串编码为指定的字符集，无法编码的字符替换为 '?'
+     */
+    std::string fromUtf8(std::string_view utf8, Encoding encoding);
+
+    /**
+     * 以指定的字符集对字符串进行 url 编码，已编码（%XX）的部分保持不变
+     * @param form 为 true 时按 application/x-www-form-urlencoded 规则编码，空格编码为 '+'
+     */
+    std::string urlEncode(std::string_view str, Encoding encoding, bool form = false);
+
+    /**
+     * 对 a=1&b=2 形式的参数串逐个编码 key 与 value，分隔符 '&' 与 '=' 保持不变
+     */
+    std::string encodeParams(std::string_view params, Encoding encoding, bool form = false);
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <booksource/data.h>
+#include <booksource/rule.h>
+#include <booksource/threadpool.h>
+
+/**
+ * 正文解析，对应阅读(Legado)的BookContent
+ * 正文分为多页时按nextContentUrl规则获取其余的页面：
+ * 1. 只有一个下一页地址时逐页串联下载，先取下一页地址再解析正文，解析当前页的同时下载下一页；
+ *    下一页是下一章、没有下一页或者地址已经访问过时停止
+ * 2. 第一页有多个下一页地址时，这些页面一起下载并解析，不再获取它们的下一页
+ * 每一页的文本依次追加到同一个字符串中
+ */
+namespace BookContent {
+    /**
+     * 把正文的html转换为文本追加到out，对应阅读的HtmlFormatter.formatKeepImg()：
+     * 换行的标签（div、p、br等）转换为换行，保留图片，去掉其余的标签与注释，
+     * 每一段去掉首尾的空白后以"　　"缩进，最后解码html实体
+     * @param pageUrl 图片地址按它转换为绝对地址
+     */
+    void appendText(std::string &out, std::string_view html, const std::string &pageUrl = "");
+
+    std::string formatHtml(std::string_view html, const std::string &pageUrl = "");
+
+    // 正文的规则，只拆分一次
+    struct ContentRules {
+        std::vector<SourceRule> content;
+        std::vector<SourceRule> nextContentUrl;
+
+        ContentRules(AnalyzeRule &analyzeRule, const ContentRule &contentRule);
+    };
+
+    // 当前内容上nextContentUrl规则的结果，去掉了当前页与下一章的地址
+    std::vector<std::string> nextContentUrls(AnalyzeRule &analyzeRule, const ContentRules &rules,
+                                             const std::string &redirectUrl,
+                                             const std::optional<std::string> &nextChapterUrl);
+
+    // 下一页正文的地址，在解析当前页的正文之前调用，可以在解析的同时开始下载下一页
+    using NextUrlHandler = std::function<void(const std::vector<std::string> &nextUrls)>;
+
+    /**
+     * 解析一页正文并把文本追加到out，rules需要在setContent()之后拆分，规则的模式取决于内容是否为json
+     * @param onNextUrls 不为空时获取nextContentUrl规则的结果，见nextContentUrls()
+     */
+    void analyzePage(
+        AnalyzeRule &analyzeRule,
+        const ContentRules &rules,
+        const std::string &baseUrl,
+        const std::string &redirectUrl,
+        const std::string &body,
+        const std::optional<std::string> &nextChapterUrl,
+        std::string &out,
+        const NextUrlHandler &onNextUrls = nullptr
+    );
+
+    /**
+     * 解析正文，多页的文本以换行连接；title规则有结果时更新章节标题，
+     * replaceRegex在完整的正文上执行，执行前去掉每一行首尾的空白，执行后每一行以"　　"缩进
+     * @param baseUrl 章节的地址
+     * @param redirectUrl 重定向后的章节地址
+     * @param body 章节第一页的内容
+     * @param nextChapterUrl 下一章的绝对地址，下一页为该地址时停止
+     * @param pool 不为空时，多个正文页在线程池中并发下载与解析；串联的正文页在解析当前页的同时下载下一页。
+     *             不能在pool的线程中调用
+     */
+    std::string analyzeContent(
+        BookSource &bookSource,
+        BookChapter &chapter,
+        RuleData &ruleData,
+        const std::string &baseUrl,
+        const std::string &redirectUrl,
+        const std::optional<std::string> &body,
+        const std::optional<std::string> &nextChapterUrl = std::nullopt,
+        ThreadPool *pool = nullptr
+    );
+}
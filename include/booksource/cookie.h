@@ -0,0 +1,94 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <optional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+/**
+ * Cookie存储：按主域名索引，线程安全
+ * 可选持久化到磁盘，文件使用 Netscape cookie 格式（与curl的cookie文件兼容），首次访问时才加载
+ */
+class CookieJar {
+public:
+    struct Cookie {
+        std::string name;
+        std::string value;
+        std::string domain;     // 不含前导的'.'
+        std::string path = "/";
+        long expires = 0;       // 过期时间（秒），0 表示会话cookie
+        bool hostOnly = true;   // 没有Domain属性时只发送给完全相同的主机
+        bool secure = false;
+        bool httpOnly = false;
+    };
+
+    /**
+     * @param file 持久化文件路径，为空时只保存在内存中
+     */
+    explicit CookieJar(std::optional<std::string> file = std::nullopt);
+
+    ~CookieJar();
+
+    CookieJar(const CookieJar &) = delete;
+
+    CookieJar &operator=(const CookieJar &) = delete;
+
+    /**
+     * 获取书源对应的CookieJar，同一个书源（getKey()相同）共享同一个实例
+     */
+    static std::shared_ptr<CookieJar> forSource(const std::string &sourceKey);
+
+    /**
+     * 设置持久化目录，之后通过forSource()创建的CookieJar会保存到该目录下，为空时不进行持久化
+     */
+    static void setStorageDir(const std::optional<std::string> &dir);
+
+    // 将全部CookieJar的修改写入磁盘
+    static void flushAll();
+
+    /**
+     * 获取发送给url的cookie，格式为：a=1; b=2
+     */
+    std::string getCookie(const std::string &url);
+
+    /**
+     * 保存响应中的一条 Set-Cookie
+     */
+    void saveFromResponse(const std::string &url, const std::string &setCookie);
+
+    /**
+     * 以 a=1; b=2 的形式设置url所在主机的cookie，同名cookie会被替换
+     */
+    void setCookie(const std::string &url, const std::string &cookies);
+
+    // 删除url所在主域名下的全部cookie
+    void removeCookie(const std::string &url);
+
+    void clear();
+
+    // 当前保存的cookie数量（含已过期但尚未清理的）
+    size_t size();
+
+    /**
+     * 写入磁盘，没有修改或者没有设置持久化文件时直接返回
+     * @return 写入失败时返回 false
+     */
+    bool flush();
+
+private:
+    std::optional<std::string> file;
+    std::once_flag loadFlag;
+    std::shared_mutex mutex;
+    // 主域名 -> cookie列表，如：www.example.com 与 m.example.com 的cookie都保存在 example.com 下
+    std::unordered_map<std::string, std::vector<Cookie> > cookies;
+    bool dirty = false;
+
+    void ensureLoaded();
+
+    void load();
+
+    // 添加或替换cookie，调用者需要持有写锁
+    void put(Cookie cookie);
+};
@@ -0,0 +1,102 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <regex>
+#include <booksource/html.h>
+
+/**
+ * css选择器：编译一次，之后在任意文档上重复执行
+ * 支持：
+ * 1. 标签、*、.class、#id
+ * 2. 属性：[attr]、[^attrPrefix]、[attr=v]、[attr^=v]、[attr$=v]、[attr*=v]、[attr|=v]、[attr~=regex]，
+ *    属性值的比较不区分大小写，与jsoup一致
+ * 3. 组合器：后代（空格）、子元素（>）、相邻兄弟（+）、兄弟（~），以及','分隔的多个选择器
+ * 4. 伪类：:nth-child(an+b)、:nth-last-child、:nth-of-type、:nth-last-of-type、:first-child、:last-child、
+ *    :first-of-type、:last-of-type、:only-child、:only-of-type、:empty、:root、:not(s)、:has(s)、
+ *    :contains(text)、:containsOwn(text)、:matches(regex)、:matchesOwn(regex)、:eq(n)、:lt(n)、:gt(n)
+ *
+ * 匹配从右往左进行，遍历文档时维护祖先元素的布隆过滤器，祖先中不可能存在所需的标签、id、class时直接跳过
+ */
+namespace Css {
+
+    class Selector;
+
+    enum class Combinator : uint8_t {
+        Descendant, Child, Adjacent, Sibling
+    };
+
+    // 复合选择器中的单个条件
+    struct Test {
+        enum class Kind : uint8_t {
+            Class, Id, HasAttr, AttrPrefix, AttrEquals, AttrStarts, AttrEnds, AttrContains, AttrDash, AttrRegex,
+            NthChild, NthLastChild, NthOfType, NthLastOfType, OnlyChild, OnlyOfType, Empty, Root,
+            Not, Has, Contains, ContainsOwn, Matches, MatchesOwn, IndexEquals, IndexLess, IndexGreater
+        };
+
+        Kind kind = Kind::Class;
+        std::string name = "";  // 类名、id、属性名
+        std::string value = ""; // 属性值（小写）、文本（小写）
+        int a = 0;              // an+b，或者:eq(n)等中的n
+        int b = 0;
+        std::shared_ptr<const Selector> sub = nullptr;
+        std::shared_ptr<const std::regex> regex = nullptr;
+    };
+
+    // 复合选择器，如 div.item[data-id]:nth-child(2)
+    struct Compound {
+        std::string tag; // 小写标签名，为空表示任意元素
+        std::vector<Test> tests;
+        Combinator combinator = Combinator::Descendant; // 与左侧复合选择器的关系
+    };
+
+    // 由组合器连接的选择器，如 div.list > li a
+    struct Complex {
+        std::vector<Compound> compounds; // 从左到右
+        std::vector<uint32_t> ancestorHashes; // 祖先元素必须具有的特征，用于布隆过滤器
+    };
+
+    /**
+     * 复合选择器中是否只有标签、class、id与属性条件，这些条件只需要元素自身的开始标签就能判断
+     */
+    bool isLocal(const Compound &compound);
+
+    // 只根据元素自身的标签名与属性判断是否匹配，compound需要满足isLocal()
+    bool matchesLocal(const Compound &compound, const Html::Node &node);
+
+    class Selector {
+    public:
+        /**
+         * 编译选择器，语法错误时抛出 std::invalid_argument
+         */
+        static std::shared_ptr<const Selector> parse(const std::string &css);
+
+        /**
+         * 与parse()相同，但以css为key缓存编译结果，规则中的选择器只编译一次
+         * 语法错误时返回nullptr
+         */
+        static std::shared_ptr<const Selector> compile(const std::string &css);
+
+        /**
+         * 在root及其全部后代中查找匹配的元素，结果按文档顺序排列
+         * root之外的祖先与兄弟不参与匹配，与jsoup的Element.select()一致
+         */
+        Html::Elements select(const Html::Node *root) const;
+
+        // 第一个匹配的元素，没有时返回nullptr
+        const Html::Node *selectFirst(const Html::Node *root) const;
+
+        // 判断元素是否匹配，root为匹配范围的根节点
+        bool matches(const Html::Node *node, const Html::Node *root) const;
+
+        const std::vector<Complex> &getGroups() const {
+            return groups;
+        }
+
+    private:
+        std::vector<Complex> groups;
+
+        template<typename Visitor>
+        void traverse(const Html::Node *root, Visitor &&visitor) const;
+    };
+}
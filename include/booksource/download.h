@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <booksource/data.h>
+#include <booksource/rule.h>
+
+/**
+ * 整本书的批量下载：多个书源、多本书的章节在工作窃取的线程中下载与解析
+ * 每个线程优先处理分配给自己的书（从第一章开始），空闲时从其它线程的队列末尾窃取章节
+ * 书源的concurrentRate各自独立限制，取章节时跳过暂时需要等待的书源，一个慢的书源不会占住全部线程
+ * 设置检查点文件时每完成一章记录一行，中断后再次运行跳过已完成的章节
+ */
+class BatchDownloader {
+public:
+    struct Options {
+        size_t threads = std::thread::hardware_concurrency();
+        std::optional<std::string> checkpointFile = std::nullopt;
+    };
+
+    // 每个书源的下载统计
+    struct SourceStats {
+        std::string source;  // 书源的getKey()
+        size_t chapters = 0; // 成功的章节数
+        size_t failures = 0;
+        size_t bytes = 0;    // 正文的字节数
+        double seconds = 0;  // 第一章开始到最后一章结束的时间
+
+        double chaptersPerSecond() const {
+            return seconds > 0 ? static_cast<double>(chapters) / seconds : 0;
+        }
+    };
+
+    /**
+     * 完成一章时在下载线程中调用，可能被多个线程同时调用；抛出异常时该章按失败处理，不记录检查点
+     */
+    using ChapterHandler = std::function<void(const Book &book, const BookChapter &chapter,
+                                              const std::string &content)>;
+
+    BatchDownloader(ChapterHandler onChapter, Options options);
+
+    explicit BatchDownloader(ChapterHandler onChapter) : BatchDownloader(std::move(onChapter), Options()) {
+    }
+
+    ~BatchDownloader();
+
+    BatchDownloader(const BatchDownloader &) = delete;
+
+    BatchDownloader &operator=(const BatchDownloader &) = delete;
+
+    /**
+     * 加入一本书的章节，书源与规则数据由调用方持有，在run()结束前有效
+     * @param chapters 完整的目录，用于确定每一章的下一章地址
+     */
+    void addBook(BookSource &bookSource, Book book, std::vector<BookChapter> chapters, RuleData &ruleData);
+
+    /**
+     * 下载已加入的书中没有完成的章节，全部完成或者被cancel()中断后返回
+     * 失败与中断的章节不记录检查点，下一次运行时重新下载
+     */
+    void run();
+
+    // 从其它线程中断run()：等待中与之后的请求不再发出
+    void cancel();
+
+    // 已经完成的章节数，包括从检查点恢复的
+    size_t completedCount();
+
+    // 按书源的统计，按书源加入的顺序排列
+    std::vector<SourceStats> stats();
+
+private:
+    struct Source;
+    struct BookTask;
+    struct Job;
+    struct BookQueue;
+    class Worker;
+
+    // 在worker的队列中取一章，没有可以立即开始的章节时从其它队列窃取；都没有时返回最短的等待时间
+    std::optional<Job> take(size_t worker, int64_t &wait);
+
+    // 下载并解析一章，成功时交给onChapter并记录检查点
+    void download(const Job &job);
+
+    static std::string checkpointKey(const Book &book, const BookChapter &chapter);
+
+    ChapterHandler onChapter;
+    Options options;
+    std::vector<std::unique_ptr<Source> > sources;
+    std::vector<std::unique_ptr<BookTask> > books;
+    std::vector<std::unique_ptr<Worker> > workers;
+    std::atomic<size_t> remaining = 0;
+    std::atomic<bool> cancelled = false;
+
+    std::mutex mutex; // 保护sources的统计、done与checkpoint
+    std::unordered_set<std::string> done;
+    std::ofstream checkpoint;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <shared_mutex>
+#include <mutex>
 #include <quickjs/quickjs.h>
 #include <string>
 #include <functional>
@@ -368,24 +369,29 @@ private:
     };
 
     // 确保Class已经被注册了
+    // class_id全局唯一，Class需要在每个线程的JSRuntime中注册，原型需要在每个JSContext中设置（reset()后的新Context也一样）
     static void ensureClassInit(JSContext *ctx) {
         JSRuntime *rt = JS_GetRuntime(ctx);
-        if (s_inited)
-            return;
-
-        JS_NewClassID(&s_classId); // 申请一个新的class_id，保证唯一，用于区分不同的class
-
-        JSClassDef def{};
-        def.class_name = s_className.c_str();
-
-        if (JS_NewClass(rt, s_classId, &def) < 0) {
-            // 这里抛异常比静默失败要好
-            throw std::runtime_error("JS_NewClass failed for " + s_className);
+        std::call_once(s_classIdOnce, [] {
+            JS_NewClassID(&s_classId); // 申请一个新的class_id，保证唯一，用于区分不同的class
+        });
+
+        if (!JS_IsRegisteredClass(rt, s_classId)) {
+            JSClassDef def{};
+            def.class_name = s_className.c_str();
+
+            if (JS_NewClass(rt, s_classId, &def) < 0) {
+                // 这里抛异常比静默失败要好
+                throw std::runtime_error("JS_NewClass failed for " + s_className);
+            }
         }
 
-        build(ctx);
-
-        s_inited = true;
+        const JSValue proto = JS_GetClassProto(ctx, s_classId);
+        const bool hasProto = JS_IsObject(proto);
+        JS_FreeValue(ctx, proto);
+        if (!hasProto) {
+            build(ctx);
+        }
     }
 
     template<typename Return, typename Method, size_t... I>
@@ -467,7 +473,7 @@ private:
 
 private:
     static inline JSClassID s_classId{0};
-    static inline bool s_inited{false};
+    static inline std::once_flag s_classIdOnce{};
     static inline std::string s_className{"NativeObject"};
     static inline std::vector<FieldBase> s_fields{};
     static inline std::vector<MethodBase> s_methods{};
@@ -0,0 +1,263 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <functional>
+
+/**
+ * html解析：容错的html分词器与树构建器
+ * 全部节点与属性都从文档自己的Arena中分配，标签名、属性值与文本尽量直接引用原始网页内容，
+ * 只有需要转换（大写标签名、实体解码）的部分才会复制到Arena中
+ * 文档解析完成后只读，可以在多个线程之间共享
+ */
+namespace Html {
+
+    /**
+     * 按块分配的内存池，只能整体释放
+     * 只用于分配平凡析构的对象
+     */
+    class Arena {
+    public:
+        explicit Arena(size_t blockSize = 64 * 1024) : blockSize(blockSize) {
+        }
+
+        Arena(const Arena &) = delete;
+
+        Arena &operator=(const Arena &) = delete;
+
+        void *allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+        template<typename T, typename... Args>
+        T *create(Args &&... args) {
+            static_assert(std::is_trivially_destructible_v<T>, "Arena only supports trivially destructible types");
+            return new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        template<typename T>
+        T *allocateArray(size_t n) {
+            static_assert(std::is_trivially_destructible_v<T>, "Arena only supports trivially destructible types");
+            auto *p = static_cast<T *>(allocate(sizeof(T) * n, alignof(T)));
+            for (size_t i = 0; i < n; i++) new(p + i) T();
+            return p;
+        }
+
+        // 复制字符串到Arena中
+        std::string_view copy(std::string_view str);
+
+        // 已分配的内存块数量
+        size_t blockCount() const {
+            return blocks.size();
+        }
+
+    private:
+        std::vector<std::unique_ptr<char[]> > blocks;
+        char *cur = nullptr;
+        size_t remaining = 0;
+        size_t blockSize;
+    };
+
+    enum class NodeType : uint8_t {
+        Document, Element, Text, Data, Comment
+    };
+
+    struct Attribute {
+        std::string_view name;  // 小写
+        std::string_view value; // 已解码实体
+    };
+
+    struct Node;
+
+    using Elements = std::vector<const Node *>;
+
+    struct Node {
+        NodeType type = NodeType::Element;
+        bool block = false;                 // 是否为块级元素，影响text()的空格
+        uint32_t index = 0;                 // 在文档中的先序遍历序号
+        std::string_view name;              // 元素为小写标签名
+        std::string_view value;             // Text/Data/Comment 的内容，Data为script、style的原始内容
+        Attribute *attributes = nullptr;
+        uint32_t attributeCount = 0;
+        Node *parent = nullptr;
+        Node *firstChild = nullptr;
+        Node *lastChild = nullptr;
+        Node *prev = nullptr;
+        Node *next = nullptr;
+
+        bool isElement() const {
+            return type == NodeType::Element;
+        }
+
+        bool nameIs(const std::string_view tag) const {
+            return type == NodeType::Element && name == tag;
+        }
+
+        // 属性不存在时返回空字符串
+        std::string_view attr(std::string_view key) const;
+
+        bool hasAttr(std::string_view key) const;
+
+        bool hasClass(std::string_view className) const;
+
+        std::string_view id() const {
+            return attr("id");
+        }
+
+        const Node *firstElementChild() const;
+
+        const Node *nextElementSibling() const;
+
+        const Node *previousElementSibling() const;
+
+        // 全部子元素
+        Elements children() const;
+
+        /**
+         * 元素及其全部后代的文本，空白字符合并为一个空格，块级元素之间以空格分隔，与jsoup的Element.text()一致
+         */
+        std::string text() const;
+
+        // 元素自身（不含后代元素）的文本
+        std::string ownText() const;
+
+        // 文本节点的内容，合并空白字符
+        std::string textNodeText() const;
+
+        // 全部直接子文本节点
+        std::vector<const Node *> textNodes() const;
+
+        // script、style以及注释中的内容
+        std::string data() const;
+
+        std::string outerHtml() const;
+
+        // 元素内部的html
+        std::string html() const;
+
+        /**
+         * 将outerHtml追加到out中
+         * @param skipScript 为 true 时跳过script与style元素
+         */
+        void appendOuterHtml(std::string &out, bool skipScript = false) const;
+    };
+
+    class Document {
+    public:
+        /**
+         * 解析html，文档持有html的所有权，节点中的字符串直接引用其中的内容
+         * @param xml 为 true 时按xml解析：保留标签名大小写，不进行html的隐式闭合
+         */
+        static std::shared_ptr<const Document> parse(std::string html, bool xml = false);
+
+        explicit Document(std::string html);
+
+        Document(const Document &) = delete;
+
+        Document &operator=(const Document &) = delete;
+
+        const Node *root() const {
+            return rootNode;
+        }
+
+        const std::string &source() const {
+            return html;
+        }
+
+        size_t nodeCount() const {
+            return nodes;
+        }
+
+        const Arena &getArena() const {
+            return arena;
+        }
+
+    private:
+        friend class Parser;
+        std::string html;
+        Arena arena;
+        Node *rootNode = nullptr;
+        size_t nodes = 0;
+    };
+
+    /**
+     * html的增量解析，用于边下载边解析
+     * 不建树，只维护打开的元素栈；隐式闭合、void元素、script等原始文本的规则与Document::parse()相同，
+     * 因此每个元素在原文中的开始与结束位置与完整解析的结果一致
+     * 每次只解析已经完整到达的标签，不完整的部分留到下一次feed()
+     */
+    class StreamParser {
+    public:
+        /**
+         * 元素开始，element只有标签名与属性，回调返回后失效
+         * @param depth 元素在打开的元素栈中的位置，文档根节点为0
+         * @param begin 开始标签在整个内容中的位置
+         */
+        using OpenHandler = std::function<void(const Node &element, size_t depth, size_t begin)>;
+
+        /**
+         * 元素结束
+         * @param end 元素在整个内容中的结束位置：由自身的结束标签闭合时为结束标签之后，
+         *            被其他标签隐式闭合时为该标签的开始位置，内容结束时为内容的长度
+         */
+        using CloseHandler = std::function<void(size_t depth, size_t end)>;
+
+        StreamParser(OpenHandler onOpen, CloseHandler onClose);
+
+        // 追加一段内容并解析其中完整的部分
+        void feed(std::string_view data);
+
+        // 内容结束，闭合全部未闭合的元素
+        void finish();
+
+        // 整个内容中 [begin, end) 的部分，begin不能小于已经丢弃的位置
+        std::string_view slice(size_t begin, size_t end) const;
+
+        // 之后不再需要offset之前的内容，可以丢弃以节省内存
+        void release(size_t offset);
+
+        // 已经收到的内容的长度
+        size_t size() const {
+            return base + buffer.size();
+        }
+
+    private:
+        OpenHandler onOpen;
+        CloseHandler onClose;
+        std::string buffer;
+        size_t base = 0;     // buffer[0]在整个内容中的位置
+        size_t pos = 0;      // buffer中下一个待解析的位置
+        size_t released = 0;
+        std::vector<std::string> stack; // 打开的元素的标签名，第0个为文档根节点
+        std::string rawTag;  // 正在等待结束标签的script、textarea等
+        std::vector<std::string> attrNames;
+        std::vector<std::string> attrValues;
+        std::vector<Attribute> attrs;
+
+        void parse(bool eof);
+
+        // 解析一个标签，标签不完整且内容尚未结束时返回false
+        bool parseStartTag(size_t tagStart, bool eof, size_t &next);
+
+        bool parseEndTag(size_t tagStart, bool eof, size_t &next);
+
+        void openElement(std::string_view name, uint8_t flags, bool selfClosing, size_t begin, size_t end);
+
+        // 闭合栈中size之后的元素
+        void closeTo(size_t size, size_t end);
+    };
+
+    /**
+     * 解码html实体，如：&amp; &#x4E2D; &nbsp;
+     * @param attribute 是否为属性值，属性值中不以';'结尾且后面跟着字母数字或'='的实体不解码
+     */
+    std::string decodeEntities(std::string_view str, bool attribute = false);
+
+    // 转义文本中的 & < > 以及不换行空格
+    void escapeText(std::string &out, std::string_view text, bool attribute = false);
+
+    // 合并空白字符后追加到out，out末尾已经是空白时去掉开头的空白
+    void appendNormalisedText(std::string &out, std::string_view text);
+}
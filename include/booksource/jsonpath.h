@@ -0,0 +1,321 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <cstdint>
+#include <functional>
+
+/**
+ * json的按需解析与JSONPath
+ * 解析时只做一次结构扫描，把每个值的类型、在原文中的位置以及子树的结束位置记录到tape中，
+ * 字符串与数字在读取时才解码，跳过一个子树是O(1)的
+ * 文档解析完成后只读，可以在多个线程之间共享，Value只是文档中的位置，复制没有开销
+ */
+namespace JsonPath {
+
+    class Document;
+
+    class Value {
+    public:
+        enum class Type : uint8_t {
+            Null, False, True, Number, String, Array, Object
+        };
+
+        Value() = default;
+
+        Value(const Document *document, const uint32_t index) : document(document), index(index) {
+        }
+
+        // 是否指向文档中的值，查找失败时返回的Value无效
+        bool valid() const {
+            return document != nullptr;
+        }
+
+        Type type() const;
+
+        bool isNull() const {
+            return type() == Type::Null;
+        }
+
+        bool isArray() const {
+            return type() == Type::Array;
+        }
+
+        bool isObject() const {
+            return type() == Type::Object;
+        }
+
+        bool isString() const {
+            return type() == Type::String;
+        }
+
+        bool isNumber() const {
+            return type() == Type::Number;
+        }
+
+        // 数组元素或者对象成员的数量
+        size_t size() const;
+
+        // 对象成员，不存在时返回无效的Value
+        Value operator[](std::string_view key) const;
+
+        // 数组元素，支持负数索引，越界时返回无效的Value
+        Value at(long i) const;
+
+        // 数组的全部元素，或者对象的全部成员值
+        std::vector<Value> children() const;
+
+        /**
+         * 遍历数组元素或者对象成员，f(key, value)，key为原文（未解码转义字符），数组元素的key为空
+         * f返回false时停止
+         */
+        template<typename F>
+        void forEach(F &&f) const;
+
+        // 原文
+        std::string_view raw() const;
+
+        /**
+         * 字符串为解码后的内容，数字与布尔值为原文，null为空字符串，数组与对象为去掉空白的json
+         */
+        std::string getString() const;
+
+        double getNumber() const;
+
+        // 去掉空白的json
+        std::string toJson() const;
+
+        bool operator==(const Value &other) const = default;
+
+        const Document *getDocument() const {
+            return document;
+        }
+
+        uint32_t getIndex() const {
+            return index;
+        }
+
+    private:
+        const Document *document = nullptr;
+        uint32_t index = 0;
+    };
+
+    class Document {
+    public:
+        /**
+         * 解析json，文档持有json的所有权，格式错误时抛出 std::invalid_argument
+         */
+        static std::shared_ptr<const Document> parse(std::string json);
+
+        explicit Document(std::string json);
+
+        Document(const Document &) = delete;
+
+        Document &operator=(const Document &) = delete;
+
+        Value root() const {
+            return {this, 0};
+        }
+
+        const std::string &source() const {
+            return json;
+        }
+
+        // tape中值的数量（对象的key也算一个）
+        size_t tapeSize() const {
+            return tape.size();
+        }
+
+        // tape中的一项，16字节
+        struct Entry {
+            uint32_t offset;    // 在原文中的起始位置
+            uint32_t end;       // 在原文中的结束位置
+            uint32_t next;      // 子树之后的下一项
+            uint32_t count: 27; // 数组元素或者对象成员的数量
+            uint32_t type: 3;
+            uint32_t escaped: 1; // 字符串中有转义字符
+            uint32_t member: 1;  // 是对象的成员值，前一项为其key
+        };
+
+        const Entry &entry(const uint32_t i) const {
+            return tape[i];
+        }
+
+    private:
+        friend class Parser;
+        std::string json;
+        std::vector<Entry> tape;
+    };
+
+    template<typename F>
+    void Value::forEach(F &&f) const {
+        const Document::Entry &e = document->entry(index);
+        if (e.type != static_cast<uint32_t>(Type::Array) && e.type != static_cast<uint32_t>(Type::Object)) return;
+        const bool object = e.type == static_cast<uint32_t>(Type::Object);
+        uint32_t i = index + 1;
+        while (i < e.next) {
+            std::string_view key;
+            if (object) {
+                const Document::Entry &k = document->entry(i);
+                key = std::string_view(document->source()).substr(k.offset + 1, k.end - k.offset - 2);
+                i++;
+            }
+            if (!f(key, Value(document, i))) return;
+            i = document->entry(i).next;
+        }
+    }
+
+    // 解码json字符串中的转义字符，str不含两端的引号
+    std::string unescape(std::string_view str);
+
+    /**
+     * json的增量扫描，用于边下载边解析
+     * 只做结构扫描，不建立tape：依次找出路径 $.keys[0].keys[1]... 对应的数组中的每一个元素，
+     * 元素在原文中完整后立即回调；每次只扫描已经完整到达的部分，不完整的留到下一次feed()
+     */
+    class StreamScanner {
+    public:
+        // 列表中的一项，begin、end为在整个内容中的位置
+        using ItemHandler = std::function<void(size_t begin, size_t end)>;
+
+        /**
+         * @param keys 从根节点到列表的对象成员名称
+         * @param members 为 true 时路径对应的对象的成员值也作为列表中的项，即 $.a.b[*] 或 $.a.b.*
+         */
+        StreamScanner(std::vector<std::string> keys, bool members, ItemHandler onItem);
+
+        // 追加一段内容并扫描其中完整的部分
+        void feed(std::string_view data);
+
+        // 内容结束
+        void finish();
+
+        /**
+         * 不是合法的json，或者路径对应的是对象但不取成员值（此时完整解析的结果是对象本身）
+         */
+        bool failed() const {
+            return error;
+        }
+
+        // 整个内容中 [begin, end) 的部分，begin不能小于已经丢弃的位置
+        std::string_view slice(size_t begin, size_t end) const;
+
+        // 之后不再需要offset之前的内容，可以丢弃以节省内存
+        void release(size_t offset);
+
+    private:
+        // 打开的数组或对象
+        struct Frame {
+            bool object;
+            bool expectKey;    // 对象中下一个字符串是成员名称
+            bool onPath;       // 是否位于路径上，即从根节点到这里的成员名称都与keys相同
+            std::string key;   // 对象中当前成员的名称
+        };
+
+        std::vector<std::string> keys;
+        bool members;
+        ItemHandler onItem;
+        std::string buffer;
+        size_t base = 0;
+        size_t pos = 0;
+        size_t released = 0;
+        size_t itemBegin = 0;
+        std::vector<Frame> stack;
+        bool error = false;
+
+        void scan(bool eof);
+
+        // 当前位置的值是否为列表中的一项
+        bool inList() const;
+
+        // 值开始
+        void beginValue(size_t at);
+
+        // 值结束，end为值之后的位置
+        void endValue(size_t end);
+    };
+
+    struct Segment;
+
+    /**
+     * JSONPath，语法与阅读(Legado)使用的Jayway JsonPath一致：
+     * $、@、.name、['name','name2']、[n]（可为负数）、[n,m]、[start:end:step]、[*]、.*、..name、..*、
+     * 过滤 [?(@.a.b > 1 && @.c =~ /^x.*$/i || !@.d)]，支持 == != < <= > >= =~ in nin 与 && || ! ()
+     * 不以$或@开头时视为以'$.'开头
+     */
+    class Path {
+    public:
+        /**
+         * 编译JSONPath，语法错误时抛出 std::invalid_argument
+         */
+        static std::shared_ptr<const Path> parse(const std::string &path);
+
+        /**
+         * 与parse()相同，但以path为key缓存编译结果，规则中的JSONPath只编译一次
+         * 语法错误时返回nullptr
+         */
+        static std::shared_ptr<const Path> compile(const std::string &path);
+
+        explicit Path(std::vector<Segment> segments);
+
+        ~Path();
+
+        // 在root上执行，结果按匹配顺序排列
+        std::vector<Value> select(Value root) const;
+
+        /**
+         * 是否为确定的路径（只有.name与[n]），确定的路径最多只有一个结果，
+         * 结果为数组时Jayway把数组本身作为结果列表
+         */
+        bool isDefinite() const {
+            return definite;
+        }
+
+    private:
+        std::vector<Segment> segments;
+        bool definite = true;
+    };
+}
+
+/**
+ * JSONPath规则的解析，如：$.data.list[*]、$.book.name、{$.name}（{$.}内嵌规则）
+ * '&&'、'||'、'%%' 分别表示合并、取第一个有结果的规则、交替合并，与阅读(Legado)保持一致
+ * 列表中的每一项仍然指向同一个文档，在子项上执行规则不需要重新解析
+ */
+class AnalyzeByJSonPath {
+public:
+    // 解析json，格式错误时抛出 std::invalid_argument
+    explicit AnalyzeByJSonPath(const std::string &json);
+
+    /**
+     * 在已经解析好的文档上执行规则
+     * @param value 规则的起始位置，无效时从文档根节点开始
+     */
+    explicit AnalyzeByJSonPath(std::shared_ptr<const JsonPath::Document> document, JsonPath::Value value = {});
+
+    // 获取全部内容，以换行符连接，规则为空或者没有结果时返回 std::nullopt
+    std::optional<std::string> getString(const std::string &rule) const;
+
+    // 获取内容列表
+    std::vector<std::string> getStringList(const std::string &rule) const;
+
+    // 获取列表，结果为单个数组时返回数组的元素
+    std::vector<JsonPath::Value> getList(const std::string &rule) const;
+
+    // 获取第一个结果，没有结果时返回无效的Value
+    JsonPath::Value getObject(const std::string &rule) const;
+
+    const std::shared_ptr<const JsonPath::Document> &getDocument() const {
+        return document;
+    }
+
+    JsonPath::Value getValue() const {
+        return value;
+    }
+
+private:
+    std::shared_ptr<const JsonPath::Document> document;
+    JsonPath::Value value;
+};
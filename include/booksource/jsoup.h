@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <booksource/html.h>
+
+/**
+ * 默认规则（JSoup规则）的解析，如：class.bookname@tag.a@text、id.list@tag.dd!0:3、@CSS:div.item > a@href
+ * 规则语法与阅读(Legado)保持一致：
+ * 1. '@'分隔多级规则，最后一级为获取内容的规则：text、textNodes、ownText、html、all 或者属性名
+ * 2. 单级规则为 类型.名称 的形式，类型为 class、tag、id、text、children，否则按css选择器处理
+ * 3. 支持索引：tag.div.-1:10:2（'.'选择，'!'排除）以及 tag.div[-1, 3:-2:-10, 2]、tag.div[!0]
+ * 4. '&&'、'||'、'%%' 分别表示合并、取第一个有结果的规则、交替合并
+ */
+class AnalyzeByJSoup {
+public:
+    // 解析html，以<?xml开头时按xml解析
+    explicit AnalyzeByJSoup(const std::string &html);
+
+    /**
+     * 在已经解析好的文档上执行规则
+     * @param element 规则的起始元素，为空时从文档根节点开始
+     */
+    explicit AnalyzeByJSoup(std::shared_ptr<const Html::Document> document, const Html::Node *element = nullptr);
+
+    // 获取列表
+    Html::Elements getElements(const std::string &rule) const;
+
+    // 获取全部内容，以换行符连接，规则为空或者没有结果时返回 std::nullopt
+    std::optional<std::string> getString(const std::string &rule) const;
+
+    // 获取第一个内容，没有结果时返回空字符串
+    std::string getString0(const std::string &rule) const;
+
+    // 获取内容列表
+    std::vector<std::string> getStringList(const std::string &rule) const;
+
+    const std::shared_ptr<const Html::Document> &getDocument() const {
+        return document;
+    }
+
+    const Html::Node *getElement() const {
+        return element;
+    }
+
+private:
+    std::shared_ptr<const Html::Document> document;
+    const Html::Node *element;
+};
@@ -0,0 +1,127 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <functional>
+#include <booksource/charset.h>
+#include <booksource/css.h>
+#include <booksource/html.h>
+#include <booksource/jsonpath.h>
+#include <booksource/rule.h>
+
+/**
+ * 书籍列表的流式解析：边下载边找出列表中的每一项，每一项完整到达后立即交给回调，
+ * 回调返回 false 时停止，调用方可以随之中断传输
+ * 只支持结果与完整解析相同、且只需要元素自身的开始标签就能判断的列表规则：
+ * 1. 默认规则 class.x、tag.x、id.x 以'@'连接的多级规则，不带索引
+ * 2. 单级css选择器或者 @CSS: 规则，只有标签、class、id、属性条件以及后代、子元素组合器
+ * 3. 内容为json时 $.a.b、$.a.b[*]、$.a.b.*（可以省略'$.'或者带 @Json: 前缀）
+ * 列表中的html元素单独解析为一个文档，其中的规则不能访问列表项之外的父元素与兄弟元素
+ * 规则不支持时create()返回nullptr；内容不是预期的格式、多级规则的结果会重复、编码推测错误时failed()为 true，
+ * 这两种情况都需要在下载完成后按完整内容解析
+ */
+class ListStream {
+public:
+    // 列表中的一项，返回 false 时停止
+    using ItemHandler = std::function<bool(RuleContent &&item)>;
+
+    /**
+     * @param ruleList 去掉了正反序前缀的书籍列表规则
+     * @param charset 书源指定的字符集
+     */
+    static std::unique_ptr<ListStream> create(const std::string &ruleList,
+                                              const std::optional<std::string> &charset, ItemHandler onItem);
+
+    ListStream(const ListStream &) = delete;
+
+    ListStream &operator=(const ListStream &) = delete;
+
+    /**
+     * 追加一段未转码的原始字节
+     * @return 回调要求停止时返回 false，失败后仍返回 true，内容只是被忽略
+     */
+    bool feed(std::string_view data, std::string_view contentType);
+
+    // 内容结束，处理剩余的列表项
+    void finish();
+
+    bool failed() const {
+        return error;
+    }
+
+    bool stopped() const {
+        return stop;
+    }
+
+    // 内容是否为json，列表项为JsonContent
+    bool isJson() const {
+        return format == Format::Json;
+    }
+
+    // 已经交给回调的列表项数量
+    size_t count() const {
+        return items;
+    }
+
+private:
+    enum class Format : uint8_t {
+        Unknown, Html, Json
+    };
+
+    // 已经找到开始标签的列表项，在整个内容中的位置
+    struct Pending {
+        size_t begin;
+        size_t end;
+        bool done;
+    };
+
+    std::optional<std::string> charset;
+    ItemHandler onItem;
+    bool htmlRule = false;
+    std::vector<Css::Compound> steps;              // 默认规则的各级
+    std::shared_ptr<const Css::Selector> selector; // css选择器
+    bool jsonRule = false;
+    std::vector<std::string> jsonKeys;
+    bool jsonMembers = false;
+
+    std::unique_ptr<Charset::StreamDecoder> decoder;
+    Format format = Format::Unknown;
+    std::string head; // 确定格式之前收到的内容
+    char opening = 0; // json的第一个字符
+    char closing = 0; // json最后一个非空白字符
+    std::unique_ptr<Html::StreamParser> html;
+    std::unique_ptr<JsonPath::StreamScanner> json;
+    std::vector<size_t> progress;   // 每一层打开的元素及其祖先已经匹配的默认规则级数
+    std::vector<uint64_t> masks;    // 每一层打开的元素在每组css选择器中的匹配状态
+    std::vector<size_t> itemAt;     // 每一层打开的元素对应的列表项序号加一，不是列表项时为0
+    std::deque<Pending> pending;
+    size_t firstSeq = 0;            // pending中第一项的序号
+    bool error = false;
+    bool stop = false;
+    size_t items = 0;
+
+    ListStream(std::optional<std::string> charset, ItemHandler onItem);
+
+    void feedText(const std::string &text, bool eof);
+
+    // 根据第一个非空白字符确定内容的格式，需要更多内容时返回false
+    bool detect(bool eof);
+
+    void onOpen(const Html::Node &element, size_t depth, size_t begin);
+
+    void onClose(size_t depth, size_t end);
+
+    bool matchSteps(const Html::Node &element, size_t depth);
+
+    bool matchSelector(const Html::Node &element, size_t depth);
+
+    // 按顺序处理已经完整的列表项，end为刚刚闭合的列表项的结束位置
+    void flush(size_t end);
+
+    void emit(RuleContent &&item);
+
+    void fail();
+};
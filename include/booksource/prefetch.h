@@ -0,0 +1,112 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <booksource/data.h>
+#include <booksource/rule.h>
+#include <booksource/threadpool.h>
+
+/**
+ * 正文预读：在后台下载并解析阅读位置之后的若干章节（可选前一章），打开下一章时直接命中缓存
+ * 预读的请求为后台优先级，书源设置了concurrentRate时让位于前台请求（见ConcurrentRateLimiter），
+ * 同时进行的预读不超过线程数；阅读位置跳出预读范围时取消范围外未完成的预读
+ * 线程安全，可以在多个线程中同时调用
+ */
+class ContentPrefetcher {
+public:
+    struct Options {
+        size_t ahead = 3;     // 预读阅读位置之后的章节数
+        bool previous = false; // 是否预读前一章
+        size_t threads = 2;   // 同时进行的预读数
+    };
+
+    /**
+     * @param chapters 完整的目录，按index排列
+     */
+    ContentPrefetcher(BookSource &bookSource, Book book, std::vector<BookChapter> chapters, RuleData &ruleData,
+                      Options options);
+
+    ContentPrefetcher(BookSource &bookSource, Book book, std::vector<BookChapter> chapters, RuleData &ruleData)
+        : ContentPrefetcher(bookSource, std::move(book), std::move(chapters), ruleData, Options()) {
+    }
+
+    // 取消全部预读，等正在进行的预读结束后返回
+    ~ContentPrefetcher();
+
+    ContentPrefetcher(const ContentPrefetcher &) = delete;
+
+    ContentPrefetcher &operator=(const ContentPrefetcher &) = delete;
+
+    /**
+     * 阅读位置改变：丢弃预读范围外的缓存并取消其中未完成的预读，然后按距离从近到远预读范围内没有缓存的章节
+     */
+    void moveTo(int durChapterIndex);
+
+    /**
+     * 获取正文：有缓存时直接返回；正在预读时等待其结果；还在排队或者预读失败时在当前线程中以前台优先级下载
+     * 结果会被缓存，直到阅读位置离开它
+     */
+    std::string getContent(int index);
+
+    // 正文已经缓存
+    bool isCached(int index);
+
+    // 章节，正文的title规则可能更新了标题
+    BookChapter getChapter(int index);
+
+    size_t size() const {
+        return chapters.size();
+    }
+
+    // getContent()命中缓存（包括等待正在进行的预读）的次数
+    size_t hitCount() const {
+        return hits;
+    }
+
+    size_t missCount() const {
+        return misses;
+    }
+
+private:
+    struct Entry {
+        enum State {
+            Queued,
+            Running,
+            Done
+        };
+
+        State state = Queued;
+        std::string content;
+        std::atomic<bool> cancelled = false;
+    };
+
+    void prefetch(int index, const std::shared_ptr<Entry> &entry);
+
+    // 下载并解析正文，更新章节的标题
+    std::string fetch(int index, bool background, const std::atomic<bool> *cancelled);
+
+    // index是否在当前的预读范围内（包括阅读位置本身）
+    bool inWindow(int index) const;
+
+    BookSource &bookSource;
+    const Book book;
+    std::vector<BookChapter> chapters;
+    std::vector<std::string> urls; // 每个章节的绝对地址，用作上一章的nextChapterUrl
+    RuleData &ruleData;
+    const Options options;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::unordered_map<int, std::shared_ptr<Entry> > entries;
+    int position = -1;
+    std::atomic<size_t> hits = 0;
+    std::atomic<size_t> misses = 0;
+    // 最后声明、最先析构：等待剩余的任务结束时其它成员仍然有效
+    ThreadPool pool;
+};
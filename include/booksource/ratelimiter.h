@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * 书源的并发率限制，对应阅读(Legado)的ConcurrentRateLimiter，同一个书源（getKey()相同）共享同一个实例
+ * concurrentRate为"毫秒数"时同一时间只有一个请求，相邻两个请求开始的间隔不小于该值；
+ * 为"次数/毫秒数"时每个时间窗口内最多开始指定次数的请求；为空或者"0"时不限制
+ * 与阅读抛出异常后由调用方重试不同，这里阻塞等待；后台请求只在没有等待中的前台请求时开始
+ */
+class ConcurrentRateLimiter {
+public:
+    enum Priority {
+        Foreground,
+        Background
+    };
+
+    /**
+     * 当前线程发出请求的优先级与取消标志，在作用域内有效，可以嵌套
+     * 取消后等待中的请求放弃，之后的请求不再发出，AnalyzeUrl按请求失败处理
+     */
+    class RequestScope {
+    public:
+        explicit RequestScope(Priority priority, const std::atomic<bool> *cancelled = nullptr);
+
+        ~RequestScope();
+
+        RequestScope(const RequestScope &) = delete;
+
+        RequestScope &operator=(const RequestScope &) = delete;
+
+        static Priority priority();
+
+        static bool cancelled();
+
+    private:
+        Priority previousPriority;
+        const std::atomic<bool> *previousCancelled;
+    };
+
+    static std::shared_ptr<ConcurrentRateLimiter> forSource(const std::string &sourceKey);
+
+    /**
+     * 请求开始前调用，需要等待时阻塞，返回 true 后请求结束时必须调用release()
+     * 优先级与取消标志取自当前线程的RequestScope
+     * @param rate 书源的concurrentRate，格式错误时不限制
+     * @return 等待中被取消时返回 false
+     */
+    bool acquire(const std::string &rate);
+
+    void release(const std::string &rate);
+
+    /**
+     * 现在调用acquire()大约还需要等待的毫秒数，0表示可以立即开始，不考虑优先级
+     * 有正在进行的请求而无法确定时返回一个较短的检查间隔
+     */
+    int64_t waitTime(const std::string &rate);
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool running = false;      // "毫秒数"：是否有正在进行的请求
+    int64_t start = INT64_MIN; // "毫秒数"为上一个请求开始的时间，"次数/毫秒数"为当前时间窗口开始的时间
+    int count = 0;             // 当前时间窗口内开始的请求数
+    int foregroundWaiting = 0;
+};
@@ -0,0 +1,108 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <regex>
+
+/**
+ * 正则表达式，语法与阅读(Legado)使用的Java正则一致
+ * 编译为NFA后以Pike VM的方式同时模拟全部状态，匹配时间与文本长度成线性关系，不回溯也不递归，
+ * 在整个网页上执行AllInOne规则不会出现指数级的耗时或者栈溢出
+ * 支持：字面字符、.、[...]、\d\w\s\D\W\S、\p{Han}、\b\B、^$\A\z\Z、(...)、(?:...)、(?<name>...)、|、
+ * 贪婪与非贪婪的 * + ? {n,m}、\Q...\E、(?i)(?s)(?m)及其局部形式 (?i:...)
+ * 顶层分支中的字面文本（如净化规则"广告|本章未完|请收藏本站"）由Aho–Corasick自动机匹配，
+ * 其余分支合并为一个NFA，两者的结果按分支的优先级合并，整个文本只扫描一遍
+ * 反向引用、环视等无法用NFA表示的语法退回到 std::regex
+ * 编译后只读，可以在多个线程之间共享
+ */
+namespace Regexp {
+
+    struct Program;
+
+    class Literals;
+
+    // 一次匹配的结果：各分组在文本中的位置，未参与匹配的分组为npos
+    class Match {
+    public:
+        std::vector<size_t> offsets; // 分组i为 [offsets[2i], offsets[2i+1])
+
+        // 分组数量加一
+        size_t size() const {
+            return offsets.size() / 2;
+        }
+
+        bool matched(const size_t group = 0) const {
+            return group < size() && offsets[group * 2] != std::string::npos;
+        }
+
+        size_t begin(const size_t group = 0) const {
+            return offsets[group * 2];
+        }
+
+        size_t end(const size_t group = 0) const {
+            return offsets[group * 2 + 1];
+        }
+
+        // 分组在text中的内容，分组不存在或者没有参与匹配时为空
+        std::string_view group(const std::string_view text, const size_t group = 0) const {
+            if (!matched(group)) return {};
+            return text.substr(begin(group), end(group) - begin(group));
+        }
+    };
+
+    class Pattern {
+    public:
+        /**
+         * 编译正则，语法错误时抛出 std::invalid_argument
+         */
+        static std::shared_ptr<const Pattern> parse(const std::string &pattern);
+
+        /**
+         * 与parse()相同，但以pattern为key缓存编译结果，语法错误时返回nullptr
+         */
+        static std::shared_ptr<const Pattern> compile(const std::string &pattern);
+
+        explicit Pattern(const std::string &pattern);
+
+        ~Pattern();
+
+        Pattern(const Pattern &) = delete;
+
+        Pattern &operator=(const Pattern &) = delete;
+
+        // 捕获分组的数量
+        size_t groupCount() const {
+            return groups;
+        }
+
+        // 是否由线性时间的引擎执行
+        bool isLinear() const {
+            return fallback == nullptr;
+        }
+
+        /**
+         * 从from开始查找第一个匹配（最左，分支与量词按优先级选择，与回溯引擎的结果相同）
+         */
+        bool search(std::string_view text, size_t from, Match &match) const;
+
+        // 全部不重叠的匹配
+        std::vector<Match> findAll(std::string_view text) const;
+
+        /**
+         * 替换全部匹配，或者只替换第一个匹配
+         * replacement中 $n、${name}、$& 为分组的内容，'\'转义下一个字符，与Java的replaceAll一致
+         */
+        std::string replace(std::string_view text, std::string_view replacement, bool first = false) const;
+
+        // 把match代入replacement
+        std::string expand(std::string_view text, const Match &match, std::string_view replacement) const;
+
+    private:
+        std::unique_ptr<const Program> program;   // 不是字面文本的分支，全部是字面文本时为空
+        std::unique_ptr<const Literals> literals; // 字面文本的分支，没有时为空
+        std::unique_ptr<const std::regex> fallback;
+        size_t groups = 0;
+        std::vector<std::pair<std::string, size_t> > names;
+    };
+}
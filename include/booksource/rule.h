@@ -6,11 +6,25 @@
 #include <optional>
 #include <regex>
 #include <any>
+#include <variant>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <condition_variable>
+#include <string_view>
 #include <unordered_set>
+#include <array>
+#include <bit>
 #include <booksource/ruledata.h>
 #include <booksource/utils.h>
 #include <booksource/data.h>
 #include <booksource/constants.h>
+#include <booksource/jsoup.h>
+#include <booksource/xpath.h>
+#include <booksource/jsonpath.h>
+#include <booksource/regexp.h>
+#include <booksource/threadpool.h>
 
 #include "rule.h"
 
@@ -89,6 +103,9 @@ struct TocRule {
 };
 
 class BaseSource;
+class UrlTemplate;
+struct SourceCache;
+class CookieJar;
 
 class JsExtensions {
 public:
@@ -106,6 +123,8 @@ public:
     std::optional<bool> enabledCookieJar = std::nullopt;
     std::optional<std::string> jsLib = std::nullopt;
 
+    BaseSource();
+
     virtual std::string getTag() = 0;
 
     virtual std::string getKey() = 0;
@@ -116,8 +135,19 @@ public:
 
     std::optional<std::string> getLoginJs() const;
 
+    /**
+     * 获取请求头，结果按header规则缓存，header或登录头改变后自动失效
+     * 对于每次请求都需要重新计算的请求头，可以在header的js中设置 dynamicHeader = true 声明不缓存
+     */
     std::unordered_map<std::string, std::string> getHeaderMap(bool hasLoginHeader = false);
 
+    // 保存登录头，loginHeader为json字符串
+    void putLoginHeader(const std::string &loginHeader);
+
+    std::optional<std::string> getLoginHeader() const;
+
+    void removeLoginHeader();
+
     std::string put(std::string key, std::string value) {
         // TODO
         return value;
@@ -128,6 +158,30 @@ public:
     }
 
     std::string evalJS(std::string jsStr);
+
+    /**
+     * 获取编译后的url模板，书源自身的url规则（见isOwnUrlRule()）只编译一次，
+     * 章节等一次性的url每次编译，不进入缓存
+     */
+    std::shared_ptr<const UrlTemplate> getUrlTemplate(const std::string &ruleUrl);
+
+    /**
+     * 获取编译后的正则，同一书源的规则共享，不是合法的正则时返回nullptr
+     */
+    std::shared_ptr<const Regexp::Pattern> getRegexp(const std::string &pattern);
+
+    /**
+     * 获取书源的CookieJar，同一书源的所有请求共享
+     */
+    std::shared_ptr<CookieJar> getCookieJar();
+
+protected:
+    std::shared_ptr<SourceCache> sourceCache;
+
+    // ruleUrl是否为书源自身反复使用的url规则，如搜索与发现页的url
+    virtual bool isOwnUrlRule(const std::string &ruleUrl) const {
+        return false;
+    }
 };
 
 class BookSource final : public BaseSource {
@@ -140,12 +194,7 @@ public:
     int customOrder = 0;
     bool enabled = true;
     bool enabledExplore = true;
-    std::optional<std::string> jsLib = std::nullopt;
-    std::optional<bool> enabledCookieJar = true;
-    std::optional<std::string> concurrentRate = std::nullopt;
-    std::optional<std::string> header = std::nullopt;
-    std::optional<std::string> loginUrl = std::nullopt;
-    std::optional<std::string> loginUi = std::nullopt;
+    // jsLib、enabledCookieJar、concurrentRate、header、loginUrl、loginUi 继承自 BaseSource
     std::optional<std::string> loginCheckJs = std::nullopt;
     std::optional<std::string> coverDecodeJs = std::nullopt;
     std::optional<std::string> bookSourceComment = std::nullopt;
@@ -164,6 +213,10 @@ public:
     std::optional<ReviewRule> ruleReview = std::nullopt;
 
 public:
+    BookSource() {
+        enabledCookieJar = true;
+    }
+
     std::string getTag() override;
 
     /**
@@ -188,6 +241,10 @@ public:
         ruleExplore = rule;
         return rule;
     }
+
+protected:
+    // searchUrl，以及exploreUrl中的一项
+    bool isOwnUrlRule(const std::string &ruleUrl) const override;
 };
 
 class BookSourceParser {
@@ -261,6 +318,9 @@ public:
 private:
     // 递归切分
     void splitRuleRec(const std::vector<std::string> &split);
+
+    // 查找第一个出现的分隔符，[]与()中的内容不参与分割
+    size_t findSplit(const std::vector<std::string> &split, size_t from);
 };
 
 
@@ -280,92 +340,142 @@ enum RequestMethod {
     GET, POST
 };
 
-class UrlOption {
+/**
+ * 模板字符串：预先将 {{key}}、{{page}} 以及其他 {{js}} 拆分为片段，
+ * 渲染时只需按顺序拼接，纯 {{key}}/{{page}} 不需要经过js引擎
+ */
+class TemplateString {
+public:
+    enum class SlotType {
+        Literal, Key, Page, Js, PageList
+    };
+
+    struct Segment {
+        SlotType type;
+        std::string text; // Literal为原文，Js为代码，PageList为<>中的原文
+        std::vector<std::string> pages{}; // PageList：<a,b,c>分割后的结果
+    };
+
+    using JsEvaluator = std::function<std::string(const std::string &)>;
+
+    /**
+     * @param pageList 是否同时解析分页规则 <a,b,c>
+     */
+    static TemplateString compile(const std::string &str, bool pageList = false);
+
+    // 是否不含任何需要替换的片段
+    bool isLiteral() const {
+        return segments.size() <= 1 && (segments.empty() || segments[0].type == SlotType::Literal);
+    }
+
+    std::string render(
+        const std::optional<std::string> &key,
+        const std::optional<int> &page,
+        const JsEvaluator &evalJs
+    ) const;
+
+    const std::vector<Segment> &getSegments() const {
+        return segments;
+    }
+
 private:
-    std::optional<std::string> method = std::nullopt;
-    std::optional<std::string> charset = std::nullopt;
-    std::optional<std::any> headers = std::nullopt;
-    std::optional<std::any> body = std::nullopt;
+    std::vector<Segment> segments;
+};
 
+/**
+ * url参数，对应于 http://xx.xx/xxxx,{"method": "POST", "body": "...", "headers": {...}} 中的json部分
+ * 解析完成后不可变，同一个规则模板只解析一次，之后在多次请求之间共享
+ */
+class UrlOption {
+public:
+    RequestMethod method = GET;
+    std::optional<std::string> charset = std::nullopt;
+    std::vector<std::pair<std::string, std::string> > headers;
+    std::optional<TemplateString> body = std::nullopt;
     std::optional<std::string> origin = std::nullopt;
-
-    std::optional<int> retry = std::nullopt;
+    int retry = 0;
     std::optional<std::string> type = std::nullopt;
-    std::optional<std::any> webView = std::nullopt;
+    bool webView = false;
     std::optional<std::string> webJs = std::nullopt;
     std::optional<std::string> js = std::nullopt;
     std::optional<long> serverID = std::nullopt;
     std::optional<long> webViewDelayTime = std::nullopt;
 
-public:
-    void setMethod(std::optional<std::string> value) {
-        method = value.has_value() && !value->empty() ? value : std::nullopt;
-    }
+    /**
+     * 解析url参数json，解析失败时抛出异常
+     */
+    static std::shared_ptr<const UrlOption> parse(const std::string &jsonStr);
 
-    std::optional<std::string> getMethod() {
-        return method;
-    }
+    /**
+     * 与parse()相同，但以jsonStr为key缓存解析结果，用于规则模板中固定不变的参数部分
+     * 解析失败时返回nullptr
+     */
+    static std::shared_ptr<const UrlOption> compile(const std::string &jsonStr);
 
-    void setCharset(std::optional<std::string> value) {
-        charset = value.has_value() && !value->empty() ? value : std::nullopt;
-    }
+    /**
+     * 在规则中查找url参数的起始位置，即 http://xx.xx/xxxx , {...} 中的逗号，{{ }} 内部的逗号会被跳过
+     * @return 逗号的位置，不存在时返回 std::string::npos
+     */
+    static size_t findOptionStart(std::string_view ruleUrl);
+};
 
-    std::optional<std::string> getCharset() {
-        return charset;
-    }
+/**
+ * 预编译的url规则，如书源的searchUrl、发现页的url
+ * 编译时拆分出字面量、{{key}}/{{page}}、{{js}}、<a,b,c>分页以及url参数，渲染时只需拼接字符串
+ * 含有 @js:/<js> 的规则需要先执行js才能确定url，此时只记录hasJs()，由AnalyzeUrl按原流程处理
+ */
+class UrlTemplate {
+public:
+    static std::shared_ptr<const UrlTemplate> compile(const std::string &ruleUrl);
 
-    void setOrigin(std::optional<std::string> value) {
-        origin = value.has_value() && !value->empty() ? value : std::nullopt;
+    bool hasJs() const {
+        return jsPipeline;
     }
 
-    std::optional<std::string> getOrigin() {
-        return origin;
+    /**
+     * 渲染不含参数部分的url（相对地址未处理）
+     */
+    std::string render(
+        const std::optional<std::string> &key,
+        const std::optional<int> &page,
+        const TemplateString::JsEvaluator &evalJs
+    ) const {
+        return url.render(key, page, evalJs);
     }
 
-    void setRetry(const std::optional<std::string> &value) {
-        retry = value.has_value() && !value->empty()
-                    ? std::optional(std::stoi(*value))
-                    : std::nullopt;
+    // url参数，没有参数时为nullptr
+    const std::shared_ptr<const UrlOption> &getOption() const {
+        return option;
     }
 
-    int getRetry() const {
-        return retry ? *retry : 0;
+    const TemplateString &getUrl() const {
+        return url;
     }
 
-    void setType(std::optional<std::string> value) {
-        type = value.has_value() && !value->empty() ? value : std::nullopt;
-    }
+private:
+    bool jsPipeline = false;
+    TemplateString url;
+    std::shared_ptr<const UrlOption> option = nullptr;
+};
 
-    std::optional<std::string> getType() {
-        return type;
-    }
+/**
+ * 书源的编译缓存，书源对象拷贝时共享同一份缓存
+ */
+struct SourceCache {
+    using HeaderMap = std::unordered_map<std::string, std::string>;
 
-    bool useWebView() const {
-        if (!webView) return false;
-        if (webView->type() == typeid(std::string)) {
-            const auto str = std::any_cast<std::string>(*webView);
-            if (str.empty()) return false; // 空字符串返回false
-            if (str == "false") return false;
-        } else if (webView->type() == typeid(bool)) {
-            const auto b = std::any_cast<bool>(*webView);
-            return b; // webView为false时返回false
-        }
-        return true;
-    }
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<const UrlTemplate> > urlTemplates;
+    std::unordered_map<std::string, std::shared_ptr<const Regexp::Pattern> > regexps;
 
-    void useWebView(const bool value) {
-        webView = value ? std::optional(true) : std::nullopt;
-    }
+    // getHeaderMap()的缓存：header规则为headerRule时的计算结果，以及合并登录头后的结果
+    std::optional<std::string> headerRule = std::nullopt;
+    std::shared_ptr<const HeaderMap> headerMap = nullptr;
+    std::shared_ptr<const HeaderMap> headerMapWithLogin = nullptr;
 
-    void setHeaders(std::optional<std::string> value) {
-        if (!value || value->empty()) {
-            // 若value为null或者空字符串
-            headers = std::nullopt;
-        } else {
-            auto map = JsonUtils::jsonStringToMap(*value);
-            this->headers = map;
-        }
-    }
+    // 登录头
+    std::optional<std::string> loginHeader = std::nullopt;
+    HeaderMap loginHeaderMap;
 };
 
 class AnalyzeUrl final : JsExtensions {
@@ -406,6 +516,7 @@ private:
     long webViewDelayTime = 0;
 
     std::optional<long> serverID = std::nullopt;
+    std::shared_ptr<const UrlOption> option = nullptr;
 
 public:
     explicit AnalyzeUrl(
@@ -428,16 +539,47 @@ public:
                        const std::optional<std::string> &result = std::nullopt);
 
 public:
+    /**
+     * 发送请求，书源设置了concurrentRate时按ConcurrentRateLimiter等待
+     * 当前线程的请求已经取消（见ConcurrentRateLimiter::RequestScope）时不发出请求，结果的body为空
+     */
     StrResponse getStrResponse(
         std::string *jsStr = nullptr,
         std::string *sourceRegex = nullptr,
         bool useWebView = false
     );
 
+    /**
+     * 响应内容的回调，参数为一段未转码的原始字节以及响应的Content-Type，返回 false 时中断传输
+     */
+    using DataHandler = std::function<bool(std::string_view data, std::string_view contentType)>;
+
+    /**
+     * 与getStrResponse()相同，但每收到一段内容就交给onData，用于边下载边解析
+     * 传输被onData中断时，结果只有中断前收到的部分
+     */
+    StrResponse getStrResponse(const DataHandler &onData);
+
     BaseSource *getSource() override {
         return source;
     }
 
+    RequestMethod getMethod() const {
+        return method;
+    }
+
+    const std::optional<std::string> &getBody() const {
+        return body;
+    }
+
+    const std::optional<std::string> &getCharset() const {
+        return charset;
+    }
+
+    int getRetry() const {
+        return retry;
+    }
+
 private:
     std::regex paramPattern{R"(\s*,\s*(?=\{))"}; // 匹配 http://xx.xx/xxxx , { "method": "POST" } 中的逗号
     std::regex pagePattern{R"(<.*?>)"}; // <a, b, c>
@@ -455,24 +597,59 @@ private:
     void replaceKeyPageJs();
 
     void analyzeUrl();
+
+    /**
+     * 将url参数应用到本次请求，body中的 {{key}}/{{page}} 在这里填充
+     */
+    void applyOption();
+
+    // 执行{{ }}中的js，结果为整数时去掉小数部分
+    std::string evalTemplateJs(const std::string &jsCode);
 };
 
-class AnalyzeByXPath {
+
+enum Mode {
+    XPath, Json, Default, Js, Regex
 };
 
-class AnalyzeByJSoup {
+/**
+ * 规则的执行对象：html文档中的一个节点
+ */
+struct HtmlContent {
+    std::shared_ptr<const Html::Document> document;
+    const Html::Node *node = nullptr;
 };
 
-class AnalyzeByJSonPath {
+/**
+ * 规则的执行对象：json文档中的一个值
+ */
+struct JsonContent {
+    std::shared_ptr<const JsonPath::Document> document;
+    JsonPath::Value value;
 };
 
-enum Mode {
-    XPath, Json, Default, Js, Regex
+/**
+ * 规则的执行对象：AllInOne正则规则的一个匹配，字段规则中的 $1、$2 等为其分组的内容
+ */
+struct RegexContent {
+    std::shared_ptr<const std::string> text;
+    Regexp::Match match;
+
+    std::string_view group(const size_t i) const {
+        return match.group(*text, i);
+    }
 };
 
+/**
+ * 规则的执行对象，为网页内容等普通文本，或者已经解析好的文档中的位置
+ * 列表规则的结果仍然指向同一个文档，在列表的每一项上执行规则时不需要重新解析，也不会复制
+ */
+using RuleContent = std::variant<std::string, HtmlContent, JsonContent, RegexContent>;
+
 class AnalyzeRule;
 
 class SourceRule {
+    friend class AnalyzeRule;
     AnalyzeRule& outer;
     Mode mode;
     std::string rule;
@@ -480,7 +657,17 @@ class SourceRule {
     std::string replacement = "";
     bool replaceFirst = false;
     std::unordered_map<std::string, std::string> putMap;
+    // 含有 @get:{key}、{{js}} 的规则被拆分为多段，执行时再拼接为rule，为空时rule是固定的
     std::vector<std::string> ruleParam;
+    std::vector<int> ruleType;
+
+    // 正数为AllInOne正则规则中 $n 的分组序号
+    static constexpr int getRuleType = -2;
+    static constexpr int jsRuleType = -1;
+    static constexpr int defaultRuleType = 0;
+
+    // 分离 rule##replaceRegex##replacement###
+    void splitReplaceRegex();
 
 public:
     explicit SourceRule(
@@ -499,18 +686,18 @@ private:
     BaseBook *book = nullptr;
     BookChapter *chapter = nullptr;
     std::optional<std::string> nextChapterUrl = std::nullopt;
-    std::optional<std::any> content = std::nullopt;
+    std::optional<RuleContent> content = std::nullopt;
     std::optional<std::string> baseUrl = std::nullopt;
     std::optional<std::string> redirectUrl = std::nullopt;
     bool isJSON = false;
     bool isRegex = false;
 
+    // content为文本时解析后的文档，同一个content只解析一次，xpath与默认规则共用同一个html文档
     std::optional<AnalyzeByXPath> analyzeByXPath = std::nullopt;
     std::optional<AnalyzeByJSoup> analyzeByJSoup = std::nullopt;
     std::optional<AnalyzeByJSonPath> analyzeByJSonPath = std::nullopt;
 
     std::unordered_map<std::string, std::vector<SourceRule> > stringRuleCache{};
-    std::unordered_map<std::string, std::regex> regexCache{};
     // private val scriptCache = hashMapOf<String, CompiledScript>()
     // private var topScopeRef: WeakReference<Scriptable>? = null
     int evalJSCallCount = 0;
@@ -524,21 +711,13 @@ public:
     ) : ruleData(_ruleData), source(_source), preUpdateJs(_preUpdateJs) {
     }
 
+    /**
+     * 设置规则的执行对象，文本在第一次执行规则时按规则类型解析为html或者json文档
+     */
     AnalyzeRule &setContent(
-        std::optional<std::any> _content,
+        std::optional<RuleContent> _content,
         const std::optional<std::string> &_baseUrl = std::nullopt
-    ) {
-        if (!_content.has_value()) {
-            throw std::runtime_error("Content cannot be null");
-        }
-        content = _content.value();
-        // TODO: 根据content初始化isJSON变量
-        setBaseUrl(_baseUrl);
-        analyzeByJSonPath = std::nullopt;
-        analyzeByXPath = std::nullopt;
-        analyzeByJSoup = std::nullopt;
-        return *this;
-    }
+    );
 
     AnalyzeRule &setBaseUrl(std::optional<std::string> _baseUrl) {
         if (_baseUrl.has_value()) {
@@ -547,6 +726,22 @@ public:
         return *this;
     }
 
+    AnalyzeRule &setBook(BaseBook *_book) {
+        book = _book;
+        return *this;
+    }
+
+    AnalyzeRule &setChapter(BookChapter *_chapter) {
+        chapter = _chapter;
+        return *this;
+    }
+
+    // 下一章的地址，在js中为nextChapterUrl
+    AnalyzeRule &setNextChapterUrl(std::optional<std::string> _nextChapterUrl) {
+        nextChapterUrl = std::move(_nextChapterUrl);
+        return *this;
+    }
+
     std::optional<std::string> setRedirectUrl(std::string &url) {
         if (NetworkUtils::isDataUrl(url)) {
             return redirectUrl;
@@ -555,31 +750,34 @@ public:
         return redirectUrl;
     }
 
-    std::vector<std::any> getElements(std::string ruleStr) {
-        std::vector<std::any> elements;
-        std::optional<std::any> result = std::nullopt;
-        auto content = this->content;
-        auto ruleList = splitSourceRule(ruleStr, true);
-        if (content.has_value() && !ruleList.empty()) {
-            result = content;
-            for (const auto &sourceRule : ruleList) {
+    /**
+     * 获取列表，结果中的html节点与json值都指向content解析后的文档
+     */
+    std::vector<RuleContent> getElements(const std::string &ruleStr);
 
-            }
-        }
-        return elements;
-    }
+    /**
+     * 获取内容列表
+     * @param isUrl 为 true 时结果转换为绝对地址，并去掉空地址与重复的地址
+     */
+    std::vector<std::string> getStringList(const std::optional<std::string> &ruleStr, bool isUrl = false);
+
+    std::vector<std::string> getStringList(const std::vector<SourceRule> &ruleList, bool isUrl = false);
+
+    /**
+     * 获取内容，没有结果时返回空字符串
+     * @param isUrl 为 true 时结果转换为绝对地址，结果为空时返回baseUrl
+     * @param unescape 为 true 时解码结果中的html实体，正文在转换为文本之后再解码
+     */
+    std::string getString(const std::optional<std::string> &ruleStr, bool isUrl = false, bool unescape = true);
+
+    std::string getString(const std::vector<SourceRule> &ruleList, bool isUrl = false, bool unescape = true);
 
-    void putRule(std::unordered_map<std::string, std::string> &map) {
+    void putRule(const std::unordered_map<std::string, std::string> &map) {
         for (const auto &[key, value] : map) {
             put(key , getString(value));
         }
     }
 
-    std::string getString(std::string ruleStr) {
-        // TODO
-        return ruleStr;
-    }
-
     std::string put(const std::string &key, const std::string &value) const {
         if (chapter != nullptr) {
             chapter->putVariable(key, value);
@@ -593,6 +791,10 @@ public:
         return value;
     }
 
+    std::string get(const std::string &key) const;
+
+    std::string evalJS(const std::string &jsStr, const std::optional<std::string> &result = std::nullopt);
+
     std::vector<SourceRule> splitSourceRule(const std::optional<std::string> &ruleStr,
         const bool allInOne = false) {
         std::vector<SourceRule> ruleList;
@@ -650,6 +852,38 @@ public:
     BaseSource *getSource() override {
         return source;
     }
+
+private:
+    // 按规则字符串缓存拆分结果
+    const std::vector<SourceRule> &splitSourceRuleCacheString(const std::string &ruleStr);
+
+    /**
+     * 拼接含有 @get:{key}、{{js}} 的规则并分离其中的替换规则，固定的规则直接返回sourceRule
+     * @param made 拼接结果的存放位置
+     */
+    const SourceRule &makeUpRule(const SourceRule &sourceRule, const RuleContent &result,
+                                 std::optional<SourceRule> &made);
+
+    // 在value上执行规则的解析器，value为content时使用缓存的文档
+    AnalyzeByJSoup getAnalyzeByJSoup(const RuleContent &value, bool isContent);
+
+    AnalyzeByXPath getAnalyzeByXPath(const RuleContent &value, bool isContent);
+
+    // value不是合法的json时返回 std::nullopt
+    std::optional<AnalyzeByJSonPath> getAnalyzeByJSonPath(const RuleContent &value, bool isContent);
+
+    std::vector<RuleContent> selectElements(const SourceRule &sourceRule, const RuleContent &value, bool isContent);
+
+    /**
+     * AllInOne的正则规则，'&&'分隔的多个正则中，前面的正则的全部匹配拼接后作为后一个正则的执行对象，
+     * 最后一个正则的每个匹配为列表中的一项
+     */
+    std::vector<RuleContent> regexElements(const std::string &rule, std::string text);
+
+    // 书源共享的正则缓存，没有书源时使用全局缓存
+    std::shared_ptr<const Regexp::Pattern> getRegexp(const std::string &pattern) const;
+
+    std::string replaceRegex(const std::string &result, const SourceRule &sourceRule);
 };
 
 namespace BookList {
@@ -657,9 +891,266 @@ namespace BookList {
 
     using BreakCondition = std::function<bool(int size)>;
 
+    // 去掉书名中的作者等信息
+    inline std::string formatBookName(const std::string &name) {
+        static const std::regex nameRegex(R"(\s+作\s*者.*|\s+\S+\s+著)");
+        std::string result = std::regex_replace(name, nameRegex, "");
+        StringUtils::trim(result);
+        return result;
+    }
 
-    static std::optional<SearchBook> getSearchItem() {
-        return std::nullopt;
+    // 去掉作者前的“作者：”等信息
+    inline std::string formatBookAuthor(const std::string &author) {
+        static const std::regex authorRegex(R"(^\s*作\s*者(?:[:\s]|：)+|\s+著)");
+        std::string result = std::regex_replace(author, authorRegex, "");
+        StringUtils::trim(result);
+        return result;
+    }
+
+    // 纯数字的字数转换为“x字”、“x.x万字”
+    inline std::string wordCountFormat(const std::string &wordCount) {
+        if (wordCount.empty() || wordCount.size() > 9 ||
+            !std::ranges::all_of(wordCount, [](const unsigned char c) { return std::isdigit(c); })) {
+            return wordCount;
+        }
+        const int words = std::stoi(wordCount);
+        if (words <= 0) {
+            return wordCount;
+        }
+        if (words <= 10000) {
+            return std::to_string(words) + "字";
+        }
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.1f", words / 10000.0);
+        std::string result = buf;
+        if (result.ends_with(".0")) {
+            result.resize(result.size() - 2);
+        }
+        return result + "万字";
+    }
+
+    /**
+    * 在列表中的一项上执行书籍信息规则，书名为空时返回 std::nullopt
+    */
+    inline std::optional<SearchBook> getSearchItem(
+        BookSource &bookSource,
+        AnalyzeRule &analyzeRule,
+        const RuleContent &item,
+        const std::string &baseUrl,
+        const std::vector<SourceRule> &ruleName,
+        const std::vector<SourceRule> &ruleBookUrl,
+        const std::vector<SourceRule> &ruleAuthor,
+        const std::vector<SourceRule> &ruleCoverUrl,
+        const std::vector<SourceRule> &ruleIntro,
+        const std::vector<SourceRule> &ruleKind,
+        const std::vector<SourceRule> &ruleLastChapter,
+        const std::vector<SourceRule> &ruleWordCount
+    ) {
+        SearchBook searchBook;
+        searchBook.type = bookSource.bookSourceType;
+        searchBook.origin = bookSource.bookSourceUrl;
+        searchBook.originName = bookSource.bookSourceName;
+        searchBook.originOrder = bookSource.customOrder;
+        analyzeRule.setBook(&searchBook);
+        analyzeRule.setContent(item);
+        searchBook.name = formatBookName(analyzeRule.getString(ruleName));
+        if (searchBook.name.empty()) {
+            analyzeRule.setBook(nullptr);
+            return std::nullopt;
+        }
+        searchBook.author = formatBookAuthor(analyzeRule.getString(ruleAuthor));
+        if (const auto kinds = analyzeRule.getStringList(ruleKind); !kinds.empty()) {
+            std::string kind;
+            for (const auto &k : kinds) {
+                if (!kind.empty()) kind += ",";
+                kind += k;
+            }
+            searchBook.kind = kind;
+        }
+        searchBook.wordCount = wordCountFormat(analyzeRule.getString(ruleWordCount));
+        searchBook.latestChapterTitle = analyzeRule.getString(ruleLastChapter);
+        searchBook.intro = analyzeRule.getString(ruleIntro);
+        if (const auto coverUrl = analyzeRule.getString(ruleCoverUrl); !coverUrl.empty()) {
+            searchBook.coverUrl = NetworkUtils::getAbsoluteURL(baseUrl, coverUrl);
+        }
+        searchBook.bookUrl = analyzeRule.getString(ruleBookUrl, true);
+        if (searchBook.bookUrl.empty()) {
+            searchBook.bookUrl = baseUrl;
+        }
+        analyzeRule.setBook(nullptr);
+        return searchBook;
+    }
+
+    // 列表中每一本书籍的字段规则，只拆分一次
+    struct SearchItemRules {
+        std::vector<SourceRule> name;
+        std::vector<SourceRule> bookUrl;
+        std::vector<SourceRule> author;
+        std::vector<SourceRule> coverUrl;
+        std::vector<SourceRule> intro;
+        std::vector<SourceRule> kind;
+        std::vector<SourceRule> lastChapter;
+        std::vector<SourceRule> wordCount;
+
+        SearchItemRules(AnalyzeRule &analyzeRule, const BookListRule &bookListRule)
+            : name(analyzeRule.splitSourceRule(bookListRule.name)),
+              bookUrl(analyzeRule.splitSourceRule(bookListRule.bookUrl)),
+              author(analyzeRule.splitSourceRule(bookListRule.author)),
+              coverUrl(analyzeRule.splitSourceRule(bookListRule.coverUrl)),
+              intro(analyzeRule.splitSourceRule(bookListRule.intro)),
+              kind(analyzeRule.splitSourceRule(bookListRule.kind)),
+              lastChapter(analyzeRule.splitSourceRule(bookListRule.lastChapter)),
+              wordCount(analyzeRule.splitSourceRule(bookListRule.wordCount)) {
+        }
+
+        std::optional<SearchBook> getSearchItem(
+            BookSource &bookSource,
+            AnalyzeRule &analyzeRule,
+            const RuleContent &item,
+            const std::string &baseUrl
+        ) const {
+            return BookList::getSearchItem(
+                bookSource, analyzeRule, item, baseUrl,
+                name, bookUrl, author, coverUrl, intro, kind, lastChapter, wordCount
+            );
+        }
+    };
+
+    // 搜索或者发现的书籍列表规则，发现规则中没有列表规则时使用搜索规则
+    inline BookListRule getBookListRule(BookSource &bookSource, const bool isSearch) {
+        if (isSearch || StringUtils::isNullOrEmpty(bookSource.getExploreRule().bookList)) {
+            return static_cast<BookListRule>(bookSource.getSearchRule());
+        }
+        return bookSource.getExploreRule();
+    }
+
+    // 处理正反序: 如果书籍列表规则前有 - 号表示反序, + 号表示正序，默认为正序
+    inline std::string splitListOrder(const BookListRule &bookListRule, bool &reverse) {
+        std::string ruleList = bookListRule.bookList ? bookListRule.bookList.value() : "";
+        reverse = false;
+        if (!ruleList.empty() && ruleList[0] == '-') {
+            reverse = true;
+            ruleList = ruleList.substr(1);
+        } else if (!ruleList.empty() && ruleList[0] == '+') {
+            ruleList = ruleList.substr(1);
+        }
+        return ruleList;
+    }
+
+    /**
+     * 按bookUrl去重，保留第一次出现的书籍且顺序不变，然后处理顺序反转
+     * 开放寻址的索引中只保存已保留的书籍在列表中的位置，书籍在原地前移压缩，只移动不复制
+     */
+    inline void distinctBookList(std::vector<SearchBook> &bookList, const bool reverse) {
+        const size_t n = bookList.size();
+        if (n > 1) {
+            constexpr uint32_t empty = UINT32_MAX;
+            // 负载不超过一半，一页的书籍数量通常不多，索引放在栈上
+            const size_t capacity = std::bit_ceil(n * 2);
+            std::array<uint32_t, 256> small;
+            std::vector<uint32_t> large;
+            uint32_t *slots = small.data();
+            if (capacity > small.size()) {
+                large.resize(capacity);
+                slots = large.data();
+            }
+            std::fill_n(slots, capacity, empty);
+            size_t kept = 0;
+            for (size_t i = 0; i < n; i++) {
+                const std::string_view url = bookList[i].bookUrl;
+                size_t slot = std::hash<std::string_view>()(url) & (capacity - 1);
+                while (slots[slot] != empty && bookList[slots[slot]].bookUrl != url) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                if (slots[slot] != empty) continue;
+                if (kept != i) bookList[kept] = std::move(bookList[i]);
+                slots[slot] = static_cast<uint32_t>(kept++);
+            }
+            bookList.erase(bookList.begin() + static_cast<std::ptrdiff_t>(kept), bookList.end());
+        }
+        if (reverse) {
+            std::ranges::reverse(bookList);
+        }
+    }
+
+    /**
+     * 在线程池中并行执行 extract(analyzeRule, index)，index为 [0, count)
+     * 每个线程通过 newRule() 创建自己的AnalyzeRule，js在该线程自己的js引擎中执行
+     * 结果在调用线程中按index的顺序交给 consume(index, result)，consume返回 false 时不再开始新的项，
+     * 已经在执行的项结束后返回；extract抛出的异常在按顺序轮到该项时重新抛出
+     * 不能在pool的线程中调用
+     */
+    template<typename T, typename NewRule, typename Extract, typename Consume>
+    void parallelExtract(ThreadPool &pool, const size_t count, NewRule &&newRule, Extract &&extract, Consume &&consume) {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<std::optional<T> > results(count);
+        std::vector<std::exception_ptr> errors(count);
+        std::vector<char> done(count, 0);
+        std::atomic<size_t> next{0};
+        std::atomic<bool> cancelled{false};
+        const size_t workers = std::min(pool.size(), count);
+        size_t running = workers;
+
+        for (size_t w = 0; w < workers; w++) {
+            pool.post([&] {
+                auto analyzeRule = newRule();
+                while (!cancelled.load(std::memory_order_relaxed)) {
+                    const size_t index = next.fetch_add(1);
+                    if (index >= count) break;
+                    std::optional<T> result;
+                    std::exception_ptr error;
+                    try {
+                        result = extract(analyzeRule, index);
+                    } catch (...) {
+                        error = std::current_exception();
+                    }
+                    std::lock_guard lock(mutex);
+                    results[index] = std::move(result);
+                    errors[index] = error;
+                    done[index] = 1;
+                    cv.notify_all();
+                }
+                // 在锁内通知，调用线程返回后这些局部变量就不存在了
+                std::lock_guard lock(mutex);
+                running--;
+                cv.notify_all();
+            });
+        }
+
+        std::exception_ptr error;
+        size_t cursor = 0;
+        std::unique_lock lock(mutex);
+        while (true) {
+            cv.wait(lock, [&] {
+                return running == 0 || (!cancelled && cursor < count && done[cursor]);
+            });
+            while (!cancelled && cursor < count && done[cursor]) {
+                const size_t index = cursor++;
+                auto result = std::move(results[index]);
+                const auto itemError = errors[index];
+                lock.unlock();
+                bool proceed = false;
+                if (itemError) {
+                    error = itemError;
+                } else {
+                    try {
+                        proceed = consume(index, std::move(result));
+                    } catch (...) {
+                        error = std::current_exception();
+                    }
+                }
+                lock.lock();
+                if (!proceed) {
+                    cancelled = true;
+                }
+            }
+            if (running == 0) break;
+        }
+        lock.unlock();
+        if (error) {
+            std::rethrow_exception(error);
+        }
     }
 
     /**
@@ -673,9 +1164,10 @@ namespace BookList {
     * @param isRedirect 是否为重定向后的地址
     * @param filter 过滤器，返回 false 则过滤掉该书籍
     * @param shouldBreak 当解析到的书籍数量满足中断条件时则中断，输入的size表示当前已解析到的书籍数量，返回值则表示是否中断
+    * @param pool 不为空时在线程池中并行解析每一本书籍，结果的顺序与shouldBreak的调用顺序与串行解析相同
     * @return 返回搜索到的书籍列表
     */
-    std::vector<SearchBook> analyzeBookList(
+    inline std::vector<SearchBook> analyzeBookList(
         BookSource &bookSource,
         RuleData &ruleData,
         AnalyzeUrl &analyzeUrl,
@@ -684,7 +1176,8 @@ namespace BookList {
         bool isSearch = true,
         bool isRedirect = false,
         const std::optional<BookFilter> &filter = std::nullopt,
-        const std::optional<BreakCondition> &shouldBreak = std::nullopt
+        const std::optional<BreakCondition> &shouldBreak = std::nullopt,
+        ThreadPool *pool = nullptr
     ) {
         if (!body.has_value()) {
             throw std::runtime_error("Failed to access website: " + analyzeUrl.ruleUrl);
@@ -696,66 +1189,46 @@ namespace BookList {
         if (isSearch) {
             // TODO
         }
-        auto reverse = false;
-        BookListRule bookListRule;
-        if (isSearch) {
-            bookListRule = static_cast<BookListRule>(bookSource.getSearchRule());
-        } else {
-            if (StringUtils::isNullOrEmpty(bookSource.getExploreRule().bookList)) {
-                bookListRule = static_cast<BookListRule>(bookSource.getSearchRule());
-            } else {
-                bookListRule = bookSource.getExploreRule();
-            }
-        }
-        std::string ruleList = bookListRule.bookList ? bookListRule.bookList.value() : ""; // 获取书籍列表规则
-        // 处理正反序: 如果书籍列表规则前有 - 号表示反序, + 号表示正序，默认为正序
-        if (!ruleList.empty() && ruleList[0] == '-') {
-            reverse = true;
-            ruleList = ruleList.substr(1);
-        } else if (!ruleList.empty() && ruleList[0] == '+') {
-            ruleList = ruleList.substr(1);
-        }
+        const BookListRule bookListRule = getBookListRule(bookSource, isSearch);
+        bool reverse;
+        const std::string ruleList = splitListOrder(bookListRule, reverse); // 获取书籍列表规则
         // 解析书籍列表对应的全部Elements，其中每个Element都对应于一本书籍
-        std::vector<std::any> collections = analyzeRule.getElements(ruleList);
-        if (!collections.empty() && StringUtils::isNullOrEmpty(bookSource.bookUrlPattern)) {
-            // TODO
+        std::vector<RuleContent> collections = analyzeRule.getElements(ruleList);
+        if (collections.empty() && StringUtils::isNullOrEmpty(bookSource.bookUrlPattern)) {
+            // TODO: 列表为空时按详情页解析
         } else {
-            auto ruleName = analyzeRule.splitSourceRule(bookListRule.name);
-            auto ruleBookUrl = analyzeRule.splitSourceRule(bookListRule.bookUrl);
-            auto ruleAuthor = analyzeRule.splitSourceRule(bookListRule.author);
-            auto ruleCoverUrl = analyzeRule.splitSourceRule(bookListRule.coverUrl);
-            auto ruleIntro = analyzeRule.splitSourceRule(bookListRule.intro);
-            auto ruleKind = analyzeRule.splitSourceRule(bookListRule.kind);
-            auto ruleLastChapter = analyzeRule.splitSourceRule(bookListRule.lastChapter);
-            auto ruleWordCount = analyzeRule.splitSourceRule(bookListRule.wordCount);
+            const SearchItemRules itemRules(analyzeRule, bookListRule);
             // 遍历全部书籍Elements，对每个书籍Element根据给定的书籍基本信息规则解析获得SearchBook
-            for (auto index = 0; index < collections.size(); index++) {
-                auto item = collections[index];
-                auto searchBook = getSearchItem();
+            const auto extract = [&](AnalyzeRule &rule, const size_t index) {
+                return itemRules.getSearchItem(bookSource, rule, collections[index], baseUrl);
+            };
+            const auto consume = [&](size_t, std::optional<SearchBook> &&searchBook) {
                 if (searchBook.has_value()) {
                     if (baseUrl == searchBook->bookUrl) {
                         searchBook->infoHtml = body;
                     }
-                    bookList.push_back(searchBook.value());
+                    bookList.push_back(std::move(searchBook.value()));
                 }
                 // 当解析到的书籍数量满足中断条件时则中断
-                if (shouldBreak.has_value() && shouldBreak.value()(bookList.size())) {
-                    break;
-                }
-            }
-            // 去重的同时保证顺序不变
-            std::unordered_set<SearchBook> seen;
-            std::vector<SearchBook> lh;
-            for (const auto& item : bookList) {
-                if (seen.insert(item).second) {
-                    lh.push_back(item);
+                return !(shouldBreak.has_value() && shouldBreak.value()(bookList.size()));
+            };
+            if (pool != nullptr && collections.size() > 1) {
+                // 每个线程使用自己的AnalyzeRule，列表中的项仍然指向同一个只读的文档
+                const auto newRule = [&] {
+                    AnalyzeRule rule(&ruleData, &bookSource);
+                    rule.setBaseUrl(baseUrl);
+                    rule.setRedirectUrl(baseUrl);
+                    return rule;
+                };
+                parallelExtract<SearchBook>(*pool, collections.size(), newRule, extract, consume);
+            } else {
+                for (size_t index = 0; index < collections.size(); index++) {
+                    if (!consume(index, extract(analyzeRule, index))) {
+                        break;
+                    }
                 }
             }
-            bookList = lh;
-            // 处理顺序反转
-            if (reverse) {
-                std::ranges::reverse(bookList);
-            }
+            distinctBookList(bookList, reverse);
         }
         return bookList;
     }
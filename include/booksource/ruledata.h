@@ -1,4 +1,6 @@
 #pragma once
+#include <atomic>
+#include <mutex>
 #include <unordered_map>
 #include <string>
 #include <optional>
@@ -69,18 +71,66 @@ static std::vector<std::string> splitNotBlank(const std::string& str, const std:
     return result;
 }
 
+/**
+ * 变量的json文本，variableMap修改后在第一次读取时才生成
+ * 生成时加锁，多个线程可以同时读取同一个const对象；复制时复制文本以及是否需要重新生成
+ */
+class VariableText {
+public:
+    VariableText() = default;
+
+    explicit VariableText(std::optional<std::string> text) : text(std::move(text)) {
+    }
+
+    VariableText(const VariableText &other);
+
+    VariableText(VariableText &&other) noexcept;
+
+    VariableText &operator=(const VariableText &other);
+
+    VariableText &operator=(VariableText &&other) noexcept;
+
+    // variableMap修改后调用，与其他读写不能同时进行
+    void invalidate() {
+        changed.store(true, std::memory_order_relaxed);
+    }
+
+    // 替换为保存的文本，与其他读写不能同时进行
+    void reset(std::optional<std::string> value) {
+        text = std::move(value);
+        changed.store(false, std::memory_order_relaxed);
+    }
+
+    // 需要时由map生成文本
+    const std::optional<std::string> &get(const std::unordered_map<std::string, std::string> &map) const;
+
+private:
+    mutable std::mutex mutex;
+    mutable std::optional<std::string> text = std::nullopt;
+    mutable std::atomic<bool> changed{false};
+};
+
 class BaseBook: RuleData {
     std::string name;
     std::string author;
     std::string bookUrl;
     std::optional<std::string> kind;
     std::optional<std::string> wordCount;
-    std::optional<std::string> variable;
+    VariableText variable;
     std::optional<std::string> infoHtml;
     std::optional<std::string> tocHtml;
 public:
+    using RuleData::getVariable;
+
+    // 只修改variableMap，转为json文本推迟到getVariableString()
     bool putVariable(const std::string &key, const std::optional<std::string> &value) override;
 
+    // 变量的json文本，用于保存；putVariable()之后第一次调用时才由variableMap生成
+    const std::optional<std::string> &getVariableString() const;
+
+    // 读回保存的变量，替换现有的全部变量
+    void setVariableString(std::optional<std::string> value);
+
     void putCustomVariable(const std::optional<std::string> &value) {
         putVariable("custom", value);
     }
@@ -121,7 +171,6 @@ public:
     std::optional<std::string> startFragmentId = std::nullopt;
     std::optional<std::string> endFragmentId = std::nullopt;
 
-    std::optional<std::string> variable = std::nullopt;
     std::optional<std::string> titleMD5 = std::nullopt;
 
     explicit BookChapter(
@@ -143,6 +192,17 @@ public:
         std::optional<std::string> variable = std::nullopt
     );
 
+    using RuleData::getVariable;
+
+    // 只修改variableMap，转为json文本推迟到getVariableString()
     bool putVariable(const std::string &key, const std::optional<std::string> &value) override;
 
+    // 变量的json文本，用于保存；putVariable()之后第一次调用时才由variableMap生成
+    const std::optional<std::string> &getVariableString() const;
+
+    // 章节的绝对地址，保留url中",{...}"的请求参数；以标题开头的卷名返回baseUrl
+    std::string getAbsoluteURL() const;
+
+private:
+    VariableText variable;
 };
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+/**
+ * 固定线程数的线程池，任务按提交顺序执行
+ * 线程常驻，每个线程的js引擎（QuickJsEngine::current()）只创建一次，之后在该线程的全部任务中复用
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+
+    // 等待已提交的任务全部执行完成后退出
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void post(std::function<void()> task);
+
+    size_t size() const {
+        return threads.size();
+    }
+
+private:
+    void run();
+
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()> > tasks;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+};
+
+/**
+ * 在pool中执行task，返回结果的future；pool为空时在当前线程中立即执行
+ */
+template<typename F>
+std::future<std::invoke_result_t<F> > submit(ThreadPool *pool, F &&task) {
+    auto packaged = std::make_shared<std::packaged_task<std::invoke_result_t<F>()> >(std::forward<F>(task));
+    auto future = packaged->get_future();
+    if (pool != nullptr) {
+        pool->post([packaged] { (*packaged)(); });
+    } else {
+        (*packaged)();
+    }
+    return future;
+}
@@ -4,8 +4,12 @@
 #include <string>
 #include <functional>
 #include <optional>
+#include <exception>
 #include <booksource/data.h>
 #include <booksource/rule.h>
+#include <booksource/liststream.h>
+#include <booksource/chapterlist.h>
+#include <booksource/content.h>
 
 
 namespace WebBook {
@@ -13,12 +17,83 @@ namespace WebBook {
 
     using BreakCondition = std::function<bool(int size)>;
 
+    /**
+     * 请求书籍列表页，边下载边解析，满足shouldBreak时中断传输，不必等待完整的网页
+     * 列表规则不支持流式解析（见ListStream）、流式解析失败或者没有结果时，下载完成后按analyzeBookList()解析完整的网页
+     * 中断传输时没有完整的网页，详情页与列表页相同的书籍不设置infoHtml
+     */
+    inline std::vector<SearchBook> getBookListStream(
+        BookSource &bookSource,
+        RuleData &ruleData,
+        AnalyzeUrl &analyzeUrl,
+        const bool isSearch = true,
+        const std::optional<BookFilter> &filter = std::nullopt,
+        const std::optional<BreakCondition> &shouldBreak = std::nullopt,
+        ThreadPool *pool = nullptr
+    ) {
+        const BookListRule bookListRule = BookList::getBookListRule(bookSource, isSearch);
+        bool reverse;
+        const std::string ruleList = BookList::splitListOrder(bookListRule, reverse);
+        std::string baseUrl = analyzeUrl.url;
+        auto analyzeRule = AnalyzeRule(&ruleData, &bookSource);
+        analyzeRule.setBaseUrl(baseUrl);
+        analyzeRule.setRedirectUrl(baseUrl);
+        std::optional<BookList::SearchItemRules> itemRules;
+        std::vector<SearchBook> bookList;
+        std::unique_ptr<ListStream> stream;
+        stream = ListStream::create(ruleList, analyzeUrl.getCharset(), [&](RuleContent &&item) {
+            if (!itemRules.has_value()) {
+                // 规则的模式取决于拆分时的内容是否为json，与完整解析时一样按列表页的格式拆分
+                analyzeRule.setContent(std::string(stream->isJson() ? "[]" : ""));
+                itemRules.emplace(analyzeRule, bookListRule);
+            }
+            if (auto searchBook = itemRules->getSearchItem(bookSource, analyzeRule, item, baseUrl)) {
+                bookList.push_back(std::move(searchBook.value()));
+            }
+            // 与analyzeBookList()相同，按去重之前的数量判断中断条件
+            return !(shouldBreak.has_value() && shouldBreak.value()(static_cast<int>(bookList.size())));
+        });
+        if (stream == nullptr) {
+            auto res = analyzeUrl.getStrResponse();
+            return BookList::analyzeBookList(bookSource, ruleData, analyzeUrl, res.url, res.body, isSearch, false,
+                                             filter, shouldBreak, pool);
+        }
+        // 回调在curl的写回调中执行，异常不能穿过curl，先保存下来
+        std::exception_ptr error;
+        auto res = analyzeUrl.getStrResponse([&](const std::string_view data, const std::string_view contentType) {
+            try {
+                return stream->feed(data, contentType);
+            } catch (...) {
+                error = std::current_exception();
+                return false;
+            }
+        });
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        stream->finish();
+        if (stream->failed() || (stream->count() == 0 && !stream->stopped())) {
+            return BookList::analyzeBookList(bookSource, ruleData, analyzeUrl, res.url, res.body, isSearch, false,
+                                             filter, shouldBreak, pool);
+        }
+        if (!stream->stopped()) {
+            for (auto &searchBook: bookList) {
+                if (res.url == searchBook.bookUrl) {
+                    searchBook.infoHtml = res.body;
+                }
+            }
+        }
+        BookList::distinctBookList(bookList, reverse);
+        return bookList;
+    }
+
     inline std::vector<SearchBook> searchBook(
         BookSource &bookSource,
         const std::string &key,
         std::optional<int> page = 1,
         const std::optional<BookFilter> &filter = std::nullopt,
-        const std::optional<BreakCondition> &shouldBreak = std::nullopt
+        const std::optional<BreakCondition> &shouldBreak = std::nullopt,
+        ThreadPool *pool = nullptr
     ) {
         const auto &searchUrl = bookSource.searchUrl;
         // searchUrl为null或者空字符串时抛异常
@@ -33,6 +108,10 @@ namespace WebBook {
             &bookSource,
             &ruleData
         );
+        if (shouldBreak.has_value()) {
+            // 只需要前面的结果，边下载边解析，满足条件后不再下载剩余的网页
+            return getBookListStream(bookSource, ruleData, analyzeUrl, true, filter, shouldBreak, pool);
+        }
         // 获取搜索结果的网页内容
         auto res = analyzeUrl.getStrResponse();
         // 检测书源是否已登录
@@ -45,7 +124,94 @@ namespace WebBook {
         return BookList::analyzeBookList(
             bookSource, ruleData, analyzeUrl,
             res.url, res.body, true, false,
-            filter, shouldBreak
+            filter, shouldBreak, pool
+        );
+    }
+
+    // 执行目录规则的preUpdateJs
+    inline void runPreUpdateJs(BookSource &bookSource, RuleData &ruleData) {
+        if (bookSource.ruleToc.has_value() && !StringUtils::isNullOrEmpty(bookSource.ruleToc->preUpdateJs)) {
+            AnalyzeRule(&ruleData, &bookSource, true).evalJS(bookSource.ruleToc->preUpdateJs.value());
+        }
+    }
+
+    /**
+     * 获取目录，目录页与详情页相同且已经有详情页内容时不再请求
+     * 目录分页时的处理见BookChapterList，pool不为空时多个目录页并发下载
+     * @param fingerprint 不为空时写入目录的指纹，用于之后的updateChapterList()
+     */
+    inline std::vector<BookChapter> getChapterList(
+        BookSource &bookSource,
+        Book &book,
+        RuleData &ruleData,
+        ThreadPool *pool = nullptr,
+        BookChapterList::TocFingerprint *fingerprint = nullptr
+    ) {
+        runPreUpdateJs(bookSource, ruleData);
+        if (book.bookUrl == book.tocUrl && !book.tocHtml.empty()) {
+            return BookChapterList::analyzeChapterList(bookSource, book, ruleData, book.tocUrl, book.tocUrl,
+                                                       book.tocHtml, pool, fingerprint);
+        }
+        auto analyzeUrl = AnalyzeUrl(
+            book.tocUrl, std::nullopt, std::nullopt,
+            std::nullopt, std::nullopt,
+            book.bookUrl,
+            &bookSource,
+            &ruleData
+        );
+        auto res = analyzeUrl.getStrResponse();
+        return BookChapterList::analyzeChapterList(bookSource, book, ruleData, book.tocUrl, res.url, res.body, pool,
+                                                   fingerprint);
+    }
+
+    /**
+     * 刷新书架时增量更新目录，只下载与解析新增章节所在的目录页，见BookChapterList::updateChapterList()
+     */
+    inline BookChapterList::TocUpdate updateChapterList(
+        BookSource &bookSource,
+        Book &book,
+        RuleData &ruleData,
+        BookChapterList::TocFingerprint &fingerprint,
+        ThreadPool *pool = nullptr
+    ) {
+        runPreUpdateJs(bookSource, ruleData);
+        return BookChapterList::updateChapterList(bookSource, book, ruleData, fingerprint, pool);
+    }
+
+    /**
+     * 获取正文，章节页与详情页相同且已经有详情页内容时不再请求
+     * 正文分页时的处理见BookContent，没有正文规则时返回章节的地址
+     * @param nextChapterUrl 下一章的绝对地址（BookChapter::getAbsoluteURL()），正文的下一页为该地址时停止
+     */
+    inline std::string getContent(
+        BookSource &bookSource,
+        const Book &book,
+        BookChapter &chapter,
+        RuleData &ruleData,
+        const std::optional<std::string> &nextChapterUrl = std::nullopt,
+        ThreadPool *pool = nullptr
+    ) {
+        if (!bookSource.ruleContent.has_value() || StringUtils::isNullOrEmpty(bookSource.ruleContent->content)) {
+            return chapter.url;
+        }
+        if (chapter.isVolume && chapter.url.starts_with(chapter.title)) {
+            return chapter.tag.value_or("");
+        }
+        const std::string url = chapter.getAbsoluteURL();
+        if (url == book.bookUrl && !book.tocHtml.empty()) {
+            return BookContent::analyzeContent(bookSource, chapter, ruleData, url, url, book.tocHtml, nextChapterUrl,
+                                               pool);
+        }
+        auto analyzeUrl = AnalyzeUrl(
+            url, std::nullopt, std::nullopt,
+            std::nullopt, std::nullopt,
+            chapter.baseUrl,
+            &bookSource,
+            &ruleData,
+            &chapter
         );
+        auto res = analyzeUrl.getStrResponse();
+        return BookContent::analyzeContent(bookSource, chapter, ruleData, url, res.url, res.body, nextChapterUrl,
+                                           pool);
     }
 }
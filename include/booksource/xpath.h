@@ -0,0 +1,93 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <booksource/html.h>
+
+/**
+ * XPath 1.0：编译一次，之后在任意文档上重复执行，与css选择器使用同一棵Html::Node树
+ * 支持：
+ * 1. 绝对与相对路径，'//'、'.'、'..'、'@attr'、'*'，以及'|'合并
+ * 2. 轴：child、descendant、descendant-or-self、self、parent、ancestor、ancestor-or-self、
+ *    following-sibling、preceding-sibling、following、preceding、attribute
+ * 3. 谓词：位置索引 [1]、[last()]、[position()<3]，比较、算术与 and/or
+ * 4. 函数：last、position、count、string、concat、contains、starts-with、ends-with、substring、
+ *    substring-before、substring-after、string-length、normalize-space、translate、not、true、false、
+ *    boolean、number、sum、floor、ceiling、round、name、local-name
+ * 5. 与阅读(Legado)使用的JsoupXpath一致的取值函数，只能作为路径的最后一步：
+ *    text()（元素自身的文本，script为其内容；'//text()'为全部后代文本节点）、allText()、html()、outerHtml()、num()
+ *
+ * 绝对路径从执行时传入的根节点开始，在子元素上执行时不会越出该元素
+ */
+namespace Xpath {
+
+    struct Expr;
+
+    class Expression {
+    public:
+        /**
+         * 编译表达式，语法错误时抛出 std::invalid_argument
+         */
+        static std::shared_ptr<const Expression> parse(const std::string &xpath);
+
+        /**
+         * 与parse()相同，但以xpath为key缓存编译结果，规则中的表达式只编译一次
+         * 语法错误时返回nullptr
+         */
+        static std::shared_ptr<const Expression> compile(const std::string &xpath);
+
+        explicit Expression(std::shared_ptr<const Expr> expr);
+
+        /**
+         * 在root上执行，返回结果中的元素，按文档顺序排列
+         */
+        Html::Elements selectElements(const Html::Node *root) const;
+
+        /**
+         * 在root上执行，返回结果的字符串形式：
+         * 元素为outerHtml，属性为属性值，文本节点为文本，取值函数与其他函数为其结果
+         */
+        std::vector<std::string> selectStrings(const Html::Node *root) const;
+
+    private:
+        std::shared_ptr<const Expr> expr;
+    };
+}
+
+/**
+ * XPath规则的解析，如：@XPath://div[@class='item']/a/@href、//ul[@id='list']/li[position()>1]
+ * '&&'、'||'、'%%' 分别表示合并、取第一个有结果的规则、交替合并，与阅读(Legado)保持一致
+ */
+class AnalyzeByXPath {
+public:
+    // 解析html，以<?xml开头时按xml解析
+    explicit AnalyzeByXPath(const std::string &html);
+
+    /**
+     * 在已经解析好的文档上执行规则
+     * @param element 规则的起始元素，为空时从文档根节点开始
+     */
+    explicit AnalyzeByXPath(std::shared_ptr<const Html::Document> document, const Html::Node *element = nullptr);
+
+    // 获取列表
+    Html::Elements getElements(const std::string &rule) const;
+
+    // 获取全部内容，以换行符连接，规则为空或者没有结果时返回 std::nullopt
+    std::optional<std::string> getString(const std::string &rule) const;
+
+    // 获取内容列表
+    std::vector<std::string> getStringList(const std::string &rule) const;
+
+    const std::shared_ptr<const Html::Document> &getDocument() const {
+        return document;
+    }
+
+    const Html::Node *getElement() const {
+        return element;
+    }
+
+private:
+    std::shared_ptr<const Html::Document> document;
+    const Html::Node *element;
+};
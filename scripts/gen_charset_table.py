@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""
+生成 src/charset_table.inc：GB18030(GBK) 与 Big5 到 Unicode 的查找表
+
+用法：python3 scripts/gen_charset_table.py > src/charset_table.inc
+表的布局与 WHATWG Encoding Standard 中的 index pointer 一致：
+  - GB18030 双字节：pointer = (lead - 0x81) * 190 + (trail - (trail < 0x7F ? 0x40 : 0x41))
+  - GB18030 四字节：按 ranges 表做线性映射（仅 BMP，补充平面为固定偏移）
+  - Big5：pointer = (lead - 0x81) * 157 + (trail - (trail < 0x7F ? 0x40 : 0x62))
+"""
+
+
+def gb18030_two_byte():
+    table = []
+    for lead in range(0x81, 0xFF):
+        for trail in range(0x40, 0xFF):
+            if trail == 0x7F:
+                continue
+            try:
+                s = bytes([lead, trail]).decode('gb18030')
+                table.append(ord(s) if len(s) == 1 and ord(s) <= 0xFFFF else 0)
+            except UnicodeDecodeError:
+                table.append(0)
+    return table
+
+
+def gb18030_ranges():
+    ranges = []
+    prev = None
+    for cp in range(0x80, 0x10000):
+        if 0xD800 <= cp <= 0xDFFF:
+            continue
+        try:
+            b = chr(cp).encode('gb18030')
+        except UnicodeEncodeError:
+            continue
+        if len(b) != 4:
+            continue
+        pointer = (b[0] - 0x81) * 12600 + (b[1] - 0x30) * 1260 + (b[2] - 0x81) * 10 + (b[3] - 0x30)
+        if prev is None or pointer - cp != prev:
+            ranges.append((pointer, cp))
+            prev = pointer - cp
+    return ranges
+
+
+def big5():
+    table = []
+    for lead in range(0x81, 0xFF):
+        for trail in list(range(0x40, 0x7F)) + list(range(0xA1, 0xFF)):
+            try:
+                s = bytes([lead, trail]).decode('cp950')
+                table.append(ord(s) if len(s) == 1 and ord(s) <= 0xFFFF else 0)
+            except UnicodeDecodeError:
+                table.append(0)
+    return table
+
+
+def dump(name, values):
+    print(f'static constexpr uint16_t {name}[{len(values)}] = {{')
+    for i in range(0, len(values), 16):
+        print('    ' + ', '.join(f'0x{v:04X}' for v in values[i:i + 16]) + ',')
+    print('};')
+    print()
+
+
+def main():
+    print('// 由 scripts/gen_charset_table.py 生成，请勿手动修改')
+    print('#pragma once')
+    print('#include <cstdint>')
+    print()
+    dump('GB18030_TWO_BYTE', gb18030_two_byte())
+    ranges = gb18030_ranges()
+    print(f'static constexpr uint32_t GB18030_RANGES[{len(ranges)}][2] = {{')
+    for pointer, cp in ranges:
+        print(f'    {{{pointer}, 0x{cp:04X}}},')
+    print('};')
+    print()
+    dump('BIG5_TABLE', big5())
+
+
+if __name__ == '__main__':
+    main()
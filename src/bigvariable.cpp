@@ -0,0 +1,22 @@
+#include <booksource/bigvariable.h>
+
+DiskRuleData::DiskRuleData(std::shared_ptr<ChapterStore> store, std::string owner)
+    : store(std::move(store)), owner(std::move(owner)) {
+}
+
+std::string DiskRuleData::storeKey(const std::string &key) const {
+    // 书籍地址与变量名中都不会有换行
+    return owner + '\n' + key;
+}
+
+void DiskRuleData::putBigVariable(const std::string &key, const std::optional<std::string> &value) {
+    if (value.has_value()) {
+        store->put(storeKey(key), 0, *value);
+    } else {
+        store->remove(storeKey(key));
+    }
+}
+
+std::optional<std::string> DiskRuleData::getBigVariable(const std::string &key) const {
+    return store->get(storeKey(key));
+}
@@ -0,0 +1,969 @@
+#include <booksource/bookshelf.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr char fileMagic[8] = {'B', 'S', 'S', 'H', 'E', 'L', 'F', '1'};
+    constexpr uint32_t frameMagic = 0x46534253; // "BSSF"
+
+    struct FrameHeader {
+        uint32_t magic;
+        uint32_t count;    // 操作数
+        uint64_t length;   // 操作的字节数
+        uint64_t checksum;
+    };
+
+    // 每个操作为 类型(1字节) + 长度(4字节) + 内容
+    enum OpType : uint8_t {
+        PutBook = 1,
+        RemoveBook = 2,
+        PutChapters = 3,
+        PutSearchBook = 4,
+        RemoveSearchBook = 5
+    };
+
+    constexpr size_t opHeaderSize = 5;
+    constexpr uint32_t noString = UINT32_MAX;
+
+    uint64_t checksum(const std::string_view data) {
+        uint64_t h = 1469598103934665603ULL;
+        size_t i = 0;
+        for (; i + 8 <= data.size(); i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data.data() + i, 8);
+            h = (h ^ word) * 0x9E3779B97F4A7C15ULL;
+            h ^= h >> 29;
+        }
+        for (; i < data.size(); i++) {
+            h ^= static_cast<unsigned char>(data[i]);
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    /* ---------- 书籍与搜索结果：全部字段按固定的顺序写入 ---------- */
+
+    class Encoder {
+    public:
+        std::string &out;
+
+        void operator()(const std::string &s) const {
+            u32(static_cast<uint32_t>(s.size()));
+            out += s;
+        }
+
+        void operator()(const std::optional<std::string> &s) const {
+            if (s.has_value()) {
+                operator()(*s);
+            } else {
+                u32(noString);
+            }
+        }
+
+        void operator()(const bool value) const {
+            out += static_cast<char>(value);
+        }
+
+        void operator()(const int value) const {
+            u32(static_cast<uint32_t>(value));
+        }
+
+        void operator()(const long value) const {
+            const auto v = static_cast<int64_t>(value);
+            out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+        }
+
+        void operator()(const DateUtils::LocalDate &date) const {
+            operator()(static_cast<int>(std::chrono::sys_days(date).time_since_epoch().count()));
+        }
+
+        void u32(const uint32_t value) const {
+            out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+    };
+
+    class Decoder {
+    public:
+        const char *p;
+        const char *end;
+        bool ok = true;
+
+        void operator()(std::string &s) {
+            const uint32_t size = u32();
+            s.assign(take(size == noString ? 0 : size));
+        }
+
+        void operator()(std::optional<std::string> &s) {
+            const uint32_t size = u32();
+            if (size == noString) {
+                s.reset();
+            } else {
+                s.emplace(take(size));
+            }
+        }
+
+        void operator()(bool &value) {
+            value = !take(1).empty() && p[-1] != 0;
+        }
+
+        void operator()(int &value) {
+            value = static_cast<int>(u32());
+        }
+
+        void operator()(long &value) {
+            int64_t v = 0;
+            const std::string_view s = take(sizeof(v));
+            if (!s.empty()) std::memcpy(&v, s.data(), sizeof(v));
+            value = static_cast<long>(v);
+        }
+
+        void operator()(DateUtils::LocalDate &date) {
+            int days = 0;
+            operator()(days);
+            date = DateUtils::LocalDate(std::chrono::sys_days(std::chrono::days(days)));
+        }
+
+        uint32_t u32() {
+            uint32_t value = 0;
+            const std::string_view s = take(sizeof(value));
+            if (!s.empty()) std::memcpy(&value, s.data(), sizeof(value));
+            return value;
+        }
+
+        std::string_view take(const size_t size) {
+            if (static_cast<size_t>(end - p) < size) {
+                ok = false;
+                p = end;
+                return {};
+            }
+            const std::string_view s(p, size);
+            p += size;
+            return s;
+        }
+    };
+
+    // 不保存infoHtml、tocHtml与downloadUrls，与阅读的数据库相同
+    template<typename B, typename F>
+    void bookFields(B &book, F &&f) {
+        f(book.bookUrl);
+        f(book.tocUrl);
+        f(book.origin);
+        f(book.originName);
+        f(book.name);
+        f(book.author);
+        f(book.kind);
+        f(book.customTag);
+        f(book.coverUrl);
+        f(book.customCoverUrl);
+        f(book.intro);
+        f(book.customIntro);
+        f(book.charset);
+        f(book.type);
+        f(book.group);
+        f(book.latestChapterTitle);
+        f(book.latestChapterTime);
+        f(book.lastCheckTime);
+        f(book.lastCheckCount);
+        f(book.totalChapterNum);
+        f(book.durChapterTitle);
+        f(book.durChapterIndex);
+        f(book.durChapterPos);
+        f(book.durChapterTime);
+        f(book.wordCount);
+        f(book.canUpdate);
+        f(book.order);
+        f(book.originOrder);
+        f(book.variable);
+        f(book.readConfig.reverseToc);
+        f(book.readConfig.pageAnim);
+        f(book.readConfig.reSegment);
+        f(book.readConfig.imageStyle);
+        f(book.readConfig.useReplaceRule);
+        f(book.readConfig.delTag);
+        f(book.readConfig.ttsEngine);
+        f(book.readConfig.splitLongChapter);
+        f(book.readConfig.readSimulating);
+        f(book.readConfig.startDate);
+        f(book.readConfig.startChapter);
+        f(book.readConfig.dailyChapters);
+        f(book.syncTime);
+    }
+
+    template<typename B, typename F>
+    void searchBookFields(B &book, F &&f) {
+        f(book.bookUrl);
+        f(book.origin);
+        f(book.originName);
+        f(book.type);
+        f(book.name);
+        f(book.author);
+        f(book.kind);
+        f(book.coverUrl);
+        f(book.intro);
+        f(book.wordCount);
+        f(book.latestChapterTitle);
+        f(book.tocUrl);
+        f(book.time);
+        // 搜索规则中@put的变量保存在BaseBook的variableMap中
+        if constexpr (std::is_const_v<B>) {
+            f(book.getVariableString());
+        } else {
+            std::optional<std::string> variable;
+            f(variable);
+            book.setVariableString(std::move(variable));
+        }
+        f(book.originOrder);
+        f(book.chapterWordCountText);
+        f(book.chapterWordCount);
+        f(book.respondTime);
+    }
+
+    /* ---------- 目录：bookUrl、章节数、字符串堆大小、定长记录数组、字符串堆 ---------- */
+
+    struct StringRef {
+        uint32_t offset; // noString表示 std::nullopt
+        uint32_t size;
+    };
+
+    enum ChapterFlags : uint32_t {
+        Volume = 1,
+        Vip = 2,
+        Pay = 4
+    };
+
+    // 较少使用的字段放在extra中，每个为 字段编号(1字节) + 内容
+    enum ExtraField : uint8_t {
+        ResourceUrl = 1,
+        Start = 2,
+        End = 3,
+        StartFragmentId = 4,
+        EndFragmentId = 5,
+        Variable = 6,
+        TitleMD5 = 7
+    };
+
+    struct ChapterRecord {
+        int32_t index;
+        uint32_t flags;
+        StringRef url;
+        StringRef title;
+        StringRef baseUrl;
+        StringRef bookUrl;
+        StringRef tag;
+        StringRef wordCount;
+        StringRef extra;
+    };
+
+    static_assert(sizeof(ChapterRecord) == 64);
+
+    // 字符串堆，相同的字符串（如同一本书的baseUrl）只保存一次
+    class StringHeap {
+    public:
+        std::string data;
+
+        StringRef add(const std::string_view s) {
+            if (const auto it = offsets.find(s); it != offsets.end()) {
+                return {it->second, static_cast<uint32_t>(s.size())};
+            }
+            const auto offset = static_cast<uint32_t>(data.size());
+            data += s;
+            offsets.emplace(s, offset);
+            return {offset, static_cast<uint32_t>(s.size())};
+        }
+
+        StringRef add(const std::optional<std::string> &s) {
+            return s.has_value() ? add(std::string_view(*s)) : StringRef{noString, 0};
+        }
+
+    private:
+        std::unordered_map<std::string_view, uint32_t> offsets; // 指向章节中的字符串
+    };
+
+    std::string encodeExtra(const BookChapter &chapter) {
+        std::string extra;
+        const auto putString = [&](const ExtraField field, const std::optional<std::string> &value) {
+            if (!value.has_value()) return;
+            extra += static_cast<char>(field);
+            Encoder{extra}(*value);
+        };
+        const auto putLong = [&](const ExtraField field, const std::optional<long> &value) {
+            if (!value.has_value()) return;
+            extra += static_cast<char>(field);
+            Encoder{extra}(*value);
+        };
+        putString(ResourceUrl, chapter.resourceUrl);
+        putLong(Start, chapter.start);
+        putLong(End, chapter.end);
+        putString(StartFragmentId, chapter.startFragmentId);
+        putString(EndFragmentId, chapter.endFragmentId);
+        putString(Variable, chapter.getVariableString());
+        putString(TitleMD5, chapter.titleMD5);
+        return extra;
+    }
+
+    // extra为encodeExtra()的结果，与chapter一起在写入前保持有效
+    ChapterRecord makeRecord(StringHeap &heap, const BookChapter &chapter, const std::string &extra) {
+        return ChapterRecord{
+            chapter.index,
+            (chapter.isVolume ? Volume : 0U) | (chapter.isVip ? Vip : 0U) | (chapter.isPay ? Pay : 0U),
+            heap.add(std::string_view(chapter.url)),
+            heap.add(std::string_view(chapter.title)),
+            heap.add(std::string_view(chapter.baseUrl)),
+            heap.add(std::string_view(chapter.bookUrl)),
+            heap.add(chapter.tag),
+            heap.add(chapter.wordCount),
+            extra.empty() ? StringRef{noString, 0} : heap.add(std::string_view(extra))
+        };
+    }
+
+    void beginOp(std::string &out, const OpType type, size_t &lengthPos) {
+        out += static_cast<char>(type);
+        lengthPos = out.size();
+        out.append(4, '\0');
+    }
+
+    void endOp(std::string &out, const size_t lengthPos) {
+        const auto length = static_cast<uint32_t>(out.size() - lengthPos - 4);
+        std::memcpy(out.data() + lengthPos, &length, sizeof(length));
+    }
+
+    // PutChapters操作：bookUrl、章节数、字符串堆的字节数、记录数组、字符串堆
+    void appendChapters(std::string &out, const std::string &bookUrl, const std::vector<ChapterRecord> &records,
+                        const StringHeap &heap) {
+        size_t lengthPos;
+        beginOp(out, PutChapters, lengthPos);
+        const Encoder encoder{out};
+        encoder(bookUrl);
+        encoder.u32(static_cast<uint32_t>(records.size()));
+        encoder.u32(static_cast<uint32_t>(heap.data.size()));
+        out.append(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(ChapterRecord));
+        out += heap.data;
+        endOp(out, lengthPos);
+    }
+
+    /**
+     * 检查帧中的操作没有越界：每个操作在帧内，目录的记录数组与字符串堆在操作内
+     * 只有最后一帧有校验，其余的帧损坏时可能越界读取映射之外的内容
+     */
+    bool validOps(const std::string_view ops, const uint32_t count) {
+        size_t pos = 0;
+        for (uint32_t n = 0; n < count; n++) {
+            if (ops.size() - pos < opHeaderSize) return false;
+            uint32_t length;
+            std::memcpy(&length, ops.data() + pos + 1, sizeof(length));
+            const size_t body = pos + opHeaderSize;
+            if (length > ops.size() - body) return false;
+            if (static_cast<OpType>(ops[pos]) == PutChapters) {
+                Decoder decoder{ops.data() + body, ops.data() + body + length};
+                std::string bookUrl;
+                decoder(bookUrl);
+                const uint64_t chapterCount = decoder.u32();
+                const uint64_t heapSize = decoder.u32();
+                if (!decoder.ok || chapterCount * sizeof(ChapterRecord) + heapSize >
+                                   static_cast<uint64_t>(decoder.end - decoder.p)) {
+                    return false;
+                }
+            }
+            pos = body + length;
+        }
+        return true;
+    }
+
+    // 重命名之后同步所在的目录，保证新的目录项落盘
+    void syncDirectory(const std::string &file) {
+        const size_t slash = file.rfind('/');
+        const std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : file.substr(0, slash);
+        const int dirFd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd < 0) return;
+        ::fsync(dirFd);
+        ::close(dirFd);
+    }
+
+    bool writeAll(const int fd, const char *data, size_t size, off_t offset) {
+        while (size > 0) {
+            const ssize_t n = ::pwrite(fd, data, size, offset);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += n;
+            size -= n;
+            offset += n;
+        }
+        return true;
+    }
+}
+
+struct BookShelf::Mapping {
+    const char *data = nullptr;
+    size_t size = 0;
+
+    Mapping(const int fd, const size_t size) : size(size) {
+        if (size == 0) return;
+        void *p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) throw std::runtime_error("Failed to map bookshelf");
+        data = static_cast<const char *>(p);
+    }
+
+    ~Mapping() {
+        if (data != nullptr) ::munmap(const_cast<char *>(data), size);
+    }
+
+    Mapping(const Mapping &) = delete;
+
+    Mapping &operator=(const Mapping &) = delete;
+};
+
+/* ---------- Batch ---------- */
+
+BookShelf::Batch &BookShelf::Batch::putBook(const Book &book) {
+    size_t lengthPos;
+    beginOp(data, PutBook, lengthPos);
+    bookFields(book, Encoder{data});
+    endOp(data, lengthPos);
+    count++;
+    return *this;
+}
+
+BookShelf::Batch &BookShelf::Batch::removeBook(const std::string &bookUrl) {
+    size_t lengthPos;
+    beginOp(data, RemoveBook, lengthPos);
+    Encoder{data}(bookUrl);
+    endOp(data, lengthPos);
+    count++;
+    return *this;
+}
+
+BookShelf::Batch &BookShelf::Batch::putChapters(const std::string &bookUrl, const std::vector<BookChapter> &chapters) {
+    std::vector<const BookChapter *> sorted;
+    sorted.reserve(chapters.size());
+    for (const auto &chapter: chapters) sorted.push_back(&chapter);
+    std::ranges::stable_sort(sorted, {}, &BookChapter::index);
+
+    StringHeap heap;
+    std::vector<std::string> extras(sorted.size());
+    std::vector<ChapterRecord> records(sorted.size());
+    for (size_t i = 0; i < sorted.size(); i++) {
+        extras[i] = encodeExtra(*sorted[i]);
+        records[i] = makeRecord(heap, *sorted[i], extras[i]);
+    }
+    appendChapters(data, bookUrl, records, heap);
+    count++;
+    return *this;
+}
+
+BookShelf::Batch &BookShelf::Batch::putChapters(const std::string &bookUrl, const ChapterList &chapters) {
+    std::vector<uint32_t> sorted(chapters.size());
+    for (uint32_t i = 0; i < sorted.size(); i++) sorted[i] = i;
+    std::ranges::stable_sort(sorted, {}, [&](const uint32_t i) { return chapters[i].index(); });
+
+    // 字符串直接取自目录的字符串区，只有带其余字段的章节生成完整的BookChapter
+    StringHeap heap;
+    std::deque<std::pair<BookChapter, std::string> > full;
+    std::vector<ChapterRecord> records(sorted.size());
+    for (size_t i = 0; i < sorted.size(); i++) {
+        const ChapterList::View chapter = chapters[sorted[i]];
+        if (chapter.hasExtra()) {
+            auto &[c, extra] = full.emplace_back(chapter.toChapter(), std::string());
+            extra = encodeExtra(c);
+            records[i] = makeRecord(heap, c, extra);
+            continue;
+        }
+        records[i] = ChapterRecord{
+            chapter.index(),
+            (chapter.isVolume() ? Volume : 0U) | (chapter.isVip() ? Vip : 0U) | (chapter.isPay() ? Pay : 0U),
+            heap.add(chapter.url()),
+            heap.add(chapter.title()),
+            heap.add(chapter.baseUrl()),
+            heap.add(chapter.bookUrl()),
+            StringRef{noString, 0},
+            StringRef{noString, 0},
+            StringRef{noString, 0}
+        };
+    }
+    appendChapters(data, bookUrl, records, heap);
+    count++;
+    return *this;
+}
+
+BookShelf::Batch &BookShelf::Batch::putSearchBook(const SearchBook &searchBook) {
+    size_t lengthPos;
+    beginOp(data, PutSearchBook, lengthPos);
+    searchBookFields(searchBook, Encoder{data});
+    endOp(data, lengthPos);
+    count++;
+    return *this;
+}
+
+BookShelf::Batch &BookShelf::Batch::removeSearchBook(const std::string &bookUrl) {
+    size_t lengthPos;
+    beginOp(data, RemoveSearchBook, lengthPos);
+    Encoder{data}(bookUrl);
+    endOp(data, lengthPos);
+    count++;
+    return *this;
+}
+
+/* ---------- Table ---------- */
+
+template<typename T>
+uint32_t BookShelf::Table<T>::put(T row, const uint32_t size) {
+    const uint32_t replaced = remove(row.bookUrl);
+    byOrigin.emplace(row.origin, row.bookUrl);
+    byNameAuthor.emplace(row.name, row.author, row.bookUrl);
+    std::string key = row.bookUrl;
+    rows.emplace(std::move(key), std::make_pair(std::move(row), size));
+    return replaced;
+}
+
+template<typename T>
+uint32_t BookShelf::Table<T>::remove(const std::string &bookUrl) {
+    const auto it = rows.find(bookUrl);
+    if (it == rows.end()) return 0;
+    const T &row = it->second.first;
+    byOrigin.erase({row.origin, row.bookUrl});
+    byNameAuthor.erase({row.name, row.author, row.bookUrl});
+    const uint32_t size = it->second.second;
+    rows.erase(it);
+    return size;
+}
+
+template<typename T>
+std::vector<T> BookShelf::Table<T>::withOrigin(const std::string &origin) const {
+    std::vector<T> result;
+    for (auto it = byOrigin.lower_bound({origin, ""}); it != byOrigin.end() && it->first == origin; ++it) {
+        result.push_back(rows.at(it->second).first);
+    }
+    return result;
+}
+
+template<typename T>
+std::vector<T> BookShelf::Table<T>::withNameAuthor(const std::string &name, const std::string &author) const {
+    std::vector<T> result;
+    for (auto it = byNameAuthor.lower_bound({name, author, ""});
+         it != byNameAuthor.end() && std::get<0>(*it) == name && std::get<1>(*it) == author; ++it) {
+        result.push_back(rows.at(std::get<2>(*it)).first);
+    }
+    return result;
+}
+
+/* ---------- BookShelf ---------- */
+
+BookShelf::BookShelf(std::string file, Options options)
+    : file(std::move(file)), options(options) {
+    open();
+}
+
+BookShelf::~BookShelf() {
+    close();
+}
+
+void BookShelf::open() {
+    fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) throw std::runtime_error("Failed to open bookshelf: " + file);
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        close();
+        throw std::runtime_error("Failed to open bookshelf: " + file);
+    }
+    const auto size = static_cast<uint64_t>(st.st_size);
+    if (size == 0) {
+        if (!writeAll(fd, fileMagic, sizeof(fileMagic), 0)) {
+            close();
+            throw std::runtime_error("Failed to write bookshelf: " + file);
+        }
+        end = sizeof(fileMagic);
+        return;
+    }
+    mapping = std::make_shared<Mapping>(fd, size);
+    if (size < sizeof(fileMagic) || std::memcmp(mapping->data, fileMagic, sizeof(fileMagic)) != 0) {
+        close();
+        throw std::runtime_error("Not a bookshelf: " + file);
+    }
+    end = replay();
+    // 截掉写入中断的事务
+    if (end < size && ::ftruncate(fd, static_cast<off_t>(end)) != 0) {
+        close();
+        throw std::runtime_error("Failed to write bookshelf: " + file);
+    }
+}
+
+void BookShelf::close() {
+    mapping.reset();
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+}
+
+uint64_t BookShelf::replay() {
+    // 先找出完整的帧，只有最后一帧可能是写入中断留下的，校验它的数据
+    std::vector<std::pair<uint64_t, FrameHeader> > frames;
+    uint64_t pos = sizeof(fileMagic);
+    while (pos + sizeof(FrameHeader) <= mapping->size) {
+        FrameHeader header;
+        std::memcpy(&header, mapping->data + pos, sizeof(header));
+        if (header.magic != frameMagic || header.length > mapping->size - pos - sizeof(header)) break;
+        frames.emplace_back(pos, header);
+        pos += sizeof(header) + header.length;
+    }
+    if (!frames.empty()) {
+        const auto &[last, header] = frames.back();
+        if (checksum(std::string_view(mapping->data + last + sizeof(header), header.length)) != header.checksum) {
+            pos = last;
+            frames.pop_back();
+        }
+    }
+    for (const auto &[offset, header]: frames) {
+        const uint64_t ops = offset + sizeof(header);
+        const std::string_view data(mapping->data + ops, header.length);
+        // 越界的帧整帧丢弃
+        if (!validOps(data, header.count)) {
+            garbage += sizeof(header) + header.length;
+            continue;
+        }
+        apply(data, header.count, ops);
+    }
+    return pos;
+}
+
+void BookShelf::apply(const std::string_view ops, const uint32_t count, const uint64_t offset) {
+    size_t pos = 0;
+    for (uint32_t n = 0; n < count && pos + opHeaderSize <= ops.size(); n++) {
+        const auto type = static_cast<OpType>(ops[pos]);
+        uint32_t length;
+        std::memcpy(&length, ops.data() + pos + 1, sizeof(length));
+        const size_t body = pos + opHeaderSize;
+        const uint32_t size = static_cast<uint32_t>(opHeaderSize) + length;
+        Decoder decoder{ops.data() + body, ops.data() + std::min(ops.size(), body + length)};
+        switch (type) {
+            case PutBook: {
+                Book book;
+                bookFields(book, decoder);
+                garbage += books.put(std::move(book), size);
+                break;
+            }
+            case PutSearchBook: {
+                SearchBook searchBook;
+                searchBookFields(searchBook, decoder);
+                garbage += searchBooks.put(std::move(searchBook), size);
+                break;
+            }
+            case RemoveBook: {
+                std::string bookUrl;
+                decoder(bookUrl);
+                garbage += size + books.remove(bookUrl);
+                if (const auto it = chapters.find(bookUrl); it != chapters.end()) {
+                    garbage += it->second.length;
+                    chapters.erase(it);
+                }
+                break;
+            }
+            case RemoveSearchBook: {
+                std::string bookUrl;
+                decoder(bookUrl);
+                garbage += size + searchBooks.remove(bookUrl);
+                break;
+            }
+            case PutChapters: {
+                std::string bookUrl;
+                decoder(bookUrl);
+                const uint32_t chapterCount = decoder.u32();
+                const uint32_t heapSize = decoder.u32();
+                const uint64_t records = offset + (decoder.p - ops.data());
+                if (!decoder.ok) break;
+                auto [it, inserted] = chapters.try_emplace(std::move(bookUrl));
+                if (!inserted) garbage += it->second.length;
+                it->second = ChapterBlock{offset + pos, size, records, chapterCount, heapSize};
+                break;
+            }
+            default:
+                garbage += size;
+                break;
+        }
+        pos += size;
+    }
+}
+
+std::shared_ptr<const BookShelf::Mapping> BookShelf::mappingFor(const uint64_t end) {
+    std::lock_guard lock(mappingMutex);
+    if (mapping == nullptr || mapping->size < end) {
+        // 多映射一部分，之后追加的数据不需要每次重新映射
+        mapping = std::make_shared<Mapping>(fd, this->end + this->end / 2);
+    }
+    return mapping;
+}
+
+uint64_t BookShelf::appendFrame(const int writeFd, uint64_t &writeEnd, const std::string_view ops,
+                                const uint32_t count) const {
+    FrameHeader header{frameMagic, count, ops.size(), checksum(ops)};
+    std::string frame(reinterpret_cast<const char *>(&header), sizeof(header));
+    frame += ops;
+    if (!writeAll(writeFd, frame.data(), frame.size(), static_cast<off_t>(writeEnd)) ||
+        (options.sync && ::fdatasync(writeFd) != 0)) {
+        // 不完整的帧在下一次写入时被覆盖，打开时被截掉
+        throw std::runtime_error("Failed to write bookshelf: " + file);
+    }
+    const uint64_t offset = writeEnd + sizeof(header);
+    writeEnd += frame.size();
+    return offset;
+}
+
+void BookShelf::write(const Batch &batch) {
+    if (batch.empty()) return;
+    std::unique_lock lock(mutex);
+    const uint64_t offset = appendFrame(fd, end, batch.data, batch.count);
+    apply(batch.data, batch.count, offset);
+    if (end >= options.compactMinSize &&
+        static_cast<double>(garbage) > options.compactRatio * static_cast<double>(end)) {
+        compactLocked();
+    }
+}
+
+void BookShelf::putBook(const Book &book) {
+    write(Batch().putBook(book));
+}
+
+void BookShelf::removeBook(const std::string &bookUrl) {
+    write(Batch().removeBook(bookUrl));
+}
+
+void BookShelf::putChapters(const std::string &bookUrl, const std::vector<BookChapter> &chapters) {
+    write(Batch().putChapters(bookUrl, chapters));
+}
+
+void BookShelf::putChapters(const std::string &bookUrl, const ChapterList &chapters) {
+    write(Batch().putChapters(bookUrl, chapters));
+}
+
+void BookShelf::putSearchBook(const SearchBook &searchBook) {
+    write(Batch().putSearchBook(searchBook));
+}
+
+std::optional<Book> BookShelf::getBook(const std::string &bookUrl) {
+    std::shared_lock lock(mutex);
+    const auto it = books.rows.find(bookUrl);
+    if (it == books.rows.end()) return std::nullopt;
+    return it->second.first;
+}
+
+std::vector<Book> BookShelf::getBooks() {
+    std::shared_lock lock(mutex);
+    std::vector<Book> result;
+    result.reserve(books.rows.size());
+    for (const auto &row: books.rows | std::views::values) result.push_back(row.first);
+    std::ranges::sort(result, {}, &Book::bookUrl);
+    return result;
+}
+
+std::vector<Book> BookShelf::getBooksByOrigin(const std::string &origin) {
+    std::shared_lock lock(mutex);
+    return books.withOrigin(origin);
+}
+
+std::vector<Book> BookShelf::getBooks(const std::string &name, const std::string &author) {
+    std::shared_lock lock(mutex);
+    return books.withNameAuthor(name, author);
+}
+
+size_t BookShelf::bookCount() {
+    std::shared_lock lock(mutex);
+    return books.rows.size();
+}
+
+std::optional<SearchBook> BookShelf::getSearchBook(const std::string &bookUrl) {
+    std::shared_lock lock(mutex);
+    const auto it = searchBooks.rows.find(bookUrl);
+    if (it == searchBooks.rows.end()) return std::nullopt;
+    return it->second.first;
+}
+
+std::vector<SearchBook> BookShelf::getSearchBooksByOrigin(const std::string &origin) {
+    std::shared_lock lock(mutex);
+    return searchBooks.withOrigin(origin);
+}
+
+std::vector<SearchBook> BookShelf::getSearchBooks(const std::string &name, const std::string &author) {
+    std::shared_lock lock(mutex);
+    return searchBooks.withNameAuthor(name, author);
+}
+
+size_t BookShelf::chapterCount(const std::string &bookUrl) {
+    std::shared_lock lock(mutex);
+    const auto it = chapters.find(bookUrl);
+    return it == chapters.end() ? 0 : it->second.count;
+}
+
+BookChapter BookShelf::decodeChapter(const Mapping &mapping, const ChapterBlock &block, const uint32_t i) const {
+    ChapterRecord record;
+    std::memcpy(&record, mapping.data + block.records + i * sizeof(ChapterRecord), sizeof(record));
+    const char *heap = mapping.data + block.records + static_cast<uint64_t>(block.count) * sizeof(ChapterRecord);
+    const auto string = [&](const StringRef ref) -> std::optional<std::string> {
+        if (ref.offset == noString || ref.offset > block.heapSize || ref.size > block.heapSize - ref.offset) {
+            return std::nullopt;
+        }
+        return std::string(heap + ref.offset, ref.size);
+    };
+    std::optional<std::string> resourceUrl, startFragmentId, endFragmentId, variable, titleMD5;
+    std::optional<long> start, end;
+    if (const auto extra = string(record.extra)) {
+        Decoder decoder{extra->data(), extra->data() + extra->size()};
+        while (decoder.ok && decoder.p < decoder.end) {
+            switch (static_cast<ExtraField>(*decoder.p++)) {
+                case ResourceUrl: decoder(resourceUrl.emplace()); break;
+                case Start: decoder(start.emplace()); break;
+                case End: decoder(end.emplace()); break;
+                case StartFragmentId: decoder(startFragmentId.emplace()); break;
+                case EndFragmentId: decoder(endFragmentId.emplace()); break;
+                case Variable: decoder(variable.emplace()); break;
+                case TitleMD5: decoder(titleMD5.emplace()); break;
+                default: decoder.ok = false; break;
+            }
+        }
+    }
+    BookChapter chapter(
+        string(record.url).value_or(""), string(record.title).value_or(""), record.flags & Volume,
+        string(record.baseUrl).value_or(""), string(record.bookUrl).value_or(""), record.index,
+        record.flags & Vip, record.flags & Pay, std::move(resourceUrl), string(record.tag),
+        string(record.wordCount), start, end, std::move(startFragmentId), std::move(endFragmentId),
+        std::move(variable)
+    );
+    chapter.titleMD5 = std::move(titleMD5);
+    return chapter;
+}
+
+std::vector<BookChapter> BookShelf::getChapters(const std::string &bookUrl, const int from, const int to) {
+    std::shared_lock lock(mutex);
+    const auto it = chapters.find(bookUrl);
+    if (it == chapters.end() || from >= to) return {};
+    const ChapterBlock &block = it->second;
+    const auto m = mappingFor(block.op + block.length);
+    const auto indexAt = [&](const uint32_t i) {
+        int32_t index;
+        std::memcpy(&index, m->data + block.records + i * sizeof(ChapterRecord), sizeof(index));
+        return index;
+    };
+    // 章节按index排列，二分查找范围的开始
+    uint32_t low = 0, high = block.count;
+    while (low < high) {
+        const uint32_t mid = low + (high - low) / 2;
+        if (indexAt(mid) < from) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    std::vector<BookChapter> result;
+    for (uint32_t i = low; i < block.count && indexAt(i) < to; i++) {
+        result.push_back(decodeChapter(*m, block, i));
+    }
+    return result;
+}
+
+ChapterList BookShelf::getChapterList(const std::string &bookUrl) {
+    std::shared_lock lock(mutex);
+    const auto it = chapters.find(bookUrl);
+    if (it == chapters.end()) return {};
+    const ChapterBlock &block = it->second;
+    const auto m = mappingFor(block.op + block.length);
+    const char *heap = m->data + block.records + static_cast<uint64_t>(block.count) * sizeof(ChapterRecord);
+    const auto string = [&](const StringRef ref) -> std::string_view {
+        if (ref.offset == noString || ref.offset > block.heapSize || ref.size > block.heapSize - ref.offset) return {};
+        return {heap + ref.offset, ref.size};
+    };
+    ChapterList result;
+    result.reserve(block.count, block.heapSize);
+    for (uint32_t i = 0; i < block.count; i++) {
+        ChapterRecord record;
+        std::memcpy(&record, m->data + block.records + i * sizeof(ChapterRecord), sizeof(record));
+        if (record.tag.offset != noString || record.wordCount.offset != noString || record.extra.offset != noString) {
+            result.push_back(decodeChapter(*m, block, i));
+            continue;
+        }
+        result.push_back(ChapterList::Fields{
+            record.index, string(record.url), string(record.title), string(record.baseUrl), string(record.bookUrl),
+            (record.flags & Volume) != 0, (record.flags & Vip) != 0, (record.flags & Pay) != 0
+        });
+    }
+    return result;
+}
+
+std::optional<BookChapter> BookShelf::getChapter(const std::string &bookUrl, const int index) {
+    if (index == std::numeric_limits<int>::max()) return std::nullopt;
+    auto result = getChapters(bookUrl, index, index + 1);
+    if (result.empty()) return std::nullopt;
+    return std::move(result.front());
+}
+
+size_t BookShelf::fileSize() {
+    std::shared_lock lock(mutex);
+    return end;
+}
+
+size_t BookShelf::garbageSize() {
+    std::shared_lock lock(mutex);
+    return garbage;
+}
+
+void BookShelf::compact() {
+    std::unique_lock lock(mutex);
+    compactLocked();
+}
+
+void BookShelf::compactLocked() {
+    const std::string tmp = file + ".tmp";
+    const int out = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) throw std::runtime_error("Failed to write bookshelf: " + tmp);
+    uint64_t written = 0;
+    const auto m = mappingFor(end);
+    std::unordered_map<std::string, ChapterBlock> moved;
+    try {
+        if (!writeAll(out, fileMagic, sizeof(fileMagic), 0)) throw std::runtime_error("write");
+        written = sizeof(fileMagic);
+        // 书籍与搜索结果重新编码，目录按原样复制；每帧约1MB
+        Batch batch;
+        const auto flush = [&] {
+            if (batch.empty()) return;
+            appendFrame(out, written, batch.data, batch.count);
+            batch = Batch();
+        };
+        for (const auto &[row, size]: books.rows | std::views::values) batch.putBook(row);
+        for (const auto &[row, size]: searchBooks.rows | std::views::values) batch.putSearchBook(row);
+        flush();
+        for (const auto &[bookUrl, block]: chapters) {
+            // 帧头之后的位置
+            const uint64_t op = written + sizeof(FrameHeader) + batch.data.size();
+            batch.data.append(m->data + block.op, block.length);
+            batch.count++;
+            moved.emplace(bookUrl, ChapterBlock{op, block.length, op + (block.records - block.op), block.count,
+                                                block.heapSize});
+            if (batch.data.size() >= (1 << 20)) flush();
+        }
+        flush();
+    } catch (const std::exception &) {
+        ::close(out);
+        ::unlink(tmp.c_str());
+        throw std::runtime_error("Failed to write bookshelf: " + file);
+    }
+    // 新文件落盘之后才替换原文件，与options.sync无关，否则断电后可能丢失整个书架
+    if (::fdatasync(out) != 0 || std::rename(tmp.c_str(), file.c_str()) != 0) {
+        ::close(out);
+        ::unlink(tmp.c_str());
+        throw std::runtime_error("Failed to write bookshelf: " + file);
+    }
+    syncDirectory(file);
+    close();
+    fd = out;
+    end = written;
+    garbage = 0;
+    chapters = std::move(moved);
+}
@@ -0,0 +1,128 @@
+#include <booksource/chaptercolumns.h>
+#include <algorithm>
+
+BookChapter ChapterList::View::toChapter() const {
+    if (!hasExtra()) {
+        return BookChapter(std::string(url()), std::string(title()), isVolume(), std::string(baseUrl()),
+                           std::string(bookUrl()), index(), isVip(), isPay());
+    }
+    const auto it = std::ranges::lower_bound(list->extras, static_cast<uint32_t>(position), {},
+                                             &std::pair<uint32_t, Extras>::first);
+    const Extras &e = it->second;
+    BookChapter chapter(std::string(url()), std::string(title()), isVolume(), std::string(baseUrl()),
+                        std::string(bookUrl()), index(), isVip(), isPay(), e.resourceUrl, e.tag, e.wordCount,
+                        e.start, e.end, e.startFragmentId, e.endFragmentId, e.variable);
+    chapter.titleMD5 = e.titleMD5;
+    return chapter;
+}
+
+ChapterList::ChapterList(const std::vector<BookChapter> &chapters) {
+    size_t bytes = 0;
+    for (const auto &chapter: chapters) bytes += chapter.url.size() + chapter.title.size();
+    reserve(chapters.size(), bytes);
+    for (const auto &chapter: chapters) push_back(chapter);
+}
+
+ChapterList::StringRef ChapterList::add(const std::string_view s) {
+    const StringRef ref{static_cast<uint32_t>(arena.size()), static_cast<uint32_t>(s.size())};
+    arena.append(s);
+    return ref;
+}
+
+uint32_t ChapterList::addShared(const std::string_view s) {
+    // 通常与上一个章节相同
+    if (!shared.empty() && string(shared.back()) == s) return static_cast<uint32_t>(shared.size() - 1);
+    // 以string_view查找，只有新的值才构造std::string
+    if (const auto it = sharedIds.find(s); it != sharedIds.end()) return it->second;
+    const auto id = static_cast<uint32_t>(shared.size());
+    sharedIds.emplace(std::string(s), id);
+    shared.push_back(add(s));
+    return id;
+}
+
+void ChapterList::push_back(const Fields &fields) {
+    indexes.push_back(fields.index);
+    flags.push_back((fields.isVolume ? Volume : 0) | (fields.isVip ? Vip : 0) | (fields.isPay ? Pay : 0));
+    urls.push_back(add(fields.url));
+    titles.push_back(add(fields.title));
+    baseUrls.push_back(addShared(fields.baseUrl));
+    bookUrls.push_back(addShared(fields.bookUrl));
+}
+
+void ChapterList::push_back(const BookChapter &chapter) {
+    push_back(Fields{
+        chapter.index, chapter.url, chapter.title, chapter.baseUrl, chapter.bookUrl, chapter.isVolume,
+        chapter.isVip, chapter.isPay
+    });
+    const auto &variable = chapter.getVariableString();
+    if (!chapter.resourceUrl && !chapter.tag && !chapter.wordCount && !chapter.start && !chapter.end &&
+        !chapter.startFragmentId && !chapter.endFragmentId && !variable && !chapter.titleMD5) {
+        return;
+    }
+    flags.back() |= Extra;
+    extras.emplace_back(static_cast<uint32_t>(size() - 1), Extras{
+                            chapter.resourceUrl, chapter.tag, chapter.wordCount, chapter.start, chapter.end,
+                            chapter.startFragmentId, chapter.endFragmentId, variable, chapter.titleMD5
+                        });
+}
+
+void ChapterList::reserve(const size_t chapters, const size_t bytes) {
+    indexes.reserve(chapters);
+    flags.reserve(chapters);
+    urls.reserve(chapters);
+    titles.reserve(chapters);
+    baseUrls.reserve(chapters);
+    bookUrls.reserve(chapters);
+    arena.reserve(bytes);
+}
+
+std::vector<BookChapter> ChapterList::toChapters() const {
+    std::vector<BookChapter> chapters;
+    chapters.reserve(size());
+    for (const View chapter: *this) chapters.push_back(chapter.toChapter());
+    return chapters;
+}
+
+std::optional<size_t> ChapterList::find(const std::string_view url) const {
+    for (size_t i = 0; i < urls.size(); i++) {
+        if (urls[i].size == url.size() && string(urls[i]) == url) return i;
+    }
+    return std::nullopt;
+}
+
+std::vector<size_t> ChapterList::search(const std::string_view keyword) const {
+    std::vector<size_t> result;
+    for (size_t i = 0; i < titles.size(); i++) {
+        if (titles[i].size >= keyword.size() && string(titles[i]).find(keyword) != std::string_view::npos) {
+            result.push_back(i);
+        }
+    }
+    return result;
+}
+
+namespace {
+    // 字符串在堆上分配的字节数，短字符串保存在对象内部时为0
+    size_t heapBytes(const std::string &s) {
+        const auto *object = reinterpret_cast<const char *>(&s);
+        const bool local = s.data() >= object && s.data() < object + sizeof(s);
+        return local ? 0 : s.capacity() + 1;
+    }
+
+    size_t heapBytes(const std::optional<std::string> &s) {
+        return s.has_value() ? heapBytes(*s) : 0;
+    }
+}
+
+size_t ChapterList::memoryUsage() const {
+    size_t bytes = sizeof(*this) + arena.capacity();
+    bytes += indexes.capacity() * sizeof(int32_t) + flags.capacity();
+    bytes += (urls.capacity() + titles.capacity() + shared.capacity()) * sizeof(StringRef);
+    bytes += (baseUrls.capacity() + bookUrls.capacity()) * sizeof(uint32_t);
+    for (const auto &[key, id]: sharedIds) bytes += sizeof(std::string) + sizeof(id) + heapBytes(key);
+    bytes += extras.capacity() * sizeof(std::pair<uint32_t, Extras>);
+    for (const auto &[position, e]: extras) {
+        bytes += heapBytes(e.resourceUrl) + heapBytes(e.tag) + heapBytes(e.wordCount) + heapBytes(e.startFragmentId) +
+                heapBytes(e.endFragmentId) + heapBytes(e.variable) + heapBytes(e.titleMD5);
+    }
+    return bytes;
+}
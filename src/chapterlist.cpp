@@ -0,0 +1,522 @@
+#include <booksource/chapterlist.h>
+#include <booksource/utils.h>
+#include <algorithm>
+#include <bit>
+#include <tuple>
+#include <unordered_set>
+
+namespace BookChapterList {
+    TocFingerprint::TocFingerprint(const std::vector<BookChapter> &chapters, const bool pageList)
+        : pageList(pageList) {
+        append(chapters);
+    }
+
+    std::optional<size_t> TocFingerprint::find(const std::string &url) const {
+        const uint64_t h = hash(url);
+        const auto it = std::ranges::lower_bound(sorted, h, {}, &std::pair<uint64_t, uint32_t>::first);
+        if (it == sorted.end() || it->first != h) return std::nullopt;
+        return it->second;
+    }
+
+    bool TocFingerprint::sameTitle(const size_t index, const std::string &title) const {
+        return index < titles.size() && titles[index] == hash(title);
+    }
+
+    TocFingerprint::TocFingerprint(const ChapterList &chapters, const bool pageList)
+        : pageList(pageList) {
+        append(chapters);
+    }
+
+    template<typename Chapters, typename Get>
+    void TocFingerprint::append(const Chapters &chapters, Get get) {
+        if (chapters.empty()) return;
+        const size_t old = sorted.size();
+        std::string_view baseUrl;
+        for (const auto &chapter: chapters) {
+            const auto [url, title, base] = get(chapter);
+            sorted.emplace_back(hash(url), static_cast<uint32_t>(titles.size()));
+            titles.push_back(hash(title));
+            baseUrl = base;
+        }
+        std::ranges::sort(sorted.begin() + static_cast<std::ptrdiff_t>(old), sorted.end());
+        std::inplace_merge(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(old), sorted.end());
+        lastPage = baseUrl;
+    }
+
+    void TocFingerprint::append(const std::vector<BookChapter> &chapters) {
+        append(chapters, [](const BookChapter &chapter) {
+            return std::tuple<std::string_view, std::string_view, std::string_view>(
+                chapter.url, chapter.title, chapter.baseUrl);
+        });
+    }
+
+    void TocFingerprint::append(const ChapterList &chapters) {
+        append(chapters, [](const ChapterList::View chapter) {
+            return std::tuple(chapter.url(), chapter.title(), chapter.baseUrl());
+        });
+    }
+
+    // FNV-1a
+    uint64_t TocFingerprint::hash(const std::string_view s) {
+        uint64_t h = 1469598103934665603ULL;
+        for (const unsigned char c: s) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    ChapterItemRules::ChapterItemRules(AnalyzeRule &analyzeRule, const TocRule &tocRule)
+        : name(analyzeRule.splitSourceRule(tocRule.chapterName)),
+          url(analyzeRule.splitSourceRule(tocRule.chapterUrl)),
+          isVolume(analyzeRule.splitSourceRule(tocRule.isVolume)),
+          isVip(analyzeRule.splitSourceRule(tocRule.isVip)),
+          isPay(analyzeRule.splitSourceRule(tocRule.isPay)),
+          updateTime(analyzeRule.splitSourceRule(tocRule.updateTime)),
+          nextTocUrl(analyzeRule.splitSourceRule(tocRule.nextTocUrl)) {
+    }
+
+    bool isTrue(const std::string &value) {
+        std::string s = value;
+        StringUtils::trim(s);
+        std::ranges::transform(s, s.begin(), [](const unsigned char c) { return std::tolower(c); });
+        return !s.empty() && s != "null" && s != "false" && s != "no" && s != "not" && s != "0";
+    }
+
+    std::vector<std::string> nextTocUrls(AnalyzeRule &analyzeRule, const ChapterItemRules &itemRules,
+                                         const std::string &redirectUrl) {
+        std::vector<std::string> nextUrls;
+        if (itemRules.nextTocUrl.empty()) return nextUrls;
+        for (auto &url: analyzeRule.getStringList(itemRules.nextTocUrl, true)) {
+            if (url != redirectUrl) nextUrls.push_back(std::move(url));
+        }
+        return nextUrls;
+    }
+
+    std::optional<BookChapter> analyzeItem(
+        const Book &book,
+        AnalyzeRule &analyzeRule,
+        const ChapterItemRules &itemRules,
+        const RuleContent &item,
+        const size_t index,
+        const std::string &baseUrl,
+        const std::string &redirectUrl
+    ) {
+        BookChapter chapter;
+        // 与阅读一致，章节规则中的@put保存到章节的变量中；chapter是局部变量，返回前解除关联
+        analyzeRule.setContent(item).setChapter(&chapter);
+        struct Detach {
+            AnalyzeRule &rule;
+            ~Detach() { rule.setChapter(nullptr); }
+        } detach{analyzeRule};
+        chapter.bookUrl = book.bookUrl;
+        chapter.baseUrl = redirectUrl;
+        chapter.title = analyzeRule.getString(itemRules.name);
+        if (chapter.title.empty()) return std::nullopt;
+        chapter.url = analyzeRule.getString(itemRules.url);
+        if (const auto tag = analyzeRule.getString(itemRules.updateTime); !tag.empty()) {
+            chapter.tag = tag;
+        }
+        chapter.isVolume = isTrue(analyzeRule.getString(itemRules.isVolume));
+        if (chapter.url.empty()) {
+            // 卷名没有地址，用标题与序号区分不同的卷
+            chapter.url = chapter.isVolume ? chapter.title + std::to_string(index) : baseUrl;
+        }
+        chapter.isVip = isTrue(analyzeRule.getString(itemRules.isVip));
+        chapter.isPay = isTrue(analyzeRule.getString(itemRules.isPay));
+        return chapter;
+    }
+
+    std::vector<BookChapter> analyzePage(
+        const Book &book,
+        AnalyzeRule &analyzeRule,
+        const std::string &listRule,
+        const ChapterItemRules &itemRules,
+        const std::string &baseUrl,
+        const std::string &redirectUrl,
+        const std::string &body,
+        const NextUrlHandler &onNextUrls
+    ) {
+        analyzeRule.setContent(body).setBaseUrl(baseUrl);
+        std::string redirect = redirectUrl;
+        analyzeRule.setRedirectUrl(redirect);
+        if (onNextUrls) {
+            onNextUrls(nextTocUrls(analyzeRule, itemRules, redirectUrl));
+        }
+        std::vector<BookChapter> chapterList;
+        const std::vector<RuleContent> elements = analyzeRule.getElements(listRule);
+        chapterList.reserve(elements.size());
+        for (size_t index = 0; index < elements.size(); index++) {
+            if (auto chapter = analyzeItem(book, analyzeRule, itemRules, elements[index], index, baseUrl,
+                                           redirectUrl)) {
+                chapterList.push_back(std::move(chapter.value()));
+            }
+        }
+        return chapterList;
+    }
+
+    namespace {
+        StrResponse fetchPage(BookSource &bookSource, RuleData &ruleData, const std::string &url,
+                              const std::string &baseUrl) {
+            AnalyzeUrl analyzeUrl(url, std::nullopt, std::nullopt, std::nullopt, std::nullopt, baseUrl, &bookSource,
+                                  &ruleData);
+            return analyzeUrl.getStrResponse();
+        }
+
+        // 有线程池时在其中下载，否则立即下载
+        std::future<StrResponse> startFetch(ThreadPool *pool, BookSource &bookSource, RuleData &ruleData,
+                                            const std::string &url, const std::string &baseUrl) {
+            return submit(pool, [&bookSource, &ruleData, url, baseUrl] {
+                return fetchPage(bookSource, ruleData, url, baseUrl);
+            });
+        }
+
+        // 去掉列表规则的正反序前缀，'-'表示网页中的章节为倒序
+        std::string splitListRule(const TocRule &tocRule, bool &reverse) {
+            std::string listRule = tocRule.chapterList.value_or("");
+            reverse = false;
+            if (listRule.starts_with('-')) {
+                reverse = true;
+                listRule = listRule.substr(1);
+            } else if (listRule.starts_with('+')) {
+                listRule = listRule.substr(1);
+            }
+            return listRule;
+        }
+
+        /**
+         * 执行formatJs，其中 index 为从1开始的序号，title 为章节标题，执行失败时保留原来的标题
+         * @param first chapters[0]在目录中的序号
+         */
+        void formatTitles(AnalyzeRule &analyzeRule, const TocRule &tocRule, std::vector<BookChapter> &chapters,
+                          const size_t first) {
+            if (StringUtils::isNullOrEmpty(tocRule.formatJs)) return;
+            for (size_t i = 0; i < chapters.size(); i++) {
+                analyzeRule.setChapter(&chapters[i]);
+                try {
+                    chapters[i].title = analyzeRule.evalJS("var index = " + std::to_string(first + i + 1) + ";\n" +
+                                                           tocRule.formatJs.value());
+                } catch (const std::exception &) {
+                }
+            }
+            analyzeRule.setChapter(nullptr);
+        }
+
+        void append(std::vector<BookChapter> &chapterList, std::vector<BookChapter> &&page) {
+            chapterList.insert(chapterList.end(), std::make_move_iterator(page.begin()),
+                               std::make_move_iterator(page.end()));
+        }
+
+        /**
+         * 按url去重，保留第一次出现的章节且顺序不变
+         * 与BookList::distinctBookList()相同，索引中只保存已保留的章节的位置，章节在原地前移压缩
+         */
+        void distinctChapterList(std::vector<BookChapter> &chapterList) {
+            const size_t n = chapterList.size();
+            if (n < 2) return;
+            constexpr uint32_t empty = UINT32_MAX;
+            const size_t capacity = std::bit_ceil(n * 2);
+            std::vector<uint32_t> slots(capacity, empty);
+            size_t kept = 0;
+            for (size_t i = 0; i < n; i++) {
+                const std::string_view url = chapterList[i].url;
+                size_t slot = std::hash<std::string_view>()(url) & (capacity - 1);
+                while (slots[slot] != empty && chapterList[slots[slot]].url != url) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                if (slots[slot] != empty) continue;
+                if (kept != i) chapterList[kept] = std::move(chapterList[i]);
+                slots[slot] = static_cast<uint32_t>(kept++);
+            }
+            chapterList.erase(chapterList.begin() + static_cast<std::ptrdiff_t>(kept), chapterList.end());
+        }
+    }
+
+    std::vector<BookChapter> analyzeChapterList(
+        BookSource &bookSource,
+        Book &book,
+        RuleData &ruleData,
+        const std::string &baseUrl,
+        const std::string &redirectUrl,
+        const std::optional<std::string> &body,
+        ThreadPool *pool,
+        TocFingerprint *fingerprint
+    ) {
+        if (!body.has_value()) {
+            throw std::runtime_error("Failed to access website: " + baseUrl);
+        }
+        const TocRule tocRule = bookSource.ruleToc.value_or(TocRule());
+        bool reverse;
+        const std::string listRule = splitListRule(tocRule, reverse);
+        AnalyzeRule analyzeRule(&ruleData, &bookSource);
+        analyzeRule.setContent(body);
+        const ChapterItemRules itemRules(analyzeRule, tocRule);
+
+        // 已经访问过的目录页，用于发现循环的下一页
+        std::unordered_set<std::string> visited{baseUrl, redirectUrl};
+        std::vector<std::string> nextUrls;
+        std::optional<std::future<StrResponse> > pending;
+        std::string pendingUrl;
+        // 串联的目录页只取第一个地址，在解析当前页的同时下载
+        const auto fetchNext = [&](const std::vector<std::string> &urls) {
+            if (urls.empty() || !visited.insert(urls[0]).second) return;
+            pendingUrl = urls[0];
+            pending = startFetch(pool, bookSource, ruleData, pendingUrl, baseUrl);
+        };
+
+        std::vector<BookChapter> chapterList;
+        try {
+            chapterList = analyzePage(book, analyzeRule, listRule, itemRules, baseUrl, redirectUrl,
+                                      *body, [&](const std::vector<std::string> &urls) {
+                                          nextUrls = urls;
+                                          if (urls.size() == 1) fetchNext(urls);
+                                      });
+            while (pending.has_value()) {
+                const StrResponse res = pending->get();
+                pending.reset();
+                const std::string pageUrl = pendingUrl;
+                append(chapterList, analyzePage(book, analyzeRule, listRule, itemRules, pageUrl, res.url,
+                                                res.body.value_or(""), fetchNext));
+            }
+        } catch (...) {
+            // 下载任务引用了调用方的书源与规则数据，等它结束后再返回
+            if (pending.has_value()) pending->wait();
+            throw;
+        }
+
+        if (nextUrls.size() > 1) {
+            // 多个目录页互不依赖，一起下载与解析，结果按地址的顺序合并
+            const auto extract = [&](AnalyzeRule &rule, const size_t index) {
+                const StrResponse res = fetchPage(bookSource, ruleData, nextUrls[index], baseUrl);
+                return analyzePage(book, rule, listRule, itemRules, nextUrls[index], res.url,
+                                   res.body.value_or(""));
+            };
+            const auto consume = [&](size_t, std::optional<std::vector<BookChapter> > &&page) {
+                if (page.has_value()) append(chapterList, std::move(page.value()));
+                return true;
+            };
+            if (pool != nullptr) {
+                const auto newRule = [&] {
+                    return AnalyzeRule(&ruleData, &bookSource);
+                };
+                BookList::parallelExtract<std::vector<BookChapter> >(*pool, nextUrls.size(), newRule, extract,
+                                                                      consume);
+            } else {
+                for (size_t index = 0; index < nextUrls.size(); index++) {
+                    consume(index, extract(analyzeRule, index));
+                }
+            }
+        }
+
+        // 与阅读一致：同一url的章节只保留一个，正序的列表保留最后出现的，然后按书籍设置的目录顺序排列
+        if (!reverse) std::ranges::reverse(chapterList);
+        distinctChapterList(chapterList);
+        if (!book.readConfig.reverseToc) std::ranges::reverse(chapterList);
+        if (chapterList.empty()) {
+            throw std::runtime_error("Chapter list is empty: " + baseUrl);
+        }
+        for (size_t i = 0; i < chapterList.size(); i++) {
+            chapterList[i].index = static_cast<int>(i);
+        }
+        formatTitles(analyzeRule, tocRule, chapterList, 0);
+
+        const int size = static_cast<int>(chapterList.size());
+        book.latestChapterTitle = chapterList.back().title;
+        book.durChapterTitle = chapterList[book.durChapterIndex >= 0 && book.durChapterIndex < size
+                                               ? book.durChapterIndex
+                                               : size - 1].title;
+        if (book.totalChapterNum < size) {
+            book.lastCheckCount = size - book.totalChapterNum;
+            book.latestChapterTime = DateUtils::currentTimeMillis();
+        }
+        book.lastCheckTime = DateUtils::currentTimeMillis();
+        book.totalChapterNum = size;
+        if (fingerprint != nullptr) {
+            *fingerprint = TocFingerprint(chapterList, nextUrls.size() > 1);
+        }
+        return chapterList;
+    }
+
+
+    namespace {
+        enum class Scan {
+            NotFound, // 没有已知的章节
+            Found,    // 遇到了已知的最新章节
+            Changed   // 遇到的已知章节不是最新的章节或者标题改变，已知的目录不再可靠
+        };
+
+        /**
+         * 从最新的一端解析当前内容中的章节，新章节按从新到旧的顺序加入found，遇到已知的章节时停止
+         * 正序的列表从最后一项向前，倒序的列表从第一项向后
+         */
+        Scan scanNewest(const Book &book, AnalyzeRule &analyzeRule, const TocRule &tocRule,
+                        const std::string &listRule, const ChapterItemRules &itemRules, const bool reverse,
+                        const TocFingerprint &fingerprint, const std::string &pageUrl, const std::string &redirectUrl,
+                        std::vector<BookChapter> &found) {
+            const std::vector<RuleContent> elements = analyzeRule.getElements(listRule);
+            for (size_t i = 0; i < elements.size(); i++) {
+                const size_t index = reverse ? i : elements.size() - 1 - i;
+                auto chapter = analyzeItem(book, analyzeRule, itemRules, elements[index], index, pageUrl, redirectUrl);
+                if (!chapter.has_value()) continue;
+                const auto known = fingerprint.find(chapter->url);
+                if (!known.has_value()) {
+                    found.push_back(std::move(chapter.value()));
+                    continue;
+                }
+                if (known.value() + 1 != fingerprint.size()) return Scan::Changed;
+                // 指纹中是formatJs处理后的标题
+                std::vector<BookChapter> last;
+                last.push_back(std::move(chapter.value()));
+                formatTitles(analyzeRule, tocRule, last, known.value());
+                return fingerprint.sameTitle(known.value(), last[0].title) ? Scan::Found : Scan::Changed;
+            }
+            return Scan::NotFound;
+        }
+    }
+
+    TocUpdate updateChapterList(
+        BookSource &bookSource,
+        Book &book,
+        RuleData &ruleData,
+        TocFingerprint &fingerprint,
+        ThreadPool *pool
+    ) {
+        const auto fullUpdate = [&] {
+            TocUpdate update;
+            update.incremental = false;
+            const StrResponse res = fetchPage(bookSource, ruleData, book.tocUrl, book.bookUrl);
+            update.chapters = analyzeChapterList(bookSource, book, ruleData, book.tocUrl, res.url, res.body, pool,
+                                                 &fingerprint);
+            return update;
+        };
+        // 倒序显示的目录中新章节在最前面，序号全部改变
+        if (fingerprint.empty() || book.readConfig.reverseToc) return fullUpdate();
+
+        const TocRule tocRule = bookSource.ruleToc.value_or(TocRule());
+        bool reverse;
+        const std::string listRule = splitListRule(tocRule, reverse);
+        std::string startUrl = reverse || fingerprint.lastPageUrl().empty() ? book.tocUrl : fingerprint.lastPageUrl();
+        AnalyzeRule analyzeRule(&ruleData, &bookSource);
+        std::optional<ChapterItemRules> itemRules;
+        // 设置目录页内容，规则按第一个目录页的格式拆分
+        const auto setPage = [&](const std::string &url, const StrResponse &res) {
+            analyzeRule.setContent(res.body.value_or("")).setBaseUrl(url);
+            std::string redirect = res.url;
+            analyzeRule.setRedirectUrl(redirect);
+            if (!itemRules.has_value()) itemRules.emplace(analyzeRule, tocRule);
+        };
+
+        // 第一页列出全部目录页时，新增的目录页只出现在第一页的列表中
+        std::vector<std::string> listedPages;
+        if (!reverse && fingerprint.isPageList() && startUrl != book.tocUrl) {
+            const StrResponse res = fetchPage(bookSource, ruleData, book.tocUrl, book.bookUrl);
+            setPage(book.tocUrl, res);
+            const auto urls = nextTocUrls(analyzeRule, itemRules.value(), res.url);
+            const auto it = std::ranges::find(urls, startUrl);
+            if (it == urls.end()) return fullUpdate();
+            listedPages.assign(it + 1, urls.end());
+        }
+
+        std::unordered_set<std::string> visited{book.tocUrl, startUrl};
+        std::vector<BookChapter> found; // 新章节，从新到旧
+        StrResponse res = fetchPage(bookSource, ruleData, startUrl, book.tocUrl);
+        setPage(startUrl, res);
+        std::vector<std::string> nextUrls = nextTocUrls(analyzeRule, itemRules.value(), res.url);
+        if (startUrl == book.tocUrl && nextUrls.size() > 1) {
+            listedPages = nextUrls;
+            nextUrls.clear();
+        } else if (fingerprint.isPageList()) {
+            nextUrls.clear();
+        }
+        Scan scan = scanNewest(book, analyzeRule, tocRule, listRule, itemRules.value(), reverse, fingerprint,
+                               startUrl, res.url, found);
+
+        if (reverse) {
+            // 最新的章节在前面的目录页，依次向后直到遇到已知的章节
+            std::vector<std::string> pages = listedPages;
+            size_t cursor = 0;
+            while (scan == Scan::NotFound) {
+                std::string url;
+                if (cursor < pages.size()) {
+                    url = pages[cursor++];
+                } else if (pages.empty() && !nextUrls.empty() && visited.insert(nextUrls[0]).second) {
+                    url = nextUrls[0];
+                } else {
+                    break;
+                }
+                res = fetchPage(bookSource, ruleData, url, book.tocUrl);
+                setPage(url, res);
+                nextUrls = nextTocUrls(analyzeRule, itemRules.value(), res.url);
+                scan = scanNewest(book, analyzeRule, tocRule, listRule, itemRules.value(), reverse, fingerprint, url,
+                                  res.url, found);
+            }
+            if (scan != Scan::Found) return fullUpdate();
+            std::ranges::reverse(found);
+        } else {
+            if (scan != Scan::Found) return fullUpdate();
+            std::ranges::reverse(found);
+            // 之后新增的目录页，整页都是已知章节时（例如最后一页的下一页指回第一页）停止
+            const auto appendNew = [&](std::vector<BookChapter> &&page) {
+                size_t added = 0;
+                for (auto &chapter: page) {
+                    if (fingerprint.find(chapter.url).has_value()) continue;
+                    found.push_back(std::move(chapter));
+                    added++;
+                }
+                return added > 0;
+            };
+            if (!listedPages.empty()) {
+                const auto extract = [&](AnalyzeRule &rule, const size_t index) {
+                    const StrResponse page = fetchPage(bookSource, ruleData, listedPages[index], book.tocUrl);
+                    return analyzePage(book, rule, listRule, itemRules.value(), listedPages[index],
+                                       page.url, page.body.value_or(""));
+                };
+                const auto consume = [&](size_t, std::optional<std::vector<BookChapter> > &&page) {
+                    if (page.has_value()) appendNew(std::move(page.value()));
+                    return true;
+                };
+                if (pool != nullptr && listedPages.size() > 1) {
+                    const auto newRule = [&] {
+                        return AnalyzeRule(&ruleData, &bookSource);
+                    };
+                    BookList::parallelExtract<std::vector<BookChapter> >(*pool, listedPages.size(), newRule, extract,
+                                                                          consume);
+                } else {
+                    for (size_t index = 0; index < listedPages.size(); index++) {
+                        consume(index, extract(analyzeRule, index));
+                    }
+                }
+            } else {
+                while (!nextUrls.empty() && visited.insert(nextUrls[0]).second) {
+                    const std::string url = nextUrls[0];
+                    res = fetchPage(bookSource, ruleData, url, book.tocUrl);
+                    auto page = analyzePage(book, analyzeRule, listRule, itemRules.value(), url, res.url,
+                                            res.body.value_or(""), [&](const std::vector<std::string> &urls) {
+                                                nextUrls = urls;
+                                            });
+                    if (!appendNew(std::move(page))) break;
+                }
+            }
+        }
+
+        // 新章节之间按url去重，保留第一次出现的
+        distinctChapterList(found);
+        const size_t known = fingerprint.size();
+        for (size_t i = 0; i < found.size(); i++) {
+            found[i].index = static_cast<int>(known + i);
+        }
+        formatTitles(analyzeRule, tocRule, found, known);
+        fingerprint.append(found);
+
+        book.lastCheckCount = static_cast<int>(found.size());
+        if (!found.empty()) {
+            book.latestChapterTitle = found.back().title;
+            book.latestChapterTime = DateUtils::currentTimeMillis();
+        }
+        book.lastCheckTime = DateUtils::currentTimeMillis();
+        book.totalChapterNum = static_cast<int>(fingerprint.size());
+        TocUpdate update;
+        update.chapters = std::move(found);
+        return update;
+    }
+}
@@ -0,0 +1,672 @@
+#include <booksource/chapterstore.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+#include <ranges>
+#include <stdexcept>
+#include <unordered_set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr char fileMagic[8] = {'B', 'S', 'C', 'H', 'A', 'P', '0', '1'};
+    constexpr uint32_t recordMagic = 0x52435342; // "BSCR"
+
+    enum RecordType : uint8_t {
+        ChapterRecord = 1,
+        DictionaryRecord = 2,
+        RemoveRecord = 3
+    };
+
+    enum RecordFlags : uint8_t {
+        WithDictionary = 1, // 以字典为前缀压缩
+        Stored = 2          // 压缩后没有变小，保存原文
+    };
+
+    // 记录头之后依次为url与数据，checksum覆盖这两部分
+    struct RecordHeader {
+        uint32_t magic;
+        uint8_t type;
+        uint8_t flags;
+        uint16_t reserved;
+        int32_t index;
+        uint32_t urlSize;
+        uint32_t rawSize;
+        uint32_t compressedSize;
+        uint64_t key;
+        uint64_t checksum;
+    };
+
+    uint64_t hash64(const std::string_view s, uint64_t h = 1469598103934665603ULL) {
+        for (const unsigned char c: s) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    // 记录的校验和，每次处理8个字节
+    uint64_t checksum(const std::string_view url, const std::string_view data) {
+        uint64_t h = hash64(url);
+        size_t i = 0;
+        for (; i + 8 <= data.size(); i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data.data() + i, 8);
+            h = (h ^ word) * 0x9E3779B97F4A7C15ULL;
+            h ^= h >> 29;
+        }
+        return hash64(data.substr(i), h);
+    }
+
+    /* ---------- 压缩：LZ77，序列为 字面量长度、字面量、匹配距离、匹配长度，均为变长整数 ---------- */
+
+    constexpr size_t minMatch = 4;
+    constexpr int hashBits = 15;
+    constexpr int maxChain = 16;
+
+    void putVarint(std::string &out, uint64_t value) {
+        while (value >= 0x80) {
+            out += static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+
+    bool getVarint(const unsigned char *&p, const unsigned char *end, uint64_t &value) {
+        value = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7) {
+            const unsigned char c = *p++;
+            value |= static_cast<uint64_t>(c & 0x7f) << shift;
+            if ((c & 0x80) == 0) return true;
+        }
+        return false;
+    }
+
+    uint32_t hash4(const unsigned char *p) {
+        uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v * 2654435761U >> (32 - hashBits);
+    }
+
+    // 字典作为src之前的内容，匹配可以引用字典
+    std::string compress(const std::string_view dict, const std::string_view src) {
+        std::string buffer;
+        buffer.reserve(dict.size() + src.size());
+        buffer.append(dict).append(src);
+        const auto *data = reinterpret_cast<const unsigned char *>(buffer.data());
+        const size_t size = buffer.size();
+        std::vector<int32_t> head(1 << hashBits, -1);
+        std::vector<int32_t> chain(size);
+        const auto insert = [&](const size_t i) {
+            if (i + minMatch > size) return;
+            const uint32_t h = hash4(data + i);
+            chain[i] = head[h];
+            head[h] = static_cast<int32_t>(i);
+        };
+        for (size_t i = 0; i < dict.size(); i++) insert(i);
+
+        std::string out;
+        out.reserve(src.size() / 2 + 16);
+        size_t pos = dict.size();
+        size_t literal = pos;
+        while (pos + minMatch <= size) {
+            size_t bestLength = 0, bestPos = 0;
+            int32_t candidate = head[hash4(data + pos)];
+            for (int depth = 0; candidate >= 0 && depth < maxChain; depth++, candidate = chain[candidate]) {
+                if (std::memcmp(data + candidate, data + pos, minMatch) != 0) continue;
+                size_t length = minMatch;
+                while (pos + length < size && data[candidate + length] == data[pos + length]) length++;
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestPos = candidate;
+                    if (pos + length == size) break;
+                }
+            }
+            if (bestLength == 0) {
+                insert(pos++);
+                continue;
+            }
+            putVarint(out, pos - literal);
+            out.append(buffer, literal, pos - literal);
+            putVarint(out, pos - bestPos);
+            putVarint(out, bestLength - minMatch);
+            for (const size_t matchEnd = pos + bestLength; pos < matchEnd; pos++) insert(pos);
+            literal = pos;
+        }
+        putVarint(out, size - literal);
+        out.append(buffer, literal, size - literal);
+        return out;
+    }
+
+    // 解压时输出与输入末尾留出的余量，短的复制可以按固定的16字节进行
+    constexpr size_t copySlack = 16;
+
+    bool decompress(const std::string_view dict, const std::string_view src, const size_t rawSize, std::string &out) {
+        out.resize(rawSize + copySlack);
+        char *o = out.data();
+        size_t written = 0;
+        const auto *p = reinterpret_cast<const unsigned char *>(src.data());
+        const auto *end = p + src.size();
+        while (true) {
+            uint64_t literal;
+            if (!getVarint(p, end, literal) || literal > static_cast<size_t>(end - p) ||
+                literal > rawSize - written) {
+                return false;
+            }
+            if (literal <= copySlack && static_cast<size_t>(end - p) >= copySlack) {
+                std::memcpy(o + written, p, copySlack);
+            } else {
+                std::memcpy(o + written, p, literal);
+            }
+            p += literal;
+            written += literal;
+            if (written == rawSize) {
+                out.resize(rawSize);
+                return p == end;
+            }
+            uint64_t distance, length;
+            if (!getVarint(p, end, distance) || !getVarint(p, end, length)) return false;
+            length += minMatch;
+            if (distance == 0 || distance > written + dict.size() || length > rawSize - written) return false;
+            size_t from = 0;
+            if (distance > written) {
+                // 从字典开始，超出字典的部分接着从输出的开头复制
+                const size_t dictPos = dict.size() - (distance - written);
+                const size_t n = std::min<size_t>(length, dict.size() - dictPos);
+                std::memcpy(o + written, dict.data() + dictPos, n);
+                written += n;
+                length -= n;
+            } else {
+                from = written - distance;
+            }
+            if (from + copySlack <= written) {
+                // 距离不小于16字节时按16字节一段复制，多写的部分会被之后的内容覆盖
+                for (size_t i = 0; i < length; i += copySlack) {
+                    std::memcpy(o + written + i, o + from + i, copySlack);
+                }
+                written += length;
+            } else {
+                // 重叠的匹配逐字节复制
+                for (size_t i = 0; i < length; i++) o[written++] = o[from + i];
+            }
+        }
+    }
+
+    /**
+     * 训练字典：统计每个8字节片段出现在多少个样本中，贪心地选出共有片段最多的64字节段落
+     * 每选中一段就清零其中片段的计数，避免字典中出现重复的内容；得分最高的段落放在字典末尾，距离正文最近
+     */
+    std::string trainDictionary(const std::vector<std::string> &samples, const size_t maxSize) {
+        constexpr size_t dmer = 8, segment = 64, step = segment / 2;
+        std::vector<std::vector<uint64_t> > hashes(samples.size());
+        std::unordered_map<uint64_t, uint32_t> counts;
+        for (size_t s = 0; s < samples.size(); s++) {
+            const std::string_view sample = samples[s];
+            std::unordered_set<uint64_t> seen;
+            for (size_t i = 0; i + dmer <= sample.size(); i++) {
+                const uint64_t h = hash64(sample.substr(i, dmer));
+                hashes[s].push_back(h);
+                if (seen.insert(h).second) counts[h]++;
+            }
+        }
+        // 只出现在一个样本中的片段对其它章节没有帮助
+        const auto score = [&](const size_t s, const size_t start) {
+            uint64_t total = 0;
+            const size_t end = std::min(start + segment - dmer + 1, hashes[s].size());
+            for (size_t i = start; i < end; i++) {
+                if (const auto it = counts.find(hashes[s][i]); it != counts.end() && it->second > 1) {
+                    total += it->second;
+                }
+            }
+            return total;
+        };
+
+        // (得分, 样本, 起始位置)
+        using Candidate = std::tuple<uint64_t, size_t, size_t>;
+        std::priority_queue<Candidate> queue;
+        for (size_t s = 0; s < samples.size(); s++) {
+            for (size_t start = 0; start < hashes[s].size(); start += step) {
+                if (const uint64_t value = score(s, start); value > 0) queue.emplace(value, s, start);
+            }
+        }
+        std::vector<std::string_view> selected;
+        size_t total = 0;
+        while (!queue.empty() && total < maxSize) {
+            const auto [value, s, start] = queue.top();
+            queue.pop();
+            // 计数可能已经被之前选中的段落清零，重新计算后不再是最高的就放回去
+            const uint64_t current = score(s, start);
+            if (current == 0) continue;
+            if (current < value && !queue.empty() && current < std::get<0>(queue.top())) {
+                queue.emplace(current, s, start);
+                continue;
+            }
+            const std::string_view part = std::string_view(samples[s]).substr(
+                start, std::min(segment, maxSize - total));
+            selected.push_back(part);
+            total += part.size();
+            for (size_t i = start; i < std::min(start + segment - dmer + 1, hashes[s].size()); i++) {
+                counts.erase(hashes[s][i]);
+            }
+        }
+        std::string dict;
+        dict.reserve(total);
+        for (auto it = selected.rbegin(); it != selected.rend(); ++it) dict.append(*it);
+        return dict;
+    }
+
+    std::string makeRecord(const RecordType type, const uint8_t flags, const int32_t index, const uint64_t key,
+                           const std::string_view url, const size_t rawSize, const std::string_view data) {
+        RecordHeader header{};
+        header.magic = recordMagic;
+        header.type = type;
+        header.flags = flags;
+        header.index = index;
+        header.urlSize = static_cast<uint32_t>(url.size());
+        header.rawSize = static_cast<uint32_t>(rawSize);
+        header.compressedSize = static_cast<uint32_t>(data.size());
+        header.key = key;
+        header.checksum = checksum(url, data);
+        std::string record(sizeof(header), '\0');
+        std::memcpy(record.data(), &header, sizeof(header));
+        record.append(url).append(data);
+        return record;
+    }
+
+    bool writeAll(const int fd, const char *data, size_t size, off_t offset) {
+        while (size > 0) {
+            const ssize_t n = ::pwrite(fd, data, size, offset);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += n;
+            size -= n;
+            offset += n;
+        }
+        return true;
+    }
+
+    // 重命名之后同步所在的目录，保证新的目录项落盘
+    void syncDirectory(const std::string &file) {
+        const size_t slash = file.rfind('/');
+        const std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : file.substr(0, slash);
+        const int dirFd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd < 0) return;
+        ::fsync(dirFd);
+        ::close(dirFd);
+    }
+}
+
+// 只读映射，文件增长后映射范围外的部分需要重新映射；读取中的线程持有旧的映射，不受影响
+struct ChapterStore::Mapping {
+    const char *data = nullptr;
+    size_t size = 0;
+
+    Mapping(const int fd, const size_t size) : size(size) {
+        if (size == 0) return;
+        void *p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) throw std::runtime_error("Failed to map chapter store");
+        data = static_cast<const char *>(p);
+    }
+
+    ~Mapping() {
+        if (data != nullptr) ::munmap(const_cast<char *>(data), size);
+    }
+
+    Mapping(const Mapping &) = delete;
+
+    Mapping &operator=(const Mapping &) = delete;
+
+    RecordHeader header(const uint64_t offset) const {
+        RecordHeader header;
+        std::memcpy(&header, data + offset, sizeof(header));
+        return header;
+    }
+
+    // 记录中保存的url
+    std::string_view url(const uint64_t offset) const {
+        return {data + offset + sizeof(RecordHeader), header(offset).urlSize};
+    }
+};
+
+ChapterStore::ChapterStore(std::string file, Options options)
+    : file(std::move(file)), options(options) {
+    open();
+}
+
+ChapterStore::~ChapterStore() {
+    close();
+}
+
+std::string ChapterStore::fileName(const std::string &bookUrl) {
+    char name[24];
+    std::snprintf(name, sizeof(name), "%016llx.seg", static_cast<unsigned long long>(hash64(bookUrl)));
+    return name;
+}
+
+void ChapterStore::open() {
+    fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) throw std::runtime_error("Failed to open chapter store: " + file);
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        close();
+        throw std::runtime_error("Failed to open chapter store: " + file);
+    }
+    const auto size = static_cast<uint64_t>(st.st_size);
+    if (size == 0) {
+        if (!writeAll(fd, fileMagic, sizeof(fileMagic), 0)) {
+            close();
+            throw std::runtime_error("Failed to write chapter store: " + file);
+        }
+        end = sizeof(fileMagic);
+        return;
+    }
+    mapping = std::make_shared<Mapping>(fd, size);
+    if (size < sizeof(fileMagic) || std::memcmp(mapping->data, fileMagic, sizeof(fileMagic)) != 0) {
+        close();
+        throw std::runtime_error("Not a chapter store: " + file);
+    }
+    end = scan(*mapping);
+    // 截掉写入中断留下的不完整记录
+    if (end < size && ::ftruncate(fd, static_cast<off_t>(end)) != 0) {
+        close();
+        throw std::runtime_error("Failed to write chapter store: " + file);
+    }
+}
+
+void ChapterStore::close() {
+    mapping.reset();
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+}
+
+uint64_t ChapterStore::scan(const Mapping &mapping) {
+    // 先找出完整的记录，只有最后一条可能是写入中断留下的，校验它的数据
+    std::vector<uint64_t> offsets;
+    uint64_t pos = sizeof(fileMagic);
+    while (pos + sizeof(RecordHeader) <= mapping.size) {
+        const RecordHeader header = mapping.header(pos);
+        const uint64_t length = sizeof(RecordHeader) + header.urlSize + header.compressedSize;
+        if (header.magic != recordMagic || pos + length > mapping.size) break;
+        offsets.push_back(pos);
+        pos += length;
+    }
+    if (!offsets.empty()) {
+        const uint64_t last = offsets.back();
+        const RecordHeader header = mapping.header(last);
+        const char *url = mapping.data + last + sizeof(RecordHeader);
+        if (checksum(std::string_view(url, header.urlSize),
+                     std::string_view(url + header.urlSize, header.compressedSize)) != header.checksum) {
+            offsets.pop_back();
+            pos = last;
+        }
+    }
+
+    for (const uint64_t offset: offsets) {
+        const RecordHeader header = mapping.header(offset);
+        const auto length = static_cast<uint32_t>(sizeof(RecordHeader) + header.urlSize + header.compressedSize);
+        switch (header.type) {
+            case ChapterRecord: {
+                auto [it, inserted] = entries.try_emplace(header.key);
+                if (!inserted) garbage += it->second.length;
+                it->second = Entry{
+                    offset, length, header.index, header.rawSize, header.compressedSize, header.flags
+                };
+                break;
+            }
+            case RemoveRecord:
+                garbage += length;
+                if (const auto it = entries.find(header.key); it != entries.end()) {
+                    garbage += it->second.length;
+                    entries.erase(it);
+                }
+                break;
+            case DictionaryRecord:
+                dict = std::make_shared<const std::string>(
+                    mapping.data + offset + sizeof(RecordHeader) + header.urlSize, header.compressedSize);
+                trained = true;
+                break;
+            default:
+                garbage += length;
+                break;
+        }
+    }
+    return pos;
+}
+
+std::shared_ptr<const ChapterStore::Mapping> ChapterStore::mappingFor(const uint64_t end) {
+    if (mapping == nullptr || mapping->size < end) {
+        // 多映射一部分，之后追加的记录不需要每次重新映射
+        mapping = std::make_shared<Mapping>(fd, this->end + this->end / 2);
+    }
+    return mapping;
+}
+
+std::optional<std::string> ChapterStore::read(const Entry &entry, const std::shared_ptr<const Mapping> &mapping,
+                                              const std::shared_ptr<const std::string> &dict) const {
+    const RecordHeader header = mapping->header(entry.offset);
+    const std::string_view url(mapping->data + entry.offset + sizeof(RecordHeader), header.urlSize);
+    const std::string_view data(url.data() + url.size(), header.compressedSize);
+    if (checksum(url, data) != header.checksum) return std::nullopt;
+    if (header.flags & Stored) return std::string(data);
+    if ((header.flags & WithDictionary) && dict == nullptr) return std::nullopt;
+    std::string content;
+    if (!decompress(header.flags & WithDictionary ? std::string_view(*dict) : std::string_view(), data,
+                    header.rawSize, content)) {
+        return std::nullopt;
+    }
+    return content;
+}
+
+void ChapterStore::append(const std::string &record) {
+    if (!writeAll(fd, record.data(), record.size(), static_cast<off_t>(end))) {
+        throw std::runtime_error("Failed to write chapter store: " + file);
+    }
+    end += record.size();
+}
+
+void ChapterStore::trainDictionary() {
+    std::vector<Entry> first;
+    for (const auto &entry: entries | std::views::values) first.push_back(entry);
+    std::ranges::sort(first, {}, &Entry::offset);
+    if (first.size() > options.dictionaryChapters) first.resize(options.dictionaryChapters);
+    std::vector<std::string> samples;
+    const auto m = mappingFor(end);
+    for (const Entry &entry: first) {
+        if (auto content = read(entry, m, dict)) samples.push_back(std::move(*content));
+    }
+    const std::string trainedDict = ::trainDictionary(samples, options.dictionarySize);
+    append(makeRecord(DictionaryRecord, 0, 0, 0, "", trainedDict.size(), trainedDict));
+    dict = std::make_shared<const std::string>(trainedDict);
+    trained = true;
+}
+
+void ChapterStore::put(const BookChapter &chapter, const std::string_view content) {
+    put(chapter.url, chapter.index, content);
+}
+
+void ChapterStore::put(const std::string &url, const int index, const std::string_view content) {
+    std::shared_ptr<const std::string> d;
+    {
+        std::lock_guard lock(mutex);
+        if (!trained && entries.size() >= options.dictionaryChapters) trainDictionary();
+        d = dict;
+    }
+    // 压缩在锁外进行
+    uint8_t flags = 0;
+    std::string compressed;
+    if (d != nullptr && !d->empty()) {
+        compressed = compress(*d, content);
+        flags = WithDictionary;
+    } else {
+        compressed = compress({}, content);
+    }
+    if (compressed.size() >= content.size()) {
+        compressed = content;
+        flags = Stored;
+    }
+    const uint64_t key = hash64(url);
+    const std::string record = makeRecord(ChapterRecord, flags, index, key, url, content.size(), compressed);
+
+    std::lock_guard lock(mutex);
+    const uint64_t offset = end;
+    append(record);
+    auto [it, inserted] = entries.try_emplace(key);
+    if (!inserted) garbage += it->second.length;
+    it->second = Entry{
+        offset, static_cast<uint32_t>(record.size()), index, static_cast<uint32_t>(content.size()),
+        static_cast<uint32_t>(compressed.size()), flags
+    };
+    if (end >= options.compactMinSize && static_cast<double>(garbage) > options.compactRatio * static_cast<double>(end)) {
+        compactLocked();
+    }
+}
+
+std::optional<std::string> ChapterStore::get(const BookChapter &chapter) {
+    return get(chapter.url);
+}
+
+std::optional<std::string> ChapterStore::get(const std::string &url) {
+    Entry entry{};
+    std::shared_ptr<const Mapping> m;
+    std::shared_ptr<const std::string> d;
+    {
+        std::lock_guard lock(mutex);
+        const auto it = entries.find(hash64(url));
+        if (it == entries.end()) return std::nullopt;
+        entry = it->second;
+        m = mappingFor(entry.offset + entry.length);
+        d = dict;
+    }
+    // 索引只用url的哈希，哈希冲突时记录属于另一个url
+    if (m->url(entry.offset) != url) return std::nullopt;
+    return read(entry, m, d);
+}
+
+bool ChapterStore::contains(const std::string &url) {
+    std::lock_guard lock(mutex);
+    const auto it = entries.find(hash64(url));
+    return it != entries.end() && mappingFor(it->second.offset + it->second.length)->url(it->second.offset) == url;
+}
+
+bool ChapterStore::remove(const std::string &url) {
+    std::lock_guard lock(mutex);
+    const uint64_t key = hash64(url);
+    const auto it = entries.find(key);
+    if (it == entries.end() || mappingFor(it->second.offset + it->second.length)->url(it->second.offset) != url) {
+        return false;
+    }
+    const std::string record = makeRecord(RemoveRecord, 0, it->second.index, key, url, 0, "");
+    append(record);
+    garbage += it->second.length + record.size();
+    entries.erase(it);
+    return true;
+}
+
+size_t ChapterStore::size() {
+    std::lock_guard lock(mutex);
+    return entries.size();
+}
+
+std::vector<ChapterStore::ChapterInfo> ChapterStore::chapters() {
+    std::lock_guard lock(mutex);
+    std::vector<ChapterInfo> result;
+    result.reserve(entries.size());
+    const auto m = mappingFor(end);
+    for (const Entry &entry: entries | std::views::values) {
+        result.push_back(ChapterInfo{
+            entry.index, std::string(m->url(entry.offset)), entry.rawSize, entry.compressedSize
+        });
+    }
+    std::ranges::sort(result, {}, &ChapterInfo::index);
+    return result;
+}
+
+size_t ChapterStore::fileSize() {
+    std::lock_guard lock(mutex);
+    return end;
+}
+
+size_t ChapterStore::garbageSize() {
+    std::lock_guard lock(mutex);
+    return garbage;
+}
+
+bool ChapterStore::hasDictionary() {
+    std::lock_guard lock(mutex);
+    return dict != nullptr && !dict->empty();
+}
+
+void ChapterStore::compact() {
+    std::lock_guard lock(mutex);
+    compactLocked();
+}
+
+void ChapterStore::compactLocked() {
+    const std::string tmp = file + ".tmp";
+    const int out = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) throw std::runtime_error("Failed to write chapter store: " + tmp);
+
+    std::vector<std::pair<uint64_t, Entry> > sorted(entries.begin(), entries.end());
+    std::ranges::sort(sorted, [](const auto &a, const auto &b) {
+        return a.second.index != b.second.index ? a.second.index < b.second.index : a.second.offset < b.second.offset;
+    });
+    const auto m = mappingFor(end);
+    const bool useDict = dict != nullptr && !dict->empty();
+    std::unordered_map<uint64_t, Entry> compacted;
+    std::string buffer(fileMagic, sizeof(fileMagic));
+    uint64_t written = 0;
+    bool ok = true;
+    // 缓冲区满时写出
+    const auto flush = [&](const bool force) {
+        if (!ok || (!force && buffer.size() < (1 << 20))) return;
+        ok = writeAll(out, buffer.data(), buffer.size(), static_cast<off_t>(written));
+        written += buffer.size();
+        buffer.clear();
+    };
+    if (trained) buffer += makeRecord(DictionaryRecord, 0, 0, 0, "", dict->size(), *dict);
+    for (const auto &[key, entry]: sorted) {
+        Entry moved = entry;
+        moved.offset = written + buffer.size();
+        const char *record = m->data + entry.offset;
+        if (useDict && !(entry.flags & (WithDictionary | Stored))) {
+            // 训练字典之前写入的章节用字典重新压缩
+            if (const auto content = read(entry, m, dict)) {
+                const std::string_view url = m->url(entry.offset);
+                std::string compressed = compress(*dict, *content);
+                if (compressed.size() < entry.compressedSize) {
+                    const std::string rewritten = makeRecord(ChapterRecord, WithDictionary, entry.index, key, url,
+                                                             content->size(), compressed);
+                    moved.length = static_cast<uint32_t>(rewritten.size());
+                    moved.compressedSize = static_cast<uint32_t>(compressed.size());
+                    moved.flags = WithDictionary;
+                    buffer += rewritten;
+                    compacted.emplace(key, moved);
+                    flush(false);
+                    continue;
+                }
+            }
+        }
+        buffer.append(record, entry.length);
+        compacted.emplace(key, moved);
+        flush(false);
+    }
+    flush(true);
+    // 新文件落盘之后才替换原文件，否则断电后可能只剩下空的或者不完整的文件
+    if (!ok || ::fdatasync(out) != 0 || std::rename(tmp.c_str(), file.c_str()) != 0) {
+        ::close(out);
+        ::unlink(tmp.c_str());
+        throw std::runtime_error("Failed to write chapter store: " + file);
+    }
+    syncDirectory(file);
+    close();
+    fd = out;
+    end = written;
+    garbage = 0;
+    entries = std::move(compacted);
+}
@@ -0,0 +1,612 @@
+#include <booksource/charset.h>
+#include <booksource/utils.h>
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "charset_table.inc"
+
+namespace Charset {
+
+// GB18030 四字节区：BMP 部分最大的 pointer，以及补充平面的起始 pointer
+constexpr uint32_t GB18030_BMP_POINTER_MAX = 39419;
+constexpr uint32_t GB18030_SUPPLEMENT_POINTER = 189000;
+constexpr uint32_t GB18030_POINTER_MAX = 1237575;
+constexpr uint32_t REPLACEMENT_CHAR = 0xFFFD;
+
+static char toLowerAscii(const char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+static std::string toLowerCopy(const std::string_view s) {
+    std::string out(s);
+    std::ranges::transform(out, out.begin(), toLowerAscii);
+    return out;
+}
+
+// 返回从 p 开始连续 ASCII 字节的数量，SSE2 下一次检查 16 字节
+static size_t asciiRun(const char *p, const size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    while (i + 16 <= n) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        if (const int mask = _mm_movemask_epi8(chunk); mask != 0) {
+            return i + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+        i += 16;
+    }
+#else
+    while (i + 8 <= n) {
+        uint64_t word;
+        std::memcpy(&word, p + i, sizeof(word));
+        if (word & 0x8080808080808080ULL) break;
+        i += 8;
+    }
+#endif
+    while (i < n && static_cast<unsigned char>(p[i]) < 0x80) i++;
+    return i;
+}
+
+static void appendUtf8(std::string &out, const uint32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+/**
+ * 从 UTF-8 中读取一个码点，失败时返回 U+FFFD 并前进一个字节
+ */
+static uint32_t nextCodePoint(const std::string_view s, size_t &i) {
+    const auto b0 = static_cast<unsigned char>(s[i]);
+    if (b0 < 0x80) {
+        i++;
+        return b0;
+    }
+    int len;
+    uint32_t cp;
+    if ((b0 & 0xE0) == 0xC0 && b0 >= 0xC2) {
+        len = 2;
+        cp = b0 & 0x1F;
+    } else if ((b0 & 0xF0) == 0xE0) {
+        len = 3;
+        cp = b0 & 0x0F;
+    } else if ((b0 & 0xF8) == 0xF0 && b0 <= 0xF4) {
+        len = 4;
+        cp = b0 & 0x07;
+    } else {
+        i++;
+        return REPLACEMENT_CHAR;
+    }
+    if (i + len > s.size()) {
+        i++;
+        return REPLACEMENT_CHAR;
+    }
+    for (int k = 1; k < len; k++) {
+        const auto b = static_cast<unsigned char>(s[i + k]);
+        if ((b & 0xC0) != 0x80) {
+            i++;
+            return REPLACEMENT_CHAR;
+        }
+        cp = (cp << 6) | (b & 0x3F);
+    }
+    // 过长编码、代理区以及超出范围的码点均视为非法
+    if ((len == 3 && cp < 0x800) || (len == 4 && (cp < 0x10000 || cp > 0x10FFFF)) ||
+        (cp >= 0xD800 && cp <= 0xDFFF)) {
+        i++;
+        return REPLACEMENT_CHAR;
+    }
+    i += len;
+    return cp;
+}
+
+std::optional<Encoding> fromName(const std::string_view name) {
+    std::string n = toLowerCopy(name);
+    StringUtils::trim(n);
+    if (n.size() >= 2 && (n.front() == '"' || n.front() == '\'')) {
+        n = n.substr(1, n.size() - 2);
+    }
+    if (n == "utf-8" || n == "utf8" || n == "unicode-1-1-utf-8") return Encoding::UTF8;
+    if (n == "gbk" || n == "gb2312" || n == "gb_2312-80" || n == "x-gbk" || n == "cp936" ||
+        n == "windows-936" || n == "euc-cn" || n == "chinese" || n == "iso-ir-58") {
+        return Encoding::GBK;
+    }
+    if (n == "gb18030") return Encoding::GB18030;
+    if (n == "big5" || n == "big5-hkscs" || n == "cp950" || n == "x-x-big5" || n == "cn-big5") {
+        return Encoding::Big5;
+    }
+    if (n == "utf-16le" || n == "utf-16") return Encoding::UTF16LE;
+    if (n == "utf-16be") return Encoding::UTF16BE;
+    return std::nullopt;
+}
+
+const char *name(const Encoding encoding) {
+    switch (encoding) {
+        case Encoding::UTF8: return "UTF-8";
+        case Encoding::GBK: return "GBK";
+        case Encoding::GB18030: return "GB18030";
+        case Encoding::Big5: return "Big5";
+        case Encoding::UTF16LE: return "UTF-16LE";
+        case Encoding::UTF16BE: return "UTF-16BE";
+    }
+    return "UTF-8";
+}
+
+// 读取 charset= 之后的字符集名称
+static std::optional<Encoding> charsetAfter(const std::string_view lower, size_t pos) {
+    while (pos < lower.size() && (lower[pos] == ' ' || lower[pos] == '=' ||
+                                  lower[pos] == '"' || lower[pos] == '\'')) {
+        pos++;
+    }
+    size_t end = pos;
+    while (end < lower.size() && (std::isalnum(static_cast<unsigned char>(lower[end])) ||
+                                  lower[end] == '-' || lower[end] == '_')) {
+        end++;
+    }
+    if (end == pos) return std::nullopt;
+    return fromName(lower.substr(pos, end - pos));
+}
+
+std::optional<Encoding> fromContentType(const std::string_view contentType) {
+    const std::string lower = toLowerCopy(contentType);
+    const size_t pos = lower.find("charset");
+    if (pos == std::string::npos) return std::nullopt;
+    return charsetAfter(lower, pos + 7);
+}
+
+std::optional<Encoding> fromBom(const std::string_view data, size_t &bomLength) {
+    bomLength = 0;
+    if (data.size() >= 3 && data.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+        bomLength = 3;
+        return Encoding::UTF8;
+    }
+    if (data.size() >= 2 && data.compare(0, 2, "\xFF\xFE") == 0) {
+        bomLength = 2;
+        return Encoding::UTF16LE;
+    }
+    if (data.size() >= 2 && data.compare(0, 2, "\xFE\xFF") == 0) {
+        bomLength = 2;
+        return Encoding::UTF16BE;
+    }
+    return std::nullopt;
+}
+
+std::optional<Encoding> fromMeta(const std::string_view html) {
+    const std::string lower = toLowerCopy(html.substr(0, std::min<size_t>(html.size(), 4096)));
+    size_t pos = 0;
+    while ((pos = lower.find("<meta", pos)) != std::string::npos) {
+        const size_t end = lower.find('>', pos);
+        const std::string_view tag = std::string_view(lower).substr(
+            pos, end == std::string::npos ? std::string::npos : end - pos);
+        if (const size_t cs = tag.find("charset"); cs != std::string_view::npos) {
+            if (auto enc = charsetAfter(tag, cs + 7)) return enc;
+        }
+        if (end == std::string::npos) break;
+        pos = end;
+    }
+    return std::nullopt;
+}
+
+bool isValidUtf8(const std::string_view data) {
+    size_t i = 0;
+    while (i < data.size()) {
+        i += asciiRun(data.data() + i, data.size() - i);
+        if (i >= data.size()) break;
+        const size_t before = i;
+        if (nextCodePoint(data, i) == REPLACEMENT_CHAR) {
+            // 原文本身就是 U+FFFD 的情况
+            if (data.compare(before, 3, "\xEF\xBF\xBD") != 0) return false;
+        }
+    }
+    return true;
+}
+
+Encoding detect(
+    const std::string_view body,
+    const std::string_view contentType,
+    const std::optional<std::string> &charset
+) {
+    if (charset.has_value()) {
+        if (const auto enc = fromName(*charset)) return *enc;
+    }
+    size_t bomLength;
+    if (const auto enc = fromBom(body, bomLength)) return *enc;
+    if (const auto enc = fromContentType(contentType)) return *enc;
+    if (const auto enc = fromMeta(body)) return *enc;
+    return isValidUtf8(body) ? Encoding::UTF8 : Encoding::GB18030;
+}
+
+// GB18030 四字节 pointer 转码点，失败返回 0
+static uint32_t gb18030RangesCodePoint(const uint32_t pointer) {
+    if ((pointer > GB18030_BMP_POINTER_MAX && pointer < GB18030_SUPPLEMENT_POINTER) ||
+        pointer > GB18030_POINTER_MAX) {
+        return 0;
+    }
+    if (pointer >= GB18030_SUPPLEMENT_POINTER) {
+        return 0x10000 + pointer - GB18030_SUPPLEMENT_POINTER;
+    }
+    if (pointer == 7457) return 0xE7C7;
+    const auto it = std::upper_bound(
+        std::begin(GB18030_RANGES), std::end(GB18030_RANGES), pointer,
+        [](const uint32_t p, const uint32_t (&range)[2]) { return p < range[0]; });
+    const auto &range = *(it - 1);
+    return range[1] + pointer - range[0];
+}
+
+// 码点转 GB18030 四字节 pointer
+static uint32_t gb18030RangesPointer(const uint32_t cp) {
+    if (cp >= 0x10000) return GB18030_SUPPLEMENT_POINTER + cp - 0x10000;
+    if (cp == 0xE7C7) return 7457;
+    const auto it = std::upper_bound(
+        std::begin(GB18030_RANGES), std::end(GB18030_RANGES), cp,
+        [](const uint32_t c, const uint32_t (&range)[2]) { return c < range[1]; });
+    const auto &range = *(it - 1);
+    return range[0] + cp - range[1];
+}
+
+static std::string decodeGb18030(const std::string_view data) {
+    std::string out;
+    out.reserve(data.size() + data.size() / 2);
+    const char *p = data.data();
+    const size_t n = data.size();
+    size_t i = 0;
+    while (i < n) {
+        const size_t run = asciiRun(p + i, n - i);
+        if (run > 0) {
+            out.append(p + i, run);
+            i += run;
+            if (i >= n) break;
+        }
+        const auto b1 = static_cast<unsigned char>(p[i]);
+        if (b1 == 0x80) {
+            appendUtf8(out, 0x20AC);
+            i++;
+            continue;
+        }
+        if (b1 == 0xFF || i + 1 >= n) {
+            appendUtf8(out, REPLACEMENT_CHAR);
+            i++;
+            continue;
+        }
+        const auto b2 = static_cast<unsigned char>(p[i + 1]);
+        if (b2 >= 0x30 && b2 <= 0x39) {
+            // 四字节
+            if (i + 3 < n) {
+                const auto b3 = static_cast<unsigned char>(p[i + 2]);
+                const auto b4 = static_cast<unsigned char>(p[i + 3]);
+                if (b3 >= 0x81 && b3 <= 0xFE && b4 >= 0x30 && b4 <= 0x39) {
+                    const uint32_t pointer = (b1 - 0x81) * 12600 + (b2 - 0x30) * 1260 +
+                                             (b3 - 0x81) * 10 + (b4 - 0x30);
+                    if (const uint32_t cp = gb18030RangesCodePoint(pointer); cp != 0) {
+                        appendUtf8(out, cp);
+                        i += 4;
+                        continue;
+                    }
+                }
+            }
+            appendUtf8(out, REPLACEMENT_CHAR);
+            i++;
+            continue;
+        }
+        if (b2 >= 0x40 && b2 <= 0xFE && b2 != 0x7F) {
+            const uint32_t pointer = (b1 - 0x81) * 190 + (b2 - (b2 < 0x7F ? 0x40 : 0x41));
+            if (const uint16_t cp = GB18030_TWO_BYTE[pointer]; cp != 0) {
+                appendUtf8(out, cp);
+                i += 2;
+                continue;
+            }
+        }
+        // 非法的双字节：第二个字节若为 ASCII 则保留给下一轮处理
+        appendUtf8(out, REPLACEMENT_CHAR);
+        i += b2 < 0x80 ? 1 : 2;
+    }
+    return out;
+}
+
+static std::string decodeBig5(const std::string_view data) {
+    std::string out;
+    out.reserve(data.size() + data.size() / 2);
+    const char *p = data.data();
+    const size_t n = data.size();
+    size_t i = 0;
+    while (i < n) {
+        const size_t run = asciiRun(p + i, n - i);
+        if (run > 0) {
+            out.append(p + i, run);
+            i += run;
+            if (i >= n) break;
+        }
+        const auto b1 = static_cast<unsigned char>(p[i]);
+        if (b1 == 0x80 || b1 == 0xFF || i + 1 >= n) {
+            appendUtf8(out, REPLACEMENT_CHAR);
+            i++;
+            continue;
+        }
+        const auto b2 = static_cast<unsigned char>(p[i + 1]);
+        if ((b2 >= 0x40 && b2 <= 0x7E) || (b2 >= 0xA1 && b2 <= 0xFE)) {
+            const uint32_t pointer = (b1 - 0x81) * 157 + (b2 - (b2 < 0x7F ? 0x40 : 0x62));
+            if (const uint16_t cp = BIG5_TABLE[pointer]; cp != 0) {
+                appendUtf8(out, cp);
+                i += 2;
+                continue;
+            }
+        }
+        appendUtf8(out, REPLACEMENT_CHAR);
+        i += b2 < 0x80 ? 1 : 2;
+    }
+    return out;
+}
+
+static std::string decodeUtf16(const std::string_view data, const bool bigEndian) {
+    std::string out;
+    out.reserve(data.size() + data.size() / 2);
+    auto unitAt = [&](const size_t i) -> uint32_t {
+        const auto a = static_cast<unsigned char>(data[i]);
+        const auto b = static_cast<unsigned char>(data[i + 1]);
+        return bigEndian ? (a << 8 | b) : (b << 8 | a);
+    };
+    size_t i = 0;
+    while (i + 1 < data.size()) {
+        uint32_t cp = unitAt(i);
+        i += 2;
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+            if (i + 1 < data.size()) {
+                if (const uint32_t low = unitAt(i); low >= 0xDC00 && low <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i += 2;
+                    appendUtf8(out, cp);
+                    continue;
+                }
+            }
+            cp = REPLACEMENT_CHAR;
+        } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+            cp = REPLACEMENT_CHAR;
+        }
+        appendUtf8(out, cp);
+    }
+    return out;
+}
+
+std::string toUtf8(std::string_view data, const Encoding encoding) {
+    size_t bomLength;
+    if (const auto bom = fromBom(data, bomLength); bom && *bom == encoding) {
+        data.remove_prefix(bomLength);
+    }
+    switch (encoding) {
+        case Encoding::GBK:
+        case Encoding::GB18030:
+            return decodeGb18030(data);
+        case Encoding::Big5:
+            return decodeBig5(data);
+        case Encoding::UTF16LE:
+            return decodeUtf16(data, false);
+        case Encoding::UTF16BE:
+            return decodeUtf16(data, true);
+        case Encoding::UTF8:
+            break;
+    }
+    return std::string(data);
+}
+
+/**
+ * 反向查找表：码点 -> 双字节编码（高字节在前），0 表示无对应编码
+ * 首次使用时由正向表生成
+ */
+static const std::vector<uint16_t> &gb18030ReverseTable() {
+    static std::vector<uint16_t> table;
+    static std::once_flag flag;
+    std::call_once(flag, [] {
+        table.assign(0x10000, 0);
+        for (uint32_t pointer = 0; pointer < std::size(GB18030_TWO_BYTE); pointer++) {
+            const uint16_t cp = GB18030_TWO_BYTE[pointer];
+            if (cp == 0 || table[cp] != 0) continue;
+            const uint32_t lead = pointer / 190 + 0x81;
+            const uint32_t offset = pointer % 190;
+            const uint32_t trail = offset + (offset < 0x3F ? 0x40 : 0x41);
+            table[cp] = static_cast<uint16_t>(lead << 8 | trail);
+        }
+    });
+    return table;
+}
+
+static const std::vector<uint16_t> &big5ReverseTable() {
+    static std::vector<uint16_t> table;
+    static std::once_flag flag;
+    std::call_once(flag, [] {
+        table.assign(0x10000, 0);
+        for (uint32_t pointer = 0; pointer < std::size(BIG5_TABLE); pointer++) {
+            const uint16_t cp = BIG5_TABLE[pointer];
+            if (cp == 0 || table[cp] != 0) continue;
+            const uint32_t lead = pointer / 157 + 0x81;
+            const uint32_t offset = pointer % 157;
+            const uint32_t trail = offset + (offset < 0x3F ? 0x40 : 0x62);
+            table[cp] = static_cast<uint16_t>(lead << 8 | trail);
+        }
+    });
+    return table;
+}
+
+std::string fromUtf8(const std::string_view utf8, const Encoding encoding) {
+    if (encoding == Encoding::UTF8) return std::string(utf8);
+    std::string out;
+    out.reserve(utf8.size());
+    const bool isGb = encoding == Encoding::GBK || encoding == Encoding::GB18030;
+    const auto &reverse = isGb ? gb18030ReverseTable() : big5ReverseTable();
+    size_t i = 0;
+    while (i < utf8.size()) {
+        if (encoding != Encoding::UTF16LE && encoding != Encoding::UTF16BE) {
+            const size_t run = asciiRun(utf8.data() + i, utf8.size() - i);
+            if (run > 0) {
+                out.append(utf8.data() + i, run);
+                i += run;
+                if (i >= utf8.size()) break;
+            }
+        }
+        const uint32_t cp = nextCodePoint(utf8, i);
+        if (encoding == Encoding::UTF16LE || encoding == Encoding::UTF16BE) {
+            auto putUnit = [&](const uint32_t unit) {
+                const char hi = static_cast<char>(unit >> 8), lo = static_cast<char>(unit & 0xFF);
+                out.push_back(encoding == Encoding::UTF16BE ? hi : lo);
+                out.push_back(encoding == Encoding::UTF16BE ? lo : hi);
+            };
+            if (cp >= 0x10000) {
+                putUnit(0xD800 + ((cp - 0x10000) >> 10));
+                putUnit(0xDC00 + ((cp - 0x10000) & 0x3FF));
+            } else {
+                putUnit(cp);
+            }
+            continue;
+        }
+        if (cp < 0x80) {
+            out.push_back(static_cast<char>(cp));
+            continue;
+        }
+        if (cp < 0x10000 && reverse[cp] != 0) {
+            out.push_back(static_cast<char>(reverse[cp] >> 8));
+            out.push_back(static_cast<char>(reverse[cp] & 0xFF));
+            continue;
+        }
+        if (encoding == Encoding::GBK && cp == 0x20AC) {
+            out.push_back(static_cast<char>(0x80));
+            continue;
+        }
+        if (encoding == Encoding::GB18030 && cp != REPLACEMENT_CHAR) {
+            uint32_t pointer = gb18030RangesPointer(cp);
+            const char b4 = static_cast<char>(0x30 + pointer % 10);
+            pointer /= 10;
+            const char b3 = static_cast<char>(0x81 + pointer % 126);
+            pointer /= 126;
+            const char b2 = static_cast<char>(0x30 + pointer % 10);
+            const char b1 = static_cast<char>(0x81 + pointer / 10);
+            out.push_back(b1);
+            out.push_back(b2);
+            out.push_back(b3);
+            out.push_back(b4);
+            continue;
+        }
+        out.push_back('?');
+    }
+    return out;
+}
+
+std::string urlEncode(const std::string_view str, const Encoding encoding, const bool form) {
+    static constexpr char HEX[] = "0123456789ABCDEF";
+    const std::string bytes = fromUtf8(str, encoding);
+    const auto &allowed = form ? NetworkUtils::notNeedEncodingForm : NetworkUtils::notNeedEncodingQuery;
+    std::string out;
+    out.reserve(bytes.size() * 3);
+    for (size_t i = 0; i < bytes.size(); i++) {
+        const auto c = static_cast<unsigned char>(bytes[i]);
+        // 已经编码过的 %XX 保持不变
+        if (c == '%' && i + 2 < bytes.size() &&
+            NetworkUtils::isDigit16Char(bytes[i + 1]) && NetworkUtils::isDigit16Char(bytes[i + 2])) {
+            out.append(bytes, i, 3);
+            i += 2;
+        } else if (c < 0x80 && allowed[c]) {
+            out.push_back(static_cast<char>(c));
+        } else if (form && c == ' ') {
+            out.push_back('+');
+        } else {
+            out.push_back('%');
+            out.push_back(HEX[c >> 4]);
+            out.push_back(HEX[c & 0x0F]);
+        }
+    }
+    return out;
+}
+
+std::string encodeParams(const std::string_view params, const Encoding encoding, const bool form) {
+    std::string out;
+    out.reserve(params.size() * 2);
+    size_t start = 0;
+    while (start <= params.size()) {
+        size_t end = params.find('&', start);
+        if (end == std::string_view::npos) end = params.size();
+        const std::string_view pair = params.substr(start, end - start);
+        if (const size_t eq = pair.find('='); eq != std::string_view::npos) {
+            out += urlEncode(pair.substr(0, eq), encoding, form);
+            out.push_back('=');
+            out += urlEncode(pair.substr(eq + 1), encoding, form);
+        } else {
+            out += urlEncode(pair, encoding, form);
+        }
+        if (end == params.size()) break;
+        out.push_back('&');
+        start = end + 1;
+    }
+    return out;
+}
+
+
+StreamDecoder::StreamDecoder(const std::string_view contentType, const std::optional<std::string> &charset)
+    : contentType(contentType) {
+    if (charset.has_value()) {
+        encoding = fromName(*charset);
+    }
+}
+
+// 可以安全分段的位置：最后一个小于 0x40 的非数字字节之后
+static size_t safeLength(const std::string_view data) {
+    for (size_t i = data.size(); i > 0; i--) {
+        if (const auto c = static_cast<unsigned char>(data[i - 1]); c < 0x40 && (c < '0' || c > '9')) return i;
+    }
+    return 0;
+}
+
+bool StreamDecoder::resolve(const bool eof) {
+    if (encoding) return true;
+    // BOM 最长为 3 字节
+    if (pending.size() < 3 && !eof) return false;
+    size_t bomLength;
+    if ((encoding = fromBom(pending, bomLength))) return true;
+    if ((encoding = fromContentType(contentType))) return true;
+    // fromMeta 只扫描前 4KB
+    if (pending.size() < 4096 && !eof) return false;
+    if ((encoding = fromMeta(pending))) return true;
+    guessed = isValidUtf8(std::string_view(pending).substr(0, eof ? pending.size() : safeLength(pending)));
+    encoding = guessed ? Encoding::UTF8 : Encoding::GB18030;
+    return true;
+}
+
+std::string StreamDecoder::convert(const size_t length) {
+    const std::string_view data = std::string_view(pending).substr(0, length);
+    if (guessed && !mismatch && !isValidUtf8(data)) {
+        mismatch = true;
+    }
+    std::string out = toUtf8(data, *encoding);
+    pending.erase(0, length);
+    return out;
+}
+
+std::string StreamDecoder::feed(const std::string_view data) {
+    pending.append(data);
+    if (!resolve(false)) return {};
+    if (!supported()) {
+        pending.clear();
+        return {};
+    }
+    return convert(safeLength(pending));
+}
+
+std::string StreamDecoder::finish() {
+    if (!resolve(true) || !supported()) return {};
+    return convert(pending.size());
+}
+
+}
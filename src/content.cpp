@@ -0,0 +1,426 @@
+#include <booksource/content.h>
+#include <booksource/html.h>
+#include <booksource/utils.h>
+#include <unordered_set>
+
+namespace BookContent {
+    namespace {
+        bool isSpace(const char c) {
+            // 与java正则的 \s 相同，只有ascii的空白
+            return c == ' ' || c == '\t' || c == '\n' || c == '\x0B' || c == '\f' || c == '\r';
+        }
+
+        bool isLetter(const char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        }
+
+        /**
+         * 按段落写入文本：空白中有换行时为段落分隔，替换为"\n　　"；行内的空白原样保留；
+         * 开头有空白时以"　　"开始，结尾的空白去掉
+         */
+        class TextWriter {
+        public:
+            explicit TextWriter(std::string &out) : out(out) {
+            }
+
+            void space(const char c) {
+                if (c == '\n') {
+                    newline = true;
+                } else if (!newline) {
+                    pending.push_back(c);
+                }
+                if (!started) leading = true;
+            }
+
+            void text(const std::string_view s) {
+                if (!started) {
+                    if (leading) out += "　　";
+                    started = true;
+                } else if (newline) {
+                    out += "\n　　";
+                } else {
+                    out += pending;
+                }
+                newline = false;
+                pending.clear();
+                out += s;
+            }
+
+        private:
+            std::string &out;
+            std::string pending;
+            bool started = false;
+            bool leading = false;
+            bool newline = false;
+        };
+
+        // 阅读HtmlFormatter中转换为换行的标签：</?(?:div|p|br|hr|h\d|article|dd|dl)[^>]*>，标签名只比较开头
+        bool isWrapTag(const std::string_view name) {
+            for (const std::string_view tag: {"div", "p", "br", "hr", "article", "dd", "dl"}) {
+                if (name.starts_with(tag)) return true;
+            }
+            return name.size() > 1 && name[0] == 'h' && name[1] >= '0' && name[1] <= '9';
+        }
+
+        // 标签中属性name的值，没有时返回空
+        std::string_view attribute(const std::string_view tag, const std::string_view name) {
+            for (size_t pos = tag.find(name); pos != std::string_view::npos; pos = tag.find(name, pos + 1)) {
+                if (pos == 0 || !isSpace(tag[pos - 1])) continue;
+                size_t i = pos + name.size();
+                while (i < tag.size() && isSpace(tag[i])) i++;
+                if (i == tag.size() || tag[i] != '=') continue;
+                i++;
+                while (i < tag.size() && isSpace(tag[i])) i++;
+                if (i == tag.size() || (tag[i] != '"' && tag[i] != '\'')) continue;
+                const size_t end = tag.find(tag[i], i + 1);
+                if (end == std::string_view::npos) continue;
+                return tag.substr(i + 1, end - i - 1);
+            }
+            return {};
+        }
+
+        bool startsWith(const std::string_view html, const size_t pos, const std::string_view prefix) {
+            return html.compare(pos, prefix.size(), prefix) == 0;
+        }
+
+        // 与阅读的 \n\s* 相同分行，空行与行首的空白属于分隔符
+        std::vector<std::string_view> splitLines(const std::string_view text) {
+            std::vector<std::string_view> lines;
+            size_t begin = 0;
+            while (true) {
+                const size_t end = text.find('\n', begin);
+                if (end == std::string_view::npos) {
+                    lines.push_back(text.substr(begin));
+                    return lines;
+                }
+                lines.push_back(text.substr(begin, end - begin));
+                begin = end + 1;
+                while (begin < text.size() && isSpace(text[begin])) begin++;
+            }
+        }
+
+        // 去掉每一行首尾的空白，包括全角空格
+        std::string trimLines(const std::string_view text) {
+            std::string result;
+            result.reserve(text.size());
+            for (std::string_view line: splitLines(text)) {
+                while (true) {
+                    if (!line.empty() && isSpace(line.front())) {
+                        line.remove_prefix(1);
+                    } else if (line.starts_with("　")) {
+                        line.remove_prefix(3);
+                    } else {
+                        break;
+                    }
+                }
+                while (true) {
+                    if (!line.empty() && isSpace(line.back())) {
+                        line.remove_suffix(1);
+                    } else if (line.ends_with("　")) {
+                        line.remove_suffix(3);
+                    } else {
+                        break;
+                    }
+                }
+                if (!result.empty()) result += '\n';
+                result += line;
+            }
+            return result;
+        }
+
+        StrResponse fetchPage(BookSource &bookSource, RuleData &ruleData, BookChapter &chapter,
+                              const std::string &url, const std::string &baseUrl) {
+            AnalyzeUrl analyzeUrl(url, std::nullopt, std::nullopt, std::nullopt, std::nullopt, baseUrl, &bookSource,
+                                  &ruleData, &chapter);
+            return analyzeUrl.getStrResponse();
+        }
+
+        // 把一页正文对章节副本的变量修改（相对于before）合并到章节
+        void mergeVariables(BookChapter &chapter, const std::unordered_map<std::string, std::string> &before,
+                            const std::optional<std::string> &after) {
+            const auto map = JsonUtils::jsonStringToMap(after.value_or(""));
+            for (const auto &[key, value]: map) {
+                if (const auto it = before.find(key); it == before.end() || it->second != value) {
+                    chapter.putVariable(key, value);
+                }
+            }
+            for (const auto &[key, value]: before) {
+                if (!map.contains(key)) chapter.putVariable(key, std::nullopt);
+            }
+        }
+    }
+
+    void appendText(std::string &out, const std::string_view html, const std::string &pageUrl) {
+        const size_t begin = out.size();
+        TextWriter writer(out);
+        size_t i = 0;
+        while (i < html.size()) {
+            const char c = html[i];
+            if (isSpace(c)) {
+                writer.space(c);
+                i++;
+                continue;
+            }
+            if (c == '&') {
+                if (startsWith(html, i, "&nbsp;")) {
+                    // 连续的&nbsp;只替换为一个空格
+                    while (startsWith(html, i, "&nbsp;")) i += 6;
+                    writer.space(' ');
+                    continue;
+                }
+                if (startsWith(html, i, "&ensp;") || startsWith(html, i, "&emsp;")) {
+                    writer.space(' ');
+                    i += 6;
+                    continue;
+                }
+                if (startsWith(html, i, "&thinsp;")) {
+                    i += 8;
+                    continue;
+                }
+                if (startsWith(html, i, "&zwnj;")) {
+                    i += 6;
+                    continue;
+                }
+                if (startsWith(html, i, "&zwj;")) {
+                    i += 5;
+                    continue;
+                }
+            } else if (c == '\xE2' && startsWith(html, i, "\xE2\x80") && i + 2 < html.size() &&
+                       (html[i + 2] == '\x89' || html[i + 2] == '\x8C' || html[i + 2] == '\x8D')) {
+                // 不可见的U+2009、U+200C、U+200D
+                i += 3;
+                continue;
+            } else if (c == '<') {
+                if (startsWith(html, i, "<!--")) {
+                    // <!--[^>]*-->
+                    if (const size_t gt = html.find('>', i + 4);
+                        gt != std::string_view::npos && gt >= i + 6 && html[gt - 1] == '-' && html[gt - 2] == '-') {
+                        i = gt + 1;
+                        continue;
+                    }
+                }
+                const size_t nameBegin = i + 1 < html.size() && html[i + 1] == '/' ? i + 2 : i + 1;
+                size_t nameEnd = nameBegin;
+                while (nameEnd < html.size() && isLetter(html[nameEnd])) nameEnd++;
+                if (isWrapTag(html.substr(nameBegin, 7))) {
+                    if (const size_t gt = html.find('>', nameBegin); gt != std::string_view::npos) {
+                        writer.space('\n');
+                        i = gt + 1;
+                        continue;
+                    }
+                }
+                // </?[a-zA-Z]+(?=[ >])[^<>]*>
+                if (nameEnd > nameBegin && nameEnd < html.size() && (html[nameEnd] == ' ' || html[nameEnd] == '>')) {
+                    const size_t gt = html.find_first_of("<>", nameEnd);
+                    if (gt != std::string_view::npos && html[gt] == '>') {
+                        if (nameBegin == i + 1 && html.substr(nameBegin, nameEnd - nameBegin) == "img") {
+                            const std::string_view tag = html.substr(nameEnd, gt - nameEnd);
+                            std::string_view src = attribute(tag, "data-src");
+                            if (src.empty()) src = attribute(tag, "src");
+                            if (!src.empty()) {
+                                writer.text("<img src=\"" +
+                                            NetworkUtils::getAbsoluteURL(pageUrl, std::string(src)) + "\">");
+                            }
+                        }
+                        i = gt + 1;
+                        continue;
+                    }
+                }
+            }
+            // 一段连续的普通字符
+            size_t end = i + 1;
+            while (end < html.size() && !isSpace(html[end]) && html[end] != '<' && html[end] != '&' &&
+                   html[end] != '\xE2') {
+                end++;
+            }
+            writer.text(html.substr(i, end - i));
+            i = end;
+        }
+        if (out.find('&', begin) != std::string::npos) {
+            const std::string decoded = Html::decodeEntities(std::string_view(out).substr(begin));
+            out.replace(begin, std::string::npos, decoded);
+        }
+    }
+
+    std::string formatHtml(const std::string_view html, const std::string &pageUrl) {
+        std::string out;
+        out.reserve(html.size());
+        appendText(out, html, pageUrl);
+        return out;
+    }
+
+    ContentRules::ContentRules(AnalyzeRule &analyzeRule, const ContentRule &contentRule)
+        : content(analyzeRule.splitSourceRule(contentRule.content)),
+          nextContentUrl(analyzeRule.splitSourceRule(contentRule.nextContentUrl)) {
+    }
+
+    std::vector<std::string> nextContentUrls(AnalyzeRule &analyzeRule, const ContentRules &rules,
+                                             const std::string &redirectUrl,
+                                             const std::optional<std::string> &nextChapterUrl) {
+        std::vector<std::string> nextUrls;
+        if (rules.nextContentUrl.empty()) return nextUrls;
+        for (auto &url: analyzeRule.getStringList(rules.nextContentUrl, true)) {
+            if (url == redirectUrl) continue;
+            // 下一章的地址可能带有",{...}"的请求参数
+            if (nextChapterUrl.has_value() && (url == *nextChapterUrl || nextChapterUrl->starts_with(url + ","))) {
+                continue;
+            }
+            nextUrls.push_back(std::move(url));
+        }
+        return nextUrls;
+    }
+
+    void analyzePage(
+        AnalyzeRule &analyzeRule,
+        const ContentRules &rules,
+        const std::string &baseUrl,
+        const std::string &redirectUrl,
+        const std::string &body,
+        const std::optional<std::string> &nextChapterUrl,
+        std::string &out,
+        const NextUrlHandler &onNextUrls
+    ) {
+        analyzeRule.setContent(body).setBaseUrl(baseUrl);
+        std::string redirect = redirectUrl;
+        analyzeRule.setRedirectUrl(redirect);
+        if (onNextUrls) {
+            onNextUrls(nextContentUrls(analyzeRule, rules, redirectUrl, nextChapterUrl));
+        }
+        // html实体在转换为文本之后解码，正文中转义的标签不会被当作标签去掉
+        const std::string html = analyzeRule.getString(rules.content, false, false);
+        if (html.empty()) return;
+        if (!out.empty()) out += '\n';
+        appendText(out, html, redirectUrl);
+    }
+
+    std::string analyzeContent(
+        BookSource &bookSource,
+        BookChapter &chapter,
+        RuleData &ruleData,
+        const std::string &baseUrl,
+        const std::string &redirectUrl,
+        const std::optional<std::string> &body,
+        const std::optional<std::string> &nextChapterUrl,
+        ThreadPool *pool
+    ) {
+        if (!body.has_value()) {
+            throw std::runtime_error("Failed to access website: " + baseUrl);
+        }
+        const ContentRule contentRule = bookSource.ruleContent.value_or(ContentRule());
+        AnalyzeRule analyzeRule(&ruleData, &bookSource);
+        analyzeRule.setChapter(&chapter).setNextChapterUrl(nextChapterUrl);
+        analyzeRule.setContent(body);
+        const ContentRules rules(analyzeRule, contentRule);
+
+        // 已经访问过的正文页，用于发现循环的下一页
+        std::unordered_set<std::string> visited{baseUrl, redirectUrl};
+        std::vector<std::string> nextUrls;
+        std::optional<std::future<StrResponse> > pending;
+        std::string pendingUrl;
+        // 串联的正文页只取第一个地址，在解析当前页的同时下载
+        const auto fetchNext = [&](const std::vector<std::string> &urls) {
+            if (urls.empty() || !visited.insert(urls[0]).second) return;
+            pendingUrl = urls[0];
+            // 下载在其它线程中进行，当前线程解析时可能@put到章节，下载使用章节此时的副本
+            pending = submit(pool, [&bookSource, &ruleData, snapshot = chapter, url = pendingUrl, baseUrl]() mutable {
+                return fetchPage(bookSource, ruleData, snapshot, url, baseUrl);
+            });
+        };
+
+        std::string content;
+        std::string title;
+        // 转换后的文本不会比第一页的内容长太多，多页时再按页数扩大
+        content.reserve(body->size() / 2);
+        try {
+            analyzePage(analyzeRule, rules, baseUrl, redirectUrl, *body, nextChapterUrl, content,
+                        [&](const std::vector<std::string> &urls) {
+                            nextUrls = urls;
+                            if (urls.size() == 1) fetchNext(urls);
+                        });
+            // 之后一起解析的正文页仍会读取章节，全部完成后再修改标题
+            if (!StringUtils::isNullOrEmpty(contentRule.title)) {
+                title = analyzeRule.getString(contentRule.title);
+            }
+            while (pending.has_value()) {
+                const StrResponse res = pending->get();
+                pending.reset();
+                const std::string pageUrl = pendingUrl;
+                if (content.capacity() - content.size() < content.size() / 2) {
+                    content.reserve(content.size() * 2);
+                }
+                analyzePage(analyzeRule, rules, pageUrl, res.url, res.body.value_or(""), nextChapterUrl, content,
+                            fetchNext);
+            }
+        } catch (...) {
+            // 下载任务引用了调用方的书源与规则数据，等它结束后再返回
+            if (pending.has_value()) pending->wait();
+            throw;
+        }
+
+        if (nextUrls.size() > 1) {
+            // 多个正文页互不依赖，一起下载与解析，文本按地址的顺序追加
+            content.reserve(content.size() * (nextUrls.size() + 1) + nextUrls.size());
+            const auto extractPage = [&](AnalyzeRule &rule, BookChapter &target, const size_t index) {
+                const StrResponse res = fetchPage(bookSource, ruleData, target, nextUrls[index], baseUrl);
+                std::string text;
+                analyzePage(rule, rules, nextUrls[index], res.url, res.body.value_or(""), nextChapterUrl, text);
+                return text;
+            };
+            const auto append = [&](const std::string &text) {
+                if (text.empty()) return;
+                if (!content.empty()) content += '\n';
+                content += text;
+            };
+            if (pool != nullptr) {
+                // 每一页使用章节的副本，@put的变量在全部完成后按地址的顺序合并到章节
+                const std::optional<std::string> saved = chapter.getVariableString();
+                std::vector<std::optional<std::string> > variables(nextUrls.size(), saved);
+                const auto newRule = [&] {
+                    AnalyzeRule rule(&ruleData, &bookSource);
+                    rule.setNextChapterUrl(nextChapterUrl);
+                    return rule;
+                };
+                const auto extract = [&](AnalyzeRule &rule, const size_t index) {
+                    BookChapter page = chapter;
+                    rule.setChapter(&page);
+                    std::string text = extractPage(rule, page, index);
+                    rule.setChapter(nullptr);
+                    return std::make_pair(std::move(text), page.getVariableString());
+                };
+                const auto consume = [&](const size_t index,
+                                         std::optional<std::pair<std::string, std::optional<std::string> > > &&page) {
+                    if (page.has_value()) {
+                        append(page->first);
+                        variables[index] = std::move(page->second);
+                    }
+                    return true;
+                };
+                BookList::parallelExtract<std::pair<std::string, std::optional<std::string> > >(
+                    *pool, nextUrls.size(), newRule, extract, consume);
+                const auto before = JsonUtils::jsonStringToMap(saved.value_or(""));
+                for (const auto &variable: variables) {
+                    if (variable != saved) mergeVariables(chapter, before, variable);
+                }
+            } else {
+                for (size_t index = 0; index < nextUrls.size(); index++) {
+                    append(extractPage(analyzeRule, chapter, index));
+                }
+            }
+        }
+
+        if (!isBlank(title)) {
+            chapter.title = std::move(title);
+        }
+        if (!StringUtils::isNullOrEmpty(contentRule.replaceRegex)) {
+            analyzeRule.setContent(trimLines(content)).setBaseUrl(baseUrl);
+            const std::string replaced = analyzeRule.getString(contentRule.replaceRegex);
+            content.clear();
+            for (const std::string_view line: splitLines(replaced)) {
+                if (!content.empty()) content += '\n';
+                content += "　　";
+                content += line;
+            }
+        }
+        return content;
+    }
+}
@@ -0,0 +1,371 @@
+#include <booksource/cookie.h>
+#include <booksource/utils.h>
+#include <curl/curl.h>
+#include <algorithm>
+#include <charconv>
+#include <ranges>
+#include <ctime>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace {
+    struct UrlParts {
+        bool https = false;
+        std::string host;
+        std::string path = "/";
+    };
+
+    std::string toLower(std::string s) {
+        std::ranges::transform(s, s.begin(), [](const unsigned char c) { return std::tolower(c); });
+        return s;
+    }
+
+    std::string trimmed(std::string s) {
+        StringUtils::trim(s);
+        return s;
+    }
+
+    UrlParts parseUrl(const std::string &url) {
+        UrlParts parts;
+        size_t pos = 0;
+        if (const size_t scheme = url.find("://"); scheme != std::string::npos) {
+            parts.https = StringUtils::startsWithIgnoreCase(url, "https");
+            pos = scheme + 3;
+        }
+        const size_t hostEnd = url.find_first_of("/?#", pos);
+        std::string host = url.substr(pos, hostEnd == std::string::npos ? std::string::npos : hostEnd - pos);
+        if (const size_t at = host.rfind('@'); at != std::string::npos) host = host.substr(at + 1);
+        if (const size_t colon = host.rfind(':'); colon != std::string::npos && host.find(']') == std::string::npos) {
+            host = host.substr(0, colon);
+        }
+        parts.host = toLower(host);
+        if (hostEnd != std::string::npos && url[hostEnd] == '/') {
+            const size_t pathEnd = url.find_first_of("?#", hostEnd);
+            parts.path = url.substr(hostEnd, pathEnd == std::string::npos ? std::string::npos : pathEnd - hostEnd);
+        }
+        return parts;
+    }
+
+    // 主域名作为索引的key，如：www.example.com -> example.com，规则与 NetworkUtils::getSubDomain 相同
+    // 这里的host已经解析好，不再走 getSubDomain 中的正则匹配
+    std::string indexKey(const std::string &host) {
+        if (NetworkUtils::isIPAddress(host)) return host;
+        const auto pos = host.rfind('.');
+        if (pos == std::string::npos || pos == 0) return host;
+        const auto pos2 = host.rfind('.', pos - 1);
+        if (pos2 == std::string::npos) return host;
+        return host.substr(pos2 + 1);
+    }
+
+    bool domainMatch(const std::string &host, const CookieJar::Cookie &cookie) {
+        if (host == cookie.domain) return true;
+        if (cookie.hostOnly || NetworkUtils::isIPAddress(host)) return false;
+        return host.size() > cookie.domain.size() &&
+               host.ends_with(cookie.domain) &&
+               host[host.size() - cookie.domain.size() - 1] == '.';
+    }
+
+    bool pathMatch(const std::string &requestPath, const std::string &cookiePath) {
+        if (requestPath == cookiePath) return true;
+        if (!requestPath.starts_with(cookiePath)) return false;
+        return cookiePath.ends_with('/') || requestPath[cookiePath.size()] == '/';
+    }
+
+    // cookie的默认path：请求路径中最后一个'/'之前的部分
+    std::string defaultPath(const std::string &requestPath) {
+        const size_t slash = requestPath.rfind('/');
+        if (slash == std::string::npos || slash == 0) return "/";
+        return requestPath.substr(0, slash);
+    }
+
+    bool expired(const CookieJar::Cookie &cookie, const long now) {
+        return cookie.expires != 0 && cookie.expires <= now;
+    }
+
+    // FNV-1a，用于生成稳定的持久化文件名
+    std::string stableHash(const std::string &s) {
+        uint64_t hash = 1469598103934665603ULL;
+        for (const unsigned char c: s) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        char buf[17];
+        std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(hash));
+        return buf;
+    }
+
+    struct Registry {
+        std::mutex mutex;
+        std::optional<std::string> storageDir;
+        std::unordered_map<std::string, std::shared_ptr<CookieJar> > jars;
+    };
+
+    Registry &registry() {
+        static Registry instance;
+        return instance;
+    }
+}
+
+CookieJar::CookieJar(std::optional<std::string> file) : file(std::move(file)) {
+}
+
+CookieJar::~CookieJar() {
+    flush();
+}
+
+std::shared_ptr<CookieJar> CookieJar::forSource(const std::string &sourceKey) {
+    auto &reg = registry();
+    std::lock_guard lock(reg.mutex);
+    if (const auto it = reg.jars.find(sourceKey); it != reg.jars.end()) {
+        return it->second;
+    }
+    std::optional<std::string> file = std::nullopt;
+    if (reg.storageDir.has_value()) {
+        file = *reg.storageDir + "/" + stableHash(sourceKey) + ".cookie";
+    }
+    auto jar = std::make_shared<CookieJar>(file);
+    reg.jars.emplace(sourceKey, jar);
+    return jar;
+}
+
+void CookieJar::setStorageDir(const std::optional<std::string> &dir) {
+    auto &reg = registry();
+    std::lock_guard lock(reg.mutex);
+    reg.storageDir = dir;
+}
+
+void CookieJar::flushAll() {
+    auto &reg = registry();
+    std::lock_guard lock(reg.mutex);
+    for (const auto &jar: reg.jars | std::views::values) {
+        jar->flush();
+    }
+}
+
+void CookieJar::ensureLoaded() {
+    std::call_once(loadFlag, [this] {
+        std::unique_lock lock(mutex);
+        load();
+    });
+}
+
+void CookieJar::load() {
+    if (!file.has_value()) return;
+    std::ifstream in(*file);
+    if (!in.is_open()) return;
+    const long now = std::time(nullptr);
+    std::string line;
+    while (std::getline(in, line)) {
+        Cookie cookie;
+        if (line.starts_with("#HttpOnly_")) {
+            cookie.httpOnly = true;
+            line = line.substr(10);
+        } else if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, '\t')) fields.push_back(field);
+        if (fields.size() < 7) continue;
+        cookie.domain = fields[0];
+        if (cookie.domain.starts_with('.')) cookie.domain = cookie.domain.substr(1);
+        cookie.hostOnly = fields[1] != "TRUE";
+        cookie.path = fields[2];
+        cookie.secure = fields[3] == "TRUE";
+        const std::string &expires = fields[4];
+        const auto [end, ec] = std::from_chars(expires.data(), expires.data() + expires.size(), cookie.expires);
+        // 损坏或者手动修改的行跳过，不影响其余的cookie
+        if (ec != std::errc() || end != expires.data() + expires.size()) continue;
+        cookie.name = fields[5];
+        cookie.value = fields[6];
+        if (!expired(cookie, now)) {
+            put(std::move(cookie));
+        }
+    }
+    dirty = false;
+}
+
+void CookieJar::put(Cookie cookie) {
+    auto &bucket = cookies[indexKey(cookie.domain)];
+    const auto it = std::ranges::find_if(bucket, [&](const Cookie &c) {
+        return c.name == cookie.name && c.domain == cookie.domain && c.path == cookie.path;
+    });
+    if (it != bucket.end()) {
+        *it = std::move(cookie);
+    } else {
+        bucket.push_back(std::move(cookie));
+    }
+    dirty = true;
+}
+
+std::string CookieJar::getCookie(const std::string &url) {
+    ensureLoaded();
+    const auto parts = parseUrl(url);
+    const long now = std::time(nullptr);
+    std::vector<const Cookie *> matched;
+    std::shared_lock lock(mutex);
+    const auto it = cookies.find(indexKey(parts.host));
+    if (it == cookies.end()) return "";
+    for (const auto &cookie: it->second) {
+        if (expired(cookie, now) || (cookie.secure && !parts.https)) continue;
+        if (domainMatch(parts.host, cookie) && pathMatch(parts.path, cookie.path)) {
+            matched.push_back(&cookie);
+        }
+    }
+    // path更长的cookie优先
+    std::ranges::stable_sort(matched, [](const Cookie *a, const Cookie *b) {
+        return a->path.size() > b->path.size();
+    });
+    std::string result;
+    for (const auto *cookie: matched) {
+        if (!result.empty()) result += "; ";
+        result += cookie->name + "=" + cookie->value;
+    }
+    return result;
+}
+
+void CookieJar::saveFromResponse(const std::string &url, const std::string &setCookie) {
+    const auto parts = parseUrl(url);
+    Cookie cookie;
+    std::optional<long> maxAge = std::nullopt;
+    std::optional<long> expires = std::nullopt;
+    bool hasPath = false;
+
+    std::stringstream ss(setCookie);
+    std::string token;
+    bool first = true;
+    while (std::getline(ss, token, ';')) {
+        const size_t eq = token.find('=');
+        const std::string key = trimmed(token.substr(0, eq));
+        const std::string value = eq == std::string::npos ? "" : trimmed(token.substr(eq + 1));
+        if (first) {
+            if (eq == std::string::npos || key.empty()) return;
+            cookie.name = key;
+            cookie.value = value;
+            first = false;
+            continue;
+        }
+        const std::string attr = toLower(key);
+        if (attr == "expires") {
+            if (const time_t t = curl_getdate(value.c_str(), nullptr); t != -1) expires = t;
+        } else if (attr == "max-age") {
+            try {
+                maxAge = std::stol(value);
+            } catch (...) {
+            }
+        } else if (attr == "domain" && !value.empty()) {
+            cookie.domain = toLower(value.starts_with('.') ? value.substr(1) : value);
+            cookie.hostOnly = false;
+        } else if (attr == "path" && value.starts_with('/')) {
+            cookie.path = value;
+            hasPath = true;
+        } else if (attr == "secure") {
+            cookie.secure = true;
+        } else if (attr == "httponly") {
+            cookie.httpOnly = true;
+        }
+    }
+    if (first) return;
+    if (cookie.hostOnly) {
+        cookie.domain = parts.host;
+    } else if (!domainMatch(parts.host, cookie)) {
+        // 不允许为其他域名设置cookie
+        return;
+    }
+    if (!hasPath) {
+        cookie.path = defaultPath(parts.path);
+    }
+    const long now = std::time(nullptr);
+    if (maxAge.has_value()) {
+        cookie.expires = *maxAge <= 0 ? now - 1 : now + *maxAge;
+    } else if (expires.has_value()) {
+        cookie.expires = *expires <= 0 ? now - 1 : *expires;
+    }
+
+    ensureLoaded();
+    std::unique_lock lock(mutex);
+    if (expired(cookie, now)) {
+        // 过期时间早于当前时间，表示删除该cookie
+        auto &bucket = cookies[indexKey(cookie.domain)];
+        const auto removed = std::erase_if(bucket, [&](const Cookie &c) {
+            return c.name == cookie.name && c.domain == cookie.domain && c.path == cookie.path;
+        });
+        dirty = dirty || removed > 0;
+        return;
+    }
+    put(std::move(cookie));
+}
+
+void CookieJar::setCookie(const std::string &url, const std::string &cookieStr) {
+    const auto parts = parseUrl(url);
+    ensureLoaded();
+    std::unique_lock lock(mutex);
+    std::stringstream ss(cookieStr);
+    std::string token;
+    while (std::getline(ss, token, ';')) {
+        const size_t eq = token.find('=');
+        if (eq == std::string::npos) continue;
+        Cookie cookie;
+        cookie.name = trimmed(token.substr(0, eq));
+        cookie.value = trimmed(token.substr(eq + 1));
+        if (cookie.name.empty()) continue;
+        // 手动设置的cookie对整个主域名生效
+        cookie.domain = indexKey(parts.host);
+        cookie.hostOnly = cookie.domain == parts.host && NetworkUtils::isIPAddress(parts.host);
+        put(std::move(cookie));
+    }
+}
+
+void CookieJar::removeCookie(const std::string &url) {
+    const auto parts = parseUrl(url);
+    ensureLoaded();
+    std::unique_lock lock(mutex);
+    if (cookies.erase(indexKey(parts.host)) > 0) {
+        dirty = true;
+    }
+}
+
+void CookieJar::clear() {
+    ensureLoaded();
+    std::unique_lock lock(mutex);
+    dirty = dirty || !cookies.empty();
+    cookies.clear();
+}
+
+size_t CookieJar::size() {
+    ensureLoaded();
+    std::shared_lock lock(mutex);
+    size_t count = 0;
+    for (const auto &bucket: cookies | std::views::values) {
+        count += bucket.size();
+    }
+    return count;
+}
+
+bool CookieJar::flush() {
+    std::unique_lock lock(mutex);
+    if (!dirty || !file.has_value()) return true;
+    // 先写入临时文件再重命名，避免写入过程中断导致文件损坏
+    const std::string tmp = *file + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out.is_open()) return false;
+        out << "# Netscape HTTP Cookie File\n";
+        const long now = std::time(nullptr);
+        for (const auto &bucket: cookies | std::views::values) {
+            for (const auto &c: bucket) {
+                if (expired(c, now)) continue;
+                out << (c.httpOnly ? "#HttpOnly_" : "") << (c.hostOnly ? "" : ".") << c.domain << '\t'
+                    << (c.hostOnly ? "FALSE" : "TRUE") << '\t' << c.path << '\t'
+                    << (c.secure ? "TRUE" : "FALSE") << '\t' << c.expires << '\t'
+                    << c.name << '\t' << c.value << '\n';
+            }
+        }
+        if (!out.good()) return false;
+    }
+    if (std::rename(tmp.c_str(), file->c_str()) != 0) return false;
+    dirty = false;
+    return true;
+}
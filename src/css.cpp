@@ -0,0 +1,697 @@
+#include <booksource/css.h>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+using Html::Node;
+using Html::Elements;
+
+namespace Css {
+    namespace {
+        enum FeatureSeed : uint32_t {
+            TAG_SEED = 0x9E3779B9u,
+            ID_SEED = 0x85EBCA6Bu,
+            CLASS_SEED = 0xC2B2AE35u,
+        };
+
+        // 特征的哈希值，lower为true时按小写计算
+        uint32_t featureHash(const uint32_t seed, const std::string_view str, const bool lower) {
+            uint32_t hash = 2166136261u ^ seed;
+            for (const char c: str) {
+                hash ^= static_cast<uint8_t>(lower ? std::tolower(static_cast<unsigned char>(c)) : c);
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+
+        bool isSpace(const char c) {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+        }
+
+        std::string toLower(std::string s) {
+            std::ranges::transform(s, s.begin(), [](const unsigned char c) { return std::tolower(c); });
+            return s;
+        }
+
+        bool equalsIgnoreCase(const std::string_view a, const std::string_view lower) {
+            if (a.size() != lower.size()) return false;
+            for (size_t i = 0; i < a.size(); i++) {
+                if (std::tolower(static_cast<unsigned char>(a[i])) != lower[i]) return false;
+            }
+            return true;
+        }
+
+        template<typename F>
+        void forEachClass(const std::string_view classes, F &&f) {
+            size_t pos = 0;
+            while (pos < classes.size()) {
+                while (pos < classes.size() && isSpace(classes[pos])) pos++;
+                const size_t start = pos;
+                while (pos < classes.size() && !isSpace(classes[pos])) pos++;
+                if (pos > start) f(classes.substr(start, pos - start));
+            }
+        }
+
+        /**
+         * 计数布隆过滤器，保存当前遍历路径上全部祖先元素的标签、id、class
+         */
+        class AncestorFilter {
+        public:
+            void push(const Node *node) {
+                const size_t begin = hashes.size();
+                hashes.push_back(featureHash(TAG_SEED, node->name, true));
+                if (const auto id = node->id(); !id.empty()) hashes.push_back(featureHash(ID_SEED, id, false));
+                forEachClass(node->attr("class"), [&](const std::string_view cls) {
+                    hashes.push_back(featureHash(CLASS_SEED, cls, true));
+                });
+                for (size_t i = begin; i < hashes.size(); i++) {
+                    counters[hashes[i] & MASK]++;
+                    counters[(hashes[i] >> 16) & MASK]++;
+                }
+                frames.push_back(begin);
+            }
+
+            void pop() {
+                const size_t begin = frames.back();
+                frames.pop_back();
+                for (size_t i = begin; i < hashes.size(); i++) {
+                    counters[hashes[i] & MASK]--;
+                    counters[(hashes[i] >> 16) & MASK]--;
+                }
+                hashes.resize(begin);
+            }
+
+            bool mayContainAll(const std::vector<uint32_t> &required) const {
+                return std::ranges::all_of(required, [&](const uint32_t h) {
+                    return counters[h & MASK] != 0 && counters[(h >> 16) & MASK] != 0;
+                });
+            }
+
+        private:
+            static constexpr uint32_t MASK = 4095;
+            std::array<uint16_t, 4096> counters{};
+            std::vector<uint32_t> hashes;
+            std::vector<size_t> frames;
+        };
+
+        /**
+         * 匹配过程中的上下文：匹配范围的根节点，以及兄弟序号的缓存
+         * 按文档顺序遍历时，相邻的兄弟元素可以直接由上一个元素的序号得到
+         */
+        struct MatchContext {
+            const Node *root;
+            const Node *lastNode = nullptr;
+            int lastIndex = 0;
+
+            // 在兄弟元素中的序号，从0开始
+            int elementIndex(const Node *node) {
+                const Node *prev = node->previousElementSibling();
+                int index = 0;
+                if (prev == nullptr) {
+                    index = 0;
+                } else if (prev == lastNode) {
+                    index = lastIndex + 1;
+                } else {
+                    for (const Node *p = prev; p != nullptr; p = p->previousElementSibling()) index++;
+                }
+                lastNode = node;
+                lastIndex = index;
+                return index;
+            }
+
+            const Node *parentOf(const Node *node) const {
+                if (node == root || node->parent == nullptr || !node->parent->isElement()) return nullptr;
+                return node->parent;
+            }
+        };
+
+        bool matchNth(const int a, const int b, const int position) {
+            if (a == 0) return position == b;
+            const int diff = position - b;
+            return diff / a >= 0 && diff % a == 0;
+        }
+
+        bool isEmpty(const Node *node) {
+            for (const Node *c = node->firstChild; c != nullptr; c = c->next) {
+                if (c->type == Html::NodeType::Comment) continue;
+                if (c->type == Html::NodeType::Text &&
+                    std::ranges::all_of(c->value, [](const char ch) { return isSpace(ch); })) {
+                    continue;
+                }
+                return false;
+            }
+            return true;
+        }
+
+        bool tagIs(const Node *node, const std::string &lowerTag) {
+            return node->name == lowerTag || equalsIgnoreCase(node->name, lowerTag);
+        }
+
+        int typeIndex(const Node *node, const bool fromEnd) {
+            int index = 0;
+            for (const Node *s = fromEnd ? node->nextElementSibling() : node->previousElementSibling();
+                 s != nullptr; s = fromEnd ? s->nextElementSibling() : s->previousElementSibling()) {
+                if (s->name == node->name) index++;
+            }
+            return index;
+        }
+
+        bool matchAttr(const Test &test, const Node *node) {
+            if (test.kind == Test::Kind::AttrPrefix) {
+                for (uint32_t i = 0; i < node->attributeCount; i++) {
+                    if (node->attributes[i].name.starts_with(test.name)) return true;
+                }
+                return false;
+            }
+            if (!node->hasAttr(test.name)) return false;
+            const std::string_view raw = node->attr(test.name);
+            if (test.kind == Test::Kind::HasAttr) return true;
+            if (test.kind == Test::Kind::AttrRegex) return std::regex_search(raw.begin(), raw.end(), *test.regex);
+            std::string value(raw);
+            for (char &c: value) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            switch (test.kind) {
+                case Test::Kind::AttrEquals: return value == test.value;
+                case Test::Kind::AttrStarts: return value.starts_with(test.value);
+                case Test::Kind::AttrEnds: return value.ends_with(test.value);
+                case Test::Kind::AttrContains: return value.find(test.value) != std::string::npos;
+                case Test::Kind::AttrDash:
+                    return value == test.value || value.starts_with(test.value + "-");
+                default: return false;
+            }
+        }
+
+        bool matchTest(const Test &test, const Node *node, MatchContext &ctx) {
+            using Kind = Test::Kind;
+            switch (test.kind) {
+                case Kind::Class: return node->hasClass(test.name);
+                case Kind::Id: return node->id() == test.name;
+                case Kind::NthChild:
+                    return ctx.parentOf(node) != nullptr && matchNth(test.a, test.b, ctx.elementIndex(node) + 1);
+                case Kind::NthLastChild: {
+                    if (ctx.parentOf(node) == nullptr) return false;
+                    int index = 1;
+                    for (const Node *s = node->nextElementSibling(); s != nullptr; s = s->nextElementSibling()) index++;
+                    return matchNth(test.a, test.b, index);
+                }
+                case Kind::NthOfType:
+                    return ctx.parentOf(node) != nullptr && matchNth(test.a, test.b, typeIndex(node, false) + 1);
+                case Kind::NthLastOfType:
+                    return ctx.parentOf(node) != nullptr && matchNth(test.a, test.b, typeIndex(node, true) + 1);
+                case Kind::OnlyChild:
+                    return ctx.parentOf(node) != nullptr && node->previousElementSibling() == nullptr &&
+                           node->nextElementSibling() == nullptr;
+                case Kind::OnlyOfType:
+                    return ctx.parentOf(node) != nullptr && typeIndex(node, false) == 0 && typeIndex(node, true) == 0;
+                case Kind::Empty: return isEmpty(node);
+                case Kind::Root: return node->parent != nullptr && node->parent->type == Html::NodeType::Document;
+                case Kind::Not: return !test.sub->matches(node, ctx.root);
+                case Kind::Has:
+                    return std::ranges::any_of(test.sub->select(node), [&](const Node *n) { return n != node; });
+                case Kind::Contains: return toLower(node->text()).find(test.value) != std::string::npos;
+                case Kind::ContainsOwn: return toLower(node->ownText()).find(test.value) != std::string::npos;
+                case Kind::Matches: return std::regex_search(node->text(), *test.regex);
+                case Kind::MatchesOwn: return std::regex_search(node->ownText(), *test.regex);
+                case Kind::IndexEquals: return ctx.elementIndex(node) == test.a;
+                case Kind::IndexLess: return ctx.elementIndex(node) < test.a;
+                case Kind::IndexGreater: return ctx.elementIndex(node) > test.a;
+                default: return matchAttr(test, node);
+            }
+        }
+
+        bool matchCompound(const Compound &compound, const Node *node, MatchContext &ctx) {
+            if (!compound.tag.empty() && !tagIs(node, compound.tag)) return false;
+            for (const auto &test: compound.tests) {
+                if (!matchTest(test, node, ctx)) return false;
+            }
+            return true;
+        }
+
+        // 从右往左匹配compounds[0..i]
+        bool matchAt(const Complex &complex, const size_t i, const Node *node, MatchContext &ctx) {
+            const Compound &compound = complex.compounds[i];
+            if (!matchCompound(compound, node, ctx)) return false;
+            if (i == 0) return true;
+            switch (compound.combinator) {
+                case Combinator::Child: {
+                    const Node *parent = ctx.parentOf(node);
+                    return parent != nullptr && matchAt(complex, i - 1, parent, ctx);
+                }
+                case Combinator::Descendant:
+                    for (const Node *p = ctx.parentOf(node); p != nullptr; p = ctx.parentOf(p)) {
+                        if (matchAt(complex, i - 1, p, ctx)) return true;
+                    }
+                    return false;
+                case Combinator::Adjacent: {
+                    if (node == ctx.root) return false;
+                    const Node *prev = node->previousElementSibling();
+                    return prev != nullptr && matchAt(complex, i - 1, prev, ctx);
+                }
+                case Combinator::Sibling:
+                    if (node == ctx.root) return false;
+                    for (const Node *s = node->previousElementSibling(); s != nullptr; s = s->previousElementSibling()) {
+                        if (matchAt(complex, i - 1, s, ctx)) return true;
+                    }
+                    return false;
+            }
+            return false;
+        }
+
+        /**
+         * 选择器的语法解析
+         */
+        class SelectorParser {
+        public:
+            explicit SelectorParser(const std::string &css) : css(css) {
+            }
+
+            std::vector<Complex> parseGroups() {
+                std::vector<Complex> groups;
+                while (true) {
+                    skipSpace();
+                    if (p >= css.size()) break;
+                    groups.push_back(parseComplex());
+                    skipSpace();
+                    if (p < css.size() && css[p] == ',') {
+                        p++;
+                        continue;
+                    }
+                    if (p < css.size()) fail("unexpected character");
+                }
+                if (groups.empty()) fail("empty selector");
+                return groups;
+            }
+
+        private:
+            const std::string &css;
+            size_t p = 0;
+
+            [[noreturn]] void fail(const std::string &message) const {
+                throw std::invalid_argument("Invalid css selector '" + css + "': " + message + " at " + std::to_string(p));
+            }
+
+            void skipSpace() {
+                while (p < css.size() && isSpace(css[p])) p++;
+            }
+
+            Complex parseComplex() {
+                Complex complex;
+                complex.compounds.push_back(parseCompound());
+                while (p < css.size()) {
+                    const size_t before = p;
+                    skipSpace();
+                    if (p >= css.size() || css[p] == ',' || css[p] == ')') break;
+                    Combinator combinator = Combinator::Descendant;
+                    if (css[p] == '>' || css[p] == '+' || css[p] == '~') {
+                        combinator = css[p] == '>'
+                                         ? Combinator::Child
+                                         : css[p] == '+'
+                                               ? Combinator::Adjacent
+                                               : Combinator::Sibling;
+                        p++;
+                        skipSpace();
+                    } else if (before == p) {
+                        fail("unexpected character");
+                    }
+                    Compound compound = parseCompound();
+                    compound.combinator = combinator;
+                    complex.compounds.push_back(std::move(compound));
+                }
+                // 组合器右侧为后代或子元素时，左侧的复合选择器一定是目标元素的祖先
+                for (size_t i = 0; i + 1 < complex.compounds.size(); i++) {
+                    const auto next = complex.compounds[i + 1].combinator;
+                    if (next != Combinator::Descendant && next != Combinator::Child) continue;
+                    const Compound &compound = complex.compounds[i];
+                    if (!compound.tag.empty()) complex.ancestorHashes.push_back(featureHash(TAG_SEED, compound.tag, true));
+                    for (const auto &test: compound.tests) {
+                        if (test.kind == Test::Kind::Id) {
+                            complex.ancestorHashes.push_back(featureHash(ID_SEED, test.name, false));
+                        } else if (test.kind == Test::Kind::Class) {
+                            complex.ancestorHashes.push_back(featureHash(CLASS_SEED, test.name, true));
+                        }
+                    }
+                }
+                return complex;
+            }
+
+            std::string parseIdent() {
+                std::string out;
+                while (p < css.size()) {
+                    const char c = css[p];
+                    if (c == '\\' && p + 1 < css.size()) {
+                        out += css[p + 1];
+                        p += 2;
+                    } else if (std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_' ||
+                               static_cast<unsigned char>(c) >= 0x80) {
+                        out += c;
+                        p++;
+                    } else {
+                        break;
+                    }
+                }
+                return out;
+            }
+
+            // 读取()中的内容，支持嵌套的括号与引号
+            std::string parseArgs() {
+                if (p >= css.size() || css[p] != '(') fail("expected '('");
+                const size_t start = ++p;
+                int depth = 1;
+                char quote = '\0';
+                while (p < css.size()) {
+                    const char c = css[p];
+                    if (quote != '\0') {
+                        if (c == '\\') p++;
+                        else if (c == quote) quote = '\0';
+                    } else if (c == '"' || c == '\'') {
+                        quote = c;
+                    } else if (c == '(') {
+                        depth++;
+                    } else if (c == ')' && --depth == 0) {
+                        break;
+                    }
+                    p++;
+                }
+                if (p >= css.size()) fail("unclosed '('");
+                std::string args = css.substr(start, p - start);
+                p++;
+                return args;
+            }
+
+            static std::string unquote(std::string s) {
+                size_t b = 0, e = s.size();
+                while (b < e && isSpace(s[b])) b++;
+                while (e > b && isSpace(s[e - 1])) e--;
+                s = s.substr(b, e - b);
+                if (s.size() >= 2 && (s[0] == '"' || s[0] == '\'') && s.back() == s[0]) {
+                    s = s.substr(1, s.size() - 2);
+                }
+                return s;
+            }
+
+            // 解析 an+b、odd、even
+            void parseNth(const std::string &raw, Test &test) const {
+                std::string expr;
+                for (const char c: raw) {
+                    if (!isSpace(c)) expr += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+                }
+                if (expr == "odd") {
+                    test.a = 2;
+                    test.b = 1;
+                    return;
+                }
+                if (expr == "even") {
+                    test.a = 2;
+                    test.b = 0;
+                    return;
+                }
+                try {
+                    if (const size_t n = expr.find('n'); n != std::string::npos) {
+                        const std::string a = expr.substr(0, n);
+                        test.a = a.empty() || a == "+" ? 1 : a == "-" ? -1 : std::stoi(a);
+                        const std::string b = expr.substr(n + 1);
+                        test.b = b.empty() ? 0 : std::stoi(b);
+                    } else {
+                        test.a = 0;
+                        test.b = std::stoi(expr);
+                    }
+                } catch (const std::exception &) {
+                    fail("invalid nth expression '" + raw + "'");
+                }
+            }
+
+            int parseIndex(const std::string &raw) const {
+                try {
+                    return std::stoi(unquote(raw));
+                } catch (const std::exception &) {
+                    fail("invalid index '" + raw + "'");
+                }
+            }
+
+            std::shared_ptr<const std::regex> parseRegex(const std::string &raw) const {
+                try {
+                    return std::make_shared<const std::regex>(unquote(raw));
+                } catch (const std::regex_error &) {
+                    fail("invalid regex '" + raw + "'");
+                }
+            }
+
+            void parseAttribute(Compound &compound) {
+                p++; // '['
+                skipSpace();
+                Test test{.kind = Test::Kind::HasAttr};
+                if (p < css.size() && css[p] == '^') {
+                    p++;
+                    test.kind = Test::Kind::AttrPrefix;
+                }
+                test.name = toLower(parseIdent());
+                if (test.name.empty()) fail("expected attribute name");
+                skipSpace();
+                if (test.kind != Test::Kind::AttrPrefix && p < css.size() && css[p] != ']') {
+                    const char op = css[p];
+                    if (op == '=') {
+                        test.kind = Test::Kind::AttrEquals;
+                        p++;
+                    } else if (p + 1 < css.size() && css[p + 1] == '=') {
+                        switch (op) {
+                            case '^': test.kind = Test::Kind::AttrStarts;
+                                break;
+                            case '$': test.kind = Test::Kind::AttrEnds;
+                                break;
+                            case '*': test.kind = Test::Kind::AttrContains;
+                                break;
+                            case '|': test.kind = Test::Kind::AttrDash;
+                                break;
+                            case '~': test.kind = Test::Kind::AttrRegex;
+                                break;
+                            default: fail("unknown attribute operator");
+                        }
+                        p += 2;
+                    } else {
+                        fail("unknown attribute operator");
+                    }
+                    const size_t start = p;
+                    char quote = '\0';
+                    while (p < css.size() && (quote != '\0' || css[p] != ']')) {
+                        if (quote != '\0' && css[p] == quote) quote = '\0';
+                        else if (quote == '\0' && (css[p] == '"' || css[p] == '\'')) quote = css[p];
+                        p++;
+                    }
+                    const std::string value = unquote(css.substr(start, p - start));
+                    if (test.kind == Test::Kind::AttrRegex) {
+                        test.regex = parseRegex(value);
+                    } else {
+                        test.value = toLower(value);
+                    }
+                }
+                if (p >= css.size() || css[p] != ']') fail("expected ']'");
+                p++;
+                compound.tests.push_back(std::move(test));
+            }
+
+            void parsePseudo(Compound &compound) {
+                p++; // ':'
+                const std::string name = toLower(parseIdent());
+                using Kind = Test::Kind;
+                static const std::unordered_map<std::string, Kind> simple = {
+                    {"only-child", Kind::OnlyChild}, {"only-of-type", Kind::OnlyOfType},
+                    {"empty", Kind::Empty}, {"root", Kind::Root},
+                };
+                static const std::unordered_map<std::string, Kind> nth = {
+                    {"nth-child", Kind::NthChild}, {"nth-last-child", Kind::NthLastChild},
+                    {"nth-of-type", Kind::NthOfType}, {"nth-last-of-type", Kind::NthLastOfType},
+                };
+                Test test{.kind = Kind::Empty};
+                if (const auto it = simple.find(name); it != simple.end()) {
+                    test.kind = it->second;
+                } else if (name == "first-child" || name == "last-child" ||
+                           name == "first-of-type" || name == "last-of-type") {
+                    const bool last = name.starts_with("last");
+                    const bool ofType = name.ends_with("of-type");
+                    test.kind = ofType
+                                    ? (last ? Kind::NthLastOfType : Kind::NthOfType)
+                                    : (last ? Kind::NthLastChild : Kind::NthChild);
+                    test.b = 1;
+                } else if (const auto nthIt = nth.find(name); nthIt != nth.end()) {
+                    test.kind = nthIt->second;
+                    parseNth(parseArgs(), test);
+                } else if (name == "not" || name == "has") {
+                    test.kind = name == "not" ? Kind::Not : Kind::Has;
+                    test.sub = Selector::parse(parseArgs());
+                } else if (name == "contains" || name == "containsown") {
+                    test.kind = name == "contains" ? Kind::Contains : Kind::ContainsOwn;
+                    test.value = toLower(unquote(parseArgs()));
+                } else if (name == "matches" || name == "matchesown") {
+                    test.kind = name == "matches" ? Kind::Matches : Kind::MatchesOwn;
+                    test.regex = parseRegex(parseArgs());
+                } else if (name == "eq" || name == "lt" || name == "gt") {
+                    test.kind = name == "eq" ? Kind::IndexEquals : name == "lt" ? Kind::IndexLess : Kind::IndexGreater;
+                    test.a = parseIndex(parseArgs());
+                } else {
+                    fail("unsupported pseudo class ':" + name + "'");
+                }
+                compound.tests.push_back(std::move(test));
+            }
+
+            Compound parseCompound() {
+                Compound compound;
+                bool any = false;
+                if (p < css.size() && css[p] == '*') {
+                    p++;
+                    any = true;
+                } else if (p < css.size() && (std::isalpha(static_cast<unsigned char>(css[p])) ||
+                                              static_cast<unsigned char>(css[p]) >= 0x80 || css[p] == '_')) {
+                    compound.tag = toLower(parseIdent());
+                    // 带命名空间的标签，如 dc|title 或 dc:title（jsoup写法），按完整名称匹配
+                    if (p + 1 < css.size() && css[p] == '|' && css[p + 1] != '=') {
+                        p++;
+                        compound.tag += ":" + toLower(parseIdent());
+                    }
+                    any = true;
+                }
+                while (p < css.size()) {
+                    const char c = css[p];
+                    if (c == '.') {
+                        p++;
+                        std::string cls = parseIdent();
+                        if (cls.empty()) fail("expected class name");
+                        compound.tests.push_back({.kind = Test::Kind::Class, .name = std::move(cls)});
+                    } else if (c == '#') {
+                        p++;
+                        std::string id = parseIdent();
+                        if (id.empty()) fail("expected id");
+                        compound.tests.push_back({.kind = Test::Kind::Id, .name = std::move(id)});
+                    } else if (c == '[') {
+                        parseAttribute(compound);
+                    } else if (c == ':') {
+                        parsePseudo(compound);
+                    } else {
+                        break;
+                    }
+                    any = true;
+                }
+                if (!any) fail("expected selector");
+                // 先检查开销小的条件
+                std::ranges::stable_sort(compound.tests, [](const Test &x, const Test &y) {
+                    return x.kind < y.kind;
+                });
+                return compound;
+            }
+        };
+    }
+
+    std::shared_ptr<const Selector> Selector::parse(const std::string &css) {
+        auto selector = std::make_shared<Selector>();
+        selector->groups = SelectorParser(css).parseGroups();
+        return selector;
+    }
+
+    std::shared_ptr<const Selector> Selector::compile(const std::string &css) {
+        static std::mutex mutex;
+        static std::unordered_map<std::string, std::shared_ptr<const Selector> > cache;
+        constexpr size_t maxCacheSize = 4096;
+        {
+            std::lock_guard lock(mutex);
+            if (const auto it = cache.find(css); it != cache.end()) return it->second;
+        }
+        std::shared_ptr<const Selector> selector = nullptr;
+        try {
+            selector = parse(css);
+        } catch (const std::invalid_argument &) {
+            selector = nullptr;
+        }
+        std::lock_guard lock(mutex);
+        if (cache.size() >= maxCacheSize) cache.clear();
+        cache.emplace(css, selector);
+        return selector;
+    }
+
+    /**
+     * 先序遍历root的子树，同时维护祖先元素的布隆过滤器
+     * visitor返回false时停止遍历
+     */
+    template<typename Visitor>
+    void Selector::traverse(const Node *root, Visitor &&visitor) const {
+        AncestorFilter filter;
+        MatchContext ctx{root};
+        const bool useFilter = std::ranges::any_of(groups, [](const Complex &c) { return !c.ancestorHashes.empty(); });
+        const Node *node = root;
+        while (true) {
+            if (node->isElement()) {
+                for (const auto &complex: groups) {
+                    if (useFilter && !filter.mayContainAll(complex.ancestorHashes)) continue;
+                    if (matchAt(complex, complex.compounds.size() - 1, node, ctx)) {
+                        if (!visitor(node)) return;
+                        break;
+                    }
+                }
+            }
+            const Node *child = node->firstChild;
+            while (child != nullptr && !child->isElement()) child = child->next;
+            if (child != nullptr) {
+                if (useFilter) filter.push(node);
+                node = child;
+                continue;
+            }
+            // 回溯到下一个兄弟元素
+            while (true) {
+                if (node == root) return;
+                const Node *sibling = node->nextElementSibling();
+                if (sibling != nullptr) {
+                    node = sibling;
+                    break;
+                }
+                node = node->parent;
+                if (useFilter) filter.pop();
+            }
+        }
+    }
+
+    Elements Selector::select(const Node *root) const {
+        Elements result;
+        if (root == nullptr) return result;
+        traverse(root, [&](const Node *node) {
+            result.push_back(node);
+            return true;
+        });
+        return result;
+    }
+
+    const Node *Selector::selectFirst(const Node *root) const {
+        const Node *first = nullptr;
+        if (root == nullptr) return first;
+        traverse(root, [&](const Node *node) {
+            first = node;
+            return false;
+        });
+        return first;
+    }
+
+    bool Selector::matches(const Node *node, const Node *root) const {
+        MatchContext ctx{root};
+        return std::ranges::any_of(groups, [&](const Complex &complex) {
+            return matchAt(complex, complex.compounds.size() - 1, node, ctx);
+        });
+    }
+
+    bool isLocal(const Compound &compound) {
+        return std::ranges::all_of(compound.tests, [](const Test &test) {
+            using Kind = Test::Kind;
+            switch (test.kind) {
+                case Kind::Class: case Kind::Id: case Kind::HasAttr: case Kind::AttrPrefix: case Kind::AttrEquals:
+                case Kind::AttrStarts: case Kind::AttrEnds: case Kind::AttrContains: case Kind::AttrDash:
+                case Kind::AttrRegex:
+                    return true;
+                default:
+                    return false;
+            }
+        });
+    }
+
+    bool matchesLocal(const Compound &compound, const Node &node) {
+        MatchContext ctx{&node};
+        return matchCompound(compound, &node, ctx);
+    }
+}
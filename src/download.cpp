@@ -0,0 +1,216 @@
+#include <booksource/download.h>
+#include <booksource/ratelimiter.h>
+#include <booksource/webbook.h>
+#include <algorithm>
+#include <deque>
+
+struct BatchDownloader::Source {
+    std::string rate;
+    std::shared_ptr<ConcurrentRateLimiter> limiter = nullptr; // 没有设置concurrentRate时为空
+    SourceStats stats;
+    std::optional<std::chrono::steady_clock::time_point> first = std::nullopt;
+
+    // 现在开始下一个请求大约还需要等待的毫秒数
+    int64_t waitTime() const {
+        return limiter != nullptr ? limiter->waitTime(rate) : 0;
+    }
+};
+
+struct BatchDownloader::BookTask {
+    Source *source;
+    BookSource *bookSource;
+    RuleData *ruleData;
+    Book book;
+    std::vector<BookChapter> chapters;
+};
+
+struct BatchDownloader::Job {
+    BookTask *book;
+    size_t index;
+};
+
+// 一本书中没有完成的章节，按目录顺序排列，[head, tail)为还没有取出的部分
+struct BatchDownloader::BookQueue {
+    BookTask *book;
+    std::vector<size_t> chapters;
+    size_t head = 0;
+    size_t tail = 0;
+};
+
+class BatchDownloader::Worker {
+public:
+    std::mutex mutex;
+    // 按书分开的队列，同一本书的章节属于同一个书源，书源需要等待时整本书一次跳过
+    // 自己从第一本书的开头取，其它线程从最后一本书的末尾窃取；取完的书移出队列
+    std::deque<BookQueue> books;
+};
+
+BatchDownloader::BatchDownloader(ChapterHandler onChapter, Options options)
+    : onChapter(std::move(onChapter)), options(std::move(options)) {
+    if (!this->options.checkpointFile.has_value()) return;
+    const std::string &file = *this->options.checkpointFile;
+    if (std::ifstream in(file); in) {
+        std::string line;
+        while (std::getline(in, line)) {
+            // 中断时可能留下不完整的最后一行，缺少分隔符的行忽略
+            if (line.find('\t') != std::string::npos) done.insert(line);
+        }
+    }
+    checkpoint.open(file, std::ios::app);
+}
+
+BatchDownloader::~BatchDownloader() = default;
+
+std::string BatchDownloader::checkpointKey(const Book &book, const BookChapter &chapter) {
+    return book.bookUrl + '\t' + chapter.url;
+}
+
+void BatchDownloader::addBook(BookSource &bookSource, Book book, std::vector<BookChapter> chapters,
+                              RuleData &ruleData) {
+    const std::string key = bookSource.getKey();
+    std::lock_guard lock(mutex);
+    auto it = std::ranges::find_if(sources, [&](const auto &source) { return source->stats.source == key; });
+    if (it == sources.end()) {
+        auto source = std::make_unique<Source>();
+        source->stats.source = key;
+        source->rate = bookSource.concurrentRate.value_or("");
+        if (!source->rate.empty()) source->limiter = ConcurrentRateLimiter::forSource(key);
+        sources.push_back(std::move(source));
+        it = sources.end() - 1;
+    }
+    books.push_back(std::make_unique<BookTask>(BookTask{
+        it->get(), &bookSource, &ruleData, std::move(book), std::move(chapters)
+    }));
+}
+
+std::optional<BatchDownloader::Job> BatchDownloader::take(const size_t worker, int64_t &wait) {
+    wait = INT64_MAX;
+    // 本次查找中各书源的等待时间，同一书源只查询一次
+    std::vector<std::pair<Source *, int64_t> > waits;
+    const auto waitOf = [&](Source *source) {
+        for (const auto &[s, t]: waits) {
+            if (s == source) return t;
+        }
+        const int64_t t = source->waitTime();
+        waits.emplace_back(source, t);
+        return t;
+    };
+    for (size_t k = 0; k < workers.size(); k++) {
+        Worker &w = *workers[(worker + k) % workers.size()];
+        std::lock_guard lock(w.mutex);
+        const size_t size = w.books.size();
+        for (size_t i = 0; i < size; i++) {
+            const size_t pos = k == 0 ? i : size - 1 - i;
+            BookQueue &queue = w.books[pos];
+            const int64_t t = waitOf(queue.book->source);
+            if (t > 0) {
+                wait = std::min(wait, t);
+                continue;
+            }
+            const Job job{queue.book, k == 0 ? queue.chapters[queue.head++] : queue.chapters[--queue.tail]};
+            if (queue.head == queue.tail) w.books.erase(w.books.begin() + static_cast<std::ptrdiff_t>(pos));
+            return job;
+        }
+    }
+    return std::nullopt;
+}
+
+void BatchDownloader::download(const Job &job) {
+    BookTask &task = *job.book;
+    {
+        std::lock_guard lock(mutex);
+        if (!task.source->first.has_value()) task.source->first = std::chrono::steady_clock::now();
+    }
+    BookChapter chapter = task.chapters[job.index];
+    const std::optional<std::string> nextChapterUrl = job.index + 1 < task.chapters.size()
+                                                          ? std::optional(task.chapters[job.index + 1].getAbsoluteURL())
+                                                          : std::nullopt;
+    try {
+        const std::string content = WebBook::getContent(*task.bookSource, task.book, chapter, *task.ruleData,
+                                                        nextChapterUrl);
+        // 中断时正文可能不完整
+        if (cancelled) return;
+        onChapter(task.book, chapter, content);
+        std::lock_guard lock(mutex);
+        SourceStats &stats = task.source->stats;
+        stats.chapters++;
+        stats.bytes += content.size();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - *task.source->first;
+        stats.seconds = elapsed.count();
+        const std::string key = checkpointKey(task.book, task.chapters[job.index]);
+        if (checkpoint.is_open()) checkpoint << key << '\n' << std::flush;
+        done.insert(key);
+    } catch (...) {
+        if (cancelled) return;
+        std::lock_guard lock(mutex);
+        task.source->stats.failures++;
+    }
+}
+
+void BatchDownloader::run() {
+    cancelled = false;
+    workers.clear();
+    const size_t threads = std::max<size_t>(options.threads, 1);
+    for (size_t i = 0; i < threads; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    size_t total = 0;
+    {
+        std::lock_guard lock(mutex);
+        // 每本书整体分配给一个线程
+        for (size_t b = 0; b < books.size(); b++) {
+            BookQueue queue{books[b].get(), {}, 0, 0};
+            for (size_t i = 0; i < books[b]->chapters.size(); i++) {
+                if (done.contains(checkpointKey(books[b]->book, books[b]->chapters[i]))) continue;
+                queue.chapters.push_back(i);
+            }
+            if (queue.chapters.empty()) continue;
+            queue.tail = queue.chapters.size();
+            total += queue.tail;
+            workers[b % threads]->books.push_back(std::move(queue));
+        }
+    }
+    remaining = total;
+
+    std::vector<std::thread> pool;
+    for (size_t i = 0; i < threads; i++) {
+        pool.emplace_back([this, i] {
+            // 批量下载让位于阅读时的请求
+            const ConcurrentRateLimiter::RequestScope scope(ConcurrentRateLimiter::Background, &cancelled);
+            while (!cancelled && remaining > 0) {
+                int64_t wait;
+                if (const auto job = take(i, wait)) {
+                    download(*job);
+                    remaining--;
+                    continue;
+                }
+                // 队列都空了，剩余的章节都在其它线程中
+                if (wait == INT64_MAX) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(std::min<int64_t>(wait, 20)));
+            }
+        });
+    }
+    for (auto &thread: pool) {
+        thread.join();
+    }
+    workers.clear();
+}
+
+void BatchDownloader::cancel() {
+    cancelled = true;
+}
+
+size_t BatchDownloader::completedCount() {
+    std::lock_guard lock(mutex);
+    return done.size();
+}
+
+std::vector<BatchDownloader::SourceStats> BatchDownloader::stats() {
+    std::lock_guard lock(mutex);
+    std::vector<SourceStats> result;
+    result.reserve(sources.size());
+    for (const auto &source: sources) {
+        result.push_back(source->stats);
+    }
+    return result;
+}
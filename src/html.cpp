@@ -0,0 +1,1035 @@
+#include <booksource/html.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <unordered_map>
+
+namespace Html {
+    namespace {
+        enum TagFlag : uint8_t {
+            VOID_TAG = 1,       // 没有结束标签，如 <br>
+            BLOCK_TAG = 2,      // 块级元素
+            DATA_TAG = 4,       // 内容为原始文本，不解码实体，如 <script>
+            RCDATA_TAG = 8,     // 内容为文本，解码实体但不解析标签，如 <textarea>
+            CLOSES_P = 16,      // 开始标签会隐式闭合 <p>
+        };
+
+        uint8_t tagFlags(const std::string_view name) {
+            static const std::unordered_map<std::string_view, uint8_t> flags = {
+                {"area", VOID_TAG}, {"base", VOID_TAG}, {"br", VOID_TAG}, {"col", VOID_TAG | BLOCK_TAG},
+                {"embed", VOID_TAG}, {"hr", VOID_TAG | BLOCK_TAG | CLOSES_P}, {"img", VOID_TAG},
+                {"input", VOID_TAG}, {"link", VOID_TAG | BLOCK_TAG}, {"meta", VOID_TAG | BLOCK_TAG},
+                {"param", VOID_TAG}, {"source", VOID_TAG}, {"track", VOID_TAG}, {"wbr", VOID_TAG},
+                {"keygen", VOID_TAG},
+                {"script", DATA_TAG | BLOCK_TAG}, {"style", DATA_TAG | BLOCK_TAG}, {"xmp", DATA_TAG},
+                {"textarea", RCDATA_TAG}, {"title", RCDATA_TAG | BLOCK_TAG},
+                {"html", BLOCK_TAG}, {"head", BLOCK_TAG}, {"body", BLOCK_TAG}, {"frameset", BLOCK_TAG},
+                {"noscript", BLOCK_TAG}, {"frame", BLOCK_TAG}, {"noframes", BLOCK_TAG},
+                {"section", BLOCK_TAG | CLOSES_P}, {"nav", BLOCK_TAG | CLOSES_P}, {"aside", BLOCK_TAG | CLOSES_P},
+                {"hgroup", BLOCK_TAG | CLOSES_P}, {"header", BLOCK_TAG | CLOSES_P},
+                {"footer", BLOCK_TAG | CLOSES_P}, {"p", BLOCK_TAG | CLOSES_P},
+                {"h1", BLOCK_TAG | CLOSES_P}, {"h2", BLOCK_TAG | CLOSES_P}, {"h3", BLOCK_TAG | CLOSES_P},
+                {"h4", BLOCK_TAG | CLOSES_P}, {"h5", BLOCK_TAG | CLOSES_P}, {"h6", BLOCK_TAG | CLOSES_P},
+                {"ul", BLOCK_TAG | CLOSES_P}, {"ol", BLOCK_TAG | CLOSES_P}, {"pre", BLOCK_TAG | CLOSES_P},
+                {"div", BLOCK_TAG | CLOSES_P}, {"blockquote", BLOCK_TAG | CLOSES_P},
+                {"address", BLOCK_TAG | CLOSES_P}, {"figure", BLOCK_TAG | CLOSES_P},
+                {"figcaption", BLOCK_TAG | CLOSES_P}, {"form", BLOCK_TAG | CLOSES_P},
+                {"fieldset", BLOCK_TAG | CLOSES_P}, {"ins", BLOCK_TAG}, {"del", BLOCK_TAG},
+                {"dl", BLOCK_TAG | CLOSES_P}, {"dt", BLOCK_TAG | CLOSES_P}, {"dd", BLOCK_TAG | CLOSES_P},
+                {"li", BLOCK_TAG | CLOSES_P}, {"table", BLOCK_TAG | CLOSES_P}, {"caption", BLOCK_TAG},
+                {"thead", BLOCK_TAG}, {"tfoot", BLOCK_TAG}, {"tbody", BLOCK_TAG}, {"colgroup", BLOCK_TAG},
+                {"tr", BLOCK_TAG}, {"th", BLOCK_TAG}, {"td", BLOCK_TAG}, {"video", BLOCK_TAG},
+                {"audio", BLOCK_TAG}, {"canvas", BLOCK_TAG}, {"details", BLOCK_TAG | CLOSES_P},
+                {"menu", BLOCK_TAG | CLOSES_P}, {"plaintext", BLOCK_TAG}, {"template", BLOCK_TAG},
+                {"article", BLOCK_TAG | CLOSES_P}, {"main", BLOCK_TAG | CLOSES_P}, {"svg", BLOCK_TAG},
+                {"math", BLOCK_TAG}, {"center", BLOCK_TAG | CLOSES_P}, {"dir", BLOCK_TAG | CLOSES_P},
+                {"summary", BLOCK_TAG | CLOSES_P}, {"listing", BLOCK_TAG | CLOSES_P},
+            };
+            const auto it = flags.find(name);
+            return it == flags.end() ? 0 : it->second;
+        }
+
+        const std::unordered_map<std::string_view, uint32_t> &namedEntities() {
+            static const std::unordered_map<std::string_view, uint32_t> entities = {
+                {"amp", '&'}, {"lt", '<'}, {"gt", '>'}, {"quot", '"'}, {"apos", '\''},
+                {"AMP", '&'}, {"LT", '<'}, {"GT", '>'}, {"QUOT", '"'},
+                {"nbsp", 160}, {"iexcl", 161}, {"cent", 162}, {"pound", 163}, {"curren", 164},
+                {"yen", 165}, {"brvbar", 166}, {"sect", 167}, {"uml", 168}, {"copy", 169},
+                {"ordf", 170}, {"laquo", 171}, {"not", 172}, {"shy", 173}, {"reg", 174},
+                {"macr", 175}, {"deg", 176}, {"plusmn", 177}, {"sup2", 178}, {"sup3", 179},
+                {"acute", 180}, {"micro", 181}, {"para", 182}, {"middot", 183}, {"cedil", 184},
+                {"sup1", 185}, {"ordm", 186}, {"raquo", 187}, {"frac14", 188}, {"frac12", 189},
+                {"frac34", 190}, {"iquest", 191}, {"times", 215}, {"divide", 247},
+                {"agrave", 224}, {"aacute", 225}, {"eacute", 233}, {"egrave", 232}, {"uuml", 252},
+                {"ouml", 246}, {"auml", 228}, {"szlig", 223},
+                {"circ", 710}, {"tilde", 732}, {"ensp", 8194}, {"emsp", 8195}, {"thinsp", 8201},
+                {"zwnj", 8204}, {"zwj", 8205}, {"lrm", 8206}, {"rlm", 8207}, {"ndash", 8211},
+                {"mdash", 8212}, {"lsquo", 8216}, {"rsquo", 8217}, {"sbquo", 8218}, {"ldquo", 8220},
+                {"rdquo", 8221}, {"bdquo", 8222}, {"dagger", 8224}, {"Dagger", 8225}, {"bull", 8226},
+                {"hellip", 8230}, {"permil", 8240}, {"prime", 8242}, {"Prime", 8243}, {"lsaquo", 8249},
+                {"rsaquo", 8250}, {"oline", 8254}, {"frasl", 8260}, {"euro", 8364}, {"trade", 8482},
+                {"larr", 8592}, {"uarr", 8593}, {"rarr", 8594}, {"darr", 8595}, {"harr", 8596},
+                {"le", 8804}, {"ge", 8805}, {"ne", 8800}, {"infin", 8734}, {"star", 9734}, {"starf", 9733},
+                {"spades", 9824}, {"clubs", 9827}, {"hearts", 9829}, {"diams", 9830},
+            };
+            return entities;
+        }
+
+        // 不以';'结尾时也会被解码的实体
+        constexpr std::string_view LEGACY_ENTITIES[] = {
+            "nbsp", "quot", "copy", "amp", "reg", "AMP", "QUOT", "lt", "gt", "LT", "GT"
+        };
+
+        void appendUtf8(std::string &out, uint32_t cp) {
+            if (cp == 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) cp = 0xFFFD;
+            if (cp < 0x80) {
+                out += static_cast<char>(cp);
+            } else if (cp < 0x800) {
+                out += static_cast<char>(0xC0 | (cp >> 6));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            } else if (cp < 0x10000) {
+                out += static_cast<char>(0xE0 | (cp >> 12));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (cp >> 18));
+                out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+        }
+
+        bool isAsciiAlnum(const char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        }
+
+        bool isSpace(const char c) {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+        }
+
+        /**
+         * 解码一个以'&'开头的实体，成功时追加到out并返回消耗的字节数，否则返回0
+         */
+        size_t decodeEntity(std::string &out, const std::string_view str, const size_t pos, const bool attribute) {
+            const size_t n = str.size();
+            size_t p = pos + 1;
+            if (p < n && str[p] == '#') {
+                p++;
+                const bool hex = p < n && (str[p] == 'x' || str[p] == 'X');
+                if (hex) p++;
+                const size_t digitsStart = p;
+                uint32_t cp = 0;
+                while (p < n && (hex ? std::isxdigit(static_cast<unsigned char>(str[p])) : std::isdigit(static_cast<unsigned char>(str[p])))) {
+                    const char c = str[p];
+                    const uint32_t d = c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+                    if (cp <= 0x10FFFF) cp = cp * (hex ? 16 : 10) + d;
+                    p++;
+                }
+                if (p == digitsStart) return 0;
+                if (p < n && str[p] == ';') p++;
+                appendUtf8(out, cp);
+                return p - pos;
+            }
+            const size_t nameStart = p;
+            while (p < n && p - nameStart < 32 && isAsciiAlnum(str[p])) p++;
+            if (p == nameStart) return 0;
+            const auto &entities = namedEntities();
+            if (p < n && str[p] == ';') {
+                if (const auto it = entities.find(str.substr(nameStart, p - nameStart)); it != entities.end()) {
+                    appendUtf8(out, it->second);
+                    return p + 1 - pos;
+                }
+            }
+            // 不以';'结尾的旧式写法，如 &nbsp &amp
+            for (const auto legacy: LEGACY_ENTITIES) {
+                if (str.substr(nameStart).starts_with(legacy)) {
+                    const size_t end = nameStart + legacy.size();
+                    if (attribute && end < n && (isAsciiAlnum(str[end]) || str[end] == '=')) return 0;
+                    appendUtf8(out, entities.at(legacy));
+                    return end - pos;
+                }
+            }
+            return 0;
+        }
+
+        void decodeInto(std::string &out, const std::string_view str, const bool attribute) {
+            size_t last = 0;
+            size_t amp = str.find('&');
+            while (amp != std::string_view::npos) {
+                out.append(str.data() + last, amp - last);
+                if (const size_t consumed = decodeEntity(out, str, amp, attribute); consumed > 0) {
+                    last = amp + consumed;
+                } else {
+                    out += '&';
+                    last = amp + 1;
+                }
+                amp = str.find('&', last);
+            }
+            out.append(str.data() + last, str.size() - last);
+        }
+
+        bool lastIsWhitespace(const std::string &out) {
+            return !out.empty() && out.back() == ' ';
+        }
+
+        // 去掉首尾不大于' '的字符，与java的String.trim()一致
+        void javaTrim(std::string &s) {
+            size_t begin = 0;
+            while (begin < s.size() && static_cast<unsigned char>(s[begin]) <= ' ') begin++;
+            size_t end = s.size();
+            while (end > begin && static_cast<unsigned char>(s[end - 1]) <= ' ') end--;
+            s.erase(end);
+            s.erase(0, begin);
+        }
+
+        // 文本节点是否位于pre中，pre中的空白字符需要保留
+        bool preserveWhitespace(const Node *node) {
+            const Node *p = node->parent;
+            for (int i = 0; i < 6 && p != nullptr; i++, p = p->parent) {
+                if (p->nameIs("pre") || p->nameIs("textarea")) return true;
+            }
+            return false;
+        }
+
+        /**
+         * 非递归的先序遍历
+         * head返回false时跳过该节点的子节点以及tail
+         */
+        template<typename Head, typename Tail>
+        void traverse(const Node *root, Head &&head, Tail &&tail) {
+            const Node *node = root;
+            while (true) {
+                const bool descend = head(node);
+                if (descend && node->firstChild != nullptr) {
+                    node = node->firstChild;
+                    continue;
+                }
+                if (descend) tail(node);
+                while (node != root && node->next == nullptr) {
+                    node = node->parent;
+                    tail(node);
+                }
+                if (node == root) break;
+                node = node->next;
+            }
+        }
+
+        bool equalsIgnoreCase(const std::string_view a, const std::string_view b) {
+            if (a.size() != b.size()) return false;
+            for (size_t i = 0; i < a.size(); i++) {
+                if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * 扫描开始标签，pos为'<'的位置
+         * onAttribute(name, value)按出现的顺序传入原文中的属性名与未解码的属性值
+         * @param complete 输出标签是否完整，内容在标签中间结束时为 false
+         * @return 标签之后的位置
+         */
+        template<typename OnAttribute>
+        size_t scanStartTag(const std::string_view src, const size_t pos, std::string_view &name, bool &selfClosing,
+                            bool &complete, OnAttribute &&onAttribute) {
+            const size_t n = src.size();
+            size_t p = pos + 1;
+            const size_t nameStart = p;
+            while (p < n && !isSpace(src[p]) && src[p] != '>' && src[p] != '/') p++;
+            name = src.substr(nameStart, p - nameStart);
+            selfClosing = false;
+            complete = false;
+            while (p < n) {
+                while (p < n && isSpace(src[p])) p++;
+                if (p >= n) break;
+                if (src[p] == '>') {
+                    complete = true;
+                    return p + 1;
+                }
+                if (src[p] == '/') {
+                    p++;
+                    if (p < n && src[p] == '>') {
+                        selfClosing = true;
+                        complete = true;
+                        return p + 1;
+                    }
+                    continue;
+                }
+                const size_t attrStart = p;
+                // 属性名至少包含一个字符，因此以'='开头的畸形属性也能被跳过
+                p++;
+                while (p < n && !isSpace(src[p]) && src[p] != '=' && src[p] != '>' && src[p] != '/') p++;
+                const std::string_view attrName = src.substr(attrStart, p - attrStart);
+                while (p < n && isSpace(src[p])) p++;
+                std::string_view attrValue;
+                if (p < n && src[p] == '=') {
+                    p++;
+                    while (p < n && isSpace(src[p])) p++;
+                    if (p < n && (src[p] == '"' || src[p] == '\'')) {
+                        const char quote = src[p++];
+                        const size_t valueStart = p;
+                        const size_t valueEnd = src.find(quote, p);
+                        p = valueEnd == std::string_view::npos ? n : valueEnd;
+                        attrValue = src.substr(valueStart, p - valueStart);
+                        if (p < n) p++;
+                    } else {
+                        const size_t valueStart = p;
+                        while (p < n && !isSpace(src[p]) && src[p] != '>') p++;
+                        attrValue = src.substr(valueStart, p - valueStart);
+                    }
+                }
+                onAttribute(attrName, attrValue);
+            }
+            return p;
+        }
+
+        // 从from开始查找 </name，忽略大小写，找不到时返回src的长度
+        size_t findEndTag(const std::string_view src, const std::string_view name, size_t from) {
+            const size_t n = src.size();
+            while (from < n) {
+                const size_t lt = src.find("</", from);
+                if (lt == std::string_view::npos) return n;
+                const size_t nameEnd = lt + 2 + name.size();
+                if (nameEnd <= n && equalsIgnoreCase(src.substr(lt + 2, name.size()), name) &&
+                    (nameEnd == n || isSpace(src[nameEnd]) || src[nameEnd] == '>' || src[nameEnd] == '/')) {
+                    return lt;
+                }
+                from = lt + 2;
+            }
+            return n;
+        }
+
+        /**
+         * 在打开的元素中从上往下查找名称在targets中的元素，遇到boundaries中的元素或者html的作用域边界时停止
+         * nameAt(i)为栈中第i个元素的名称，第0个为文档根节点
+         * @return 元素在栈中的位置，不存在时返回-1
+         */
+        template<typename NameAt>
+        int findOpen(const size_t size, NameAt &&nameAt,
+                     const std::initializer_list<std::string_view> targets,
+                     const std::initializer_list<std::string_view> boundaries,
+                     const bool scoped = false) {
+            for (int i = static_cast<int>(size) - 1; i > 0; i--) {
+                const std::string_view name = nameAt(i);
+                if (std::ranges::find(targets, name) != targets.end()) return i;
+                if (std::ranges::find(boundaries, name) != boundaries.end()) return -1;
+                if (scoped && (name == "table" || name == "td" || name == "th" || name == "caption" ||
+                               name == "button" || name == "object" || name == "marquee" ||
+                               name == "template" || name == "html")) {
+                    return -1;
+                }
+            }
+            return -1;
+        }
+
+        /**
+         * 开始标签引起的隐式闭合，如 <li> 闭合前一个 <li>、块级元素闭合 <p>
+         * @param size 打开的元素的数量
+         * @return 闭合之后打开的元素的数量
+         */
+        template<typename NameAt>
+        size_t implicitClose(size_t size, NameAt &&nameAt, const std::string_view name, const uint8_t flags) {
+            const auto closeOpen = [&](const std::initializer_list<std::string_view> targets,
+                                       const std::initializer_list<std::string_view> boundaries,
+                                       const bool scoped) {
+                if (const int index = findOpen(size, nameAt, targets, boundaries, scoped); index > 0) {
+                    size = index;
+                }
+            };
+            if (flags & CLOSES_P) closeOpen({"p"}, {}, true);
+            if (name == "li") {
+                closeOpen({"li"}, {"ul", "ol"}, true);
+            } else if (name == "dd" || name == "dt") {
+                closeOpen({"dd", "dt"}, {"dl"}, true);
+            } else if (name == "option" || name == "optgroup") {
+                if (nameAt(size - 1) == "option") size--;
+                if (name == "optgroup" && nameAt(size - 1) == "optgroup") size--;
+            } else if (name == "tr") {
+                closeOpen({"tr"}, {"table", "thead", "tbody", "tfoot"}, false);
+            } else if (name == "td" || name == "th") {
+                closeOpen({"td", "th"}, {"tr", "table"}, false);
+            } else if (name == "thead" || name == "tbody" || name == "tfoot") {
+                closeOpen({"thead", "tbody", "tfoot"}, {"table"}, false);
+            } else if (name == "a") {
+                closeOpen({"a"}, {}, true);
+            } else if (name.size() == 2 && name[0] == 'h' && name[1] >= '1' && name[1] <= '6') {
+                if (const std::string_view cur = nameAt(size - 1);
+                    cur.size() == 2 && cur[0] == 'h' && cur[1] >= '1' && cur[1] <= '6') {
+                    size--;
+                }
+            }
+            return size;
+        }
+    }
+
+    void *Arena::allocate(const size_t size, const size_t align) {
+        auto space = reinterpret_cast<uintptr_t>(cur);
+        size_t padding = (align - space % align) % align;
+        if (cur == nullptr || padding + size > remaining) {
+            // 新的内存块按上一块的大小翻倍，保证总的分配次数为对数级
+            const size_t newSize = std::max(size + align, blocks.empty() ? blockSize : blockSize *= 2);
+            blocks.emplace_back(new char[newSize]);
+            cur = blocks.back().get();
+            remaining = newSize;
+            space = reinterpret_cast<uintptr_t>(cur);
+            padding = (align - space % align) % align;
+        }
+        char *result = cur + padding;
+        cur += padding + size;
+        remaining -= padding + size;
+        return result;
+    }
+
+    std::string_view Arena::copy(const std::string_view str) {
+        if (str.empty()) return {};
+        auto *p = static_cast<char *>(allocate(str.size(), 1));
+        std::memcpy(p, str.data(), str.size());
+        return {p, str.size()};
+    }
+
+    std::string decodeEntities(const std::string_view str, const bool attribute) {
+        std::string out;
+        out.reserve(str.size());
+        decodeInto(out, str, attribute);
+        return out;
+    }
+
+    void escapeText(std::string &out, const std::string_view text, const bool attribute) {
+        for (size_t i = 0; i < text.size(); i++) {
+            const char c = text[i];
+            switch (c) {
+                case '&': out += "&amp;";
+                    break;
+                case '<': out += attribute ? "<" : "&lt;";
+                    break;
+                case '>': out += attribute ? ">" : "&gt;";
+                    break;
+                case '"': out += attribute ? "&quot;" : "\"";
+                    break;
+                default:
+                    if (c == '\xC2' && i + 1 < text.size() && text[i + 1] == '\xA0') {
+                        out += "&nbsp;";
+                        i++;
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+    }
+
+    void appendNormalisedText(std::string &out, const std::string_view text) {
+        bool lastWasWhite = lastIsWhitespace(out);
+        for (size_t i = 0; i < text.size(); i++) {
+            const char c = text[i];
+            const bool nbsp = c == '\xC2' && i + 1 < text.size() && text[i + 1] == '\xA0';
+            if (isSpace(c) || nbsp) {
+                if (nbsp) i++;
+                if (!lastWasWhite) {
+                    out += ' ';
+                    lastWasWhite = true;
+                }
+                continue;
+            }
+            // 跳过不可见字符：U+00AD 软连字符，U+200B 零宽空格
+            if (c == '\xC2' && i + 1 < text.size() && text[i + 1] == '\xAD') {
+                i++;
+                continue;
+            }
+            if (c == '\xE2' && i + 2 < text.size() && text[i + 1] == '\x80' && text[i + 2] == '\x8B') {
+                i += 2;
+                continue;
+            }
+            out += c;
+            lastWasWhite = false;
+        }
+    }
+
+    std::string_view Node::attr(const std::string_view key) const {
+        for (uint32_t i = 0; i < attributeCount; i++) {
+            if (attributes[i].name == key) return attributes[i].value;
+        }
+        return {};
+    }
+
+    bool Node::hasAttr(const std::string_view key) const {
+        for (uint32_t i = 0; i < attributeCount; i++) {
+            if (attributes[i].name == key) return true;
+        }
+        return false;
+    }
+
+    bool Node::hasClass(const std::string_view className) const {
+        const std::string_view classes = attr("class");
+        size_t pos = 0;
+        while (pos < classes.size()) {
+            while (pos < classes.size() && isSpace(classes[pos])) pos++;
+            const size_t start = pos;
+            while (pos < classes.size() && !isSpace(classes[pos])) pos++;
+            if (pos > start && equalsIgnoreCase(classes.substr(start, pos - start), className)) return true;
+        }
+        return false;
+    }
+
+    const Node *Node::firstElementChild() const {
+        for (const Node *c = firstChild; c != nullptr; c = c->next) {
+            if (c->isElement()) return c;
+        }
+        return nullptr;
+    }
+
+    const Node *Node::nextElementSibling() const {
+        for (const Node *c = next; c != nullptr; c = c->next) {
+            if (c->isElement()) return c;
+        }
+        return nullptr;
+    }
+
+    const Node *Node::previousElementSibling() const {
+        for (const Node *c = prev; c != nullptr; c = c->prev) {
+            if (c->isElement()) return c;
+        }
+        return nullptr;
+    }
+
+    Elements Node::children() const {
+        Elements result;
+        for (const Node *c = firstChild; c != nullptr; c = c->next) {
+            if (c->isElement()) result.push_back(c);
+        }
+        return result;
+    }
+
+    std::string Node::text() const {
+        std::string out;
+        traverse(this, [&](const Node *node) {
+            if (node->type == NodeType::Text) {
+                if (preserveWhitespace(node)) {
+                    out += node->value;
+                } else {
+                    appendNormalisedText(out, node->value);
+                }
+            } else if (node->isElement() && !out.empty() &&
+                       (node->block || node->name == "br") && !lastIsWhitespace(out)) {
+                out += ' ';
+            }
+            return true;
+        }, [&](const Node *node) {
+            if (node->isElement() && node->block && node->next != nullptr &&
+                node->next->type == NodeType::Text && !lastIsWhitespace(out)) {
+                out += ' ';
+            }
+        });
+        javaTrim(out);
+        return out;
+    }
+
+    std::string Node::ownText() const {
+        std::string out;
+        for (const Node *c = firstChild; c != nullptr; c = c->next) {
+            if (c->type == NodeType::Text) {
+                if (preserveWhitespace(c)) {
+                    out += c->value;
+                } else {
+                    appendNormalisedText(out, c->value);
+                }
+            } else if (c->nameIs("br") && !lastIsWhitespace(out)) {
+                out += ' ';
+            }
+        }
+        javaTrim(out);
+        return out;
+    }
+
+    std::string Node::textNodeText() const {
+        std::string out;
+        appendNormalisedText(out, value);
+        return out;
+    }
+
+    std::vector<const Node *> Node::textNodes() const {
+        std::vector<const Node *> result;
+        for (const Node *c = firstChild; c != nullptr; c = c->next) {
+            if (c->type == NodeType::Text) result.push_back(c);
+        }
+        return result;
+    }
+
+    std::string Node::data() const {
+        std::string out;
+        traverse(this, [&](const Node *node) {
+            if (node->type == NodeType::Data || node->type == NodeType::Comment) {
+                out += node->value;
+            }
+            return true;
+        }, [](const Node *) {
+        });
+        return out;
+    }
+
+    void Node::appendOuterHtml(std::string &out, const bool skipScript) const {
+        traverse(this, [&](const Node *node) {
+            switch (node->type) {
+                case NodeType::Document:
+                    return true;
+                case NodeType::Text:
+                    escapeText(out, node->value);
+                    return true;
+                case NodeType::Data:
+                    out += node->value;
+                    return true;
+                case NodeType::Comment:
+                    out += "<!--";
+                    out += node->value;
+                    out += "-->";
+                    return true;
+                case NodeType::Element:
+                    break;
+            }
+            if (skipScript && (node->name == "script" || node->name == "style")) return false;
+            out += '<';
+            out += node->name;
+            for (uint32_t i = 0; i < node->attributeCount; i++) {
+                out += ' ';
+                out += node->attributes[i].name;
+                out += "=\"";
+                escapeText(out, node->attributes[i].value, true);
+                out += '"';
+            }
+            out += '>';
+            return true;
+        }, [&](const Node *node) {
+            if (node->isElement() && !(tagFlags(node->name) & VOID_TAG)) {
+                out += "</";
+                out += node->name;
+                out += '>';
+            }
+        });
+    }
+
+    std::string Node::outerHtml() const {
+        std::string out;
+        appendOuterHtml(out);
+        return out;
+    }
+
+    std::string Node::html() const {
+        std::string out;
+        for (const Node *c = firstChild; c != nullptr; c = c->next) {
+            c->appendOuterHtml(out);
+        }
+        return out;
+    }
+
+    /**
+     * 一次遍历完成分词与建树
+     * 容错规则参考html5规范中最常见的部分：void元素、p/li/dd/dt/option/tr/td等的隐式闭合、
+     * 没有对应开始标签的结束标签直接忽略、未闭合的元素在文档结束时闭合
+     */
+    class Parser {
+    public:
+        Parser(Document &doc, const bool xml) : doc(doc), src(doc.html), arena(doc.arena), xml(xml) {
+            stack.reserve(64);
+            attrs.reserve(16);
+        }
+
+        void run() {
+            Node *root = newNode(NodeType::Document);
+            doc.rootNode = root;
+            stack.push_back(root);
+
+            const size_t n = src.size();
+            size_t pos = 0;
+            while (pos < n) {
+                const auto *lt = static_cast<const char *>(std::memchr(src.data() + pos, '<', n - pos));
+                const size_t tagStart = lt == nullptr ? n : lt - src.data();
+                if (tagStart > pos) appendText(pos, tagStart);
+                if (tagStart >= n) break;
+                const char c = tagStart + 1 < n ? src[tagStart + 1] : '\0';
+                if (std::isalpha(static_cast<unsigned char>(c))) {
+                    pos = parseStartTag(tagStart);
+                } else if (c == '/') {
+                    pos = parseEndTag(tagStart);
+                } else if (c == '!') {
+                    pos = parseMarkup(tagStart);
+                } else if (c == '?') {
+                    pos = skipTo(tagStart, '>');
+                } else {
+                    // 单独的'<'作为文本
+                    appendText(tagStart, tagStart + 1);
+                    pos = tagStart + 1;
+                }
+            }
+            doc.nodes = counter;
+        }
+
+    private:
+        Document &doc;
+        const std::string &src;
+        Arena &arena;
+        bool xml;
+        std::vector<Node *> stack;
+        std::vector<Attribute> attrs;
+        std::string scratch;
+        uint32_t counter = 0;
+
+        // 栈中第i个元素的名称
+        auto nameAt() const {
+            return [this](const size_t i) { return stack[i]->name; };
+        }
+
+        Node *newNode(const NodeType type) {
+            Node *node = arena.create<Node>();
+            node->type = type;
+            node->index = counter++;
+            return node;
+        }
+
+        static void append(Node *parent, Node *child) {
+            child->parent = parent;
+            if (parent->lastChild == nullptr) {
+                parent->firstChild = child;
+            } else {
+                parent->lastChild->next = child;
+                child->prev = parent->lastChild;
+            }
+            parent->lastChild = child;
+        }
+
+        size_t skipTo(const size_t from, const char c) const {
+            const size_t end = src.find(c, from);
+            return end == std::string::npos ? src.size() : end + 1;
+        }
+
+        std::string_view view(const size_t begin, const size_t end) const {
+            return {src.data() + begin, end - begin};
+        }
+
+        // 含有实体时解码到Arena中，否则直接引用原文
+        std::string_view decoded(const std::string_view str, const bool attribute) {
+            if (str.find('&') == std::string_view::npos) return str;
+            scratch.clear();
+            decodeInto(scratch, str, attribute);
+            return arena.copy(scratch);
+        }
+
+        std::string_view lowerName(const std::string_view name) {
+            if (xml || std::ranges::none_of(name, [](const char c) { return c >= 'A' && c <= 'Z'; })) return name;
+            scratch.assign(name);
+            for (char &c: scratch) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            return arena.copy(scratch);
+        }
+
+        void appendText(const size_t begin, const size_t end, const NodeType type = NodeType::Text) {
+            Node *parent = stack.back();
+            const std::string_view raw = view(begin, end);
+            // 文档根节点下的空白文本没有意义
+            if (parent->type == NodeType::Document &&
+                std::ranges::all_of(raw, [](const char c) { return isSpace(c); })) {
+                return;
+            }
+            const std::string_view text = type == NodeType::Text ? decoded(raw, false) : raw;
+            if (Node *last = parent->lastChild; last != nullptr && last->type == type && type == NodeType::Text) {
+                // 相邻的文本合并为一个节点
+                scratch.assign(last->value);
+                scratch += text;
+                last->value = arena.copy(scratch);
+                return;
+            }
+            Node *node = newNode(type);
+            node->value = text;
+            append(parent, node);
+        }
+
+        size_t parseMarkup(const size_t pos) {
+            if (src.compare(pos, 4, "<!--") == 0) {
+                const size_t end = src.find("-->", pos + 4);
+                const size_t contentEnd = end == std::string::npos ? src.size() : end;
+                Node *node = newNode(NodeType::Comment);
+                node->value = view(pos + 4, contentEnd);
+                append(stack.back(), node);
+                return end == std::string::npos ? src.size() : end + 3;
+            }
+            if (src.compare(pos, 9, "<![CDATA[") == 0) {
+                const size_t end = src.find("]]>", pos + 9);
+                const size_t contentEnd = end == std::string::npos ? src.size() : end;
+                Node *node = newNode(NodeType::Text);
+                node->value = view(pos + 9, contentEnd);
+                append(stack.back(), node);
+                return end == std::string::npos ? src.size() : end + 3;
+            }
+            // <!DOCTYPE ...> 等
+            return skipTo(pos, '>');
+        }
+
+        size_t parseStartTag(const size_t pos) {
+            std::string_view rawName;
+            bool selfClosing;
+            bool complete;
+            attrs.clear();
+            const size_t p = scanStartTag(src, pos, rawName, selfClosing, complete,
+                                          [&](const std::string_view rawAttrName, const std::string_view rawValue) {
+                                              const std::string_view attrName = lowerName(rawAttrName);
+                                              const std::string_view attrValue = decoded(rawValue, true);
+                                              // 重复的属性以第一个为准
+                                              if (std::ranges::none_of(attrs, [&](const Attribute &a) {
+                                                  return a.name == attrName;
+                                              })) {
+                                                  attrs.push_back({attrName, attrValue});
+                                              }
+                                          });
+            const std::string_view name = lowerName(rawName);
+            const size_t n = src.size();
+
+            const uint8_t flags = xml ? 0 : tagFlags(name);
+            Node *element = openElement(name, flags, selfClosing);
+            if (selfClosing || (flags & VOID_TAG) || !(flags & (DATA_TAG | RCDATA_TAG))) {
+                return p;
+            }
+            // script、style、textarea、title 的内容不解析标签，直到对应的结束标签
+            const size_t end = findEndTag(src, name, p);
+            if (end > p) {
+                Node *text = newNode(flags & DATA_TAG ? NodeType::Data : NodeType::Text);
+                text->value = flags & DATA_TAG ? view(p, end) : decoded(view(p, end), false);
+                append(element, text);
+            }
+            stack.pop_back();
+            return end >= n ? n : skipTo(end, '>');
+        }
+
+        size_t parseEndTag(const size_t pos) {
+            const size_t n = src.size();
+            size_t p = pos + 2;
+            const size_t nameStart = p;
+            while (p < n && !isSpace(src[p]) && src[p] != '>' && src[p] != '/') p++;
+            const std::string_view name = lowerName(view(nameStart, p));
+            const size_t end = skipTo(p, '>');
+            if (name.empty()) return end;
+            if (!xml && name == "br") {
+                // </br> 按 <br> 处理
+                attrs.clear();
+                openElement("br", tagFlags("br"), true);
+                return end;
+            }
+            if (const int index = findOpen(stack.size(), nameAt(), {name}, {}); index > 0) {
+                stack.resize(index);
+            }
+            return end;
+        }
+
+        Node *openElement(const std::string_view name, const uint8_t flags, const bool selfClosing) {
+            if (!xml) {
+                stack.resize(implicitClose(stack.size(), nameAt(), name, flags));
+            }
+            Node *element = newNode(NodeType::Element);
+            element->name = name;
+            element->block = flags & BLOCK_TAG;
+            if (!attrs.empty()) {
+                element->attributes = arena.allocateArray<Attribute>(attrs.size());
+                std::ranges::copy(attrs, element->attributes);
+                element->attributeCount = static_cast<uint32_t>(attrs.size());
+            }
+            append(stack.back(), element);
+            if (!selfClosing && !(flags & VOID_TAG)) {
+                stack.push_back(element);
+            }
+            return element;
+        }
+    };
+
+    Document::Document(std::string html)
+        : html(std::move(html)),
+          // 节点数量大致与网页大小成正比，第一块内存尽量一次容纳整个文档
+          arena(std::max<size_t>(16 * 1024, this->html.size() * 2)) {
+    }
+
+    std::shared_ptr<const Document> Document::parse(std::string html, const bool xml) {
+        auto doc = std::make_shared<Document>(std::move(html));
+        Parser(*doc, xml).run();
+        return doc;
+    }
+
+    StreamParser::StreamParser(OpenHandler onOpen, CloseHandler onClose)
+        : onOpen(std::move(onOpen)), onClose(std::move(onClose)) {
+        stack.emplace_back();
+    }
+
+    void StreamParser::feed(const std::string_view data) {
+        // 已解析且不再需要的内容超过一半时才丢弃，避免频繁移动
+        if (const size_t drop = std::min(released - std::min(released, base), pos); drop > 0 && drop * 2 >= buffer.size()) {
+            buffer.erase(0, drop);
+            base += drop;
+            pos -= drop;
+        }
+        buffer.append(data);
+        parse(false);
+    }
+
+    void StreamParser::finish() {
+        parse(true);
+        closeTo(1, size());
+    }
+
+    std::string_view StreamParser::slice(const size_t begin, const size_t end) const {
+        return std::string_view(buffer).substr(begin - base, end - begin);
+    }
+
+    void StreamParser::release(const size_t offset) {
+        released = std::max(released, offset);
+    }
+
+    void StreamParser::parse(const bool eof) {
+        const std::string_view src(buffer);
+        const size_t n = src.size();
+        while (pos < n) {
+            if (!rawTag.empty()) {
+                // script、style、textarea、title 的内容不解析标签，直到对应的结束标签
+                const size_t end = findEndTag(src, rawTag, pos);
+                if (end >= n && !eof) return;
+                const size_t gt = end >= n ? std::string_view::npos : src.find('>', end);
+                if (gt == std::string_view::npos && !eof) return;
+                const size_t next = gt == std::string_view::npos ? n : gt + 1;
+                closeTo(stack.size() - 1, base + next);
+                rawTag.clear();
+                pos = next;
+                continue;
+            }
+            const auto *lt = static_cast<const char *>(std::memchr(src.data() + pos, '<', n - pos));
+            if (lt == nullptr) {
+                pos = n;
+                break;
+            }
+            const size_t tagStart = lt - src.data();
+            if (tagStart + 1 >= n) {
+                pos = eof ? n : tagStart;
+                break;
+            }
+            const char c = src[tagStart + 1];
+            size_t next;
+            if (std::isalpha(static_cast<unsigned char>(c))) {
+                if (!parseStartTag(tagStart, eof, next)) {
+                    pos = tagStart;
+                    return;
+                }
+            } else if (c == '/') {
+                if (!parseEndTag(tagStart, eof, next)) {
+                    pos = tagStart;
+                    return;
+                }
+            } else if (c == '!' || c == '?') {
+                // 注释、CDATA、<!DOCTYPE ...> 等，与Parser::parseMarkup相同
+                const bool comment = src.compare(tagStart, 4, "<!--") == 0;
+                const bool cdata = src.compare(tagStart, 9, "<![CDATA[") == 0;
+                if (!eof && c == '!' && n - tagStart < 9) {
+                    pos = tagStart;
+                    return;
+                }
+                size_t end;
+                if (comment) {
+                    end = src.find("-->", tagStart + 4);
+                    if (end != std::string_view::npos) end += 3;
+                } else if (cdata) {
+                    end = src.find("]]>", tagStart + 9);
+                    if (end != std::string_view::npos) end += 3;
+                } else {
+                    end = src.find('>', tagStart);
+                    if (end != std::string_view::npos) end += 1;
+                }
+                if (end == std::string_view::npos) {
+                    if (!eof) {
+                        pos = tagStart;
+                        return;
+                    }
+                    end = n;
+                }
+                next = end;
+            } else {
+                // 单独的'<'作为文本
+                next = tagStart + 1;
+            }
+            pos = next;
+        }
+    }
+
+    bool StreamParser::parseStartTag(const size_t tagStart, const bool eof, size_t &next) {
+        std::string_view rawName;
+        bool selfClosing;
+        bool complete;
+        attrNames.clear();
+        attrValues.clear();
+        next = scanStartTag(buffer, tagStart, rawName, selfClosing, complete,
+                            [&](const std::string_view rawAttrName, const std::string_view rawValue) {
+                                std::string attrName(rawAttrName);
+                                for (char &c: attrName) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+                                // 重复的属性以第一个为准
+                                if (std::ranges::find(attrNames, attrName) == attrNames.end()) {
+                                    attrNames.push_back(std::move(attrName));
+                                    attrValues.push_back(decodeEntities(rawValue, true));
+                                }
+                            });
+        if (!complete && !eof) return false;
+        std::string name(rawName);
+        for (char &c: name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        attrs.clear();
+        for (size_t i = 0; i < attrNames.size(); i++) {
+            attrs.push_back({attrNames[i], attrValues[i]});
+        }
+        const uint8_t flags = tagFlags(name);
+        openElement(name, flags, selfClosing, base + tagStart, base + next);
+        if (!selfClosing && !(flags & VOID_TAG) && (flags & (DATA_TAG | RCDATA_TAG))) {
+            rawTag = std::move(name);
+        }
+        return true;
+    }
+
+    bool StreamParser::parseEndTag(const size_t tagStart, const bool eof, size_t &next) {
+        const size_t n = buffer.size();
+        size_t p = tagStart + 2;
+        const size_t nameStart = p;
+        while (p < n && !isSpace(buffer[p]) && buffer[p] != '>' && buffer[p] != '/') p++;
+        const size_t gt = buffer.find('>', p);
+        if (gt == std::string::npos && !eof) return false;
+        next = gt == std::string::npos ? n : gt + 1;
+        std::string name = buffer.substr(nameStart, p - nameStart);
+        for (char &c: name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (name.empty()) return true;
+        if (name == "br") {
+            // </br> 按 <br> 处理
+            attrs.clear();
+            openElement("br", tagFlags("br"), true, base + tagStart, base + next);
+            return true;
+        }
+        const auto nameAt = [this](const size_t i) { return std::string_view(stack[i]); };
+        if (const int index = findOpen(stack.size(), nameAt, {name}, {}); index > 0) {
+            // 上层元素的结束标签同时闭合其中未闭合的元素
+            closeTo(index + 1, base + tagStart);
+            closeTo(index, base + next);
+        }
+        return true;
+    }
+
+    void StreamParser::openElement(const std::string_view name, const uint8_t flags, const bool selfClosing,
+                                   const size_t begin, const size_t end) {
+        const auto nameAt = [this](const size_t i) { return std::string_view(stack[i]); };
+        closeTo(implicitClose(stack.size(), nameAt, name, flags), begin);
+        Node element;
+        element.name = name;
+        element.block = flags & BLOCK_TAG;
+        element.attributes = attrs.empty() ? nullptr : attrs.data();
+        element.attributeCount = static_cast<uint32_t>(attrs.size());
+        const size_t depth = stack.size();
+        onOpen(element, depth, begin);
+        if (selfClosing || (flags & VOID_TAG)) {
+            onClose(depth, end);
+        } else {
+            stack.emplace_back(name);
+        }
+    }
+
+    void StreamParser::closeTo(const size_t size, const size_t end) {
+        while (stack.size() > size) {
+            stack.pop_back();
+            onClose(stack.size(), end);
+        }
+    }
+}
@@ -0,0 +1,1240 @@
+#include <booksource/jsonpath.h>
+#include <booksource/rule.h>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <regex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace JsonPath {
+
+    // ---------------------------------------------------------------- tape
+
+    class Parser {
+    public:
+        explicit Parser(Document &document) : doc(document), s(document.json.data()), n(document.json.size()) {
+        }
+
+        void run() {
+            if (n >= std::numeric_limits<uint32_t>::max()) throw std::invalid_argument("json: document too large");
+            // 大致按每8字节一个值预留，避免反复扩容
+            doc.tape.reserve(n / 8 + 16);
+            skipWhitespace();
+            value(0);
+            skipWhitespace();
+            if (p != n) error("unexpected content after value");
+        }
+
+    private:
+        static constexpr int maxDepth = 1024;
+        Document &doc;
+        const char *s;
+        size_t n;
+        size_t p = 0;
+
+        [[noreturn]] void error(const std::string &message) const {
+            throw std::invalid_argument("Invalid json: " + message + " at " + std::to_string(p));
+        }
+
+        void skipWhitespace() {
+            while (p < n && (s[p] == ' ' || s[p] == '\n' || s[p] == '\r' || s[p] == '\t')) p++;
+        }
+
+        uint32_t push(const Value::Type type) {
+            Document::Entry e{};
+            e.offset = static_cast<uint32_t>(p);
+            e.type = static_cast<uint32_t>(type);
+            doc.tape.push_back(e);
+            return static_cast<uint32_t>(doc.tape.size() - 1);
+        }
+
+        void finish(const uint32_t i) {
+            Document::Entry &e = doc.tape[i];
+            e.end = static_cast<uint32_t>(p);
+            e.next = static_cast<uint32_t>(doc.tape.size());
+        }
+
+        void value(const int depth) {
+            if (p >= n) error("unexpected end");
+            switch (s[p]) {
+                case '{':
+                    object(depth);
+                    return;
+                case '[':
+                    array(depth);
+                    return;
+                case '"':
+                    string();
+                    return;
+                case 't':
+                    literal("true", Value::Type::True);
+                    return;
+                case 'f':
+                    literal("false", Value::Type::False);
+                    return;
+                case 'n':
+                    literal("null", Value::Type::Null);
+                    return;
+                default:
+                    number();
+            }
+        }
+
+        void object(const int depth) {
+            if (depth >= maxDepth) error("nesting too deep");
+            const uint32_t i = push(Value::Type::Object);
+            uint32_t count = 0;
+            p++;
+            skipWhitespace();
+            if (p < n && s[p] == '}') {
+                p++;
+            } else {
+                while (true) {
+                    if (p >= n || s[p] != '"') error("expected string key");
+                    string();
+                    skipWhitespace();
+                    if (p >= n || s[p] != ':') error("expected ':'");
+                    p++;
+                    skipWhitespace();
+                    const auto member = static_cast<uint32_t>(doc.tape.size());
+                    value(depth + 1);
+                    doc.tape[member].member = 1;
+                    count++;
+                    skipWhitespace();
+                    if (p < n && s[p] == ',') {
+                        p++;
+                        skipWhitespace();
+                        continue;
+                    }
+                    if (p < n && s[p] == '}') {
+                        p++;
+                        break;
+                    }
+                    error("expected ',' or '}'");
+                }
+            }
+            doc.tape[i].count = count;
+            finish(i);
+        }
+
+        void array(const int depth) {
+            if (depth >= maxDepth) error("nesting too deep");
+            const uint32_t i = push(Value::Type::Array);
+            uint32_t count = 0;
+            p++;
+            skipWhitespace();
+            if (p < n && s[p] == ']') {
+                p++;
+            } else {
+                while (true) {
+                    value(depth + 1);
+                    count++;
+                    skipWhitespace();
+                    if (p < n && s[p] == ',') {
+                        p++;
+                        skipWhitespace();
+                        continue;
+                    }
+                    if (p < n && s[p] == ']') {
+                        p++;
+                        break;
+                    }
+                    error("expected ',' or ']'");
+                }
+            }
+            doc.tape[i].count = count;
+            finish(i);
+        }
+
+        void string() {
+            const uint32_t i = push(Value::Type::String);
+            p++;
+            bool escaped = false;
+            while (true) {
+                // 先用memchr跳到下一个引号，再检查中间是否有转义或者控制字符
+                const auto *quote = static_cast<const char *>(std::memchr(s + p, '"', n - p));
+                if (quote == nullptr) error("unterminated string");
+                const size_t q = quote - s;
+                for (; p < q; p++) {
+                    const auto c = static_cast<unsigned char>(s[p]);
+                    if (c == '\\') {
+                        escaped = true;
+                        p++;
+                    } else if (c < 0x20) {
+                        error("control character in string");
+                    }
+                }
+                // 引号被转义时p越过了它
+                if (p == q) break;
+            }
+            p++;
+            doc.tape[i].escaped = escaped;
+            finish(i);
+        }
+
+        void literal(const std::string_view text, const Value::Type type) {
+            if (std::string_view(s + p, std::min(text.size(), n - p)) != text) error("invalid literal");
+            const uint32_t i = push(type);
+            p += text.size();
+            finish(i);
+        }
+
+        void number() {
+            const uint32_t i = push(Value::Type::Number);
+            auto digits = [&] {
+                const size_t begin = p;
+                while (p < n && s[p] >= '0' && s[p] <= '9') p++;
+                return p > begin;
+            };
+            if (p < n && s[p] == '-') p++;
+            if (p < n && s[p] == '0') {
+                p++;
+            } else if (!digits()) {
+                error("invalid value");
+            }
+            if (p < n && s[p] == '.') {
+                p++;
+                if (!digits()) error("invalid number");
+            }
+            if (p < n && (s[p] == 'e' || s[p] == 'E')) {
+                p++;
+                if (p < n && (s[p] == '+' || s[p] == '-')) p++;
+                if (!digits()) error("invalid number");
+            }
+            finish(i);
+        }
+    };
+
+    std::shared_ptr<const Document> Document::parse(std::string json) {
+        auto document = std::make_shared<Document>(std::move(json));
+        Parser(*document).run();
+        return document;
+    }
+
+    Document::Document(std::string json) : json(std::move(json)) {
+    }
+
+    namespace {
+        void appendUtf8(std::string &out, const uint32_t cp) {
+            if (cp < 0x80) {
+                out += static_cast<char>(cp);
+            } else if (cp < 0x800) {
+                out += static_cast<char>(0xC0 | cp >> 6);
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            } else if (cp < 0x10000) {
+                out += static_cast<char>(0xE0 | cp >> 12);
+                out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | cp >> 18);
+                out += static_cast<char>(0x80 | (cp >> 12 & 0x3F));
+                out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+        }
+
+        std::optional<uint32_t> hex4(const std::string_view s, const size_t p) {
+            if (p + 4 > s.size()) return std::nullopt;
+            uint32_t v = 0;
+            const auto [end, ec] = std::from_chars(s.data() + p, s.data() + p + 4, v, 16);
+            if (ec != std::errc() || end != s.data() + p + 4) return std::nullopt;
+            return v;
+        }
+
+        bool isWhitespace(const char c) {
+            return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+        }
+
+        // 去掉json中字符串之外的空白
+        void appendCompact(std::string &out, const std::string_view raw) {
+            bool inString = false;
+            for (size_t i = 0; i < raw.size(); i++) {
+                const char c = raw[i];
+                if (inString) {
+                    out += c;
+                    if (c == '\\' && i + 1 < raw.size()) {
+                        out += raw[++i];
+                    } else if (c == '"') {
+                        inString = false;
+                    }
+                } else if (!isWhitespace(c)) {
+                    out += c;
+                    inString = c == '"';
+                }
+            }
+        }
+    }
+
+    std::string unescape(const std::string_view str) {
+        std::string out;
+        out.reserve(str.size());
+        for (size_t i = 0; i < str.size(); i++) {
+            const char c = str[i];
+            if (c != '\\' || i + 1 >= str.size()) {
+                out += c;
+                continue;
+            }
+            switch (const char e = str[++i]) {
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    auto cp = hex4(str, i + 1);
+                    if (!cp.has_value()) {
+                        out += "\\u";
+                        break;
+                    }
+                    i += 4;
+                    // 代理对
+                    if (*cp >= 0xD800 && *cp <= 0xDBFF && i + 2 < str.size() && str[i + 1] == '\\' && str[i + 2] == 'u') {
+                        if (const auto low = hex4(str, i + 3); low.has_value() && *low >= 0xDC00 && *low <= 0xDFFF) {
+                            cp = 0x10000 + ((*cp - 0xD800) << 10) + (*low - 0xDC00);
+                            i += 6;
+                        }
+                    }
+                    appendUtf8(out, *cp);
+                    break;
+                }
+                default:
+                    out += e;
+            }
+        }
+        return out;
+    }
+
+    // ---------------------------------------------------------------- Value
+
+    Value::Type Value::type() const {
+        return static_cast<Type>(document->entry(index).type);
+    }
+
+    size_t Value::size() const {
+        const auto &e = document->entry(index);
+        return e.type == static_cast<uint32_t>(Type::Array) || e.type == static_cast<uint32_t>(Type::Object) ? e.count : 0;
+    }
+
+    Value Value::operator[](const std::string_view key) const {
+        Value result;
+        if (!valid() || !isObject()) return result;
+        // 没有转义的key直接与原文比较
+        forEach([&](const std::string_view k, const Value v) {
+            const bool escaped = document->entry(v.index - 1).escaped;
+            if (escaped ? unescape(k) == key : k == key) {
+                result = v;
+                return false;
+            }
+            return true;
+        });
+        return result;
+    }
+
+    Value Value::at(long i) const {
+        Value result;
+        if (!valid() || !isArray()) return result;
+        const long count = static_cast<long>(size());
+        if (i < 0) i += count;
+        if (i < 0 || i >= count) return result;
+        uint32_t j = index + 1;
+        while (i-- > 0) j = document->entry(j).next;
+        return {document, j};
+    }
+
+    std::vector<Value> Value::children() const {
+        std::vector<Value> result;
+        if (!valid()) return result;
+        result.reserve(size());
+        forEach([&](std::string_view, const Value v) {
+            result.push_back(v);
+            return true;
+        });
+        return result;
+    }
+
+    std::string_view Value::raw() const {
+        if (!valid()) return {};
+        const auto &e = document->entry(index);
+        return std::string_view(document->source()).substr(e.offset, e.end - e.offset);
+    }
+
+    std::string Value::getString() const {
+        if (!valid()) return "";
+        switch (type()) {
+            case Type::Null:
+                return "";
+            case Type::String: {
+                const std::string_view r = raw().substr(1, raw().size() - 2);
+                return document->entry(index).escaped ? unescape(r) : std::string(r);
+            }
+            case Type::Array:
+            case Type::Object:
+                return toJson();
+            default:
+                return std::string(raw());
+        }
+    }
+
+    double Value::getNumber() const {
+        if (!valid()) return std::numeric_limits<double>::quiet_NaN();
+        if (type() == Type::True) return 1;
+        if (type() == Type::False) return 0;
+        const std::string s = type() == Type::String ? getString() : std::string(raw());
+        double number = 0;
+        const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), number);
+        if (ec != std::errc() || end != s.data() + s.size() || s.empty()) return std::numeric_limits<double>::quiet_NaN();
+        return number;
+    }
+
+    std::string Value::toJson() const {
+        std::string out;
+        if (!valid()) return out;
+        const std::string_view r = raw();
+        if (type() != Type::Array && type() != Type::Object) return std::string(r);
+        out.reserve(r.size());
+        appendCompact(out, r);
+        return out;
+    }
+
+    // ---------------------------------------------------------------- JSONPath
+
+    struct Filter;
+
+    struct Selector {
+        enum class Kind : uint8_t {
+            Name, Wildcard, Index, Slice, Filter
+        };
+
+        Kind kind = Kind::Name;
+        std::string name = "";
+        long index = 0;
+        std::optional<long> start = std::nullopt;
+        std::optional<long> end = std::nullopt;
+        long step = 1;
+        std::shared_ptr<const JsonPath::Filter> filter = nullptr;
+    };
+
+    struct Segment {
+        bool recursive = false; // '..'
+        std::vector<Selector> selectors;
+    };
+
+    // 过滤表达式中的字面量
+    struct Literal {
+        Value::Type type = Value::Type::Null;
+        double number = 0;
+        std::string str;
+    };
+
+    struct Operand {
+        enum class Kind : uint8_t {
+            Current, Root, Literal, Regex, List
+        };
+
+        Kind kind = Kind::Literal;
+        std::vector<Segment> path; // Current、Root
+        JsonPath::Literal literal;
+        std::shared_ptr<const std::regex> regex;
+        std::vector<JsonPath::Literal> list;
+    };
+
+    struct Filter {
+        enum class Kind : uint8_t {
+            Or, And, Not, Exists, Compare
+        };
+
+        enum class Op : uint8_t {
+            Eq, Ne, Lt, Le, Gt, Ge, Match, In, Nin
+        };
+
+        Kind kind = Kind::Exists;
+        Op op = Op::Eq;
+        std::vector<std::unique_ptr<Filter> > children;
+        Operand left;
+        Operand right;
+    };
+
+    namespace {
+        [[noreturn]] void syntaxError(const std::string &path, const std::string &message, const size_t pos) {
+            throw std::invalid_argument("Invalid json path '" + path + "': " + message + " at " + std::to_string(pos));
+        }
+
+        class PathParser {
+        public:
+            explicit PathParser(const std::string &path) : path(path) {
+            }
+
+            std::vector<Segment> parse() {
+                if (p < path.size() && path[p] == '$') p++;
+                else if (p < path.size() && path[p] == '@') p++;
+                auto segments = parseSegments(false);
+                skipSpace();
+                if (p != path.size()) error("unexpected character");
+                return segments;
+            }
+
+        private:
+            const std::string &path;
+            size_t p = 0;
+
+            [[noreturn]] void error(const std::string &message) const {
+                syntaxError(path, message, p);
+            }
+
+            void skipSpace() {
+                while (p < path.size() && path[p] == ' ') p++;
+            }
+
+            bool peekIs(const char c) const {
+                return p < path.size() && path[p] == c;
+            }
+
+            /**
+             * 解析 .name、..name、[...] 形式的路径
+             * @param inFilter 在过滤表达式中时，名称遇到运算符、空白与括号结束
+             */
+            std::vector<Segment> parseSegments(const bool inFilter) {
+                std::vector<Segment> segments;
+                while (p < path.size()) {
+                    Segment segment;
+                    if (path.compare(p, 2, "..") == 0) {
+                        segment.recursive = true;
+                        p += 2;
+                        if (peekIs('[')) {
+                            segment.selectors = parseBracket();
+                        } else {
+                            segment.selectors.push_back(parseName(inFilter));
+                        }
+                    } else if (peekIs('.')) {
+                        p++;
+                        segment.selectors.push_back(parseName(inFilter));
+                    } else if (peekIs('[')) {
+                        segment.selectors = parseBracket();
+                    } else {
+                        break;
+                    }
+                    segments.push_back(std::move(segment));
+                }
+                return segments;
+            }
+
+            Selector parseName(const bool inFilter) {
+                if (peekIs('*')) {
+                    p++;
+                    return {.kind = Selector::Kind::Wildcard};
+                }
+                const size_t begin = p;
+                while (p < path.size()) {
+                    const char c = path[p];
+                    if (c == '.' || c == '[' || c == '(') break;
+                    if (inFilter && std::strchr(" )=!<>&|,]", c) != nullptr) break;
+                    p++;
+                }
+                if (p == begin) error("expected property name");
+                if (peekIs('(')) error("functions are not supported");
+                Selector selector{.kind = Selector::Kind::Name};
+                selector.name = path.substr(begin, p - begin);
+                return selector;
+            }
+
+            std::string parseQuoted() {
+                const char quote = path[p++];
+                std::string result;
+                while (p < path.size() && path[p] != quote) {
+                    if (path[p] == '\\' && p + 1 < path.size()) p++;
+                    result += path[p++];
+                }
+                if (p >= path.size()) error("unterminated string");
+                p++;
+                return result;
+            }
+
+            std::optional<long> parseInt() {
+                skipSpace();
+                const size_t begin = p;
+                if (peekIs('-')) p++;
+                while (p < path.size() && std::isdigit(static_cast<unsigned char>(path[p]))) p++;
+                if (p == begin) return std::nullopt;
+                long value = 0;
+                const auto [end, ec] = std::from_chars(path.data() + begin, path.data() + p, value);
+                if (ec != std::errc() || end != path.data() + p) error("invalid index");
+                skipSpace();
+                return value;
+            }
+
+            std::vector<Selector> parseBracket() {
+                p++; // '['
+                skipSpace();
+                std::vector<Selector> selectors;
+                if (peekIs('*')) {
+                    p++;
+                    selectors.push_back({.kind = Selector::Kind::Wildcard});
+                } else if (peekIs('?')) {
+                    p++;
+                    skipSpace();
+                    if (!peekIs('(')) error("expected '(' after '?'");
+                    p++;
+                    Selector selector{.kind = Selector::Kind::Filter};
+                    selector.filter = parseOr();
+                    skipSpace();
+                    if (!peekIs(')')) error("expected ')'");
+                    p++;
+                    selectors.push_back(std::move(selector));
+                } else if (peekIs('\'') || peekIs('"')) {
+                    do {
+                        skipSpace();
+                        if (!peekIs('\'') && !peekIs('"')) error("expected quoted name");
+                        Selector selector{.kind = Selector::Kind::Name};
+                        selector.name = parseQuoted();
+                        selectors.push_back(std::move(selector));
+                        skipSpace();
+                    } while (peekIs(',') && ++p);
+                } else {
+                    do {
+                        const auto first = parseInt();
+                        if (peekIs(':')) {
+                            Selector selector{.kind = Selector::Kind::Slice};
+                            selector.start = first;
+                            p++;
+                            selector.end = parseInt();
+                            if (peekIs(':')) {
+                                p++;
+                                selector.step = parseInt().value_or(1);
+                                if (selector.step <= 0) error("slice step must be positive");
+                            }
+                            selectors.push_back(std::move(selector));
+                        } else {
+                            if (!first.has_value()) error("expected index");
+                            Selector selector{.kind = Selector::Kind::Index};
+                            selector.index = *first;
+                            selectors.push_back(std::move(selector));
+                        }
+                    } while (peekIs(',') && ++p);
+                }
+                skipSpace();
+                if (!peekIs(']')) error("expected ']'");
+                p++;
+                return selectors;
+            }
+
+            // ------------------------------------------------ 过滤表达式
+
+            std::unique_ptr<Filter> parseOr() {
+                auto left = parseAnd();
+                while (true) {
+                    skipSpace();
+                    if (path.compare(p, 2, "||") != 0) return left;
+                    p += 2;
+                    auto node = std::make_unique<Filter>();
+                    node->kind = Filter::Kind::Or;
+                    node->children.push_back(std::move(left));
+                    node->children.push_back(parseAnd());
+                    left = std::move(node);
+                }
+            }
+
+            std::unique_ptr<Filter> parseAnd() {
+                auto left = parseUnary();
+                while (true) {
+                    skipSpace();
+                    if (path.compare(p, 2, "&&") != 0) return left;
+                    p += 2;
+                    auto node = std::make_unique<Filter>();
+                    node->kind = Filter::Kind::And;
+                    node->children.push_back(std::move(left));
+                    node->children.push_back(parseUnary());
+                    left = std::move(node);
+                }
+            }
+
+            std::unique_ptr<Filter> parseUnary() {
+                skipSpace();
+                if (peekIs('!') && path.compare(p, 2, "!=") != 0) {
+                    p++;
+                    auto node = std::make_unique<Filter>();
+                    node->kind = Filter::Kind::Not;
+                    node->children.push_back(parseUnary());
+                    return node;
+                }
+                if (peekIs('(')) {
+                    p++;
+                    auto node = parseOr();
+                    skipSpace();
+                    if (!peekIs(')')) error("expected ')'");
+                    p++;
+                    return node;
+                }
+                auto node = std::make_unique<Filter>();
+                node->left = parseOperand();
+                skipSpace();
+                static const std::pair<const char *, Filter::Op> ops[] = {
+                    {"==", Filter::Op::Eq}, {"!=", Filter::Op::Ne}, {"<=", Filter::Op::Le}, {">=", Filter::Op::Ge},
+                    {"=~", Filter::Op::Match}, {"<", Filter::Op::Lt}, {">", Filter::Op::Gt},
+                    {"nin ", Filter::Op::Nin}, {"in ", Filter::Op::In},
+                };
+                for (const auto &[text, op]: ops) {
+                    if (path.compare(p, std::strlen(text), text) == 0) {
+                        p += std::strlen(text);
+                        node->kind = Filter::Kind::Compare;
+                        node->op = op;
+                        node->right = parseOperand();
+                        break;
+                    }
+                }
+                if (node->kind == Filter::Kind::Exists) {
+                    if (node->left.kind != Operand::Kind::Current && node->left.kind != Operand::Kind::Root) {
+                        error("expected path");
+                    }
+                } else if (node->op == Filter::Op::Match && node->right.kind != Operand::Kind::Regex) {
+                    error("expected regex after '=~'");
+                }
+                return node;
+            }
+
+            Operand parseOperand() {
+                skipSpace();
+                if (p >= path.size()) error("expected operand");
+                Operand operand;
+                const char c = path[p];
+                if (c == '@' || c == '$') {
+                    p++;
+                    operand.kind = c == '@' ? Operand::Kind::Current : Operand::Kind::Root;
+                    operand.path = parseSegments(true);
+                } else if (c == '/') {
+                    operand.kind = Operand::Kind::Regex;
+                    const size_t begin = ++p;
+                    while (p < path.size() && path[p] != '/') {
+                        if (path[p] == '\\') p++;
+                        p++;
+                    }
+                    if (p >= path.size()) error("unterminated regex");
+                    const std::string pattern = path.substr(begin, p - begin);
+                    p++;
+                    auto flags = std::regex::ECMAScript;
+                    while (p < path.size() && std::isalpha(static_cast<unsigned char>(path[p]))) {
+                        if (path[p] == 'i') flags |= std::regex::icase;
+                        p++;
+                    }
+                    try {
+                        operand.regex = std::make_shared<const std::regex>(pattern, flags);
+                    } catch (const std::regex_error &) {
+                        error("invalid regex");
+                    }
+                } else if (c == '[') {
+                    operand.kind = Operand::Kind::List;
+                    p++;
+                    skipSpace();
+                    while (!peekIs(']')) {
+                        operand.list.push_back(parseLiteral());
+                        skipSpace();
+                        if (peekIs(',')) p++;
+                        else if (!peekIs(']')) error("expected ',' or ']'");
+                        skipSpace();
+                    }
+                    p++;
+                } else {
+                    operand.literal = parseLiteral();
+                }
+                return operand;
+            }
+
+            Literal parseLiteral() {
+                skipSpace();
+                Literal literal;
+                if (peekIs('\'') || peekIs('"')) {
+                    literal.type = Value::Type::String;
+                    literal.str = parseQuoted();
+                    return literal;
+                }
+                for (const auto &[text, type]: {
+                         std::pair{"true", Value::Type::True}, std::pair{"false", Value::Type::False},
+                         std::pair{"null", Value::Type::Null}
+                     }) {
+                    if (path.compare(p, std::strlen(text), text) == 0) {
+                        p += std::strlen(text);
+                        literal.type = type;
+                        return literal;
+                    }
+                }
+                const char *begin = path.data() + p;
+                const auto [end, ec] = std::from_chars(begin, path.data() + path.size(), literal.number);
+                if (ec != std::errc()) error("expected literal");
+                p += end - begin;
+                literal.type = Value::Type::Number;
+                return literal;
+            }
+        };
+
+        // ---------------------------------------------------------------- 执行
+
+        void selectSegments(const std::vector<Segment> &segments, size_t from, Value current, Value root,
+                            std::vector<Value> &out);
+
+        std::vector<Value> selectPath(const std::vector<Segment> &segments, const Value current, const Value root) {
+            std::vector<Value> out;
+            selectSegments(segments, 0, current, root, out);
+            return out;
+        }
+
+        Literal literalOf(const Value v) {
+            Literal literal;
+            literal.type = v.type();
+            if (literal.type == Value::Type::Number) literal.number = v.getNumber();
+            else if (literal.type != Value::Type::Null) literal.str = v.getString();
+            return literal;
+        }
+
+        bool isBoolean(const Value::Type type) {
+            return type == Value::Type::True || type == Value::Type::False;
+        }
+
+        bool literalEquals(const Literal &a, const Literal &b) {
+            if (isBoolean(a.type) && isBoolean(b.type)) return a.type == b.type;
+            if (a.type != b.type) return false;
+            if (a.type == Value::Type::Number) return a.number == b.number;
+            return a.str == b.str;
+        }
+
+        bool compareLiterals(const Literal &a, const Literal &b, const Filter::Op op) {
+            switch (op) {
+                case Filter::Op::Eq:
+                    return literalEquals(a, b);
+                case Filter::Op::Ne:
+                    return !literalEquals(a, b);
+                default:
+                    break;
+            }
+            int order;
+            if (a.type == Value::Type::Number && b.type == Value::Type::Number) {
+                if (std::isnan(a.number) || std::isnan(b.number)) return false;
+                order = a.number < b.number ? -1 : a.number > b.number ? 1 : 0;
+            } else if (a.type == Value::Type::String && b.type == Value::Type::String) {
+                order = a.str.compare(b.str);
+            } else {
+                return false;
+            }
+            switch (op) {
+                case Filter::Op::Lt: return order < 0;
+                case Filter::Op::Le: return order <= 0;
+                case Filter::Op::Gt: return order > 0;
+                case Filter::Op::Ge: return order >= 0;
+                default: return false;
+            }
+        }
+
+        // 操作数的值，路径取第一个结果
+        std::optional<Literal> operandValue(const Operand &operand, const Value current, const Value root) {
+            if (operand.kind == Operand::Kind::Literal) return operand.literal;
+            if (operand.kind != Operand::Kind::Current && operand.kind != Operand::Kind::Root) return std::nullopt;
+            const auto values = selectPath(operand.path, operand.kind == Operand::Kind::Current ? current : root, root);
+            if (values.empty()) return std::nullopt;
+            return literalOf(values.front());
+        }
+
+        bool evaluate(const Filter &filter, const Value current, const Value root) {
+            switch (filter.kind) {
+                case Filter::Kind::Or:
+                    return evaluate(*filter.children[0], current, root) || evaluate(*filter.children[1], current, root);
+                case Filter::Kind::And:
+                    return evaluate(*filter.children[0], current, root) && evaluate(*filter.children[1], current, root);
+                case Filter::Kind::Not:
+                    return !evaluate(*filter.children[0], current, root);
+                case Filter::Kind::Exists: {
+                    const Value start = filter.left.kind == Operand::Kind::Current ? current : root;
+                    return !selectPath(filter.left.path, start, root).empty();
+                }
+                case Filter::Kind::Compare:
+                    break;
+            }
+            const auto left = operandValue(filter.left, current, root);
+            if (!left.has_value()) return false;
+            switch (filter.op) {
+                case Filter::Op::Match:
+                    return left->type == Value::Type::String && std::regex_match(left->str, *filter.right.regex);
+                case Filter::Op::In:
+                case Filter::Op::Nin: {
+                    bool found = false;
+                    if (filter.right.kind == Operand::Kind::List) {
+                        found = std::ranges::any_of(filter.right.list, [&](const Literal &l) { return literalEquals(*left, l); });
+                    } else if (filter.right.kind == Operand::Kind::Current || filter.right.kind == Operand::Kind::Root) {
+                        const Value start = filter.right.kind == Operand::Kind::Current ? current : root;
+                        for (const Value array: selectPath(filter.right.path, start, root)) {
+                            array.forEach([&](std::string_view, const Value v) {
+                                found = literalEquals(*left, literalOf(v));
+                                return !found;
+                            });
+                            if (found) break;
+                        }
+                    }
+                    return found == (filter.op == Filter::Op::In);
+                }
+                default: {
+                    const auto right = operandValue(filter.right, current, root);
+                    return right.has_value() && compareLiterals(*left, *right, filter.op);
+                }
+            }
+        }
+
+        bool keyEquals(const Value v, const std::string_view key, const std::string &name) {
+            if (v.getDocument()->entry(v.getIndex() - 1).escaped) return unescape(key) == name;
+            return key == name;
+        }
+
+        // 对单个值执行一组选择器
+        template<typename Emit>
+        void applySelectors(const std::vector<Selector> &selectors, const Value value, const Value root, Emit &&emit) {
+            for (const Selector &selector: selectors) {
+                switch (selector.kind) {
+                    case Selector::Kind::Name:
+                        if (value.isObject()) {
+                            value.forEach([&](const std::string_view key, const Value v) {
+                                if (!keyEquals(v, key, selector.name)) return true;
+                                emit(v);
+                                return false;
+                            });
+                        }
+                        break;
+                    case Selector::Kind::Wildcard:
+                        value.forEach([&](std::string_view, const Value v) {
+                            emit(v);
+                            return true;
+                        });
+                        break;
+                    case Selector::Kind::Index:
+                        if (const Value v = value.at(selector.index); v.valid()) emit(v);
+                        break;
+                    case Selector::Kind::Slice: {
+                        if (!value.isArray()) break;
+                        const auto len = static_cast<long>(value.size());
+                        auto clamp = [&](const std::optional<long> &x, const long def) {
+                            if (!x.has_value()) return def;
+                            const long i = *x < 0 ? *x + len : *x;
+                            return std::clamp(i, 0L, len);
+                        };
+                        const long start = clamp(selector.start, 0);
+                        const long end = clamp(selector.end, len);
+                        long i = 0;
+                        value.forEach([&](std::string_view, const Value v) {
+                            if (i >= end) return false;
+                            if (i >= start && (i - start) % selector.step == 0) emit(v);
+                            i++;
+                            return true;
+                        });
+                        break;
+                    }
+                    case Selector::Kind::Filter:
+                        // 数组按元素过滤，对象按自身过滤，与Jayway一致
+                        if (value.isArray()) {
+                            value.forEach([&](std::string_view, const Value v) {
+                                if (evaluate(*selector.filter, v, root)) emit(v);
+                                return true;
+                            });
+                        } else if (value.isObject() && evaluate(*selector.filter, value, root)) {
+                            emit(value);
+                        }
+                        break;
+                }
+            }
+        }
+
+        // '..'：value本身及其全部后代，先序
+        template<typename Visit>
+        void forSelfAndDescendants(const Value value, Visit &&visit) {
+            visit(value);
+            value.forEach([&](std::string_view, const Value v) {
+                forSelfAndDescendants(v, visit);
+                return true;
+            });
+        }
+
+        void selectSegments(const std::vector<Segment> &segments, const size_t from, const Value current, const Value root,
+                            std::vector<Value> &out) {
+            if (from == segments.size()) {
+                out.push_back(current);
+                return;
+            }
+            const Segment &segment = segments[from];
+            auto next = [&](const Value v) { selectSegments(segments, from + 1, v, root, out); };
+            if (segment.recursive) {
+                forSelfAndDescendants(current, [&](const Value v) { applySelectors(segment.selectors, v, root, next); });
+            } else {
+                applySelectors(segment.selectors, current, root, next);
+            }
+        }
+    }
+
+    std::shared_ptr<const Path> Path::parse(const std::string &path) {
+        std::string normalized = path;
+        // 与Jayway一致，不以$或@开头时补上'$.'
+        if (!normalized.starts_with("$") && !normalized.starts_with("@")) {
+            normalized = (normalized.starts_with("[") ? "$" : "$.") + normalized;
+        }
+        return std::make_shared<const Path>(PathParser(normalized).parse());
+    }
+
+    std::shared_ptr<const Path> Path::compile(const std::string &path) {
+        static std::mutex mutex;
+        static std::unordered_map<std::string, std::shared_ptr<const Path> > cache;
+        constexpr size_t maxCacheSize = 4096;
+        {
+            std::lock_guard lock(mutex);
+            if (const auto it = cache.find(path); it != cache.end()) return it->second;
+        }
+        std::shared_ptr<const Path> compiled = nullptr;
+        try {
+            compiled = parse(path);
+        } catch (const std::invalid_argument &) {
+            compiled = nullptr;
+        }
+        std::lock_guard lock(mutex);
+        if (cache.size() >= maxCacheSize) cache.clear();
+        cache.emplace(path, compiled);
+        return compiled;
+    }
+
+    Path::Path(std::vector<Segment> segments) : segments(std::move(segments)) {
+        definite = std::ranges::all_of(this->segments, [](const Segment &segment) {
+            return !segment.recursive && segment.selectors.size() == 1 &&
+                   (segment.selectors[0].kind == Selector::Kind::Name || segment.selectors[0].kind == Selector::Kind::Index);
+        });
+    }
+
+    Path::~Path() = default;
+
+    std::vector<Value> Path::select(const Value root) const {
+        std::vector<Value> out;
+        if (root.valid()) selectSegments(segments, 0, root, root, out);
+        return out;
+    }
+
+    // ---------------------------------------------------------------- stream
+
+    StreamScanner::StreamScanner(std::vector<std::string> keys, const bool members, ItemHandler onItem)
+        : keys(std::move(keys)), members(members), onItem(std::move(onItem)) {
+    }
+
+    void StreamScanner::feed(const std::string_view data) {
+        // 已扫描且不再需要的内容超过一半时才丢弃，避免频繁移动
+        if (const size_t drop = std::min(released - std::min(released, base), pos); drop > 0 && drop * 2 >= buffer.size()) {
+            buffer.erase(0, drop);
+            base += drop;
+            pos -= drop;
+        }
+        buffer.append(data);
+        scan(false);
+    }
+
+    void StreamScanner::finish() {
+        scan(true);
+        // 内容不完整，不是合法的json
+        if (!stack.empty()) error = true;
+    }
+
+    std::string_view StreamScanner::slice(const size_t begin, const size_t end) const {
+        return std::string_view(buffer).substr(begin - base, end - begin);
+    }
+
+    void StreamScanner::release(const size_t offset) {
+        released = std::max(released, offset);
+    }
+
+    bool StreamScanner::inList() const {
+        if (stack.size() != keys.size() + 1) return false;
+        const Frame &frame = stack.back();
+        return frame.onPath && !(frame.object && frame.expectKey);
+    }
+
+    void StreamScanner::beginValue(const size_t at) {
+        if (inList()) itemBegin = at;
+    }
+
+    void StreamScanner::endValue(const size_t end) {
+        if (inList()) onItem(itemBegin, end);
+    }
+
+    void StreamScanner::scan(const bool eof) {
+        const size_t n = buffer.size();
+        while (pos < n && !error) {
+            const char c = buffer[pos];
+            switch (c) {
+                case ' ': case '\t': case '\n': case '\r': case ':':
+                    pos++;
+                    break;
+                case ',':
+                    if (!stack.empty() && stack.back().object) stack.back().expectKey = true;
+                    pos++;
+                    break;
+                case '{': case '[': {
+                    beginValue(base + pos);
+                    Frame frame{c == '{', c == '{', stack.empty(), {}};
+                    if (!stack.empty()) {
+                        const Frame &parent = stack.back();
+                        frame.onPath = parent.onPath && parent.object && stack.size() <= keys.size() &&
+                                       parent.key == keys[stack.size() - 1];
+                    }
+                    // 路径对应的是对象且不取成员值时，完整解析的结果是对象本身
+                    if (frame.onPath && frame.object && !members && stack.size() == keys.size()) error = true;
+                    stack.push_back(std::move(frame));
+                    pos++;
+                    break;
+                }
+                case '}': case ']':
+                    if (stack.empty() || stack.back().object != (c == '}')) {
+                        error = true;
+                        break;
+                    }
+                    stack.pop_back();
+                    pos++;
+                    endValue(base + pos);
+                    break;
+                case '"': {
+                    size_t p = pos + 1;
+                    while (p < n && buffer[p] != '"') p += buffer[p] == '\\' ? 2 : 1;
+                    if (p >= n) {
+                        if (!eof) return;
+                        error = true;
+                        break;
+                    }
+                    if (!stack.empty() && stack.back().object && stack.back().expectKey) {
+                        const std::string_view raw(buffer.data() + pos + 1, p - pos - 1);
+                        stack.back().key = raw.find('\\') == std::string_view::npos ? std::string(raw) : unescape(raw);
+                        stack.back().expectKey = false;
+                    } else {
+                        beginValue(base + pos);
+                        endValue(base + p + 1);
+                    }
+                    pos = p + 1;
+                    break;
+                }
+                default: {
+                    // 数字、true、false、null
+                    if (c != '-' && c != 't' && c != 'f' && c != 'n' && (c < '0' || c > '9')) {
+                        error = true;
+                        break;
+                    }
+                    size_t p = pos + 1;
+                    while (p < n && std::strchr(" \t\r\n,]}:", buffer[p]) == nullptr) p++;
+                    if (p >= n && !eof) return;
+                    beginValue(base + pos);
+                    endValue(base + p);
+                    pos = p;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+using JsonPath::Value;
+
+namespace {
+    std::string trim(const std::string &s) {
+        size_t begin = 0;
+        while (begin < s.size() && static_cast<unsigned char>(s[begin]) <= ' ') begin++;
+        size_t end = s.size();
+        while (end > begin && static_cast<unsigned char>(s[end - 1]) <= ' ') end--;
+        return s.substr(begin, end - begin);
+    }
+
+    template<typename T>
+    std::vector<T> mergeResults(std::vector<std::vector<T> > &results, const std::string &elementsType) {
+        std::vector<T> merged;
+        if (results.empty()) return merged;
+        if (elementsType == "%%") {
+            // 交替合并
+            for (size_t i = 0; i < results[0].size(); i++) {
+                for (auto &temp: results) {
+                    if (i < temp.size()) merged.push_back(std::move(temp[i]));
+                }
+            }
+        } else {
+            for (auto &temp: results) {
+                std::move(temp.begin(), temp.end(), std::back_inserter(merged));
+            }
+        }
+        return merged;
+    }
+
+    /**
+     * 按 '&&'、'||'、'%%' 拆分规则，对每一部分执行 single 后合并结果
+     */
+    template<typename T, typename Single>
+    std::vector<T> evaluateRule(const std::string &rule, Single &&single) {
+        if (rule.empty()) return {};
+        // 大多数规则没有分隔符，不需要经过RuleAnalyzer
+        if (rule.find_first_of("&|%") == std::string::npos) return single(rule);
+        RuleAnalyzer ruleAnalyzes(rule, true);
+        const auto rules = ruleAnalyzes.splitRule({"&&", "||", "%%"});
+        if (rules.size() == 1) return single(rules[0]);
+        std::vector<std::vector<T> > results;
+        for (const auto &rl: rules) {
+            auto temp = evaluateRule<T>(rl, single);
+            if (temp.empty()) continue;
+            results.push_back(std::move(temp));
+            if (ruleAnalyzes.elementsType == "||") break;
+        }
+        return mergeResults(results, ruleAnalyzes.elementsType);
+    }
+
+    /**
+     * 执行单个JSONPath，确定路径的结果为数组时返回数组的元素，与Jayway的read一致
+     */
+    std::vector<Value> read(const std::string &rule, const Value value) {
+        const auto path = JsonPath::Path::compile(trim(rule));
+        if (path == nullptr) return {};
+        auto values = path->select(value);
+        if (path->isDefinite() && values.size() == 1 && values[0].isArray()) return values[0].children();
+        return values;
+    }
+}
+
+AnalyzeByJSonPath::AnalyzeByJSonPath(const std::string &json)
+    : document(JsonPath::Document::parse(json)), value(document->root()) {
+}
+
+AnalyzeByJSonPath::AnalyzeByJSonPath(std::shared_ptr<const JsonPath::Document> document, const Value value)
+    : document(std::move(document)), value(value.valid() ? value : this->document->root()) {
+}
+
+std::optional<std::string> AnalyzeByJSonPath::getString(const std::string &rule) const {
+    const auto list = getStringList(rule);
+    if (list.empty()) return std::nullopt;
+    std::string result;
+    for (const auto &s: list) {
+        if (!result.empty()) result += '\n';
+        result += s;
+    }
+    return result;
+}
+
+std::vector<std::string> AnalyzeByJSonPath::getStringList(const std::string &rule) const {
+    return evaluateRule<std::string>(rule, [&](const std::string &rl) -> std::vector<std::string> {
+        if (rl.find("{$.") != std::string::npos) {
+            // 内嵌规则，如 {$.name}（{$.author}），替换为各自的结果
+            RuleAnalyzer analyzer(rl, true);
+            return {analyzer.innerRuleCode("{$.", 1, 1, [&](const std::string &inner) {
+                return getString(inner).value_or("");
+            })};
+        }
+        std::vector<std::string> result;
+        for (const Value v: read(rl, value)) {
+            if (!v.isNull()) result.push_back(v.getString());
+        }
+        return result;
+    });
+}
+
+std::vector<Value> AnalyzeByJSonPath::getList(const std::string &rule) const {
+    return evaluateRule<Value>(rule, [&](const std::string &rl) { return read(rl, value); });
+}
+
+Value AnalyzeByJSonPath::getObject(const std::string &rule) const {
+    const auto path = JsonPath::Path::compile(trim(rule));
+    if (path == nullptr) return {};
+    const auto values = path->select(value);
+    return values.empty() ? Value{} : values.front();
+}
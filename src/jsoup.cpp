@@ -0,0 +1,456 @@
+#include <booksource/jsoup.h>
+#include <booksource/rule.h>
+#include <booksource/css.h>
+#include <algorithm>
+#include <variant>
+
+using Html::Node;
+using Html::Elements;
+
+namespace {
+    std::string trimRule(const std::string &s) {
+        size_t begin = 0;
+        while (begin < s.size() && static_cast<unsigned char>(s[begin]) <= ' ') begin++;
+        size_t end = s.size();
+        while (end > begin && static_cast<unsigned char>(s[end - 1]) <= ' ') end--;
+        return s.substr(begin, end - begin);
+    }
+
+    std::string toLower(std::string s) {
+        std::ranges::transform(s, s.begin(), [](const unsigned char c) { return std::tolower(c); });
+        return s;
+    }
+
+    // 标签名比较，xml文档中的标签名保留了大小写
+    bool tagIs(const Node *node, const std::string &lowerTag) {
+        if (node->name.size() != lowerTag.size()) return false;
+        for (size_t i = 0; i < lowerTag.size(); i++) {
+            if (std::tolower(static_cast<unsigned char>(node->name[i])) != lowerTag[i]) return false;
+        }
+        return true;
+    }
+
+    // 去掉规则开头多余的'@'以及空白字符
+    std::string trimLeadingAt(const std::string &rule) {
+        size_t p = 0;
+        while (p < rule.size() && (rule[p] == '@' || static_cast<unsigned char>(rule[p]) < '!')) p++;
+        return rule.substr(p);
+    }
+
+    /**
+     * 先序遍历root及其全部后代元素（包含root本身），与jsoup的getElementsByXxx一致
+     */
+    template<typename Pred>
+    Elements collect(const Node *root, Pred &&pred) {
+        Elements result;
+        const Node *node = root;
+        while (node != nullptr) {
+            if (node->isElement() && pred(node)) result.push_back(node);
+            if (node->firstChild != nullptr) {
+                node = node->firstChild;
+                continue;
+            }
+            while (node != root && node->next == nullptr) node = node->parent;
+            if (node == root) break;
+            node = node->next;
+        }
+        return result;
+    }
+
+    // 执行css选择器，选择器只编译一次，语法错误时没有结果
+    Elements select(const Node *root, const std::string &css) {
+        const auto selector = Css::Selector::compile(css);
+        return selector != nullptr ? selector->select(root) : Elements{};
+    }
+
+    /**
+     * 单级规则，支持索引：
+     * 1. 阅读原有写法，':'分隔索引，'!'或'.'表示筛选方式，索引可为负数，如 tag.div.-1:10:2 或 tag.div!0:3
+     * 2. 与jsonPath类似的[]索引写法，格式形如 [it,it,...] 或 [!it,it,...]，其中[!开头表示排除，
+     *    it为单个索引或区间，区间格式为 start:end 或 start:end:step，start为0时可省略，end为-1时可省略，
+     *    索引、区间两端及间隔都支持负数，如 tag.div[-1, 3:-2:-10, 2]，特殊用法 tag.div[-1:0] 可以让列表反向
+     */
+    class ElementsSingle {
+    public:
+        Elements getElementsSingle(const Node *temp, const std::string &rule) {
+            findIndexSet(rule);
+            Elements elements;
+            if (beforeRule.empty()) {
+                // 允许索引直接作为根元素，此时前置规则为空，效果与children相同
+                elements = temp->children();
+            } else {
+                const size_t dot = beforeRule.find('.');
+                const std::string type = beforeRule.substr(0, dot);
+                const std::string name = dot == std::string::npos ? "" : beforeRule.substr(dot + 1, beforeRule.find('.', dot + 1) - dot - 1);
+                if (type == "children") {
+                    elements = temp->children();
+                } else if (dot != std::string::npos && type == "class") {
+                    elements = collect(temp, [&](const Node *n) { return n->hasClass(name); });
+                } else if (dot != std::string::npos && type == "tag") {
+                    const std::string tag = toLower(name);
+                    elements = collect(temp, [&](const Node *n) { return tagIs(n, tag); });
+                } else if (dot != std::string::npos && type == "id") {
+                    elements = collect(temp, [&](const Node *n) { return n->id() == name; });
+                } else if (dot != std::string::npos && type == "text") {
+                    const std::string text = toLower(name);
+                    elements = collect(temp, [&](const Node *n) {
+                        return toLower(n->ownText()).find(text) != std::string::npos;
+                    });
+                } else {
+                    elements = select(temp, beforeRule);
+                }
+            }
+            return filter(std::move(elements));
+        }
+
+    private:
+        struct Range {
+            std::optional<int> start;
+            std::optional<int> end;
+            int step;
+        };
+
+        char split = '.';
+        std::string beforeRule;
+        std::vector<int> indexDefault;
+        std::vector<std::variant<int, Range> > indexes;
+
+        Elements filter(Elements elements) const {
+            if (split != '.' && split != '!') return elements;
+            const int len = static_cast<int>(elements.size());
+            if (len == 0) return elements;
+            // 无重且不越界的索引，保持插入顺序
+            std::vector<int> indexSet;
+            std::vector<bool> seen(len, false);
+            auto add = [&](const int i) {
+                if (i >= 0 && i < len && !seen[i]) {
+                    seen[i] = true;
+                    indexSet.push_back(i);
+                }
+            };
+            auto normalize = [&](const int i) {
+                if (i >= 0 && i < len) add(i);
+                else if (i < 0 && len >= -i) add(i + len);
+            };
+            // 索引是逆向解析的，这里逆向遍历以还原顺序
+            if (indexes.empty()) {
+                for (int ix = static_cast<int>(indexDefault.size()) - 1; ix >= 0; ix--) {
+                    normalize(indexDefault[ix]);
+                }
+            } else {
+                for (int ix = static_cast<int>(indexes.size()) - 1; ix >= 0; ix--) {
+                    if (const auto *index = std::get_if<int>(&indexes[ix])) {
+                        normalize(*index);
+                        continue;
+                    }
+                    const auto &[startX, endX, stepX] = std::get<Range>(indexes[ix]);
+                    auto clamp = [&](const std::optional<int> &x, const int def) {
+                        if (!x.has_value()) return def;
+                        if (*x >= 0) return *x < len ? *x : len - 1;
+                        return -*x <= len ? len + *x : 0;
+                    };
+                    const int start = clamp(startX, 0);
+                    const int end = clamp(endX, len - 1);
+                    if (start == end || stepX >= len) {
+                        add(start);
+                        continue;
+                    }
+                    const int step = stepX > 0 ? stepX : -stepX < len ? stepX + len : 1;
+                    if (end > start) {
+                        for (int i = start; i <= end; i += step) add(i);
+                    } else {
+                        for (int i = start; i >= end; i -= step) add(i);
+                    }
+                }
+            }
+            Elements result;
+            if (split == '!') {
+                for (int i = 0; i < len; i++) {
+                    if (!seen[i]) result.push_back(elements[i]);
+                }
+            } else {
+                for (const int i: indexSet) result.push_back(elements[i]);
+            }
+            return result;
+        }
+
+        static std::optional<int> toInt(const std::string &digits, const bool minus) {
+            if (digits.empty()) return std::nullopt;
+            const int value = std::stoi(digits);
+            return minus ? -value : value;
+        }
+
+        void findIndexSet(const std::string &rule) {
+            const std::string rus = trimRule(rule);
+            std::string l; // 暂存数字
+            bool curMinus = false;
+            std::vector<std::optional<int> > curList; // 当前数字区间
+            if (!rus.empty() && rus.back() == ']') {
+                // []索引写法，逆向遍历，可以没有前置规则
+                for (int len = static_cast<int>(rus.size()) - 2; len >= 0; len--) {
+                    char rl = rus[len];
+                    if (rl == ' ') continue;
+                    if (rl >= '0' && rl <= '9') {
+                        l.insert(l.begin(), rl);
+                        continue;
+                    }
+                    if (rl == '-') {
+                        curMinus = true;
+                        continue;
+                    }
+                    const auto curInt = toInt(l, curMinus);
+                    if (rl == ':') {
+                        curList.push_back(curInt);
+                    } else {
+                        // 为保证查找顺序，区间和单个索引都添加到同一集合
+                        if (curList.empty()) {
+                            // 是css选择器而非索引列表
+                            if (!curInt.has_value()) break;
+                            indexes.emplace_back(*curInt);
+                        } else {
+                            // 最后压入的是区间右端，有间隔时第一个压入的是间隔
+                            const int step = curList.size() == 2 ? curList.front().value_or(1) : 1;
+                            indexes.emplace_back(Range{curInt, curList.back(), step});
+                            curList.clear();
+                        }
+                        if (rl == '!') {
+                            split = '!';
+                            while (len > 0) {
+                                rl = rus[--len];
+                                if (rl != ' ') break;
+                            }
+                        }
+                        if (rl == '[') {
+                            beforeRule = rus.substr(0, len);
+                            return;
+                        }
+                        if (rl != ',') break;
+                    }
+                    l.clear();
+                    curMinus = false;
+                }
+            } else {
+                // 阅读原有写法，逆向遍历，可以没有前置规则
+                for (int len = static_cast<int>(rus.size()) - 1; len >= 0; len--) {
+                    const char rl = rus[len];
+                    if (rl == ' ') continue;
+                    if (rl >= '0' && rl <= '9') {
+                        l.insert(l.begin(), rl);
+                        continue;
+                    }
+                    if (rl == '-') {
+                        curMinus = true;
+                        continue;
+                    }
+                    if ((rl == '!' || rl == '.' || rl == ':') && !l.empty()) {
+                        indexDefault.push_back(*toInt(l, curMinus));
+                        if (rl != ':') {
+                            split = rl;
+                            beforeRule = rus.substr(0, len);
+                            return;
+                        }
+                    } else {
+                        break;
+                    }
+                    l.clear();
+                    curMinus = false;
+                }
+            }
+            split = ' ';
+            beforeRule = rus;
+        }
+    };
+
+    struct JSoupSourceRule {
+        bool isCss = false;
+        std::string elementsRule;
+
+        explicit JSoupSourceRule(const std::string &ruleStr) {
+            if (StringUtils::startsWithIgnoreCase(ruleStr, "@CSS:")) {
+                isCss = true;
+                elementsRule = trimRule(ruleStr.substr(5));
+            } else {
+                elementsRule = ruleStr;
+            }
+        }
+    };
+
+    void appendOuterHtml(std::string &out, const Elements &elements, const bool skipScript) {
+        for (const Node *e: elements) {
+            if (!out.empty()) out += '\n';
+            e->appendOuterHtml(out, skipScript);
+        }
+    }
+
+    // 根据最后一级规则获取内容
+    std::vector<std::string> getResultLast(const Elements &elements, const std::string &lastRule) {
+        std::vector<std::string> textS;
+        if (lastRule == "text") {
+            for (const Node *e: elements) {
+                if (std::string text = e->text(); !text.empty()) textS.push_back(std::move(text));
+            }
+        } else if (lastRule == "textNodes") {
+            for (const Node *e: elements) {
+                std::string joined;
+                for (const Node *item: e->textNodes()) {
+                    std::string text = trimRule(item->textNodeText());
+                    if (text.empty()) continue;
+                    if (!joined.empty()) joined += '\n';
+                    joined += text;
+                }
+                if (!joined.empty()) textS.push_back(std::move(joined));
+            }
+        } else if (lastRule == "ownText") {
+            for (const Node *e: elements) {
+                if (std::string text = e->ownText(); !text.empty()) textS.push_back(std::move(text));
+            }
+        } else if (lastRule == "html") {
+            // 去掉script与style
+            std::string html;
+            appendOuterHtml(html, elements, true);
+            if (!html.empty()) textS.push_back(std::move(html));
+        } else if (lastRule == "all") {
+            std::string html;
+            appendOuterHtml(html, elements, false);
+            textS.push_back(std::move(html));
+        } else {
+            std::string key = toLower(lastRule);
+            // 没有baseUrl，abs:前缀的绝对地址由AnalyzeRule统一处理
+            if (key.starts_with("abs:")) key = key.substr(4);
+            for (const Node *e: elements) {
+                const std::string_view value = e->attr(key);
+                if (std::ranges::all_of(value, [](const unsigned char c) { return std::isspace(c); })) continue;
+                if (std::ranges::find(textS, value) != textS.end()) continue;
+                textS.emplace_back(value);
+            }
+        }
+        return textS;
+    }
+
+    template<typename T>
+    std::vector<T> mergeResults(std::vector<std::vector<T> > &results, const std::string &elementsType) {
+        std::vector<T> merged;
+        if (results.empty()) return merged;
+        if (elementsType == "%%") {
+            // 交替合并
+            for (size_t i = 0; i < results[0].size(); i++) {
+                for (auto &temp: results) {
+                    if (i < temp.size()) merged.push_back(std::move(temp[i]));
+                }
+            }
+        } else {
+            for (auto &temp: results) {
+                std::move(temp.begin(), temp.end(), std::back_inserter(merged));
+            }
+        }
+        return merged;
+    }
+
+    Elements getElements(const Node *temp, const std::string &rule) {
+        if (temp == nullptr || rule.empty()) return {};
+        const JSoupSourceRule sourceRule(rule);
+        RuleAnalyzer ruleAnalyzes(sourceRule.elementsRule);
+        const auto ruleStrS = ruleAnalyzes.splitRule({"&&", "||", "%%"});
+        std::vector<Elements> elementsList;
+        for (const auto &ruleStr: ruleStrS) {
+            Elements el;
+            if (sourceRule.isCss) {
+                el = select(temp, ruleStr);
+            } else {
+                RuleAnalyzer rsRule(trimLeadingAt(ruleStr));
+                if (const auto rs = rsRule.splitRule({"@"}); rs.size() > 1) {
+                    el.push_back(temp);
+                    for (const auto &rl: rs) {
+                        Elements es;
+                        for (const Node *et: el) {
+                            auto sub = getElements(et, rl);
+                            es.insert(es.end(), sub.begin(), sub.end());
+                        }
+                        el = std::move(es);
+                    }
+                } else {
+                    el = ElementsSingle().getElementsSingle(temp, ruleStr);
+                }
+            }
+            const bool found = !el.empty();
+            elementsList.push_back(std::move(el));
+            if (found && ruleAnalyzes.elementsType == "||") break;
+        }
+        return mergeResults(elementsList, ruleAnalyzes.elementsType);
+    }
+
+    // 获取内容列表
+    std::vector<std::string> getResultList(const Node *element, const std::string &ruleStr) {
+        if (ruleStr.empty()) return {};
+        Elements elements{element};
+        RuleAnalyzer rule(trimLeadingAt(ruleStr));
+        const auto rules = rule.splitRule({"@"});
+        const size_t last = rules.size() - 1;
+        for (size_t i = 0; i < last; i++) {
+            Elements es;
+            for (const Node *elt: elements) {
+                auto sub = ElementsSingle().getElementsSingle(elt, rules[i]);
+                es.insert(es.end(), sub.begin(), sub.end());
+            }
+            elements = std::move(es);
+        }
+        if (elements.empty()) return {};
+        return getResultLast(elements, rules[last]);
+    }
+}
+
+AnalyzeByJSoup::AnalyzeByJSoup(const std::string &html)
+    : document(Html::Document::parse(html, StringUtils::startsWithIgnoreCase(trimRule(html.substr(0, 64)), "<?xml"))),
+      element(document->root()) {
+}
+
+AnalyzeByJSoup::AnalyzeByJSoup(std::shared_ptr<const Html::Document> document, const Html::Node *element)
+    : document(std::move(document)), element(element != nullptr ? element : this->document->root()) {
+}
+
+Elements AnalyzeByJSoup::getElements(const std::string &rule) const {
+    return ::getElements(element, rule);
+}
+
+std::optional<std::string> AnalyzeByJSoup::getString(const std::string &rule) const {
+    if (rule.empty()) return std::nullopt;
+    const auto list = getStringList(rule);
+    if (list.empty()) return std::nullopt;
+    std::string result;
+    for (const auto &s: list) {
+        if (!result.empty()) result += '\n';
+        result += s;
+    }
+    return result;
+}
+
+std::string AnalyzeByJSoup::getString0(const std::string &rule) const {
+    auto list = getStringList(rule);
+    return list.empty() ? "" : std::move(list[0]);
+}
+
+std::vector<std::string> AnalyzeByJSoup::getStringList(const std::string &rule) const {
+    if (rule.empty()) return {};
+    const JSoupSourceRule sourceRule(rule);
+    if (sourceRule.elementsRule.empty()) {
+        return {element->data()};
+    }
+    RuleAnalyzer ruleAnalyzes(sourceRule.elementsRule);
+    const auto ruleStrS = ruleAnalyzes.splitRule({"&&", "||", "%%"});
+    std::vector<std::vector<std::string> > results;
+    for (const auto &ruleStrX: ruleStrS) {
+        std::vector<std::string> temp;
+        if (sourceRule.isCss) {
+            if (const size_t lastIndex = ruleStrX.rfind('@'); lastIndex != std::string::npos) {
+                temp = getResultLast(select(element, ruleStrX.substr(0, lastIndex)), ruleStrX.substr(lastIndex + 1));
+            }
+        } else {
+            temp = getResultList(element, ruleStrX);
+        }
+        if (!temp.empty()) {
+            results.push_back(std::move(temp));
+            if (ruleAnalyzes.elementsType == "||") break;
+        }
+    }
+    return mergeResults(results, ruleAnalyzes.elementsType);
+}
@@ -0,0 +1,355 @@
+#include <booksource/liststream.h>
+#include <booksource/utils.h>
+#include <algorithm>
+
+namespace {
+    bool isBlank(const char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    std::string trim(const std::string &s) {
+        size_t begin = 0;
+        while (begin < s.size() && static_cast<unsigned char>(s[begin]) <= ' ') begin++;
+        size_t end = s.size();
+        while (end > begin && static_cast<unsigned char>(s[end - 1]) <= ' ') end--;
+        return s.substr(begin, end - begin);
+    }
+
+    bool isNameChar(const char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-';
+    }
+
+    // 名称以字母或'_'开头，避免与 tag.div.0 这样的索引混淆
+    bool isName(const std::string_view name) {
+        return !name.empty() && (std::isalpha(static_cast<unsigned char>(name[0])) || name[0] == '_') &&
+               std::ranges::all_of(name, isNameChar);
+    }
+
+    // 需要执行js、拼接、替换的规则，AllInOne的正则规则，以及合并多个规则的结果
+    bool hasEval(const std::string &rule) {
+        if (rule.starts_with(':')) return true;
+        std::string lower = rule;
+        std::ranges::transform(lower, lower.begin(), [](const unsigned char c) { return std::tolower(c); });
+        return std::ranges::any_of(std::initializer_list<std::string_view>{
+            "{{", "##", "@js:", "<js>", "@put:", "@get:", "&&", "||", "%%"
+        }, [&](const std::string_view mark) { return lower.find(mark) != std::string::npos; });
+    }
+
+    /**
+     * 默认规则 class.x@tag.y@id.z 转换为只有标签、class、id的复合选择器
+     */
+    bool parseSteps(const std::string &rule, std::vector<Css::Compound> &steps) {
+        steps.clear();
+        size_t start = 0;
+        while (true) {
+            size_t end = rule.find('@', start);
+            if (end == std::string::npos) end = rule.size();
+            const std::string step = trim(rule.substr(start, end - start));
+            const size_t dot = step.find('.');
+            if (dot == std::string::npos) {
+                steps.clear();
+                return false;
+            }
+            const std::string type = step.substr(0, dot);
+            const std::string name = step.substr(dot + 1);
+            if (!isName(name)) {
+                steps.clear();
+                return false;
+            }
+            Css::Compound compound;
+            if (type == "tag") {
+                compound.tag = name;
+                std::ranges::transform(compound.tag, compound.tag.begin(),
+                                       [](const unsigned char c) { return std::tolower(c); });
+            } else if (type == "class" || type == "id") {
+                Css::Test test;
+                test.kind = type == "class" ? Css::Test::Kind::Class : Css::Test::Kind::Id;
+                test.name = name;
+                compound.tests.push_back(std::move(test));
+            } else {
+                steps.clear();
+                return false;
+            }
+            steps.push_back(std::move(compound));
+            if (end == rule.size()) return true;
+            start = end + 1;
+        }
+    }
+
+    // 结尾可能是 .0、!0:3 或者 [-1, 2] 这样的索引
+    bool hasIndex(const std::string &rule) {
+        if (rule.empty() || std::isdigit(static_cast<unsigned char>(rule.back()))) return true;
+        if (rule.back() != ']') return false;
+        const size_t open = rule.rfind('[');
+        return open == std::string::npos || rule.find_first_not_of("0123456789-:,! ", open + 1) == rule.size() - 1;
+    }
+
+    // 每组只有局部条件以及后代、子元素组合器，组合器的匹配状态用64位掩码记录
+    bool isStreamable(const Css::Selector &selector) {
+        return std::ranges::all_of(selector.getGroups(), [](const Css::Complex &complex) {
+            return complex.compounds.size() <= 64 && std::ranges::all_of(complex.compounds, [](const Css::Compound &c) {
+                return Css::isLocal(c) && (c.combinator == Css::Combinator::Descendant ||
+                                           c.combinator == Css::Combinator::Child);
+            });
+        });
+    }
+
+    /**
+     * JSONPath $.a.b、$.a.b[*]、$.a.b.*，不以'$'开头时视为以'$.'开头
+     */
+    bool parseJsonPath(const std::string &rule, std::vector<std::string> &keys, bool &members) {
+        std::string path = trim(rule);
+        if (path.starts_with('$')) {
+            path = path.substr(1);
+        } else {
+            path = "." + path;
+        }
+        size_t p = 0;
+        while (p < path.size()) {
+            if (path.compare(p, std::string::npos, ".*") == 0 || path.compare(p, std::string::npos, "[*]") == 0) {
+                members = true;
+                return true;
+            }
+            if (path[p] != '.') return false;
+            size_t end = p + 1;
+            while (end < path.size() && isNameChar(path[end])) end++;
+            std::string key = path.substr(p + 1, end - p - 1);
+            if (!isName(key)) return false;
+            keys.push_back(std::move(key));
+            p = end;
+        }
+        return true;
+    }
+}
+
+ListStream::ListStream(std::optional<std::string> charset, ItemHandler onItem)
+    : charset(std::move(charset)), onItem(std::move(onItem)) {
+}
+
+std::unique_ptr<ListStream> ListStream::create(
+    const std::string &ruleList,
+    const std::optional<std::string> &charset,
+    ItemHandler onItem
+) {
+    const std::string rule = trim(ruleList);
+    if (rule.empty() || hasEval(rule)) return nullptr;
+    std::unique_ptr<ListStream> stream(new ListStream(charset, std::move(onItem)));
+    // 内容为html时规则的模式，与SourceRule的判断顺序一致
+    if (StringUtils::startsWithIgnoreCase(rule, "@CSS:")) {
+        stream->selector = Css::Selector::compile(trim(rule.substr(5)));
+    } else if (!StringUtils::startsWithIgnoreCase(rule, "@CSS") && !StringUtils::startsWithIgnoreCase(rule, "@XPath") &&
+               !StringUtils::startsWithIgnoreCase(rule, "@Json") && !rule.starts_with("$.") &&
+               !rule.starts_with("$[") && !rule.starts_with("/")) {
+        const std::string jsoup = rule.starts_with("@@") ? trim(rule.substr(2)) : rule;
+        if (parseSteps(jsoup, stream->steps)) {
+            stream->htmlRule = true;
+        } else if (jsoup.find('@') == std::string::npos) {
+            // 单级的css选择器
+            const std::string type = jsoup.substr(0, jsoup.find('.'));
+            if (!hasIndex(jsoup) && type != "children" && type != "class" && type != "tag" && type != "id" &&
+                type != "text") {
+                stream->selector = Css::Selector::compile(jsoup);
+            }
+        }
+    }
+    if (stream->selector != nullptr) {
+        stream->htmlRule = isStreamable(*stream->selector);
+    }
+    // 内容为json时，除了@CSS、@@、@XPath以外的规则都按JSONPath执行
+    if (StringUtils::startsWithIgnoreCase(rule, "@Json")) {
+        stream->jsonRule = rule.size() > 6 && parseJsonPath(rule.substr(6), stream->jsonKeys, stream->jsonMembers);
+    } else if (!StringUtils::startsWithIgnoreCase(rule, "@CSS") && !StringUtils::startsWithIgnoreCase(rule, "@XPath") &&
+               !rule.starts_with("@@")) {
+        stream->jsonRule = parseJsonPath(rule, stream->jsonKeys, stream->jsonMembers);
+    }
+    if (!stream->htmlRule && !stream->jsonRule) return nullptr;
+    return stream;
+}
+
+bool ListStream::feed(const std::string_view data, const std::string_view contentType) {
+    if (stop) return false;
+    if (error) return true;
+    if (decoder == nullptr) {
+        decoder = std::make_unique<Charset::StreamDecoder>(contentType, charset);
+    }
+    const std::string text = decoder->feed(data);
+    if (!decoder->supported() || decoder->mismatched()) {
+        fail();
+        return true;
+    }
+    feedText(text, false);
+    return !stop;
+}
+
+void ListStream::finish() {
+    if (stop || error || decoder == nullptr) return;
+    const std::string text = decoder->finish();
+    if (!decoder->supported() || decoder->mismatched()) {
+        fail();
+        return;
+    }
+    feedText(text, true);
+    if (stop || error) return;
+    if (html != nullptr) {
+        html->finish();
+    } else if (json != nullptr) {
+        json->finish();
+        // 与AnalyzeRule一致，首尾字符不是成对的括号时不是json
+        if (!stop && (json->failed() || closing != (opening == '{' ? '}' : ']'))) fail();
+    }
+}
+
+void ListStream::feedText(const std::string &text, const bool eof) {
+    if (format == Format::Unknown) {
+        head += text;
+        if (!detect(eof) || error) return;
+        const std::string content = std::move(head);
+        head.clear();
+        feedText(content, eof);
+        return;
+    }
+    if (format == Format::Html) {
+        html->feed(text);
+        return;
+    }
+    for (size_t i = text.size(); i > 0; i--) {
+        if (!isBlank(text[i - 1])) {
+            closing = text[i - 1];
+            break;
+        }
+    }
+    json->feed(text);
+    if (json->failed()) fail();
+}
+
+bool ListStream::detect(const bool eof) {
+    size_t first = 0;
+    while (first < head.size() && isBlank(head[first])) first++;
+    if (first == head.size()) return false;
+    if (head[first] == '{' || head[first] == '[') {
+        if (!jsonRule) {
+            fail();
+            return true;
+        }
+        format = Format::Json;
+        opening = head[first];
+        json = std::make_unique<JsonPath::StreamScanner>(jsonKeys, jsonMembers, [this](const size_t begin, const size_t end) {
+            if (stop || error) return;
+            std::shared_ptr<const JsonPath::Document> document;
+            try {
+                document = JsonPath::Document::parse(std::string(json->slice(begin, end)));
+            } catch (const std::invalid_argument &) {
+                fail();
+                return;
+            }
+            json->release(end);
+            emit(JsonContent{document, document->root()});
+        });
+        return true;
+    }
+    // 以<?xml开头时按xml解析，标签名保留大小写
+    if (head.size() - first < 5 && !eof) return false;
+    if (!htmlRule || StringUtils::startsWithIgnoreCase(head.substr(first, 5), "<?xml")) {
+        fail();
+        return true;
+    }
+    format = Format::Html;
+    progress.assign(1, 0);
+    itemAt.assign(1, 0);
+    if (selector != nullptr) masks.assign(selector->getGroups().size() * 2, 0);
+    html = std::make_unique<Html::StreamParser>(
+        [this](const Html::Node &element, const size_t depth, const size_t begin) { onOpen(element, depth, begin); },
+        [this](const size_t depth, const size_t end) { onClose(depth, end); }
+    );
+    return true;
+}
+
+void ListStream::onOpen(const Html::Node &element, const size_t depth, const size_t begin) {
+    if (stop || error) return;
+    const bool matched = selector != nullptr ? matchSelector(element, depth) : matchSteps(element, depth);
+    if (error) return;
+    itemAt.resize(depth + 1);
+    itemAt[depth] = 0;
+    // 之前的列表项都已经处理完，开始标签之前的内容不再需要
+    if (pending.empty()) html->release(begin);
+    if (matched) {
+        pending.push_back({begin, 0, false});
+        itemAt[depth] = firstSeq + pending.size();
+    }
+}
+
+void ListStream::onClose(const size_t depth, const size_t end) {
+    if (stop || error || depth >= itemAt.size() || itemAt[depth] == 0) return;
+    Pending &item = pending[itemAt[depth] - 1 - firstSeq];
+    item.end = end;
+    item.done = true;
+    itemAt[depth] = 0;
+    flush(end);
+}
+
+bool ListStream::matchSteps(const Html::Node &element, const size_t depth) {
+    const size_t n = steps.size();
+    const size_t parent = progress[depth - 1];
+    // 祖先已经匹配过的非最后一级再次匹配时，这一级的结果互相嵌套，完整解析的结果会重复
+    for (size_t k = 0; k < std::min(parent, n - 1); k++) {
+        if (Css::matchesLocal(steps[k], element)) {
+            fail();
+            return false;
+        }
+    }
+    // 每一级都在上一级结果自身及其后代中查找，因此同一个元素可以连续匹配多级
+    size_t p = parent;
+    while (p < n - 1 && Css::matchesLocal(steps[p], element)) p++;
+    progress.resize(depth + 1);
+    progress[depth] = p;
+    return p == n - 1 && Css::matchesLocal(steps[n - 1], element);
+}
+
+bool ListStream::matchSelector(const Html::Node &element, const size_t depth) {
+    const auto &groups = selector->getGroups();
+    const size_t stride = groups.size() * 2;
+    masks.resize((depth + 1) * stride);
+    const uint64_t *parent = masks.data() + (depth - 1) * stride;
+    uint64_t *self = masks.data() + depth * stride;
+    bool matched = false;
+    for (size_t g = 0; g < groups.size(); g++) {
+        // S: 以该元素结尾匹配了前i+1个复合选择器，D: 该元素或其祖先的S
+        const auto &compounds = groups[g].compounds;
+        uint64_t s = 0;
+        for (size_t i = 0; i < compounds.size(); i++) {
+            if (i > 0) {
+                const uint64_t required = compounds[i].combinator == Css::Combinator::Child ? parent[g * 2] : parent[g * 2 + 1];
+                if ((required >> (i - 1) & 1) == 0) continue;
+            }
+            if (Css::matchesLocal(compounds[i], element)) s |= uint64_t{1} << i;
+        }
+        self[g * 2] = s;
+        self[g * 2 + 1] = s | parent[g * 2 + 1];
+        if (s >> (compounds.size() - 1) & 1) matched = true;
+    }
+    return matched;
+}
+
+void ListStream::flush(const size_t end) {
+    while (!pending.empty() && pending.front().done && !stop && !error) {
+        const Pending item = pending.front();
+        pending.pop_front();
+        firstSeq++;
+        // 列表项单独解析，开始标签就是文档的第一个节点
+        auto document = Html::Document::parse(std::string(html->slice(item.begin, item.end)));
+        const Html::Node *node = document->root()->firstChild;
+        emit(HtmlContent{std::move(document), node});
+    }
+    html->release(pending.empty() ? end : pending.front().begin);
+}
+
+void ListStream::emit(RuleContent &&item) {
+    items++;
+    if (!onItem(std::move(item))) stop = true;
+}
+
+void ListStream::fail() {
+    error = true;
+    pending.clear();
+    head.clear();
+}
@@ -0,0 +1,151 @@
+#include <booksource/prefetch.h>
+#include <booksource/ratelimiter.h>
+#include <booksource/webbook.h>
+#include <ranges>
+
+ContentPrefetcher::ContentPrefetcher(BookSource &bookSource, Book book, std::vector<BookChapter> chapters,
+                                     RuleData &ruleData, const Options options)
+    : bookSource(bookSource), book(std::move(book)), chapters(std::move(chapters)), ruleData(ruleData),
+      options(options), pool(options.threads) {
+    urls.reserve(this->chapters.size());
+    for (const auto &chapter: this->chapters) {
+        urls.push_back(chapter.getAbsoluteURL());
+    }
+}
+
+ContentPrefetcher::~ContentPrefetcher() {
+    std::lock_guard lock(mutex);
+    for (const auto &entry: entries | std::views::values) {
+        entry->cancelled = true;
+    }
+}
+
+bool ContentPrefetcher::inWindow(const int index) const {
+    const int first = position - (options.previous ? 1 : 0);
+    return position >= 0 && index >= first && index <= position + static_cast<int>(options.ahead);
+}
+
+void ContentPrefetcher::moveTo(const int durChapterIndex) {
+    std::lock_guard lock(mutex);
+    // 等待被取消的预读的getContent()改为自己下载
+    cv.notify_all();
+    position = durChapterIndex;
+    std::erase_if(entries, [this](const auto &item) {
+        if (inWindow(item.first)) return false;
+        item.second->cancelled = true;
+        return true;
+    });
+    std::vector<int> indexes;
+    for (size_t i = 1; i <= options.ahead; i++) {
+        indexes.push_back(durChapterIndex + static_cast<int>(i));
+    }
+    if (options.previous) indexes.push_back(durChapterIndex - 1);
+    for (const int index: indexes) {
+        if (index < 0 || index >= static_cast<int>(chapters.size()) || entries.contains(index)) continue;
+        auto entry = std::make_shared<Entry>();
+        entries.emplace(index, entry);
+        pool.post([this, index, entry] { prefetch(index, entry); });
+    }
+}
+
+std::string ContentPrefetcher::fetch(const int index, const bool background, const std::atomic<bool> *cancelled) {
+    BookChapter chapter;
+    {
+        std::lock_guard lock(mutex);
+        chapter = chapters[index];
+    }
+    const ConcurrentRateLimiter::RequestScope scope(
+        background ? ConcurrentRateLimiter::Background : ConcurrentRateLimiter::Foreground, cancelled);
+    const std::optional<std::string> nextChapterUrl =
+        index + 1 < static_cast<int>(urls.size()) ? std::optional(urls[index + 1]) : std::nullopt;
+    std::string content = WebBook::getContent(bookSource, book, chapter, ruleData, nextChapterUrl);
+    std::lock_guard lock(mutex);
+    chapters[index].title = std::move(chapter.title);
+    return content;
+}
+
+void ContentPrefetcher::prefetch(const int index, const std::shared_ptr<Entry> &entry) {
+    {
+        std::lock_guard lock(mutex);
+        // 已经取消，或者被getContent()接手
+        if (entry->cancelled || entry->state != Entry::Queued) return;
+        entry->state = Entry::Running;
+    }
+    std::optional<std::string> content;
+    try {
+        content = fetch(index, true, &entry->cancelled);
+    } catch (...) {
+        // 预读失败时不缓存，由getContent()重新下载
+    }
+    {
+        std::lock_guard lock(mutex);
+        if (content.has_value() && !entry->cancelled) {
+            entry->content = std::move(*content);
+            entry->state = Entry::Done;
+        } else {
+            entry->cancelled = true;
+            if (const auto it = entries.find(index); it != entries.end() && it->second == entry) entries.erase(it);
+        }
+    }
+    cv.notify_all();
+}
+
+std::string ContentPrefetcher::getContent(const int index) {
+    if (index < 0 || index >= static_cast<int>(chapters.size())) {
+        throw std::out_of_range("Chapter index out of range: " + std::to_string(index));
+    }
+    std::shared_ptr<Entry> entry;
+    {
+        std::unique_lock lock(mutex);
+        if (const auto it = entries.find(index); it != entries.end()) {
+            entry = it->second;
+            if (entry->state == Entry::Running) {
+                cv.wait(lock, [&] { return entry->state == Entry::Done || entry->cancelled; });
+            }
+            if (entry->state == Entry::Done) {
+                hits++;
+                return entry->content;
+            }
+            entry->cancelled = true;
+        }
+        // 还在排队的预读由当前线程接手，预读任务开始时会跳过
+        entry = std::make_shared<Entry>();
+        entry->state = Entry::Running;
+        entries[index] = entry;
+    }
+    misses++;
+    std::string content;
+    try {
+        content = fetch(index, false, nullptr);
+    } catch (...) {
+        std::lock_guard lock(mutex);
+        entry->cancelled = true;
+        if (const auto it = entries.find(index); it != entries.end() && it->second == entry) entries.erase(it);
+        cv.notify_all();
+        throw;
+    }
+    {
+        std::lock_guard lock(mutex);
+        // 阅读位置已经离开时不缓存
+        if (const auto it = entries.find(index); it != entries.end() && it->second == entry && inWindow(index)) {
+            entry->content = content;
+            entry->state = Entry::Done;
+        } else {
+            entry->cancelled = true;
+            if (it != entries.end() && it->second == entry) entries.erase(it);
+        }
+    }
+    cv.notify_all();
+    return content;
+}
+
+bool ContentPrefetcher::isCached(const int index) {
+    std::lock_guard lock(mutex);
+    const auto it = entries.find(index);
+    return it != entries.end() && it->second->state == Entry::Done;
+}
+
+BookChapter ContentPrefetcher::getChapter(const int index) {
+    std::lock_guard lock(mutex);
+    return chapters.at(index);
+}
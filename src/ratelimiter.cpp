@@ -0,0 +1,133 @@
+#include <booksource/ratelimiter.h>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <unordered_map>
+
+namespace {
+    thread_local ConcurrentRateLimiter::Priority currentPriority = ConcurrentRateLimiter::Foreground;
+    thread_local const std::atomic<bool> *currentCancelled = nullptr;
+
+    // 等待时每隔一段时间检查一次取消标志
+    constexpr int64_t checkInterval = 20;
+
+    int64_t now() {
+        using namespace std::chrono;
+        return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool parseNumber(const std::string_view s, int64_t &value) {
+        const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+        return ec == std::errc() && end == s.data() + s.size() && value > 0;
+    }
+
+    /**
+     * 解析concurrentRate，不限制时返回 false
+     * @param limit "次数/毫秒数"的次数，"毫秒数"时为0
+     */
+    bool parseRate(const std::string &rate, int64_t &limit, int64_t &window) {
+        limit = 0;
+        if (const size_t slash = rate.find('/'); slash != std::string::npos) {
+            return parseNumber(std::string_view(rate).substr(0, slash), limit) &&
+                   parseNumber(std::string_view(rate).substr(slash + 1), window);
+        }
+        return parseNumber(rate, window);
+    }
+}
+
+ConcurrentRateLimiter::RequestScope::RequestScope(const Priority priority, const std::atomic<bool> *cancelled)
+    : previousPriority(currentPriority), previousCancelled(currentCancelled) {
+    currentPriority = priority;
+    currentCancelled = cancelled;
+}
+
+ConcurrentRateLimiter::RequestScope::~RequestScope() {
+    currentPriority = previousPriority;
+    currentCancelled = previousCancelled;
+}
+
+ConcurrentRateLimiter::Priority ConcurrentRateLimiter::RequestScope::priority() {
+    return currentPriority;
+}
+
+bool ConcurrentRateLimiter::RequestScope::cancelled() {
+    return currentCancelled != nullptr && currentCancelled->load();
+}
+
+std::shared_ptr<ConcurrentRateLimiter> ConcurrentRateLimiter::forSource(const std::string &sourceKey) {
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::shared_ptr<ConcurrentRateLimiter> > limiters;
+    std::lock_guard lock(mutex);
+    auto &limiter = limiters[sourceKey];
+    if (limiter == nullptr) limiter = std::make_shared<ConcurrentRateLimiter>();
+    return limiter;
+}
+
+bool ConcurrentRateLimiter::acquire(const std::string &rate) {
+    int64_t limit, window;
+    if (!parseRate(rate, limit, window)) return !RequestScope::cancelled();
+    const bool foreground = RequestScope::priority() == Foreground;
+    std::unique_lock lock(mutex);
+    if (foreground) foregroundWaiting++;
+    while (true) {
+        if (RequestScope::cancelled()) {
+            if (foreground) foregroundWaiting--;
+            return false;
+        }
+        const int64_t time = now();
+        int64_t wait = checkInterval;
+        if (!foreground && foregroundWaiting > 0) {
+            // 前台请求优先
+        } else if (limit == 0) {
+            if (!running && time >= start + window) {
+                running = true;
+                start = time;
+                break;
+            }
+            if (!running) wait = std::min(wait, start + window - time);
+        } else {
+            if (time >= start + window) {
+                start = time;
+                count = 1;
+                break;
+            }
+            if (count < limit) {
+                count++;
+                break;
+            }
+            wait = std::min(wait, start + window - time);
+        }
+        cv.wait_for(lock, std::chrono::milliseconds(wait));
+    }
+    if (foreground) {
+        foregroundWaiting--;
+        // 等待中的后台请求可以继续
+        if (foregroundWaiting == 0) cv.notify_all();
+    }
+    return true;
+}
+
+void ConcurrentRateLimiter::release(const std::string &rate) {
+    int64_t limit, window;
+    if (!parseRate(rate, limit, window) || limit > 0) return;
+    {
+        std::lock_guard lock(mutex);
+        running = false;
+    }
+    cv.notify_all();
+}
+
+int64_t ConcurrentRateLimiter::waitTime(const std::string &rate) {
+    int64_t limit, window;
+    if (!parseRate(rate, limit, window)) return 0;
+    std::lock_guard lock(mutex);
+    const int64_t time = now();
+    // 先比较再相减，start的初始值与当前时间相减会溢出
+    if (limit == 0) {
+        if (running) return checkInterval;
+        if (time >= start + window) return 0;
+        return start + window - time;
+    }
+    if (time >= start + window || count < limit) return 0;
+    return start + window - time;
+}
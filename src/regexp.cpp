@@ -0,0 +1,1422 @@
+#include <booksource/regexp.h>
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace Regexp {
+    namespace {
+        constexpr uint32_t maxCodePoint = 0x10FFFF;
+        constexpr int maxRepeat = 1000;     // {n,m}中n、m的上限，与RE2一致
+        constexpr int maxDepth = 256;       // 分组嵌套的上限，解析是递归的
+        constexpr size_t maxProgramSize = 100000;
+        constexpr uint32_t noSlot = UINT32_MAX;
+
+        // NFA无法表示的语法，改用 std::regex
+        struct Unsupported {
+        };
+
+        enum class AssertKind : uint8_t {
+            BeginText, EndText, EndTextOrNewline, BeginLine, EndLine, WordBoundary, NotWordBoundary
+        };
+
+        // 解码一个UTF-8字符，返回其字节数，不合法的字节作为单个U+FFFD
+        size_t decode(const std::string_view s, const size_t pos, uint32_t &c) {
+            const auto b = static_cast<unsigned char>(s[pos]);
+            if (b < 0x80) {
+                c = b;
+                return 1;
+            }
+            size_t len;
+            uint32_t cp;
+            if ((b & 0xE0) == 0xC0) {
+                len = 2;
+                cp = b & 0x1F;
+            } else if ((b & 0xF0) == 0xE0) {
+                len = 3;
+                cp = b & 0x0F;
+            } else if ((b & 0xF8) == 0xF0) {
+                len = 4;
+                cp = b & 0x07;
+            } else {
+                c = 0xFFFD;
+                return 1;
+            }
+            if (pos + len > s.size()) {
+                c = 0xFFFD;
+                return 1;
+            }
+            for (size_t i = 1; i < len; i++) {
+                const auto next = static_cast<unsigned char>(s[pos + i]);
+                if ((next & 0xC0) != 0x80) {
+                    c = 0xFFFD;
+                    return 1;
+                }
+                cp = cp << 6 | (next & 0x3F);
+            }
+            c = cp;
+            return len;
+        }
+
+        void appendUtf8(std::string &out, const uint32_t c) {
+            if (c < 0x80) {
+                out += static_cast<char>(c);
+            } else if (c < 0x800) {
+                out += static_cast<char>(0xC0 | c >> 6);
+                out += static_cast<char>(0x80 | (c & 0x3F));
+            } else if (c < 0x10000) {
+                out += static_cast<char>(0xE0 | c >> 12);
+                out += static_cast<char>(0x80 | (c >> 6 & 0x3F));
+                out += static_cast<char>(0x80 | (c & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | c >> 18);
+                out += static_cast<char>(0x80 | (c >> 12 & 0x3F));
+                out += static_cast<char>(0x80 | (c >> 6 & 0x3F));
+                out += static_cast<char>(0x80 | (c & 0x3F));
+            }
+        }
+
+        bool isAsciiLetter(const uint32_t c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        }
+
+        uint32_t toLower(const uint32_t c) {
+            return c >= 'A' && c <= 'Z' ? c + 32 : c;
+        }
+
+        // \b两侧的字符类型，只看一个字节：ASCII字母、数字、'_'以及非ASCII字符（与Java一样把汉字等文字算作单词）
+        bool isWordByte(const char ch) {
+            const auto b = static_cast<unsigned char>(ch);
+            return b >= 0x80 || b == '_' || (b >= '0' && b <= '9') || (b >= 'a' && b <= 'z') || (b >= 'A' && b <= 'Z');
+        }
+
+        bool isLineEnd(const char c) {
+            return c == '\n' || c == '\r';
+        }
+
+        struct CharClass {
+            std::vector<std::pair<uint32_t, uint32_t> > ranges; // 排序并合并后的闭区间
+            bool negate = false;
+            bool fold = false; // 不区分大小写（只有ASCII字母，与Java默认的CASE_INSENSITIVE一致）
+
+            void add(const uint32_t lo, const uint32_t hi) {
+                ranges.emplace_back(lo, hi);
+            }
+
+            void normalize() {
+                std::ranges::sort(ranges);
+                std::vector<std::pair<uint32_t, uint32_t> > merged;
+                for (const auto &range: ranges) {
+                    if (!merged.empty() && range.first <= merged.back().second + 1) {
+                        merged.back().second = std::max(merged.back().second, range.second);
+                    } else {
+                        merged.push_back(range);
+                    }
+                }
+                ranges = std::move(merged);
+            }
+
+            bool inRanges(const uint32_t c) const {
+                const auto it = std::ranges::lower_bound(ranges, c, {}, &std::pair<uint32_t, uint32_t>::second);
+                return it != ranges.end() && it->first <= c;
+            }
+
+            bool contains(const uint32_t c) const {
+                bool in = inRanges(c);
+                if (!in && fold && isAsciiLetter(c)) {
+                    in = inRanges(c >= 'a' ? c - 32 : c + 32);
+                }
+                return in != negate;
+            }
+        };
+
+        // 把ranges的补集加入cc
+        void addComplement(CharClass &cc, std::vector<std::pair<uint32_t, uint32_t> > ranges) {
+            std::ranges::sort(ranges);
+            uint32_t next = 0;
+            for (const auto &[lo, hi]: ranges) {
+                if (lo > next) cc.add(next, lo - 1);
+                next = std::max(next, hi + 1);
+            }
+            if (next <= maxCodePoint) cc.add(next, maxCodePoint);
+        }
+
+        // \d \w \s \h 及其大写形式
+        void addShorthand(CharClass &cc, const char c) {
+            std::vector<std::pair<uint32_t, uint32_t> > ranges;
+            switch (c | 0x20) {
+                case 'd':
+                    ranges = {{'0', '9'}};
+                    break;
+                case 'w':
+                    ranges = {{'0', '9'}, {'A', 'Z'}, {'_', '_'}, {'a', 'z'}};
+                    break;
+                case 's':
+                    ranges = {{'\t', '\r'}, {' ', ' '}};
+                    break;
+                default:
+                    ranges = {{'\t', '\t'}, {' ', ' '}, {0xA0, 0xA0}, {0x1680, 0x1680}, {0x180E, 0x180E},
+                              {0x2000, 0x200A}, {0x202F, 0x202F}, {0x205F, 0x205F}, {0x3000, 0x3000}};
+                    break;
+            }
+            if (c >= 'A' && c <= 'Z') {
+                addComplement(cc, std::move(ranges));
+            } else {
+                for (const auto &[lo, hi]: ranges) cc.add(lo, hi);
+            }
+        }
+
+        // \p{name}，只支持汉字与POSIX字符类
+        bool propertyRanges(const std::string &name, std::vector<std::pair<uint32_t, uint32_t> > &ranges) {
+            if (name == "Han" || name == "IsHan" || name == "script=Han" || name == "sc=Han") {
+                ranges = {{0x2E80, 0x2FDF}, {0x3005, 0x3005}, {0x3007, 0x3007}, {0x3021, 0x3029}, {0x3038, 0x303B},
+                          {0x3400, 0x4DBF}, {0x4E00, 0x9FFF}, {0xF900, 0xFAFF}, {0x20000, 0x3134F}};
+            } else if (name == "Lower") {
+                ranges = {{'a', 'z'}};
+            } else if (name == "Upper") {
+                ranges = {{'A', 'Z'}};
+            } else if (name == "Alpha") {
+                ranges = {{'A', 'Z'}, {'a', 'z'}};
+            } else if (name == "Digit") {
+                ranges = {{'0', '9'}};
+            } else if (name == "Alnum") {
+                ranges = {{'0', '9'}, {'A', 'Z'}, {'a', 'z'}};
+            } else if (name == "Space") {
+                ranges = {{'\t', '\r'}, {' ', ' '}};
+            } else if (name == "ASCII") {
+                ranges = {{0, 0x7F}};
+            } else {
+                return false;
+            }
+            return true;
+        }
+
+        struct Node {
+            enum class Kind : uint8_t {
+                Empty, Char, Class, Any, Assert, Group, Concat, Alt, Repeat
+            };
+
+            Kind kind = Kind::Empty;
+            bool flag = false;  // Char: 不区分大小写；Any: 包括换行；Repeat: 贪婪
+            uint32_t value = 0; // Char: 字符；Class: 字符类序号；Assert: 类型；Group: 分组序号
+            int min = 0;        // Repeat
+            int max = 0;        // Repeat，-1表示不限
+            std::vector<Node> children;
+        };
+
+        struct Flags {
+            bool ignoreCase = false;
+            bool dotAll = false;
+            bool multiline = false;
+        };
+
+        class Parser {
+        public:
+            std::vector<CharClass> classes;
+            size_t groups = 0;
+            std::vector<std::pair<std::string, size_t> > names;
+
+            explicit Parser(const std::string_view pattern) : p(pattern) {
+            }
+
+            Node parse() {
+                Flags flags;
+                Node node = parseAlt(flags, 0);
+                if (more()) error("不匹配的')'");
+                return node;
+            }
+
+        private:
+            std::string_view p;
+            size_t pos = 0;
+
+            [[noreturn]] void error(const std::string &message) const {
+                throw std::invalid_argument(message + ": " + std::string(p));
+            }
+
+            bool more() const {
+                return pos < p.size();
+            }
+
+            bool eat(const char c) {
+                if (more() && p[pos] == c) {
+                    pos++;
+                    return true;
+                }
+                return false;
+            }
+
+            uint32_t nextCodePoint() {
+                uint32_t c;
+                pos += decode(p, pos, c);
+                return c;
+            }
+
+            Node charNode(const uint32_t c, const Flags &flags) const {
+                Node node;
+                node.kind = Node::Kind::Char;
+                node.flag = flags.ignoreCase && isAsciiLetter(c);
+                node.value = node.flag ? toLower(c) : c;
+                return node;
+            }
+
+            Node classNode(CharClass cc) {
+                cc.normalize();
+                Node node;
+                node.kind = Node::Kind::Class;
+                node.value = static_cast<uint32_t>(classes.size());
+                classes.push_back(std::move(cc));
+                return node;
+            }
+
+            static Node assertNode(const AssertKind kind) {
+                Node node;
+                node.kind = Node::Kind::Assert;
+                node.value = static_cast<uint32_t>(kind);
+                return node;
+            }
+
+            Node parseAlt(Flags &flags, const int depth) {
+                if (depth > maxDepth) error("分组嵌套过深");
+                std::vector<Node> alternatives;
+                alternatives.push_back(parseConcat(flags, depth));
+                while (eat('|')) alternatives.push_back(parseConcat(flags, depth));
+                if (alternatives.size() == 1) return std::move(alternatives[0]);
+                Node node;
+                node.kind = Node::Kind::Alt;
+                node.children = std::move(alternatives);
+                return node;
+            }
+
+            Node parseConcat(Flags &flags, const int depth) {
+                Node node;
+                node.kind = Node::Kind::Concat;
+                while (more() && p[pos] != '|' && p[pos] != ')') {
+                    if (p.compare(pos, 2, "\\Q") == 0) {
+                        // \Q...\E 中的内容都是字面字符，之后的量词只作用于最后一个字符
+                        pos += 2;
+                        size_t end = p.find("\\E", pos);
+                        if (end == std::string_view::npos) end = p.size();
+                        while (pos < end) node.children.push_back(charNode(nextCodePoint(), flags));
+                        pos = std::min(end + 2, p.size());
+                    } else {
+                        std::optional<Node> atom = parseAtom(flags, depth);
+                        if (!atom.has_value()) continue;
+                        node.children.push_back(std::move(*atom));
+                    }
+                    if (!node.children.empty()) parseQuantifier(node.children.back());
+                }
+                if (node.children.size() == 1) return std::move(node.children[0]);
+                if (node.children.empty()) node.kind = Node::Kind::Empty;
+                return node;
+            }
+
+            // {n}、{n,}、{n,m}，不是量词时不移动位置，'{'作为字面字符
+            bool parseBraces(int &min, int &max) {
+                size_t i = pos + 1;
+                const auto number = [&](int &value) {
+                    const size_t start = i;
+                    long n = 0;
+                    while (i < p.size() && p[i] >= '0' && p[i] <= '9') {
+                        n = std::min(n * 10 + (p[i] - '0'), 100000L);
+                        i++;
+                    }
+                    value = static_cast<int>(n);
+                    return i > start;
+                };
+                if (!number(min)) return false;
+                max = min;
+                if (i < p.size() && p[i] == ',') {
+                    i++;
+                    if (!number(max)) max = -1;
+                }
+                if (i >= p.size() || p[i] != '}') return false;
+                pos = i + 1;
+                return true;
+            }
+
+            void parseQuantifier(Node &atom) {
+                if (!more()) return;
+                int min;
+                int max;
+                switch (p[pos]) {
+                    case '*':
+                        min = 0;
+                        max = -1;
+                        pos++;
+                        break;
+                    case '+':
+                        min = 1;
+                        max = -1;
+                        pos++;
+                        break;
+                    case '?':
+                        min = 0;
+                        max = 1;
+                        pos++;
+                        break;
+                    case '{':
+                        if (!parseBraces(min, max)) return;
+                        break;
+                    default:
+                        return;
+                }
+                if (min > maxRepeat || max > maxRepeat) error("重复次数过多");
+                if (max != -1 && min > max) error("重复次数的范围错误");
+                bool greedy = true;
+                if (eat('?')) {
+                    greedy = false;
+                } else {
+                    // 占有量词无法用NFA表示，按贪婪量词处理
+                    eat('+');
+                }
+                if (more() && (p[pos] == '*' || p[pos] == '+' || p[pos] == '?')) error("重复的量词");
+                Node repeat;
+                repeat.kind = Node::Kind::Repeat;
+                repeat.min = min;
+                repeat.max = max;
+                repeat.flag = greedy;
+                repeat.children.push_back(std::move(atom));
+                atom = std::move(repeat);
+            }
+
+            std::optional<Node> parseAtom(Flags &flags, const int depth) {
+                switch (p[pos]) {
+                    case '(':
+                        return parseGroup(flags, depth);
+                    case '[':
+                        pos++;
+                        return classNode(parseClass(flags));
+                    case '.': {
+                        pos++;
+                        Node node;
+                        node.kind = Node::Kind::Any;
+                        node.flag = flags.dotAll;
+                        return node;
+                    }
+                    case '^':
+                        pos++;
+                        return assertNode(flags.multiline ? AssertKind::BeginLine : AssertKind::BeginText);
+                    case '$':
+                        pos++;
+                        return assertNode(flags.multiline ? AssertKind::EndLine : AssertKind::EndTextOrNewline);
+                    case '\\':
+                        return parseEscape(flags);
+                    case '*':
+                    case '+':
+                    case '?':
+                        error("量词之前没有内容");
+                    default:
+                        return charNode(nextCodePoint(), flags);
+                }
+            }
+
+            std::optional<Node> parseGroup(Flags &flags, const int depth) {
+                pos++;
+                Flags inner = flags;
+                size_t index = 0;
+                if (eat('?')) {
+                    if (eat(':')) {
+                        // 不捕获的分组
+                    } else if (pos + 1 < p.size() && p[pos] == '<' && p[pos + 1] != '=' && p[pos + 1] != '!') {
+                        const size_t end = p.find('>', pos);
+                        if (end == std::string_view::npos) error("分组名称没有结束");
+                        index = ++groups;
+                        names.emplace_back(std::string(p.substr(pos + 1, end - pos - 1)), index);
+                        pos = end + 1;
+                    } else if (more() && (p[pos] == '=' || p[pos] == '!' || p[pos] == '<' || p[pos] == '>')) {
+                        // 环视与独立分组
+                        throw Unsupported{};
+                    } else {
+                        // (?flags) 改变所在分组之后的部分，(?flags:...) 只改变其中的部分
+                        bool on = true;
+                        while (more() && p[pos] != ')' && p[pos] != ':') {
+                            switch (p[pos++]) {
+                                case '-':
+                                    on = false;
+                                    break;
+                                case 'i':
+                                    inner.ignoreCase = on;
+                                    break;
+                                case 's':
+                                    inner.dotAll = on;
+                                    break;
+                                case 'm':
+                                    inner.multiline = on;
+                                    break;
+                                case 'u':
+                                case 'U':
+                                case 'd':
+                                    break;
+                                case 'x':
+                                    throw Unsupported{};
+                                default:
+                                    error("未知的标志");
+                            }
+                        }
+                        if (eat(')')) {
+                            flags = inner;
+                            return std::nullopt;
+                        }
+                        if (!eat(':')) error("分组没有结束");
+                    }
+                } else {
+                    index = ++groups;
+                }
+                Node body = parseAlt(inner, depth + 1);
+                if (!eat(')')) error("分组没有结束");
+                if (index == 0) return body;
+                Node node;
+                node.kind = Node::Kind::Group;
+                node.value = static_cast<uint32_t>(index);
+                node.children.push_back(std::move(body));
+                return node;
+            }
+
+            uint32_t hexDigits(const size_t count) {
+                uint32_t value = 0;
+                for (size_t i = 0; i < count; i++) {
+                    if (!more() || !std::isxdigit(static_cast<unsigned char>(p[pos]))) error("十六进制转义错误");
+                    const char c = p[pos++];
+                    value = value * 16 + (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+                }
+                return value;
+            }
+
+            // '\'之后表示单个字符的转义
+            uint32_t escapeChar() {
+                const char c = p[pos];
+                switch (c) {
+                    case 'n':
+                        pos++;
+                        return '\n';
+                    case 'r':
+                        pos++;
+                        return '\r';
+                    case 't':
+                        pos++;
+                        return '\t';
+                    case 'f':
+                        pos++;
+                        return '\f';
+                    case 'a':
+                        pos++;
+                        return 0x07;
+                    case 'e':
+                        pos++;
+                        return 0x1B;
+                    case 'v':
+                        pos++;
+                        return 0x0B;
+                    case '0': {
+                        pos++;
+                        uint32_t value = 0;
+                        for (int i = 0; i < 3 && more() && p[pos] >= '0' && p[pos] <= '7' && value * 8 + (p[pos] - '0') <= 0377; i++) {
+                            value = value * 8 + (p[pos++] - '0');
+                        }
+                        return value;
+                    }
+                    case 'x': {
+                        pos++;
+                        if (!eat('{')) return hexDigits(2);
+                        uint32_t value = 0;
+                        while (more() && p[pos] != '}') {
+                            value = value * 16 + hexDigits(1);
+                            if (value > maxCodePoint) error("字符超出范围");
+                        }
+                        if (!eat('}')) error("十六进制转义错误");
+                        return value;
+                    }
+                    case 'u':
+                        pos++;
+                        return hexDigits(4);
+                    case 'c':
+                        pos++;
+                        if (!more()) error("控制字符转义错误");
+                        return static_cast<unsigned char>(p[pos++]) ^ 0x40;
+                    default:
+                        return nextCodePoint();
+                }
+            }
+
+            // \p{name}、\pL，pos位于'p'之后
+            void addProperty(CharClass &cc, const bool negate) {
+                std::string name;
+                if (eat('{')) {
+                    const size_t end = p.find('}', pos);
+                    if (end == std::string_view::npos) error("\\p没有结束");
+                    name = p.substr(pos, end - pos);
+                    pos = end + 1;
+                } else if (more()) {
+                    name = p.substr(pos++, 1);
+                }
+                std::vector<std::pair<uint32_t, uint32_t> > ranges;
+                if (!propertyRanges(name, ranges)) throw Unsupported{};
+                if (negate) {
+                    addComplement(cc, std::move(ranges));
+                } else {
+                    for (const auto &[lo, hi]: ranges) cc.add(lo, hi);
+                }
+            }
+
+            std::optional<Node> parseEscape(const Flags &flags) {
+                pos++;
+                if (!more()) error("末尾的'\\'");
+                const char c = p[pos];
+                switch (c) {
+                    case 'd':
+                    case 'D':
+                    case 'w':
+                    case 'W':
+                    case 's':
+                    case 'S':
+                    case 'h':
+                    case 'H': {
+                        pos++;
+                        CharClass cc;
+                        addShorthand(cc, c);
+                        return classNode(std::move(cc));
+                    }
+                    case 'p':
+                    case 'P': {
+                        pos++;
+                        CharClass cc;
+                        addProperty(cc, c == 'P');
+                        return classNode(std::move(cc));
+                    }
+                    case 'b':
+                        pos++;
+                        return assertNode(AssertKind::WordBoundary);
+                    case 'B':
+                        pos++;
+                        return assertNode(AssertKind::NotWordBoundary);
+                    case 'A':
+                        pos++;
+                        return assertNode(AssertKind::BeginText);
+                    case 'z':
+                        pos++;
+                        return assertNode(AssertKind::EndText);
+                    case 'Z':
+                        pos++;
+                        return assertNode(AssertKind::EndTextOrNewline);
+                    case 'G':
+                    case 'k':
+                    case 'R':
+                    case 'X':
+                        throw Unsupported{};
+                    default:
+                        // 反向引用
+                        if (c >= '1' && c <= '9') throw Unsupported{};
+                        return charNode(escapeChar(), flags);
+                }
+            }
+
+            CharClass parseClass(const Flags &flags) {
+                CharClass cc;
+                cc.fold = flags.ignoreCase;
+                if (eat('^')) cc.negate = true;
+                bool first = true;
+                while (true) {
+                    if (!more()) error("字符类没有结束");
+                    const char c = p[pos];
+                    if (c == ']' && !first) {
+                        pos++;
+                        break;
+                    }
+                    first = false;
+                    // Java的嵌套字符类与交集
+                    if (c == '[' || p.compare(pos, 2, "&&") == 0) throw Unsupported{};
+                    uint32_t lo;
+                    if (c == '\\') {
+                        pos++;
+                        if (!more()) error("末尾的'\\'");
+                        const char e = p[pos];
+                        if (std::string_view("dDwWsShH").find(e) != std::string_view::npos) {
+                            pos++;
+                            addShorthand(cc, e);
+                            continue;
+                        }
+                        if (e == 'p' || e == 'P') {
+                            pos++;
+                            addProperty(cc, e == 'P');
+                            continue;
+                        }
+                        if (e == 'Q') {
+                            pos++;
+                            size_t end = p.find("\\E", pos);
+                            if (end == std::string_view::npos) end = p.size();
+                            while (pos < end) {
+                                const uint32_t q = nextCodePoint();
+                                cc.add(q, q);
+                            }
+                            pos = std::min(end + 2, p.size());
+                            continue;
+                        }
+                        if (e == 'b') {
+                            pos++;
+                            lo = 0x08;
+                        } else {
+                            lo = escapeChar();
+                        }
+                    } else {
+                        lo = nextCodePoint();
+                    }
+                    uint32_t hi = lo;
+                    if (pos + 1 < p.size() && p[pos] == '-' && p[pos + 1] != ']') {
+                        pos++;
+                        if (p[pos] == '[') throw Unsupported{};
+                        if (p[pos] == '\\') {
+                            pos++;
+                            if (!more()) error("末尾的'\\'");
+                            hi = escapeChar();
+                        } else {
+                            hi = nextCodePoint();
+                        }
+                        if (hi < lo) error("字符范围错误");
+                    }
+                    cc.add(lo, hi);
+                }
+                return cc;
+            }
+        };
+
+        enum class Op : uint8_t {
+            Char, Class, Any, Split, Jmp, Save, Assert, Match
+        };
+
+        struct Inst {
+            Op op;
+            bool flag = false; // Char: 不区分大小写；Any: 包括换行
+            uint32_t x = 0;    // Char: 字符；Class: 字符类序号；Split、Jmp: 优先的目标；Save: 位置序号；Assert: 类型；Match: 分支序号
+            uint32_t y = 0;    // Split: 另一个目标
+        };
+    }
+
+    // 不是字面文本的分支编译成的NFA
+    struct Program {
+        std::vector<Inst> insts;
+        std::vector<CharClass> classes;
+        size_t slots = 2;
+        std::string prefix;         // 匹配必须以之开头的文本，用于跳过不可能开始匹配的位置
+        bool anchored = false;      // 只能在文本开头匹配
+        std::bitset<256> first;     // 匹配的第一个字节可能的取值
+        bool skip = false;          // 是否可以按first跳过不可能开始匹配的位置
+    };
+
+    /**
+     * 多个字面文本的Aho–Corasick自动机，按字节匹配
+     * 查找最左的匹配，同一位置有多个字面文本时取序号最小的，与正则分支的优先级一致
+     */
+    class Literals {
+    public:
+        void add(const std::string &literal, const uint32_t id) {
+            uint32_t state = 0;
+            for (const char c: literal) {
+                const auto b = static_cast<unsigned char>(c);
+                uint32_t next = find(state, b);
+                if (next == 0) {
+                    next = static_cast<uint32_t>(states.size());
+                    states.emplace_back();
+                    states.back().length = states[state].length + 1;
+                    auto &edges = states[state].next;
+                    edges.insert(std::ranges::lower_bound(edges, b, {}, &Edge::first), {b, next});
+                }
+                state = next;
+            }
+            states[state].output = std::min(states[state].output, id);
+            maxLength = std::max(maxLength, literal.size());
+        }
+
+        // 全部字面文本加入后计算失败链接
+        void build() {
+            root.fill(0);
+            std::vector<uint32_t> queue;
+            for (const auto &[b, next]: states[0].next) {
+                root[b] = next;
+                queue.push_back(next);
+            }
+            for (size_t i = 0; i < queue.size(); i++) {
+                const uint32_t state = queue[i];
+                for (const auto &[b, next]: states[state].next) {
+                    uint32_t fail = states[state].fail;
+                    while (fail != 0 && find(fail, b) == 0) fail = states[fail].fail;
+                    fail = fail == 0 ? root[b] : find(fail, b);
+                    states[next].fail = fail;
+                    states[next].dictionary = states[fail].output != none ? fail : states[fail].dictionary;
+                    queue.push_back(next);
+                }
+            }
+        }
+
+        bool search(const std::string_view text, const size_t pos, size_t &begin, size_t &end, uint32_t &id) const {
+            begin = std::string_view::npos;
+            uint32_t state = 0;
+            for (size_t i = pos; i < text.size(); i++) {
+                // 之后的匹配不可能更靠左
+                if (begin != std::string_view::npos && i + 1 > begin + maxLength) break;
+                state = step(state, static_cast<unsigned char>(text[i]));
+                for (uint32_t s = states[state].output != none ? state : states[state].dictionary; s != 0;
+                     s = states[s].dictionary) {
+                    const size_t start = i + 1 - states[s].length;
+                    if (start < begin || (start == begin && states[s].output < id)) {
+                        begin = start;
+                        end = i + 1;
+                        id = states[s].output;
+                    }
+                }
+            }
+            return begin != std::string_view::npos;
+        }
+
+    private:
+        using Edge = std::pair<unsigned char, uint32_t>;
+        static constexpr uint32_t none = UINT32_MAX;
+
+        struct State {
+            std::vector<Edge> next;      // 按字节排序
+            uint32_t fail = 0;
+            uint32_t dictionary = 0;     // 沿失败链接的下一个有输出的状态，0表示没有
+            uint32_t output = none;      // 在此结束的字面文本的序号
+            uint32_t length = 0;
+        };
+
+        std::vector<State> states{1};
+        std::array<uint32_t, 256> root{}; // 根节点的转移
+        size_t maxLength = 0;
+
+        uint32_t find(const uint32_t state, const unsigned char b) const {
+            const auto &edges = states[state].next;
+            const auto it = std::ranges::lower_bound(edges, b, {}, &Edge::first);
+            return it != edges.end() && it->first == b ? it->second : 0;
+        }
+
+        uint32_t step(uint32_t state, const unsigned char b) const {
+            while (state != 0) {
+                if (const uint32_t next = find(state, b); next != 0) return next;
+                state = states[state].fail;
+            }
+            return root[b];
+        }
+    };
+
+    namespace {
+        class Compiler {
+        public:
+            explicit Compiler(std::vector<Inst> &insts) : insts(insts) {
+            }
+
+            void emit(const Node &node) {
+                if (insts.size() > maxProgramSize) throw std::invalid_argument("正则表达式过大");
+                switch (node.kind) {
+                    case Node::Kind::Empty:
+                        break;
+                    case Node::Kind::Char:
+                        push({Op::Char, node.flag, node.value});
+                        break;
+                    case Node::Kind::Class:
+                        push({Op::Class, false, node.value});
+                        break;
+                    case Node::Kind::Any:
+                        push({Op::Any, node.flag});
+                        break;
+                    case Node::Kind::Assert:
+                        push({Op::Assert, false, node.value});
+                        break;
+                    case Node::Kind::Group:
+                        push({Op::Save, false, node.value * 2});
+                        emit(node.children[0]);
+                        push({Op::Save, false, node.value * 2 + 1});
+                        break;
+                    case Node::Kind::Concat:
+                        for (const auto &child: node.children) emit(child);
+                        break;
+                    case Node::Kind::Alt: {
+                        std::vector<size_t> jumps;
+                        for (size_t i = 0; i + 1 < node.children.size(); i++) {
+                            const size_t split = push({Op::Split});
+                            insts[split].x = static_cast<uint32_t>(split + 1);
+                            emit(node.children[i]);
+                            jumps.push_back(push({Op::Jmp}));
+                            insts[split].y = here();
+                        }
+                        emit(node.children.back());
+                        for (const size_t jump: jumps) insts[jump].x = here();
+                        break;
+                    }
+                    case Node::Kind::Repeat:
+                        emitRepeat(node);
+                        break;
+                }
+            }
+
+        private:
+            std::vector<Inst> &insts;
+
+            size_t push(const Inst inst) {
+                insts.push_back(inst);
+                return insts.size() - 1;
+            }
+
+            uint32_t here() const {
+                return static_cast<uint32_t>(insts.size());
+            }
+
+            // Split的两个目标，贪婪时优先进入循环体
+            void patchSplit(const size_t split, const bool greedy) {
+                const auto body = static_cast<uint32_t>(split + 1);
+                insts[split].x = greedy ? body : here();
+                insts[split].y = greedy ? here() : body;
+            }
+
+            void emitRepeat(const Node &node) {
+                const Node &body = node.children[0];
+                for (int i = 0; i < node.min; i++) emit(body);
+                if (node.max == -1) {
+                    // L: split body, out; body; jmp L
+                    const size_t loop = push({Op::Split});
+                    emit(body);
+                    push({Op::Jmp, false, static_cast<uint32_t>(loop)});
+                    patchSplit(loop, node.flag);
+                } else {
+                    std::vector<size_t> splits;
+                    for (int i = node.min; i < node.max; i++) {
+                        splits.push_back(push({Op::Split}));
+                        emit(body);
+                    }
+                    for (const size_t split: splits) patchSplit(split, node.flag);
+                }
+            }
+        };
+
+        // 收集匹配必须以之开头的字面文本，返回false表示之后的内容不再确定
+        bool literalPrefix(const Node &node, std::string &prefix) {
+            switch (node.kind) {
+                case Node::Kind::Empty:
+                    return true;
+                case Node::Kind::Char:
+                    if (node.flag) return false;
+                    appendUtf8(prefix, node.value);
+                    return true;
+                case Node::Kind::Group:
+                    return literalPrefix(node.children[0], prefix);
+                case Node::Kind::Concat:
+                    for (const auto &child: node.children) {
+                        if (!literalPrefix(child, prefix)) return false;
+                    }
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        bool beginsWithText(const Node &node) {
+            switch (node.kind) {
+                case Node::Kind::Assert:
+                    return node.value == static_cast<uint32_t>(AssertKind::BeginText);
+                case Node::Kind::Group:
+                case Node::Kind::Concat:
+                    return !node.children.empty() && beginsWithText(node.children[0]);
+                default:
+                    return false;
+            }
+        }
+
+        // 分支是否为不区分大小写以外的字面文本，是时把UTF-8编码的文本写入literal
+        bool isLiteral(const Node &node, std::string &literal) {
+            if (node.kind == Node::Kind::Char) {
+                // U+FFFD还匹配不合法的字节
+                if (node.flag || node.value == 0xFFFD) return false;
+                appendUtf8(literal, node.value);
+                return true;
+            }
+            if (node.kind != Node::Kind::Concat) return false;
+            for (const auto &child: node.children) {
+                if (child.kind != Node::Kind::Char || !isLiteral(child, literal)) return false;
+            }
+            return !literal.empty();
+        }
+
+        uint8_t leadByte(const uint32_t c) {
+            std::string s;
+            appendUtf8(s, c);
+            return static_cast<uint8_t>(s[0]);
+        }
+
+        // 匹配的第一个字节可能的取值加入first，返回node能否匹配空文本
+        bool firstBytes(const Node &node, const std::vector<CharClass> &classes, std::bitset<256> &first) {
+            switch (node.kind) {
+                case Node::Kind::Empty:
+                case Node::Kind::Assert:
+                    return true;
+                case Node::Kind::Char:
+                    if (node.value == 0xFFFD) first.set();
+                    first.set(leadByte(node.value));
+                    if (node.flag) first.set(node.value - 32);
+                    return false;
+                case Node::Kind::Class: {
+                    const CharClass &cc = classes[node.value];
+                    if (cc.negate || cc.inRanges(0xFFFD)) {
+                        // 不合法的字节按U+FFFD匹配
+                        first.set();
+                        return false;
+                    }
+                    for (const auto &[lo, hi]: cc.ranges) {
+                        for (uint32_t b = leadByte(lo); b <= leadByte(std::min(hi, maxCodePoint)); b++) first.set(b);
+                    }
+                    if (cc.fold) {
+                        for (uint32_t b = 'A'; b <= 'Z'; b++) first.set(b).set(b + 32);
+                    }
+                    return false;
+                }
+                case Node::Kind::Any:
+                    first.set();
+                    return false;
+                case Node::Kind::Group:
+                    return firstBytes(node.children[0], classes, first);
+                case Node::Kind::Concat:
+                    for (const auto &child: node.children) {
+                        if (!firstBytes(child, classes, first)) return false;
+                    }
+                    return true;
+                case Node::Kind::Alt: {
+                    bool empty = false;
+                    for (const auto &child: node.children) empty = firstBytes(child, classes, first) || empty;
+                    return empty;
+                }
+                case Node::Kind::Repeat:
+                    return firstBytes(node.children[0], classes, first) || node.min == 0;
+            }
+            return true;
+        }
+
+        // Pike VM的线程列表：按优先级排列的指令位置，以及每个位置上线程的分组位置
+        struct ThreadList {
+            std::vector<uint32_t> sparse;
+            std::vector<uint32_t> dense;
+            std::vector<size_t> caps;
+            size_t size = 0;
+
+            void init(const size_t n, const size_t slots) {
+                sparse.resize(n);
+                dense.resize(n);
+                caps.resize(n * slots);
+            }
+
+            bool contains(const uint32_t pc) const {
+                const uint32_t i = sparse[pc];
+                return i < size && dense[i] == pc;
+            }
+
+            void insert(const uint32_t pc) {
+                sparse[pc] = static_cast<uint32_t>(size);
+                dense[size++] = pc;
+            }
+        };
+
+        /**
+         * 在同一段文本上执行程序，多次查找时复用线程列表
+         * 每个位置上每条指令最多只有一个线程，时间为 O(文本长度 × 程序长度)
+         */
+        class Executor {
+        public:
+            Executor(const Program &program, const std::string_view text) : program(program), text(text) {
+                clist.init(program.insts.size(), program.slots);
+                nlist.init(program.insts.size(), program.slots);
+                caps.resize(program.slots);
+            }
+
+            // 从pos开始查找，alternative为匹配的分支序号
+            bool search(size_t pos, Match &match, uint32_t &alternative) {
+                const size_t slots = program.slots;
+                bool matched = false;
+                clist.size = 0;
+                while (true) {
+                    if (!matched && (!program.anchored || pos == 0)) {
+                        if (clist.size == 0 && !program.prefix.empty()) {
+                            pos = text.find(program.prefix, pos);
+                            if (pos == std::string_view::npos) break;
+                        } else if (clist.size == 0 && program.skip) {
+                            while (pos < text.size() && !program.first[static_cast<unsigned char>(text[pos])]) pos++;
+                            if (pos == text.size()) break;
+                        }
+                        std::ranges::fill(caps, std::string::npos);
+                        add(clist, 0, pos);
+                    }
+                    if (clist.size == 0) break;
+                    uint32_t c = 0;
+                    const size_t len = pos < text.size() ? decode(text, pos, c) : 0;
+                    nlist.size = 0;
+                    for (size_t i = 0; i < clist.size; i++) {
+                        const uint32_t pc = clist.dense[i];
+                        const Inst &inst = program.insts[pc];
+                        const size_t *threadCaps = &clist.caps[pc * slots];
+                        if (inst.op == Op::Match) {
+                            matched = true;
+                            match.offsets.assign(threadCaps, threadCaps + slots);
+                            alternative = inst.x;
+                            // 优先级更低的线程不再需要
+                            break;
+                        }
+                        if (len == 0 || !consume(inst, c)) continue;
+                        std::copy_n(threadCaps, slots, caps.begin());
+                        add(nlist, pc + 1, pos + len);
+                    }
+                    std::swap(clist, nlist);
+                    if (len == 0) break;
+                    pos += len;
+                }
+                return matched;
+            }
+
+        private:
+            // 执行中的一项：从pc开始添加线程，或者恢复分组位置slot的值
+            struct Job {
+                uint32_t pc;
+                uint32_t slot;
+                size_t value;
+            };
+
+            const Program &program;
+            std::string_view text;
+            ThreadList clist;
+            ThreadList nlist;
+            std::vector<size_t> caps;
+            std::vector<Job> stack;
+
+            bool consume(const Inst &inst, const uint32_t c) const {
+                switch (inst.op) {
+                    case Op::Char:
+                        return (inst.flag ? toLower(c) : c) == inst.x;
+                    case Op::Class:
+                        return program.classes[inst.x].contains(c);
+                    case Op::Any:
+                        return inst.flag || (c != '\n' && c != '\r');
+                    default:
+                        return false;
+                }
+            }
+
+            bool check(const AssertKind kind, const size_t pos) const {
+                const size_t n = text.size();
+                switch (kind) {
+                    case AssertKind::BeginText:
+                        return pos == 0;
+                    case AssertKind::EndText:
+                        return pos == n;
+                    case AssertKind::EndTextOrNewline:
+                        return pos == n || (pos + 1 == n && isLineEnd(text[pos])) ||
+                               (pos + 2 == n && text[pos] == '\r' && text[pos + 1] == '\n');
+                    case AssertKind::BeginLine:
+                        return pos == 0 || (pos < n && isLineEnd(text[pos - 1]) &&
+                                            !(text[pos - 1] == '\r' && text[pos] == '\n'));
+                    case AssertKind::EndLine:
+                        return pos == n || (isLineEnd(text[pos]) &&
+                                            !(text[pos] == '\n' && pos > 0 && text[pos - 1] == '\r'));
+                    case AssertKind::WordBoundary:
+                    case AssertKind::NotWordBoundary: {
+                        const bool before = pos > 0 && isWordByte(text[pos - 1]);
+                        const bool after = pos < n && isWordByte(text[pos]);
+                        return (before != after) == (kind == AssertKind::WordBoundary);
+                    }
+                }
+                return false;
+            }
+
+            // 沿着不消耗字符的指令把线程加入list，分组位置为caps；用显式的栈代替递归
+            void add(ThreadList &list, const uint32_t start, const size_t pos) {
+                const size_t slots = program.slots;
+                stack.clear();
+                stack.push_back({start, noSlot, 0});
+                while (!stack.empty()) {
+                    const Job job = stack.back();
+                    stack.pop_back();
+                    if (job.slot != noSlot) {
+                        caps[job.slot] = job.value;
+                        continue;
+                    }
+                    uint32_t pc = job.pc;
+                    while (!list.contains(pc)) {
+                        list.insert(pc);
+                        const Inst &inst = program.insts[pc];
+                        if (inst.op == Op::Jmp) {
+                            pc = inst.x;
+                        } else if (inst.op == Op::Split) {
+                            stack.push_back({inst.y, noSlot, 0});
+                            pc = inst.x;
+                        } else if (inst.op == Op::Save) {
+                            stack.push_back({0, inst.x, caps[inst.x]});
+                            caps[inst.x] = pos;
+                            pc++;
+                        } else if (inst.op == Op::Assert) {
+                            if (!check(static_cast<AssertKind>(inst.x), pos)) break;
+                            pc++;
+                        } else {
+                            std::ranges::copy(caps, list.caps.begin() + static_cast<std::ptrdiff_t>(pc * slots));
+                            break;
+                        }
+                    }
+                }
+            }
+        };
+
+        size_t charLength(const std::string_view text, const size_t pos) {
+            uint32_t c;
+            return pos < text.size() ? decode(text, pos, c) : 1;
+        }
+
+        /**
+         * 在同一文本上依次查找，合并字面文本分支与NFA的结果：取最左的匹配，同一位置取序号小的分支
+         * 两者上一次的结果在之后的查找中仍然有效时不再重新查找，整个文本只扫描一遍
+         */
+        class Scanner {
+        public:
+            Scanner(const Program *program, const Literals *literals, const size_t slots, const std::string_view text)
+                : literals(literals), slots(slots), text(text) {
+                if (program != nullptr) executor.emplace(*program, text);
+            }
+
+            bool search(const size_t pos, Match &match) {
+                if (executor.has_value() && !valid(program, pos)) {
+                    program.found = executor->search(pos, program.match, program.alternative);
+                    program.pos = pos;
+                }
+                if (literals != nullptr && !valid(literal, pos)) {
+                    size_t begin, end;
+                    literal.found = literals->search(text, pos, begin, end, literal.alternative);
+                    if (literal.found) {
+                        literal.match.offsets.assign(slots, std::string::npos);
+                        literal.match.offsets[0] = begin;
+                        literal.match.offsets[1] = end;
+                    }
+                    literal.pos = pos;
+                }
+                const Result *best = nullptr;
+                for (const Result *result: {&program, &literal}) {
+                    if (!result->found) continue;
+                    if (best == nullptr || result->match.begin() < best->match.begin() ||
+                        (result->match.begin() == best->match.begin() && result->alternative < best->alternative)) {
+                        best = result;
+                    }
+                }
+                if (best == nullptr) return false;
+                match = best->match;
+                return true;
+            }
+
+        private:
+            struct Result {
+                bool found = false;
+                size_t pos = std::string_view::npos; // 查找的起点，npos表示还没有查找
+                uint32_t alternative = 0;
+                Match match;
+            };
+
+            const Literals *literals;
+            size_t slots;
+            std::string_view text;
+            std::optional<Executor> executor;
+            Result program;
+            Result literal;
+
+            // 从更早的位置查找的结果，没有匹配或者匹配不早于pos时，与从pos查找的结果相同
+            static bool valid(const Result &result, const size_t pos) {
+                return result.pos != std::string_view::npos && result.pos <= pos &&
+                       (!result.found || result.match.begin() >= pos);
+            }
+        };
+    }
+
+    Pattern::Pattern(const std::string &pattern) {
+        try {
+            Parser parser(pattern);
+            const Node root = parser.parse();
+            // 顶层的分支中字面文本由Aho–Corasick自动机匹配，其余的编译为一个NFA，分支序号即优先级
+            std::vector<const Node *> alternatives;
+            if (root.kind == Node::Kind::Alt) {
+                for (const auto &child: root.children) alternatives.push_back(&child);
+            } else {
+                alternatives.push_back(&root);
+            }
+            auto dictionary = std::make_unique<Literals>();
+            std::vector<std::pair<const Node *, uint32_t> > rest;
+            size_t literalCount = 0;
+            for (uint32_t i = 0; i < alternatives.size(); i++) {
+                if (std::string literal; alternatives.size() > 1 && isLiteral(*alternatives[i], literal)) {
+                    dictionary->add(literal, i);
+                    literalCount++;
+                } else {
+                    rest.emplace_back(alternatives[i], i);
+                }
+            }
+            if (literalCount > 0) {
+                dictionary->build();
+                literals = std::move(dictionary);
+            }
+            if (!rest.empty()) {
+                auto compiled = std::make_unique<Program>();
+                compiled->classes = std::move(parser.classes);
+                compiled->slots = (parser.groups + 1) * 2;
+                if (rest.size() == 1 && literalCount == 0) {
+                    literalPrefix(root, compiled->prefix);
+                    compiled->anchored = beginsWithText(root);
+                }
+                bool empty = false;
+                for (const auto &[node, alternative]: rest) {
+                    empty = firstBytes(*node, compiled->classes, compiled->first) || empty;
+                }
+                compiled->skip = !empty && !compiled->first.all();
+                Compiler compiler(compiled->insts);
+                compiled->insts.push_back({Op::Save, false, 0});
+                std::vector<size_t> splits;
+                for (size_t i = 0; i < rest.size(); i++) {
+                    if (i + 1 < rest.size()) {
+                        splits.push_back(compiled->insts.size());
+                        compiled->insts.push_back({Op::Split, false, static_cast<uint32_t>(compiled->insts.size() + 1)});
+                    }
+                    compiler.emit(*rest[i].first);
+                    compiled->insts.push_back({Op::Save, false, 1});
+                    compiled->insts.push_back({Op::Match, false, rest[i].second});
+                    if (i + 1 < rest.size()) compiled->insts[splits.back()].y = static_cast<uint32_t>(compiled->insts.size());
+                }
+                program = std::move(compiled);
+            }
+            groups = parser.groups;
+            names = std::move(parser.names);
+        } catch (const Unsupported &) {
+            try {
+                fallback = std::make_unique<const std::regex>(pattern);
+            } catch (const std::regex_error &e) {
+                throw std::invalid_argument(std::string(e.what()) + ": " + pattern);
+            }
+            groups = fallback->mark_count();
+        }
+    }
+
+    Pattern::~Pattern() = default;
+
+    std::shared_ptr<const Pattern> Pattern::parse(const std::string &pattern) {
+        return std::make_shared<const Pattern>(pattern);
+    }
+
+    std::shared_ptr<const Pattern> Pattern::compile(const std::string &pattern) {
+        static std::mutex mutex;
+        static std::unordered_map<std::string, std::shared_ptr<const Pattern> > cache;
+        constexpr size_t maxCacheSize = 1024;
+        {
+            std::lock_guard lock(mutex);
+            if (const auto it = cache.find(pattern); it != cache.end()) return it->second;
+        }
+        std::shared_ptr<const Pattern> compiled = nullptr;
+        try {
+            compiled = parse(pattern);
+        } catch (const std::invalid_argument &) {
+            compiled = nullptr;
+        }
+        std::lock_guard lock(mutex);
+        if (cache.size() >= maxCacheSize) cache.clear();
+        cache.emplace(pattern, compiled);
+        return compiled;
+    }
+
+    bool Pattern::search(const std::string_view text, const size_t from, Match &match) const {
+        if (from > text.size()) return false;
+        if (fallback == nullptr) {
+            return Scanner(program.get(), literals.get(), (groups + 1) * 2, text).search(from, match);
+        }
+        std::match_results<std::string_view::const_iterator> m;
+        const auto flags = from > 0 ? std::regex_constants::match_prev_avail : std::regex_constants::match_default;
+        if (!std::regex_search(text.begin() + static_cast<std::ptrdiff_t>(from), text.end(), m, *fallback, flags)) {
+            return false;
+        }
+        match.offsets.assign((groups + 1) * 2, std::string::npos);
+        for (size_t i = 0; i < m.size() && i <= groups; i++) {
+            if (!m[i].matched) continue;
+            match.offsets[i * 2] = m[i].first - text.begin();
+            match.offsets[i * 2 + 1] = m[i].second - text.begin();
+        }
+        return true;
+    }
+
+    std::vector<Match> Pattern::findAll(const std::string_view text) const {
+        std::vector<Match> matches;
+        std::optional<Scanner> scanner;
+        if (fallback == nullptr) scanner.emplace(program.get(), literals.get(), (groups + 1) * 2, text);
+        size_t pos = 0;
+        Match match;
+        while (pos <= text.size() && (scanner.has_value() ? scanner->search(pos, match) : search(text, pos, match))) {
+            // 空的匹配之后前进一个字符
+            pos = match.end() > match.begin() ? match.end() : match.end() + charLength(text, match.end());
+            matches.push_back(std::move(match));
+        }
+        return matches;
+    }
+
+    std::string Pattern::replace(const std::string_view text, const std::string_view replacement, const bool first) const {
+        std::string result;
+        std::optional<Scanner> scanner;
+        if (fallback == nullptr) scanner.emplace(program.get(), literals.get(), (groups + 1) * 2, text);
+        size_t pos = 0;
+        size_t last = 0;
+        Match match;
+        while (pos <= text.size() && (scanner.has_value() ? scanner->search(pos, match) : search(text, pos, match))) {
+            result.append(text.substr(last, match.begin() - last));
+            result += expand(text, match, replacement);
+            last = match.end();
+            if (first) break;
+            pos = match.end() > match.begin() ? match.end() : match.end() + charLength(text, match.end());
+        }
+        result.append(text.substr(std::min(last, text.size())));
+        return result;
+    }
+
+    std::string Pattern::expand(const std::string_view text, const Match &match, const std::string_view replacement) const {
+        std::string result;
+        for (size_t i = 0; i < replacement.size(); i++) {
+            const char c = replacement[i];
+            if (c == '\\' && i + 1 < replacement.size()) {
+                result += replacement[++i];
+                continue;
+            }
+            if (c != '$' || i + 1 >= replacement.size()) {
+                result += c;
+                continue;
+            }
+            const char next = replacement[i + 1];
+            if (next >= '0' && next <= '9') {
+                // 与Java一致，分组序号尽量取更多的数字，但不超过分组数量
+                size_t group = next - '0';
+                i++;
+                while (i + 1 < replacement.size() && replacement[i + 1] >= '0' && replacement[i + 1] <= '9') {
+                    const size_t more = group * 10 + (replacement[i + 1] - '0');
+                    if (more > groups) break;
+                    group = more;
+                    i++;
+                }
+                result += match.group(text, group);
+            } else if (next == '&') {
+                i++;
+                result += match.group(text, 0);
+            } else if (next == '$') {
+                i++;
+                result += '$';
+            } else if (next == '{') {
+                const size_t end = replacement.find('}', i + 2);
+                if (end == std::string_view::npos) {
+                    result += c;
+                    continue;
+                }
+                const std::string_view name = replacement.substr(i + 2, end - i - 2);
+                for (const auto &[groupName, index]: names) {
+                    if (groupName == name) result += match.group(text, index);
+                }
+                i = end;
+            } else {
+                result += c;
+            }
+        }
+        return result;
+    }
+}
@@ -1,10 +1,15 @@
+#include <charconv>
 #include <sstream>
+#include <mutex>
 #include <iostream>
 #include <nlohmann/json.hpp>
 #include <booksource/rule.h>
 #include <booksource/engine.h>
 #include <booksource/utils.h>
 #include <booksource/constants.h>
+#include <booksource/charset.h>
+#include <booksource/cookie.h>
+#include <booksource/ratelimiter.h>
 
 static void parseHeaderMap(
     const std::string &jsonStr,
@@ -68,6 +73,9 @@ static std::string trimCopy(std::string s) {
     return s;
 }
 
+BaseSource::BaseSource() : sourceCache(std::make_shared<SourceCache>()) {
+}
+
 std::optional<std::string> BaseSource::getLoginJs() const {
     if (!loginUrl.has_value()) {
         return std::nullopt;
@@ -90,45 +98,159 @@ std::optional<std::string> BaseSource::getLoginJs() const {
     return loginJs;
 }
 
+/**
+ * 执行header规则中的js
+ * @param dynamic 输出脚本是否声明了 dynamicHeader = true，即请求头每次都需要重新计算
+ */
+static std::string evalHeaderJs(BaseSource &source, const std::string &jsStr, bool &dynamic) {
+    auto &engine = QuickJsEngine::current();
+    engine.reset();
+    engine.addValue("baseUrl", source.getKey());
+    engine.addValue("dynamicHeader", false);
+    std::string result = engine.eval(jsStr);
+    dynamic = engine.eval("dynamicHeader === true") == "true";
+    return result;
+}
+
 std::unordered_map<std::string, std::string> BaseSource::getHeaderMap(bool hasLoginHeader) {
-    std::unordered_map<std::string, std::string> result;
-    if (header.has_value()) {
-        try {
-            std::string json;
-            const std::string &headerStr = header.value();
-            if (headerStr.rfind("@js:", 0) == 0) {
-                // startsWith("@js:")
-                json = evalJS(headerStr.substr(4));
-            } else if (headerStr.rfind("<js>", 0) == 0) {
-                // startsWith("<js>")
-                const size_t endPos = headerStr.find_last_of('<');
-                json = evalJS(headerStr.substr(4, endPos - 4));
-            } else {
-                json = headerStr;
+    using HeaderMap = SourceCache::HeaderMap;
+    std::shared_ptr<const HeaderMap> base = nullptr;
+    {
+        std::lock_guard lock(sourceCache->mutex);
+        if (sourceCache->headerMap && sourceCache->headerRule == header) {
+            if (!hasLoginHeader) return *sourceCache->headerMap;
+            if (sourceCache->headerMapWithLogin) return *sourceCache->headerMapWithLogin;
+            base = sourceCache->headerMap;
+        }
+    }
+    // 缓存未命中：解析header规则，js执行失败或者声明了dynamicHeader时不缓存
+    bool cacheable = true;
+    if (!base) {
+        HeaderMap result;
+        if (header.has_value()) {
+            try {
+                std::string json;
+                bool dynamic = false;
+                const std::string &headerStr = header.value();
+                if (headerStr.rfind("@js:", 0) == 0) {
+                    // startsWith("@js:")
+                    json = evalHeaderJs(*this, headerStr.substr(4), dynamic);
+                } else if (headerStr.rfind("<js>", 0) == 0) {
+                    // startsWith("<js>")
+                    const size_t endPos = headerStr.find_last_of('<');
+                    json = evalHeaderJs(*this, headerStr.substr(4, endPos - 4), dynamic);
+                } else {
+                    json = headerStr;
+                }
+                cacheable = !dynamic;
+                parseHeaderMap(json, result);
+            } catch (...) {
+                // TODO: 输出错误日志
+                cacheable = false;
             }
-            parseHeaderMap(json, result);
-        } catch (...) {
-            // TODO: 输出错误日志
         }
+        // 如果没有UA，使用默认的UA
+        if (!mapContainsIgnoreCase(result, Constants::UA_KEY)) {
+            result[Constants::UA_KEY] = Constants::UA_DEFAULT_VALUE;
+        }
+        base = std::make_shared<const HeaderMap>(std::move(result));
     }
-    // 如果没有UA，使用默认的UA
-    if (!mapContainsIgnoreCase(result, Constants::UA_KEY)) {
-        result[Constants::UA_KEY] = Constants::UA_DEFAULT_VALUE;
+    std::lock_guard lock(sourceCache->mutex);
+    if (cacheable) {
+        if (sourceCache->headerRule != header) {
+            sourceCache->headerMapWithLogin = nullptr;
+        }
+        sourceCache->headerRule = header;
+        sourceCache->headerMap = base;
     }
-    if (hasLoginHeader) {
-        // TODO: Cache process
+    if (!hasLoginHeader || sourceCache->loginHeaderMap.empty()) {
+        return *base;
     }
-    return result;
+    // 登录头覆盖同名的请求头
+    HeaderMap merged = *base;
+    for (const auto &[k, v]: sourceCache->loginHeaderMap) {
+        merged[k] = v;
+    }
+    if (cacheable) {
+        sourceCache->headerMapWithLogin = std::make_shared<const HeaderMap>(merged);
+    }
+    return merged;
+}
+
+void BaseSource::putLoginHeader(const std::string &loginHeader) {
+    auto map = JsonUtils::jsonStringToMap(loginHeader);
+    std::lock_guard lock(sourceCache->mutex);
+    sourceCache->loginHeader = loginHeader;
+    sourceCache->loginHeaderMap = std::move(map);
+    sourceCache->headerMapWithLogin = nullptr;
+}
+
+std::optional<std::string> BaseSource::getLoginHeader() const {
+    std::lock_guard lock(sourceCache->mutex);
+    return sourceCache->loginHeader;
+}
+
+void BaseSource::removeLoginHeader() {
+    std::lock_guard lock(sourceCache->mutex);
+    sourceCache->loginHeader = std::nullopt;
+    sourceCache->loginHeaderMap.clear();
+    sourceCache->headerMapWithLogin = nullptr;
 }
 
 std::string BaseSource::evalJS(std::string jsStr) {
-    auto engine = QuickJsEngine::current();
+    auto &engine = QuickJsEngine::current();
     engine.reset();
     // TODO: support more binding variable
     engine.addValue("baseUrl", getKey());
     return engine.eval(jsStr);
 }
 
+std::shared_ptr<const UrlTemplate> BaseSource::getUrlTemplate(const std::string &ruleUrl) {
+    // 章节等一次性的url会挤掉搜索、发现页的模板，不缓存
+    if (!isOwnUrlRule(ruleUrl)) return UrlTemplate::compile(ruleUrl);
+    // exploreUrl很长时可能有很多项，超过上限时直接清空
+    constexpr size_t maxCacheSize = 256;
+    {
+        std::lock_guard lock(sourceCache->mutex);
+        if (const auto it = sourceCache->urlTemplates.find(ruleUrl); it != sourceCache->urlTemplates.end()) {
+            return it->second;
+        }
+    }
+    auto urlTemplate = UrlTemplate::compile(ruleUrl);
+    std::lock_guard lock(sourceCache->mutex);
+    if (sourceCache->urlTemplates.size() >= maxCacheSize) {
+        sourceCache->urlTemplates.clear();
+    }
+    sourceCache->urlTemplates.emplace(ruleUrl, urlTemplate);
+    return urlTemplate;
+}
+
+std::shared_ptr<const Regexp::Pattern> BaseSource::getRegexp(const std::string &pattern) {
+    constexpr size_t maxCacheSize = 256;
+    {
+        std::lock_guard lock(sourceCache->mutex);
+        if (const auto it = sourceCache->regexps.find(pattern); it != sourceCache->regexps.end()) {
+            return it->second;
+        }
+    }
+    std::shared_ptr<const Regexp::Pattern> regexp = nullptr;
+    try {
+        regexp = Regexp::Pattern::parse(pattern);
+    } catch (const std::invalid_argument &) {
+        regexp = nullptr;
+    }
+    std::lock_guard lock(sourceCache->mutex);
+    if (sourceCache->regexps.size() >= maxCacheSize) {
+        sourceCache->regexps.clear();
+    }
+    sourceCache->regexps.emplace(pattern, regexp);
+    return regexp;
+}
+
+std::shared_ptr<CookieJar> BaseSource::getCookieJar() {
+    return CookieJar::forSource(getKey());
+}
+
 std::string BookSource::getTag() {
     return bookSourceName;
 }
@@ -137,6 +259,13 @@ std::string BookSource::getKey() {
     return bookSourceUrl;
 }
 
+bool BookSource::isOwnUrlRule(const std::string &ruleUrl) const {
+    if (ruleUrl.empty()) return false;
+    if (searchUrl == ruleUrl) return true;
+    // 发现页的每一项为 名称::url，url是exploreUrl中的一段
+    return exploreUrl.has_value() && exploreUrl->find(ruleUrl) != std::string::npos;
+}
+
 
 using json = nlohmann::json;
 
@@ -594,30 +723,130 @@ std::string RuleAnalyzer::innerRuleCode(
 std::vector<std::string> RuleAnalyzer::splitRule(const std::vector<std::string> &split) {
     elementsType = split[0];
 
-    if (!consumeTo(elementsType)) {
+    // 以最先出现的分隔符作为本条规则的分隔类型
+    const size_t first = findSplit(split, pos);
+    if (first == std::string::npos) {
         rule.push_back(queue.substr(startX));
         return rule;
     }
-
+    pos = first;
     step = static_cast<int>(elementsType.size());
     splitRuleRec(split);
     return rule;
 }
 
 void RuleAnalyzer::splitRuleRec(const std::vector<std::string> &split) {
-    while (consumeTo(elementsType)) {
-        const size_t end = pos;
-
-        std::string part = queue.substr(startX, end - startX);
-        rule.push_back(part);
-
+    const std::vector<std::string> type{elementsType};
+    while (pos != std::string::npos) {
+        rule.push_back(queue.substr(startX, pos - startX));
         pos += step;
         startX = pos;
+        pos = findSplit(type, pos);
     }
-
+    pos = queue.size();
     rule.push_back(queue.substr(startX));
 }
 
+// 查找第一个出现的分隔符，[]与()中的内容不参与分割，找到时将elementsType设置为该分隔符
+size_t RuleAnalyzer::findSplit(const std::vector<std::string> &split, size_t from) {
+    int depth = 0;
+    char quote = '\0';
+    for (size_t p = from; p < queue.size(); p++) {
+        const char c = queue[p];
+        if (quote != '\0') {
+            if (c == '\\') p++;
+            else if (c == quote) quote = '\0';
+            continue;
+        }
+        if (depth > 0 && (c == '\'' || c == '"')) {
+            quote = c;
+            continue;
+        }
+        if (c == '[' || c == '(') {
+            depth++;
+            continue;
+        }
+        if ((c == ']' || c == ')') && depth > 0) {
+            depth--;
+            continue;
+        }
+        if (depth > 0) continue;
+        for (const auto &s: split) {
+            if (queue.compare(p, s.size(), s) == 0) {
+                elementsType = s;
+                return p;
+            }
+        }
+    }
+    return std::string::npos;
+}
+
+// 查找下一个 @put:{...}，返回其位置与长度
+static bool findPutRule(const std::string &rule, const size_t from, size_t &pos, size_t &len) {
+    for (size_t p = from; p + 6 < rule.size(); p++) {
+        if (rule[p] != '@' || !StringUtils::startsWithIgnoreCase(rule.substr(p, 6), "@put:{")) continue;
+        const size_t end = rule.find('}', p + 6);
+        if (end == std::string::npos) return false;
+        if (end == p + 6) continue;
+        pos = p;
+        len = end + 1 - p;
+        return true;
+    }
+    return false;
+}
+
+// 查找下一个 @get:{key} 或者 {{js}}，返回其位置与长度
+static bool findEvalRule(const std::string &rule, const size_t from, size_t &pos, size_t &len) {
+    for (size_t p = from; p + 1 < rule.size(); p++) {
+        if (rule[p] == '{' && rule[p + 1] == '{') {
+            const size_t end = rule.find("}}", p + 2);
+            if (end == std::string::npos) continue;
+            pos = p;
+            len = end + 2 - p;
+            return true;
+        }
+        if (rule[p] == '@' && StringUtils::startsWithIgnoreCase(rule.substr(p, 6), "@get:{")) {
+            const size_t end = rule.find('}', p + 6);
+            if (end == std::string::npos || end == p + 6) continue;
+            pos = p;
+            len = end + 1 - p;
+            return true;
+        }
+    }
+    return false;
+}
+
+// 查找limit之前的下一个 $1、$2 等AllInOne正则的分组，返回其位置与长度
+static bool findGroupRule(const std::string &rule, const size_t from, const size_t limit, size_t &pos, size_t &len) {
+    for (size_t p = from; p + 1 < rule.size() && p < limit; p++) {
+        if (rule[p] != '$' || !std::isdigit(static_cast<unsigned char>(rule[p + 1]))) continue;
+        pos = p;
+        len = p + 2 < rule.size() && std::isdigit(static_cast<unsigned char>(rule[p + 2])) ? 3 : 2;
+        return true;
+    }
+    return false;
+}
+
+// 分离 @put:{"key":"rule"}，保存到putMap中
+static std::string splitPutRule(const std::string &ruleStr, std::unordered_map<std::string, std::string> &putMap) {
+    std::string rule;
+    size_t start = 0;
+    size_t pos = 0;
+    size_t len = 0;
+    while (findPutRule(ruleStr, start, pos, len)) {
+        rule += ruleStr.substr(start, pos - start);
+        const json map = json::parse(ruleStr.substr(pos + 5, len - 5), nullptr, false);
+        if (map.is_object()) {
+            for (const auto &[key, value]: map.items()) {
+                putMap[key] = value.is_string() ? value.get<std::string>() : value.dump();
+            }
+        }
+        start = pos + len;
+    }
+    if (start == 0) return ruleStr;
+    return rule + ruleStr.substr(start);
+}
+
 SourceRule::SourceRule(
         AnalyzeRule &_outer,
         const std::string &ruleStr,
@@ -645,6 +874,599 @@ SourceRule::SourceRule(
     } else {
         rule = ruleStr;
     }
+    // 分离put
+    rule = splitPutRule(rule, putMap);
+    // 拆分 @get:{key}、{{js}}，以及正则模式中的 $1、$2 等，拼接的规则在执行时才能确定
+    // 替换规则中的 $n 是替换的分组，不在这里拆分
+    const size_t groupLimit = this->mode == Regex ? rule.find("##") : 0;
+    size_t pos = 0;
+    size_t len = 0;
+    const auto findParam = [&](const size_t from) {
+        const bool found = findEvalRule(rule, from, pos, len);
+        if (size_t groupPos, groupLen; findGroupRule(rule, from, groupLimit, groupPos, groupLen) &&
+                                       (!found || groupPos < pos)) {
+            pos = groupPos;
+            len = groupLen;
+            return true;
+        }
+        return found;
+    };
+    if (!findParam(0)) {
+        splitReplaceRegex();
+        return;
+    }
+    // {{js}}前面没有替换规则时，整条规则是拼接的文本
+    if (this->mode != Js && this->mode != Regex && (pos == 0 || rule.substr(0, pos).find("##") == std::string::npos)) {
+        this->mode = Regex;
+    }
+    size_t start = 0;
+    do {
+        if (pos > start) {
+            ruleType.push_back(defaultRuleType);
+            ruleParam.push_back(rule.substr(start, pos - start));
+        }
+        if (rule[pos] == '$') {
+            ruleType.push_back(std::stoi(rule.substr(pos + 1, len - 1)));
+            ruleParam.push_back(rule.substr(pos, len));
+        } else if (rule[pos] == '@') {
+            ruleType.push_back(getRuleType);
+            ruleParam.push_back(rule.substr(pos + 6, len - 7));
+        } else {
+            ruleType.push_back(jsRuleType);
+            ruleParam.push_back(rule.substr(pos + 2, len - 4));
+        }
+        start = pos + len;
+    } while (findParam(start));
+    if (rule.size() > start) {
+        ruleType.push_back(defaultRuleType);
+        ruleParam.push_back(rule.substr(start));
+    }
+}
+
+void SourceRule::splitReplaceRegex() {
+    // rule##replaceRegex##replacement，以###结尾时只替换第一个匹配
+    const size_t first = rule.find("##");
+    if (first == std::string::npos) {
+        StringUtils::trim(rule);
+        return;
+    }
+    std::vector<std::string> parts;
+    size_t start = 0;
+    size_t pos = first;
+    while (pos != std::string::npos) {
+        parts.push_back(rule.substr(start, pos - start));
+        start = pos + 2;
+        pos = rule.find("##", start);
+    }
+    parts.push_back(rule.substr(start));
+    rule = parts[0];
+    StringUtils::trim(rule);
+    replaceRegex = parts[1];
+    if (parts.size() > 2) replacement = parts[2];
+    if (parts.size() > 3) replaceFirst = true;
+}
+
+// 规则中是否为非js的规则，{{ }}中的这类规则按规则执行
+static bool isRule(const std::string &ruleStr) {
+    return ruleStr.starts_with('@') || ruleStr.starts_with("$.") || ruleStr.starts_with("$[") ||
+           ruleStr.starts_with("//");
+}
+
+static bool isJson(const std::string &str) {
+    const size_t first = str.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return false;
+    const size_t last = str.find_last_not_of(" \t\r\n");
+    return (str[first] == '{' && str[last] == '}') || (str[first] == '[' && str[last] == ']');
+}
+
+/**
+ * 规则执行对象的文本：文本本身，html节点为其html（文档为原始网页内容），
+ * json的字符串为解码后的内容，数组与对象为json
+ */
+static std::string contentText(const RuleContent &value) {
+    if (const auto *text = std::get_if<std::string>(&value)) return *text;
+    if (const auto *html = std::get_if<HtmlContent>(&value)) {
+        const Html::Node *node = html->node != nullptr ? html->node : html->document->root();
+        switch (node->type) {
+            case Html::NodeType::Document:
+                return html->document->source();
+            case Html::NodeType::Element:
+                return node->outerHtml();
+            case Html::NodeType::Text:
+                return node->textNodeText();
+            default:
+                return node->data();
+        }
+    }
+    if (const auto *regex = std::get_if<RegexContent>(&value)) return std::string(regex->group(0));
+    const auto &jsonContent = std::get<JsonContent>(value);
+    return jsonContent.value.valid() ? jsonContent.value.getString() : jsonContent.document->source();
+}
+
+static std::string joinText(const std::vector<RuleContent> &values) {
+    std::string text;
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i > 0) text += '\n';
+        text += contentText(values[i]);
+    }
+    return text;
+}
+
+static std::string joinText(const std::vector<std::string> &values) {
+    std::string text;
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i > 0) text += '\n';
+        text += values[i];
+    }
+    return text;
+}
+
+// js在列表规则中的结果以json传出：数组的每一项为列表中的一项，字符串为文本
+static std::vector<RuleContent> jsElements(const std::string &result) {
+    std::vector<RuleContent> elements;
+    std::shared_ptr<const JsonPath::Document> document;
+    try {
+        document = JsonPath::Document::parse(result);
+    } catch (const std::invalid_argument &) {
+        return elements;
+    }
+    const auto add = [&](const JsonPath::Value value) {
+        if (value.isString()) {
+            elements.emplace_back(value.getString());
+        } else {
+            elements.emplace_back(JsonContent{document, value});
+        }
+    };
+    const JsonPath::Value root = document->root();
+    if (root.isArray()) {
+        for (const auto &value: root.children()) add(value);
+    } else if (!root.isNull()) {
+        add(root);
+    }
+    return elements;
+}
+
+AnalyzeRule &AnalyzeRule::setContent(
+    std::optional<RuleContent> _content,
+    const std::optional<std::string> &_baseUrl
+) {
+    if (!_content.has_value()) {
+        throw std::runtime_error("Content cannot be null");
+    }
+    content = std::move(_content);
+    if (const auto *text = std::get_if<std::string>(&*content)) {
+        isJSON = isJson(*text);
+    } else if (const auto *jsonContent = std::get_if<JsonContent>(&*content)) {
+        isJSON = jsonContent->value.isString() ? isJson(jsonContent->value.getString()) : !jsonContent->value.isNull();
+    } else {
+        isJSON = false;
+    }
+    setBaseUrl(_baseUrl);
+    analyzeByJSonPath = std::nullopt;
+    analyzeByXPath = std::nullopt;
+    analyzeByJSoup = std::nullopt;
+    return *this;
+}
+
+AnalyzeByJSoup AnalyzeRule::getAnalyzeByJSoup(const RuleContent &value, const bool isContent) {
+    if (const auto *html = std::get_if<HtmlContent>(&value)) {
+        return AnalyzeByJSoup(html->document, html->node);
+    }
+    if (!isContent) {
+        return AnalyzeByJSoup(contentText(value));
+    }
+    if (!analyzeByJSoup.has_value()) {
+        if (analyzeByXPath.has_value()) {
+            analyzeByJSoup.emplace(analyzeByXPath->getDocument());
+        } else {
+            analyzeByJSoup.emplace(contentText(value));
+        }
+    }
+    return *analyzeByJSoup;
+}
+
+AnalyzeByXPath AnalyzeRule::getAnalyzeByXPath(const RuleContent &value, const bool isContent) {
+    if (const auto *html = std::get_if<HtmlContent>(&value)) {
+        return AnalyzeByXPath(html->document, html->node);
+    }
+    if (!isContent) {
+        return AnalyzeByXPath(contentText(value));
+    }
+    if (!analyzeByXPath.has_value()) {
+        if (analyzeByJSoup.has_value()) {
+            analyzeByXPath.emplace(analyzeByJSoup->getDocument());
+        } else {
+            analyzeByXPath.emplace(contentText(value));
+        }
+    }
+    return *analyzeByXPath;
+}
+
+std::optional<AnalyzeByJSonPath> AnalyzeRule::getAnalyzeByJSonPath(const RuleContent &value, const bool isContent) {
+    if (const auto *jsonContent = std::get_if<JsonContent>(&value); jsonContent != nullptr && !jsonContent->value.isString()) {
+        return AnalyzeByJSonPath(jsonContent->document, jsonContent->value);
+    }
+    try {
+        if (!isContent) {
+            return AnalyzeByJSonPath(contentText(value));
+        }
+        if (!analyzeByJSonPath.has_value()) {
+            analyzeByJSonPath.emplace(contentText(value));
+        }
+        return analyzeByJSonPath;
+    } catch (const std::invalid_argument &) {
+        return std::nullopt;
+    }
+}
+
+std::vector<RuleContent> AnalyzeRule::selectElements(
+    const SourceRule &sourceRule,
+    const RuleContent &value,
+    const bool isContent
+) {
+    std::vector<RuleContent> elements;
+    switch (sourceRule.mode) {
+        case Json: {
+            if (const auto analyzer = getAnalyzeByJSonPath(value, isContent)) {
+                for (const auto &item: analyzer->getList(sourceRule.rule)) {
+                    elements.emplace_back(JsonContent{analyzer->getDocument(), item});
+                }
+            }
+            break;
+        }
+        case XPath: {
+            const auto analyzer = getAnalyzeByXPath(value, isContent);
+            for (const Html::Node *node: analyzer.getElements(sourceRule.rule)) {
+                elements.emplace_back(HtmlContent{analyzer.getDocument(), node});
+            }
+            break;
+        }
+        case Default: {
+            const auto analyzer = getAnalyzeByJSoup(value, isContent);
+            for (const Html::Node *node: analyzer.getElements(sourceRule.rule)) {
+                elements.emplace_back(HtmlContent{analyzer.getDocument(), node});
+            }
+            break;
+        }
+        default:
+            // AllInOne的正则规则在getElements()中处理
+            break;
+    }
+    return elements;
+}
+
+std::shared_ptr<const Regexp::Pattern> AnalyzeRule::getRegexp(const std::string &pattern) const {
+    return source != nullptr ? source->getRegexp(pattern) : Regexp::Pattern::compile(pattern);
+}
+
+std::vector<RuleContent> AnalyzeRule::regexElements(const std::string &rule, std::string text) {
+    // 与阅读一致按'&&'直接分割，不考虑正则中的括号
+    std::vector<std::string> regs;
+    size_t start = 0;
+    while (start <= rule.size()) {
+        size_t end = rule.find("&&", start);
+        if (end == std::string::npos) end = rule.size();
+        if (std::string reg = rule.substr(start, end - start); !isBlank(reg)) regs.push_back(std::move(reg));
+        start = end + 2;
+    }
+    std::vector<RuleContent> elements;
+    for (size_t i = 0; i < regs.size(); i++) {
+        const auto pattern = getRegexp(regs[i]);
+        if (pattern == nullptr) break;
+        auto matches = pattern->findAll(text);
+        if (matches.empty()) break;
+        if (i + 1 < regs.size()) {
+            std::string joined;
+            for (const auto &match: matches) joined += match.group(text);
+            text = std::move(joined);
+            continue;
+        }
+        // 每一项只记录分组的位置，共享同一份文本
+        const auto shared = std::make_shared<const std::string>(std::move(text));
+        elements.reserve(matches.size());
+        for (auto &match: matches) {
+            elements.emplace_back(RegexContent{shared, std::move(match)});
+        }
+    }
+    return elements;
+}
+
+std::vector<RuleContent> AnalyzeRule::getElements(const std::string &ruleStr) {
+    std::vector<RuleContent> result;
+    const auto ruleList = splitSourceRule(ruleStr, true);
+    if (!content.has_value() || ruleList.empty()) {
+        return result;
+    }
+    bool isContent = true;
+    for (const auto &sourceRule: ruleList) {
+        putRule(sourceRule.putMap);
+        std::vector<RuleContent> elements;
+        if (sourceRule.mode == Js) {
+            // 列表作为整体传给js，结果转换为json
+            const std::string code = "JSON.stringify(eval(" +
+                json(sourceRule.rule).dump(-1, ' ', false, json::error_handler_t::replace) + "))";
+            elements = jsElements(evalJS(code, isContent ? contentText(*content) : joinText(result)));
+        } else if (sourceRule.mode == Regex) {
+            elements = regexElements(sourceRule.rule, isContent ? contentText(*content) : joinText(result));
+        } else if (isContent) {
+            elements = selectElements(sourceRule, *content, true);
+        } else {
+            for (const auto &item: result) {
+                auto sub = selectElements(sourceRule, item, false);
+                elements.insert(elements.end(), std::make_move_iterator(sub.begin()), std::make_move_iterator(sub.end()));
+            }
+        }
+        if (!sourceRule.replaceRegex.empty()) {
+            std::string text = replaceRegex(joinText(elements), sourceRule);
+            elements.clear();
+            elements.emplace_back(std::move(text));
+        }
+        result = std::move(elements);
+        isContent = false;
+        if (result.empty()) break;
+    }
+    return result;
+}
+
+const std::vector<SourceRule> &AnalyzeRule::splitSourceRuleCacheString(const std::string &ruleStr) {
+    if (const auto it = stringRuleCache.find(ruleStr); it != stringRuleCache.end()) {
+        return it->second;
+    }
+    return stringRuleCache.emplace(ruleStr, splitSourceRule(ruleStr)).first->second;
+}
+
+const SourceRule &AnalyzeRule::makeUpRule(
+    const SourceRule &sourceRule,
+    const RuleContent &result,
+    std::optional<SourceRule> &made
+) {
+    if (sourceRule.ruleParam.empty()) {
+        return sourceRule;
+    }
+    std::string rule;
+    for (size_t i = 0; i < sourceRule.ruleParam.size(); i++) {
+        const std::string &param = sourceRule.ruleParam[i];
+        switch (sourceRule.ruleType[i]) {
+            case SourceRule::jsRuleType:
+                if (isRule(param)) {
+                    std::vector<SourceRule> ruleList;
+                    ruleList.emplace_back(*this, param);
+                    rule += getString(ruleList);
+                } else {
+                    rule += evalJS(param, contentText(result));
+                }
+                break;
+            case SourceRule::getRuleType:
+                rule += get(param);
+                break;
+            default:
+                // AllInOne列表项的分组，不是列表项时保留原文
+                if (const auto *regex = std::get_if<RegexContent>(&result); regex != nullptr && sourceRule.ruleType[i] > 0) {
+                    rule += regex->group(sourceRule.ruleType[i]);
+                } else {
+                    rule += param;
+                }
+                break;
+        }
+    }
+    made.emplace(sourceRule);
+    made->rule = std::move(rule);
+    made->ruleParam.clear();
+    made->ruleType.clear();
+    made->splitReplaceRegex();
+    return *made;
+}
+
+std::vector<std::string> AnalyzeRule::getStringList(const std::optional<std::string> &ruleStr, const bool isUrl) {
+    if (StringUtils::isNullOrEmpty(ruleStr)) {
+        return {};
+    }
+    return getStringList(splitSourceRuleCacheString(*ruleStr), isUrl);
+}
+
+std::vector<std::string> AnalyzeRule::getStringList(const std::vector<SourceRule> &ruleList, const bool isUrl) {
+    std::vector<std::string> list;
+    // js与拼接的规则的结果为单个文本，最后按行分割
+    std::optional<std::string> text;
+    if (content.has_value() && !ruleList.empty()) {
+        const RuleContent *value = &*content;
+        RuleContent step;
+        for (size_t i = 0; i < ruleList.size(); i++) {
+            if (i > 0) {
+                step = text.has_value() ? std::move(*text) : joinText(list);
+                value = &step;
+            }
+            const bool isContent = i == 0;
+            putRule(ruleList[i].putMap);
+            std::optional<SourceRule> made;
+            const SourceRule &sourceRule = makeUpRule(ruleList[i], *value, made);
+            text.reset();
+            list.clear();
+            if (!sourceRule.rule.empty()) {
+                switch (sourceRule.mode) {
+                    case Js:
+                        text = evalJS(sourceRule.rule, contentText(*value));
+                        break;
+                    case Json:
+                        if (const auto analyzer = getAnalyzeByJSonPath(*value, isContent)) {
+                            list = analyzer->getStringList(sourceRule.rule);
+                        }
+                        break;
+                    case XPath:
+                        list = getAnalyzeByXPath(*value, isContent).getStringList(sourceRule.rule);
+                        break;
+                    case Default:
+                        list = getAnalyzeByJSoup(*value, isContent).getStringList(sourceRule.rule);
+                        break;
+                    default:
+                        text = sourceRule.rule;
+                        break;
+                }
+            } else {
+                text = contentText(*value);
+            }
+            if (!sourceRule.replaceRegex.empty()) {
+                if (text.has_value()) {
+                    text = replaceRegex(*text, sourceRule);
+                } else {
+                    for (auto &item: list) item = replaceRegex(item, sourceRule);
+                }
+            }
+        }
+    }
+    if (text.has_value()) {
+        size_t start = 0;
+        size_t pos;
+        while ((pos = text->find('\n', start)) != std::string::npos) {
+            list.push_back(text->substr(start, pos - start));
+            start = pos + 1;
+        }
+        list.push_back(text->substr(start));
+    }
+    if (isUrl) {
+        std::vector<std::string> urlList;
+        const std::string &base = redirectUrl.has_value() ? *redirectUrl : baseUrl.value_or("");
+        for (const auto &url: list) {
+            std::string absoluteURL = NetworkUtils::getAbsoluteURL(base, url);
+            if (!absoluteURL.empty() && std::ranges::find(urlList, absoluteURL) == urlList.end()) {
+                urlList.push_back(std::move(absoluteURL));
+            }
+        }
+        return urlList;
+    }
+    return list;
+}
+
+std::string AnalyzeRule::getString(const std::optional<std::string> &ruleStr, const bool isUrl, const bool unescape) {
+    if (StringUtils::isNullOrEmpty(ruleStr)) {
+        return "";
+    }
+    return getString(splitSourceRuleCacheString(*ruleStr), isUrl, unescape);
+}
+
+std::string AnalyzeRule::getString(const std::vector<SourceRule> &ruleList, const bool isUrl, const bool unescape) {
+    std::optional<std::string> result;
+    if (content.has_value() && !ruleList.empty()) {
+        const RuleContent *value = &*content;
+        RuleContent step;
+        for (size_t i = 0; i < ruleList.size(); i++) {
+            if (i > 0) {
+                // 上一条规则没有结果时不再继续
+                if (!result.has_value()) break;
+                step = std::move(*result);
+                value = &step;
+            }
+            const bool isContent = i == 0;
+            putRule(ruleList[i].putMap);
+            std::optional<SourceRule> made;
+            const SourceRule &sourceRule = makeUpRule(ruleList[i], *value, made);
+            if (!isBlank(sourceRule.rule) || sourceRule.replaceRegex.empty()) {
+                switch (sourceRule.mode) {
+                    case Js:
+                        result = evalJS(sourceRule.rule, contentText(*value));
+                        break;
+                    case Json:
+                        if (const auto analyzer = getAnalyzeByJSonPath(*value, isContent)) {
+                            result = analyzer->getString(sourceRule.rule);
+                        } else {
+                            result = std::nullopt;
+                        }
+                        break;
+                    case XPath:
+                        result = getAnalyzeByXPath(*value, isContent).getString(sourceRule.rule);
+                        break;
+                    case Default:
+                        if (isUrl) {
+                            result = getAnalyzeByJSoup(*value, isContent).getString0(sourceRule.rule);
+                        } else {
+                            result = getAnalyzeByJSoup(*value, isContent).getString(sourceRule.rule);
+                        }
+                        break;
+                    default:
+                        result = sourceRule.rule;
+                        break;
+                }
+            } else {
+                result = contentText(*value);
+            }
+            if (result.has_value() && !sourceRule.replaceRegex.empty()) {
+                result = replaceRegex(*result, sourceRule);
+            }
+        }
+    }
+    std::string str = result.has_value() ? std::move(*result) : "";
+    if (unescape && str.find('&') != std::string::npos) {
+        str = Html::decodeEntities(str);
+    }
+    if (isUrl) {
+        if (isBlank(str)) {
+            return baseUrl.value_or("");
+        }
+        return NetworkUtils::getAbsoluteURL(redirectUrl.has_value() ? *redirectUrl : baseUrl.value_or(""), str);
+    }
+    return str;
+}
+
+std::string AnalyzeRule::replaceRegex(const std::string &result, const SourceRule &sourceRule) {
+    if (sourceRule.replaceRegex.empty()) {
+        return result;
+    }
+    const auto pattern = getRegexp(sourceRule.replaceRegex);
+    if (pattern == nullptr) {
+        // 不是合法的正则时按普通文本替换
+        if (sourceRule.replaceFirst) {
+            return sourceRule.replacement;
+        }
+        return replaceAll(result, sourceRule.replaceRegex, sourceRule.replacement);
+    }
+    if (sourceRule.replaceFirst) {
+        // 与阅读一致，只保留第一个匹配，并在其上替换
+        Regexp::Match match;
+        if (!pattern->search(result, 0, match)) {
+            return "";
+        }
+        return pattern->replace(match.group(result), sourceRule.replacement, true);
+    }
+    return pattern->replace(result, sourceRule.replacement);
+}
+
+std::string AnalyzeRule::get(const std::string &key) const {
+    if (key == "title" && chapter != nullptr) {
+        return chapter->title;
+    }
+    if (chapter != nullptr) {
+        if (auto value = chapter->getVariable(key); !value.empty()) return value;
+    }
+    if (book != nullptr) {
+        if (auto value = book->getVariable(key); !value.empty()) return value;
+    }
+    if (ruleData != nullptr) {
+        if (auto value = ruleData->getVariable(key); !value.empty()) return value;
+    }
+    if (source != nullptr) {
+        return source->get(key);
+    }
+    return "";
+}
+
+std::string AnalyzeRule::evalJS(const std::string &jsStr, const std::optional<std::string> &result) {
+    evalJSCallCount++;
+    auto &engine = QuickJsEngine::current();
+    engine.reset();
+    engine.addObjectBinding("java", this);
+    engine.addValue("baseUrl", baseUrl.value_or(""));
+    engine.addObjectBinding("book", ruleData);
+    engine.addObjectBinding("source", source);
+    if (chapter != nullptr) {
+        engine.addValue("title", chapter->title);
+    }
+    if (nextChapterUrl.has_value()) {
+        engine.addValue("nextChapterUrl", *nextChapterUrl);
+    }
+    if (result.has_value()) {
+        engine.addValue("result", *result);
+    }
+    return engine.eval(jsStr);
 }
 
 AnalyzeUrl::AnalyzeUrl(
@@ -696,6 +1518,7 @@ AnalyzeUrl::AnalyzeUrl(
             headerMap.erase("proxy"); // 删除 headerMap 中的 proxy
         }
     }
+    enabledCookieJar = source != nullptr && source->enabledCookieJar.value_or(false);
     initUrl();
 }
 
@@ -725,12 +1548,38 @@ std::string AnalyzeUrl::evalJS(const std::string &jsStr, const std::optional<std
 }
 
 void AnalyzeUrl::initUrl() {
-    ruleUrl = mUrl;
-    analyzeJs();
-    replaceKeyPageJs();
+    const auto urlTemplate = source != nullptr ? source->getUrlTemplate(mUrl) : UrlTemplate::compile(mUrl);
+    if (urlTemplate->hasJs()) {
+        // url由js生成，只能每次执行js以后再替换key、page并解析参数
+        ruleUrl = mUrl;
+        analyzeJs();
+        replaceKeyPageJs();
+    } else {
+        // 编译好的模板：纯 {{key}}/{{page}} 与分页规则直接拼接，只有 {{js}} 需要执行js
+        ruleUrl = urlTemplate->render(key, page, [this](const std::string &jsCode) {
+            return evalTemplateJs(jsCode);
+        });
+        option = urlTemplate->getOption();
+    }
     analyzeUrl();
 }
 
+std::string AnalyzeUrl::evalTemplateJs(const std::string &jsCode) {
+    std::string jsEval = evalJS(jsCode);
+    // 先尝试将jsEval转为double，接着将double转为整数字符串
+    // 如果转换失败，则直接使用jsEval作为处理结果
+    try {
+        size_t idx = 0;
+        if (const double d = std::stod(jsEval, &idx);
+            idx == jsEval.size() && std::fabs(d - std::round(d)) < 1e-9) {
+            const long long intVal = std::llround(d);
+            jsEval = std::to_string(intVal);
+        }
+    } catch (...) {
+    } // 不是数字，则保持原样
+    return jsEval;
+}
+
 /**
 * 执行@js,<js></js>
 */
@@ -785,18 +1634,7 @@ void AnalyzeUrl::replaceKeyPageJs() {
         std::string processedUrl = analyzer.innerRule(
             "{{", "}}",
             [&](const std::string &jsCode) -> std::string {
-                std::string jsEval = evalJS(jsCode);
-                // 先尝试将jsEval转为double，接着将double转为整数字符串
-                // 如果转换失败，则直接使用jsEval作为处理结果
-                try {
-                    if (const double d = std::stod(jsEval);
-                        std::fabs(d - std::round(d)) < 1e-9) {
-                        const long long intVal = std::llround(d);
-                        jsEval = std::to_string(intVal);
-                    }
-                } catch (...) {
-                } // 不是数字，则保持原样
-                return jsEval;
+                return evalTemplateJs(jsCode);
             }
         );
         if (!processedUrl.empty()) {
@@ -837,65 +1675,572 @@ void AnalyzeUrl::replaceKeyPageJs() {
 
 void AnalyzeUrl::analyzeUrl() {
     // 在之前的处理中，已经替换掉了额外的内容，接下来要处理的是形如：https://www.qidian.com/so/斗破.html,{"webView": true} 的字符串
-    std::smatch m;
-    std::string urlNoOption; // 实际上就是取逗号之前的部分作为没有参数的url，如：https://www.qidian.com/so/斗破.html
-    if (std::regex_search(ruleUrl, m, paramPattern)) {
-        urlNoOption = ruleUrl.substr(0, m.position());
-    } else {
-        urlNoOption = ruleUrl;
+    // 实际上就是取逗号之前的部分作为没有参数的url，如：https://www.qidian.com/so/斗破.html
+    std::string urlNoOption = ruleUrl;
+    if (const size_t optionStart = UrlOption::findOptionStart(ruleUrl);
+        optionStart != std::string::npos) {
+        urlNoOption = trimCopy(ruleUrl.substr(0, optionStart));
+        // 由js生成的参数每次都可能不同，不进行缓存
+        try {
+            option = UrlOption::parse(ruleUrl.substr(optionStart + 1));
+        } catch (...) {
+            // 参数不是合法的json，忽略
+        }
     }
     url = NetworkUtils::getAbsoluteURL(baseUrl, urlNoOption);
     const auto curBaseUrl = NetworkUtils::getBaseUrl(url);
     if (curBaseUrl.has_value()) {
         baseUrl = curBaseUrl.value();
     }
-    // 前后长度发生变化，说明可能存在额外参数
-    if (urlNoOption.size() != ruleUrl.size()) {
-        std::string urlOptionStr = ruleUrl.substr(m.position() + 1);
-        // TODO: 继续处理
+    if (option) {
+        applyOption();
+    }
+    const auto encoding = charset
+        ? Charset::fromName(*charset).value_or(Charset::Encoding::UTF8)
+        : Charset::Encoding::UTF8;
+    // 分离查询参数，未编码时按照书源指定的字符集（默认 UTF-8）进行编码
+    const size_t queryPos = url.find('?');
+    urlNoQuery = url.substr(0, queryPos);
+    if (queryPos != std::string::npos) {
+        const std::string query = url.substr(queryPos + 1);
+        if (NetworkUtils::encodedQuery(query)) {
+            encodedQuery = query;
+        } else {
+            encodedQuery = Charset::encodeParams(query, encoding);
+        }
+        url = urlNoQuery + "?" + *encodedQuery;
+    }
+    // POST 的表单数据同样按字符集编码，json/xml 以及指定了Content-Type的body保持原样
+    if (method == POST && body.has_value()) {
+        const std::string trimmed = trimCopy(*body);
+        const bool isJsonOrXml = trimmed.starts_with('{') || trimmed.starts_with('[') ||
+                                 trimmed.starts_with('<');
+        if (!isJsonOrXml && !mapContainsIgnoreCase(headerMap, "Content-Type")) {
+            encodedForm = NetworkUtils::encodedForm(*body) ? *body : Charset::encodeParams(*body, encoding, true);
+        }
+    }
+}
+
+void AnalyzeUrl::applyOption() {
+    method = option->method;
+    for (const auto &[k, v]: option->headers) {
+        headerMap[k] = v;
+    }
+    if (option->body.has_value()) {
+        body = option->body->render(key, page, [this](const std::string &jsCode) {
+            return evalTemplateJs(jsCode);
+        });
+    }
+    type = option->type;
+    charset = option->charset;
+    retry = option->retry;
+    useWebView = option->webView;
+    webJs = option->webJs;
+    if (option->js.has_value()) {
+        url = evalJS(*option->js, url);
+    }
+    serverID = option->serverID;
+    webViewDelayTime = std::max(0L, option->webViewDelayTime.value_or(0L));
+}
+
+// 将json中的值转为字符串：字符串直接取值，其他类型序列化为json文本
+static std::optional<std::string> jsonToString(const nlohmann::json &value) {
+    if (value.is_null()) return std::nullopt;
+    std::string str = value.is_string() ? value.get<std::string>() : value.dump();
+    if (str.empty()) return std::nullopt;
+    return str;
+}
+
+// 将字面量中的分页规则 <a,b,c> 拆分为 PageList 片段
+static void splitPageList(const std::string &text, std::vector<TemplateString::Segment> &out) {
+    using SlotType = TemplateString::SlotType;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const size_t open = text.find('<', pos);
+        const size_t close = open == std::string::npos ? std::string::npos : text.find('>', open + 1);
+        if (close == std::string::npos) {
+            out.push_back({SlotType::Literal, text.substr(pos)});
+            return;
+        }
+        if (open > pos) {
+            out.push_back({SlotType::Literal, text.substr(pos, open - pos)});
+        }
+        TemplateString::Segment segment{SlotType::PageList, text.substr(open + 1, close - open - 1)};
+        splitByComma(segment.text, segment.pages);
+        for (auto &p: segment.pages) {
+            p = trimCopy(p);
+        }
+        if (segment.pages.empty()) {
+            segment.pages.emplace_back();
+        }
+        out.push_back(std::move(segment));
+        pos = close + 1;
+    }
+}
+
+TemplateString TemplateString::compile(const std::string &str, const bool pageList) {
+    TemplateString result;
+    auto addLiteral = [&result, pageList](const std::string &text) {
+        if (text.empty()) return;
+        if (pageList && text.find('<') != std::string::npos) {
+            splitPageList(text, result.segments);
+        } else if (!result.segments.empty() && result.segments.back().type == SlotType::Literal) {
+            result.segments.back().text += text;
+        } else {
+            result.segments.push_back({SlotType::Literal, text});
+        }
+    };
+    size_t pos = 0;
+    while (pos < str.size()) {
+        const size_t open = str.find("{{", pos);
+        const size_t close = open == std::string::npos ? std::string::npos : str.find("}}", open + 2);
+        if (close == std::string::npos) {
+            addLiteral(str.substr(pos));
+            break;
+        }
+        addLiteral(str.substr(pos, open - pos));
+        const std::string code = trimCopy(str.substr(open + 2, close - open - 2));
+        if (code == "key") {
+            result.segments.push_back({SlotType::Key, ""});
+        } else if (code == "page") {
+            result.segments.push_back({SlotType::Page, ""});
+        } else {
+            result.segments.push_back({SlotType::Js, code});
+        }
+        pos = close + 2;
     }
+    return result;
+}
+
+std::string TemplateString::render(
+    const std::optional<std::string> &key,
+    const std::optional<int> &page,
+    const JsEvaluator &evalJs
+) const {
+    std::string out;
+    for (const auto &[type, text, pages]: segments) {
+        switch (type) {
+            case SlotType::Literal:
+                out += text;
+                break;
+            case SlotType::Key:
+                out += key.value_or("");
+                break;
+            case SlotType::Page:
+                out += page.has_value() ? std::to_string(*page) : "";
+                break;
+            case SlotType::Js:
+                out += evalJs(text);
+                break;
+            case SlotType::PageList:
+                // 对于越界的page约束到"<a,b,c>"中最后一个，没有page时保持原样
+                if (page.has_value()) {
+                    const size_t index = std::clamp<size_t>(std::max(*page, 1), 1, pages.size());
+                    out += pages[index - 1];
+                } else {
+                    out += "<" + text + ">";
+                }
+                break;
+        }
+    }
+    return out;
+}
+
+std::shared_ptr<const UrlOption> UrlOption::parse(const std::string &jsonStr) {
+    using json = nlohmann::json;
+    const json j = json::parse(jsonStr);
+    if (!j.is_object()) {
+        throw std::runtime_error("url option is not a json object");
+    }
+    auto option = std::make_shared<UrlOption>();
+    for (auto &[k, value]: j.items()) {
+        if (k == "method") {
+            if (const auto m = jsonToString(value); m && StringUtils::startsWithIgnoreCase(*m, "POST")) {
+                option->method = POST;
+            }
+        } else if (k == "charset") {
+            option->charset = jsonToString(value);
+        } else if (k == "headers") {
+            // headers可以是json对象，也可以是json字符串
+            json headers = value;
+            if (value.is_string()) {
+                headers = json::parse(value.get<std::string>());
+            }
+            if (headers.is_object()) {
+                for (auto &[hk, hv]: headers.items()) {
+                    option->headers.emplace_back(hk, jsonToString(hv).value_or(""));
+                }
+            }
+        } else if (k == "body") {
+            if (const auto b = jsonToString(value)) {
+                option->body = TemplateString::compile(*b);
+            }
+        } else if (k == "origin") {
+            option->origin = jsonToString(value);
+        } else if (k == "retry") {
+            if (value.is_number_integer()) {
+                option->retry = value.get<int>();
+            } else if (const auto r = jsonToString(value)) {
+                // 不是数字时忽略，不影响其余的参数
+                const std::string text = trimCopy(*r);
+                int retry = 0;
+                if (const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), retry);
+                    ec == std::errc()) {
+                    option->retry = retry;
+                }
+            }
+        } else if (k == "type") {
+            option->type = jsonToString(value);
+        } else if (k == "webView") {
+            if (value.is_boolean()) {
+                option->webView = value.get<bool>();
+            } else if (const auto w = jsonToString(value)) {
+                option->webView = *w != "false";
+            }
+        } else if (k == "webJs") {
+            option->webJs = jsonToString(value);
+        } else if (k == "js") {
+            option->js = jsonToString(value);
+        } else if (k == "serverID") {
+            if (value.is_number_integer()) option->serverID = value.get<long>();
+        } else if (k == "webViewDelayTime") {
+            if (value.is_number_integer()) option->webViewDelayTime = value.get<long>();
+        }
+    }
+    return option;
+}
+
+std::shared_ptr<const UrlOption> UrlOption::compile(const std::string &jsonStr) {
+    // 规则模板的数量有限，超过上限时直接清空，避免异常书源导致缓存无限增长
+    constexpr size_t maxCacheSize = 4096;
+    static std::mutex cacheMutex;
+    static std::unordered_map<std::string, std::shared_ptr<const UrlOption> > cache;
+    {
+        std::lock_guard lock(cacheMutex);
+        if (const auto it = cache.find(jsonStr); it != cache.end()) {
+            return it->second;
+        }
+    }
+    std::shared_ptr<const UrlOption> option = nullptr;
+    try {
+        option = parse(jsonStr);
+    } catch (...) {
+        // 解析失败同样缓存，避免重复解析
+    }
+    std::lock_guard lock(cacheMutex);
+    if (cache.size() >= maxCacheSize) {
+        cache.clear();
+    }
+    cache.emplace(jsonStr, option);
+    return option;
+}
+
+size_t UrlOption::findOptionStart(const std::string_view ruleUrl) {
+    size_t i = 0;
+    while (i < ruleUrl.size()) {
+        if (ruleUrl.compare(i, 2, "{{") == 0) {
+            const size_t close = ruleUrl.find("}}", i + 2);
+            if (close == std::string_view::npos) return std::string::npos;
+            i = close + 2;
+            continue;
+        }
+        if (ruleUrl[i] == ',') {
+            size_t j = i + 1;
+            while (j < ruleUrl.size() && std::isspace(static_cast<unsigned char>(ruleUrl[j]))) j++;
+            if (j < ruleUrl.size() && ruleUrl[j] == '{' && ruleUrl.compare(j, 2, "{{") != 0) {
+                return i;
+            }
+        }
+        i++;
+    }
+    return std::string::npos;
+}
+
+std::shared_ptr<const UrlTemplate> UrlTemplate::compile(const std::string &ruleUrl) {
+    auto urlTemplate = std::make_shared<UrlTemplate>();
+    if (std::smatch m; std::regex_search(ruleUrl, m, Constants::JS_PATTERN)) {
+        urlTemplate->jsPipeline = true;
+        return urlTemplate;
+    }
+    std::string urlPart = ruleUrl;
+    if (const size_t optionStart = UrlOption::findOptionStart(ruleUrl); optionStart != std::string::npos) {
+        urlPart = trimCopy(ruleUrl.substr(0, optionStart));
+        urlTemplate->option = UrlOption::compile(ruleUrl.substr(optionStart + 1));
+    }
+    urlTemplate->url = TemplateString::compile(urlPart, true);
+    return urlTemplate;
 }
 
 #include <curl/curl.h>
 
+// http请求的原始结果：未经转码的字节以及Content-Type响应头
+struct HttpResult {
+    std::string body;
+    std::string contentType;
+    bool aborted = false; // 传输被onData中断
+};
+
+// 响应内容回调的上下文
+struct WriteContext {
+    HttpResult *result;
+    const AnalyzeUrl::DataHandler *onData;
+    bool skip = false; // 手动跟随重定向时，重定向响应的内容不属于结果
+};
+
 static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
     size_t totalSize = size * nmemb;
-    auto* str = static_cast<std::string*>(userp);
-    str->append(static_cast<char*>(contents), totalSize);
+    auto *ctx = static_cast<WriteContext *>(userp);
+    if (ctx->skip) return totalSize;
+    ctx->result->body.append(static_cast<char*>(contents), totalSize);
+    if (ctx->onData != nullptr &&
+        !(*ctx->onData)(std::string_view(static_cast<char *>(contents), totalSize), ctx->result->contentType)) {
+        // 返回值与数据长度不同时curl中断传输
+        ctx->result->aborted = true;
+        return 0;
+    }
     return totalSize;
 }
 
-// 封装函数：输入 URL，返回响应内容
-std::string httpGet(const std::string& url) {
-    CURL* curl = curl_easy_init();
-    if (!curl) return "";
+// 响应头回调的上下文
+struct HeaderContext {
+    CURL *curl;
+    HttpResult *result;
+    CookieJar *cookieJar;
+    WriteContext *write;
+    int status = 0; // 当前响应的状态码
+};
+
+static bool isRedirect(const int status) {
+    return status == 301 || status == 302 || status == 303 || status == 307 || status == 308;
+}
 
-    std::string response;
+// 记录Content-Type响应头，重定向时以最后一次响应为准；启用cookieJar时保存每一次响应的Set-Cookie
+static size_t HeaderCallback(char* buffer, size_t size, size_t nitems, void* userp) {
+    const size_t totalSize = size * nitems;
+    const std::string_view line(buffer, totalSize);
+    auto *ctx = static_cast<HeaderContext *>(userp);
+    if (line.starts_with("HTTP/")) {
+        // 状态行，新的响应开始
+        ctx->status = 0;
+        if (const size_t space = line.find(' '); space != std::string_view::npos) {
+            std::from_chars(line.data() + space + 1, line.data() + line.size(), ctx->status);
+        }
+        ctx->write->skip = false;
+    } else if (ctx->cookieJar != nullptr && isRedirect(ctx->status) && line.size() > 9 &&
+               StringUtils::startsWithIgnoreCase(std::string(line.substr(0, 9)), "location:")) {
+        // 启用cookieJar时由httpRequest()跟随重定向
+        ctx->write->skip = true;
+    } else if (line.size() > 13 && StringUtils::startsWithIgnoreCase(std::string(line.substr(0, 13)), "content-type:")) {
+        ctx->result->contentType = trimCopy(std::string(line.substr(13)));
+    } else if (ctx->cookieJar != nullptr && line.size() > 11 &&
+               StringUtils::startsWithIgnoreCase(std::string(line.substr(0, 11)), "set-cookie:")) {
+        // 重定向过程中的Set-Cookie属于当前请求的url，而不是最初的url
+        char *effectiveUrl = nullptr;
+        curl_easy_getinfo(ctx->curl, CURLINFO_EFFECTIVE_URL, &effectiveUrl);
+        if (effectiveUrl != nullptr) {
+            ctx->cookieJar->saveFromResponse(effectiveUrl, trimCopy(std::string(line.substr(11))));
+        }
+    }
+    return totalSize;
+}
 
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+/**
+ * 合并请求头中的Cookie与cookieJar中的cookie，同名时以请求头中的为准
+ */
+static std::string mergeCookie(const std::string &jarCookie, const std::string &headerCookie) {
+    if (jarCookie.empty()) return headerCookie;
+    if (headerCookie.empty()) return jarCookie;
+    std::unordered_set<std::string> names;
+    std::stringstream ss(headerCookie);
+    std::string token;
+    while (std::getline(ss, token, ';')) {
+        names.insert(trimCopy(token.substr(0, token.find('='))));
+    }
+    std::string merged = headerCookie;
+    std::stringstream js(jarCookie);
+    while (std::getline(js, token, ';')) {
+        token = trimCopy(token);
+        if (!names.contains(token.substr(0, token.find('=')))) {
+            merged += "; " + token;
+        }
+    }
+    return merged;
+}
+
+// 与curl的默认值相同
+static constexpr int maxRedirects = 30;
+
+/**
+ * 发送http请求
+ * 启用cookieJar时手动跟随重定向，每一次请求都按当时的url从cookieJar中取cookie，
+ * 登录时302响应设置的cookie会在重定向后的请求中发送；与curl相同，跨主机时不再发送请求头中的Cookie与Authorization
+ * @return 请求成功返回 true，结果保存在result中
+ */
+static bool httpRequest(
+    const std::string &url,
+    const RequestMethod method,
+    const std::unordered_map<std::string, std::string> &headerMap,
+    const std::optional<std::string> &body,
+    HttpResult &result,
+    CookieJar *cookieJar = nullptr,
+    const AnalyzeUrl::DataHandler *onData = nullptr
+) {
+    result = {};
+    CURL* curl = curl_easy_init();
+    if (!curl) return false;
+
+    std::vector<std::string> headerLines;
+    std::string headerCookie;
+    std::string authorization;
+    for (const auto &[k, v]: headerMap) {
+        if (cookieJar != nullptr && k.size() == 6 && StringUtils::startsWithIgnoreCase(k, "Cookie")) {
+            headerCookie = v;
+            continue;
+        }
+        if (cookieJar != nullptr && k.size() == 13 && StringUtils::startsWithIgnoreCase(k, "Authorization")) {
+            authorization = v;
+            continue;
+        }
+        headerLines.push_back(k + ": " + v);
+    }
+    // json格式的body默认使用application/json
+    if (method == POST && body.has_value() && !mapContainsIgnoreCase(headerMap, "Content-Type")) {
+        if (const std::string trimmed = trimCopy(*body);
+            trimmed.starts_with('{') || trimmed.starts_with('[')) {
+            headerLines.emplace_back("Content-Type: application/json; charset=UTF-8");
+        }
+    }
+
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, cookieJar == nullptr ? 1L : 0L);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    WriteContext writeContext{&result, onData};
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &writeContext);
+    HeaderContext headerContext{curl, &result, cookieJar, &writeContext};
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &headerContext);
+    if (method == POST) {
+        const std::string &postData = body.has_value() ? *body : "";
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(postData.size()));
+        curl_easy_setopt(curl, CURLOPT_COPYPOSTFIELDS, postData.c_str());
+    }
 
     // 如需忽略 HTTPS 证书错误（可选）
     // curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
     // curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
 
-    CURLcode res = curl_easy_perform(curl);
+    const std::string host = NetworkUtils::getDomain(url);
+    std::string requestUrl = url;
+    CURLcode res = CURLE_OK;
+    for (int redirects = 0;; redirects++) {
+        curl_slist *headers = nullptr;
+        for (const auto &line: headerLines) headers = curl_slist_append(headers, line.c_str());
+        if (cookieJar != nullptr) {
+            const bool sameHost = NetworkUtils::getDomain(requestUrl) == host;
+            if (sameHost && !authorization.empty()) {
+                headers = curl_slist_append(headers, ("Authorization: " + authorization).c_str());
+            }
+            const std::string cookie = mergeCookie(cookieJar->getCookie(requestUrl), sameHost ? headerCookie : "");
+            if (!cookie.empty()) headers = curl_slist_append(headers, ("Cookie: " + cookie).c_str());
+        }
+        curl_easy_setopt(curl, CURLOPT_URL, requestUrl.c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        res = curl_easy_perform(curl);
+        curl_slist_free_all(headers);
+        if (res != CURLE_OK || !writeContext.skip) break;
+
+        // 重定向：与curl相同，301、302、303把POST改为GET，307、308保持原来的请求方法与内容
+        char *location = nullptr;
+        curl_easy_getinfo(curl, CURLINFO_REDIRECT_URL, &location);
+        if (location == nullptr) break;
+        if (redirects == maxRedirects) {
+            res = CURLE_TOO_MANY_REDIRECTS;
+            break;
+        }
+        requestUrl = location;
+        if (headerContext.status != 307 && headerContext.status != 308) {
+            curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+        }
+        result.body.clear();
+        result.contentType.clear();
+        writeContext.skip = false;
+    }
     curl_easy_cleanup(curl);
 
-    if (res != CURLE_OK) {
-        // 如果失败，返回空字符串，也可以抛异常或返回错误信息
-        return "";
+    if (res != CURLE_OK && !(res == CURLE_WRITE_ERROR && result.aborted)) {
+        // 如果失败，清空已收到的部分内容
+        result = {};
+        return false;
     }
-
-    return response;
+    return true;
 }
 
+/**
+ * 按书源的concurrentRate限制请求，作用域结束时释放
+ * 当前线程的请求已经取消时acquired为 false，不应再发出请求
+ */
+class RateLimit {
+public:
+    explicit RateLimit(BaseSource *source) {
+        if (source != nullptr && !StringUtils::isNullOrEmpty(source->concurrentRate)) {
+            rate = *source->concurrentRate;
+            limiter = ConcurrentRateLimiter::forSource(source->getKey());
+        }
+        acquired = limiter != nullptr ? limiter->acquire(rate) : !ConcurrentRateLimiter::RequestScope::cancelled();
+    }
+
+    ~RateLimit() {
+        if (limiter != nullptr && acquired) limiter->release(rate);
+    }
+
+    RateLimit(const RateLimit &) = delete;
+
+    RateLimit &operator=(const RateLimit &) = delete;
+
+    bool acquired = false;
+
+private:
+    std::string rate;
+    std::shared_ptr<ConcurrentRateLimiter> limiter = nullptr;
+};
+
 StrResponse AnalyzeUrl::getStrResponse(
         std::string *jsStr ,
         std::string *sourceRegex,
         bool useWebView
     ) {
-    auto res = httpGet(url);
-    return StrResponse(url, res);
-}
\ No newline at end of file
+    const RateLimit rateLimit(source);
+    if (!rateLimit.acquired) {
+        return StrResponse(url, std::nullopt);
+    }
+    HttpResult res;
+    const std::optional<std::string> &postBody = encodedForm.has_value() ? encodedForm : body;
+    const auto cookieJar = enabledCookieJar && source != nullptr ? source->getCookieJar() : nullptr;
+    for (int i = 0; i <= retry; i++) {
+        if (httpRequest(url, method, headerMap, postBody, res, cookieJar.get())) break;
+    }
+    // 按照 指定字符集 > BOM > Content-Type > meta 的顺序确定编码，统一转为 UTF-8
+    const auto encoding = Charset::detect(res.body, res.contentType, charset);
+    return StrResponse(url, Charset::toUtf8(res.body, encoding));
+}
+
+StrResponse AnalyzeUrl::getStrResponse(const DataHandler &onData) {
+    const RateLimit rateLimit(source);
+    if (!rateLimit.acquired) {
+        return StrResponse(url, std::nullopt);
+    }
+    HttpResult res;
+    const std::optional<std::string> &postBody = encodedForm.has_value() ? encodedForm : body;
+    const auto cookieJar = enabledCookieJar && source != nullptr ? source->getCookieJar() : nullptr;
+    bool received = false;
+    const DataHandler handler = [&](const std::string_view data, const std::string_view contentType) {
+        received = true;
+        return onData(data, contentType);
+    };
+    for (int i = 0; i <= retry; i++) {
+        // 已经交给onData的内容无法撤回，收到过内容后失败的请求不再重试
+        if (httpRequest(url, method, headerMap, postBody, res, cookieJar.get(), &handler) || received) break;
+    }
+    const auto encoding = Charset::detect(res.body, res.contentType, charset);
+    return StrResponse(url, Charset::toUtf8(res.body, encoding));
+}
@@ -58,13 +58,58 @@ optional<std::string> RuleData::getBigVariable(const std::string &key) const {
     return std::nullopt;
 }
 
+VariableText::VariableText(const VariableText &other) {
+    std::lock_guard lock(other.mutex);
+    text = other.text;
+    changed.store(other.changed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+VariableText::VariableText(VariableText &&other) noexcept
+    : text(std::move(other.text)), changed(other.changed.load(std::memory_order_relaxed)) {
+}
+
+VariableText &VariableText::operator=(const VariableText &other) {
+    if (this == &other) return *this;
+    std::scoped_lock lock(mutex, other.mutex);
+    text = other.text;
+    changed.store(other.changed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    return *this;
+}
+
+VariableText &VariableText::operator=(VariableText &&other) noexcept {
+    text = std::move(other.text);
+    changed.store(other.changed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    return *this;
+}
+
+const optional<string> &VariableText::get(const std::unordered_map<string, string> &map) const {
+    // 已经生成后只读，不需要加锁
+    if (changed.load(std::memory_order_acquire)) {
+        std::lock_guard lock(mutex);
+        if (changed.load(std::memory_order_relaxed)) {
+            text = JsonUtils::mapToJsonString(map);         // map转文本
+            changed.store(false, std::memory_order_release);
+        }
+    }
+    return text;
+}
+
 bool BaseBook::putVariable(const string &key, const optional<string> &value) {
     if (RuleData::putVariable(key, value)) {
-        variable = JsonUtils::mapToJsonString(variableMap);         // map转文本
+        variable.invalidate();
     }
     return true;
 }
 
+const optional<string> &BaseBook::getVariableString() const {
+    return variable.get(variableMap);
+}
+
+void BaseBook::setVariableString(optional<string> value) {
+    variableMap = value.has_value() ? JsonUtils::jsonStringToMap(*value) : std::unordered_map<string, string>();
+    variable.reset(std::move(value));
+}
+
 BookChapter::BookChapter(
         string url,
         string title,
@@ -97,11 +142,35 @@ BookChapter::BookChapter(
         end(end),
         startFragmentId(std::move(startFragmentId)),
         endFragmentId(std::move(endFragmentId)),
-        variable(std::move(variable)) {}
+        variable(std::move(variable)) {
+    // 保存的变量，之后的putVariable在它的基础上修改
+    if (const auto &saved = this->variable.get(variableMap); saved.has_value()) {
+        variableMap = JsonUtils::jsonStringToMap(*saved);
+    }
+}
 
 bool BookChapter::putVariable(const string &key, const optional<string> &value) {
     if (RuleData::putVariable(key, value)) {
-        variable = JsonUtils::mapToJsonString(variableMap);         // map转文本
+        variable.invalidate();
     }
     return true;
-}
\ No newline at end of file
+}
+
+const optional<string> &BookChapter::getVariableString() const {
+    return variable.get(variableMap);
+}
+string BookChapter::getAbsoluteURL() const {
+    if (isVolume && url.starts_with(title)) {
+        return baseUrl;
+    }
+    // 与阅读的 \s*,\s*(?=\{) 相同，参数之前的部分转换为绝对地址
+    for (size_t i = url.find(','); i != string::npos; i = url.find(',', i + 1)) {
+        size_t option = i + 1;
+        while (option < url.size() && std::isspace(static_cast<unsigned char>(url[option]))) option++;
+        if (option == url.size() || url[option] != '{') continue;
+        size_t end = i;
+        while (end > 0 && std::isspace(static_cast<unsigned char>(url[end - 1]))) end--;
+        return NetworkUtils::getAbsoluteURL(baseUrl, url.substr(0, end)) + "," + url.substr(option);
+    }
+    return NetworkUtils::getAbsoluteURL(baseUrl, url);
+}
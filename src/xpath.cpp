@@ -0,0 +1,1464 @@
+#include <booksource/xpath.h>
+#include <booksource/rule.h>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+using Html::Node;
+using Html::NodeType;
+using Html::Elements;
+
+namespace Xpath {
+
+    enum class Axis : uint8_t {
+        Child, Descendant, DescendantOrSelf, Self, Parent, Ancestor, AncestorOrSelf,
+        FollowingSibling, PrecedingSibling, Following, Preceding, Attribute
+    };
+
+    enum class NodeTest : uint8_t {
+        Name, Any, Node, Comment,
+        Function // 取值函数，如 text()、allText()，只能作为最后一步
+    };
+
+    struct Step {
+        Axis axis = Axis::Child;
+        NodeTest test = NodeTest::Any;
+        std::string name;       // 小写的名称，或者取值函数名
+        bool recursive = false; // '//text()'，取全部后代文本节点
+        std::vector<std::unique_ptr<Expr> > predicates;
+    };
+
+    struct Expr {
+        enum class Kind : uint8_t {
+            Or, And, Eq, Ne, Lt, Le, Gt, Ge, Add, Sub, Mul, Div, Mod, Neg, Union,
+            Literal, Number, Function, Path
+        };
+
+        Kind kind;
+        std::vector<std::unique_ptr<Expr> > args; // 运算数或者函数参数
+        std::string str;                          // 字符串字面量或者函数名
+        double number = 0;
+        // Path：filter不为空时为 FilterExpr/steps 的形式，否则absolute表示是否从根节点开始
+        std::unique_ptr<Expr> filter;
+        std::vector<std::unique_ptr<Expr> > filterPredicates;
+        bool absolute = false;
+        std::vector<Step> steps;
+        std::string attribute; // 不为空时表示路径为单个'@name'，谓词中直接查找属性，不需要构造节点集合
+
+        explicit Expr(const Kind kind) : kind(kind) {
+        }
+    };
+}
+
+namespace {
+    using namespace Xpath;
+
+    // 结果中的节点，attr >= 0 时表示node的第attr个属性
+    struct Item {
+        const Node *node;
+        int32_t attr = -1;
+
+        bool operator==(const Item &other) const = default;
+    };
+
+    bool itemLess(const Item &a, const Item &b) {
+        return a.node->index != b.node->index ? a.node->index < b.node->index : a.attr < b.attr;
+    }
+
+    // 按文档顺序排序并去重，已经有序时不做任何事
+    void sortUnique(std::vector<Item> &items) {
+        if (std::ranges::adjacent_find(items, [](const Item &a, const Item &b) { return !itemLess(a, b); }) == items.end()) {
+            return;
+        }
+        std::ranges::sort(items, itemLess);
+        const auto [first, last] = std::ranges::unique(items);
+        items.erase(first, last);
+    }
+
+    struct Value {
+        enum class Type : uint8_t {
+            Nodes, Strings, String, Number, Boolean
+        };
+
+        Type type = Type::Nodes;
+        std::vector<Item> nodes;
+        std::vector<std::string> strings; // 取值函数的结果
+        std::string str;
+        double number = 0;
+        bool boolean = false;
+
+        bool isSet() const {
+            return type == Type::Nodes || type == Type::Strings;
+        }
+
+        static Value ofNodes(std::vector<Item> nodes) {
+            Value v;
+            v.nodes = std::move(nodes);
+            return v;
+        }
+
+        static Value ofStrings(std::vector<std::string> strings) {
+            Value v;
+            v.type = Type::Strings;
+            v.strings = std::move(strings);
+            return v;
+        }
+
+        static Value ofString(std::string str) {
+            Value v;
+            v.type = Type::String;
+            v.str = std::move(str);
+            return v;
+        }
+
+        static Value ofNumber(const double number) {
+            Value v;
+            v.type = Type::Number;
+            v.number = number;
+            return v;
+        }
+
+        static Value ofBoolean(const bool boolean) {
+            Value v;
+            v.type = Type::Boolean;
+            v.boolean = boolean;
+            return v;
+        }
+    };
+
+    struct Context {
+        Item item;
+        size_t position;
+        size_t size;
+        const Node *root; // 绝对路径的起点
+    };
+
+    bool equalsIgnoreCase(const std::string_view name, const std::string &lower) {
+        if (name.size() != lower.size()) return false;
+        for (size_t i = 0; i < lower.size(); i++) {
+            if (std::tolower(static_cast<unsigned char>(name[i])) != lower[i]) return false;
+        }
+        return true;
+    }
+
+    const Html::Attribute *findAttribute(const Node *node, const std::string &lower) {
+        for (uint32_t i = 0; i < node->attributeCount; i++) {
+            if (equalsIgnoreCase(node->attributes[i].name, lower)) return &node->attributes[i];
+        }
+        return nullptr;
+    }
+
+    // 上下文节点上'@name'引用的属性，不存在时返回nullptr
+    const Html::Attribute *attributeOf(const Expr &e, const Context &ctx) {
+        if (ctx.item.attr >= 0 || ctx.item.node->type != NodeType::Element) return nullptr;
+        return findAttribute(ctx.item.node, e.attribute);
+    }
+
+    std::string toLower(std::string s) {
+        std::ranges::transform(s, s.begin(), [](const unsigned char c) { return std::tolower(c); });
+        return s;
+    }
+
+    bool isSpace(const unsigned char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    std::string_view trimSpace(std::string_view s) {
+        while (!s.empty() && isSpace(s.front())) s.remove_prefix(1);
+        while (!s.empty() && isSpace(s.back())) s.remove_suffix(1);
+        return s;
+    }
+
+    // utf-8字符的起始字节
+    bool isCharStart(const char c) {
+        return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+    }
+
+    size_t charCount(const std::string_view s) {
+        return std::ranges::count_if(s, isCharStart);
+    }
+
+    // 按utf-8字符拆分
+    std::vector<std::string_view> splitChars(const std::string_view s) {
+        std::vector<std::string_view> chars;
+        size_t start = 0;
+        for (size_t i = 1; i <= s.size(); i++) {
+            if (i == s.size() || isCharStart(s[i])) {
+                chars.push_back(s.substr(start, i - start));
+                start = i;
+            }
+        }
+        return chars;
+    }
+
+    // ---------------------------------------------------------------- 类型转换
+
+    // 节点的字符串值，属性与文本节点直接引用原始内容
+    template<typename F>
+    void withStringOf(const Item &item, F &&f) {
+        if (item.attr >= 0) {
+            f(item.node->attributes[item.attr].value);
+        } else if (item.node->type == NodeType::Element || item.node->type == NodeType::Document) {
+            f(std::string_view(item.node->text()));
+        } else {
+            f(item.node->value);
+        }
+    }
+
+    std::string stringOf(const Item &item) {
+        std::string result;
+        withStringOf(item, [&](const std::string_view s) { result = s; });
+        return result;
+    }
+
+    std::string numberToString(const double number) {
+        if (std::isnan(number)) return "NaN";
+        if (std::isinf(number)) return number > 0 ? "Infinity" : "-Infinity";
+        if (number == std::floor(number) && std::abs(number) < 1e15) {
+            return std::to_string(static_cast<long long>(number));
+        }
+        char buf[32];
+        const auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), number);
+        return {buf, end};
+    }
+
+    double stringToNumber(const std::string_view s) {
+        const std::string_view t = trimSpace(s);
+        if (t.empty()) return std::numeric_limits<double>::quiet_NaN();
+        double number = 0;
+        // from_chars不接受'+'，XPath也不接受
+        const auto [end, ec] = std::from_chars(t.data(), t.data() + t.size(), number);
+        if (ec != std::errc() || end != t.data() + t.size()) return std::numeric_limits<double>::quiet_NaN();
+        return number;
+    }
+
+    std::string toString(const Value &v) {
+        switch (v.type) {
+            case Value::Type::Nodes:
+                return v.nodes.empty() ? "" : stringOf(v.nodes.front());
+            case Value::Type::Strings:
+                return v.strings.empty() ? "" : v.strings.front();
+            case Value::Type::String:
+                return v.str;
+            case Value::Type::Number:
+                return numberToString(v.number);
+            case Value::Type::Boolean:
+                return v.boolean ? "true" : "false";
+        }
+        return "";
+    }
+
+    double toNumber(const Value &v) {
+        switch (v.type) {
+            case Value::Type::Number:
+                return v.number;
+            case Value::Type::Boolean:
+                return v.boolean ? 1 : 0;
+            default:
+                return stringToNumber(toString(v));
+        }
+    }
+
+    bool toBoolean(const Value &v) {
+        switch (v.type) {
+            case Value::Type::Nodes:
+                return !v.nodes.empty();
+            case Value::Type::Strings:
+                return !v.strings.empty();
+            case Value::Type::String:
+                return !v.str.empty();
+            case Value::Type::Number:
+                return v.number != 0 && !std::isnan(v.number);
+            case Value::Type::Boolean:
+                return v.boolean;
+        }
+        return false;
+    }
+
+    // 遍历集合中每一项的字符串值，f返回true时停止
+    template<typename F>
+    bool anyString(const Value &v, F &&f) {
+        if (v.type == Value::Type::Strings) {
+            return std::ranges::any_of(v.strings, [&](const std::string &s) { return f(std::string_view(s)); });
+        }
+        for (const Item &item: v.nodes) {
+            bool found = false;
+            withStringOf(item, [&](const std::string_view s) { found = f(s); });
+            if (found) return true;
+        }
+        return false;
+    }
+
+    bool compareNumbers(const double a, const double b, const Expr::Kind op) {
+        switch (op) {
+            case Expr::Kind::Eq: return a == b;
+            case Expr::Kind::Ne: return a != b;
+            case Expr::Kind::Lt: return a < b;
+            case Expr::Kind::Le: return a <= b;
+            case Expr::Kind::Gt: return a > b;
+            case Expr::Kind::Ge: return a >= b;
+            default: return false;
+        }
+    }
+
+    bool compareStrings(const std::string_view a, const std::string_view b, const Expr::Kind op) {
+        if (op == Expr::Kind::Eq) return a == b;
+        if (op == Expr::Kind::Ne) return a != b;
+        return compareNumbers(stringToNumber(a), stringToNumber(b), op);
+    }
+
+    Expr::Kind swapOperator(const Expr::Kind op) {
+        switch (op) {
+            case Expr::Kind::Lt: return Expr::Kind::Gt;
+            case Expr::Kind::Le: return Expr::Kind::Ge;
+            case Expr::Kind::Gt: return Expr::Kind::Lt;
+            case Expr::Kind::Ge: return Expr::Kind::Le;
+            default: return op;
+        }
+    }
+
+    /**
+     * XPath 1.0 的比较：集合与其他值比较时，只要集合中有一项满足即为真
+     */
+    bool compare(const Value &a, const Value &b, const Expr::Kind op) {
+        if (!a.isSet() && b.isSet()) return compare(b, a, swapOperator(op));
+        if (a.isSet()) {
+            switch (b.type) {
+                case Value::Type::Nodes:
+                case Value::Type::Strings:
+                    return anyString(a, [&](const std::string_view x) {
+                        return anyString(b, [&](const std::string_view y) { return compareStrings(x, y, op); });
+                    });
+                case Value::Type::Number:
+                    return anyString(a, [&](const std::string_view x) {
+                        return compareNumbers(stringToNumber(x), b.number, op);
+                    });
+                case Value::Type::String:
+                    return anyString(a, [&](const std::string_view x) { return compareStrings(x, b.str, op); });
+                case Value::Type::Boolean:
+                    return compareNumbers(toBoolean(a), b.boolean, op);
+            }
+        }
+        if (op == Expr::Kind::Eq || op == Expr::Kind::Ne) {
+            if (a.type == Value::Type::Boolean || b.type == Value::Type::Boolean) {
+                return (toBoolean(a) == toBoolean(b)) == (op == Expr::Kind::Eq);
+            }
+            if (a.type == Value::Type::Number || b.type == Value::Type::Number) {
+                return compareNumbers(toNumber(a), toNumber(b), op);
+            }
+            return compareStrings(toString(a), toString(b), op);
+        }
+        return compareNumbers(toNumber(a), toNumber(b), op);
+    }
+
+    // ---------------------------------------------------------------- 词法分析
+
+    enum class Tok : uint8_t {
+        Name, Number, Literal, Dollar, Slash, DoubleSlash, LBracket, RBracket, LParen, RParen, At, Comma,
+        DoubleColon, Dot, DoubleDot, Pipe, Plus, Minus, Eq, Ne, Lt, Le, Gt, Ge, Star, Multiply, And, Or, Div, Mod, End
+    };
+
+    struct Token {
+        Tok type;
+        std::string value;
+        double number = 0;
+        size_t pos = 0;
+    };
+
+    bool isOperator(const Tok t) {
+        switch (t) {
+            case Tok::And: case Tok::Or: case Tok::Mod: case Tok::Div: case Tok::Multiply: case Tok::Slash:
+            case Tok::DoubleSlash: case Tok::Pipe: case Tok::Plus: case Tok::Minus: case Tok::Eq: case Tok::Ne:
+            case Tok::Lt: case Tok::Le: case Tok::Gt: case Tok::Ge:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool isNameStart(const unsigned char c) {
+        return std::isalpha(c) || c == '_' || c >= 0x80;
+    }
+
+    bool isNameChar(const unsigned char c) {
+        return isNameStart(c) || std::isdigit(c) || c == '-' || c == '.';
+    }
+
+    [[noreturn]] void syntaxError(const std::string &xpath, const std::string &message, const size_t pos) {
+        throw std::invalid_argument("Invalid xpath '" + xpath + "': " + message + " at " + std::to_string(pos));
+    }
+
+    std::vector<Token> tokenize(const std::string &xpath) {
+        std::vector<Token> tokens;
+        size_t p = 0;
+        const size_t n = xpath.size();
+        auto push = [&](const Tok type, const size_t len, std::string value = "") {
+            tokens.push_back({type, std::move(value), 0, p});
+            p += len;
+        };
+        while (true) {
+            while (p < n && isSpace(xpath[p])) p++;
+            if (p >= n) break;
+            // XPath 1.0 3.7：前一个token不是 @ :: ( [ , 或运算符时，'*'是乘号，名称是运算符
+            const bool operatorContext = !tokens.empty() && !isOperator(tokens.back().type) &&
+                                         tokens.back().type != Tok::At && tokens.back().type != Tok::DoubleColon &&
+                                         tokens.back().type != Tok::LParen && tokens.back().type != Tok::LBracket &&
+                                         tokens.back().type != Tok::Comma;
+            const char c = xpath[p];
+            const char next = p + 1 < n ? xpath[p + 1] : '\0';
+            switch (c) {
+                case '/':
+                    next == '/' ? push(Tok::DoubleSlash, 2) : push(Tok::Slash, 1);
+                    continue;
+                case '[': push(Tok::LBracket, 1); continue;
+                case ']': push(Tok::RBracket, 1); continue;
+                case '(': push(Tok::LParen, 1); continue;
+                case ')': push(Tok::RParen, 1); continue;
+                case '@': push(Tok::At, 1); continue;
+                case ',': push(Tok::Comma, 1); continue;
+                case '|': push(Tok::Pipe, 1); continue;
+                case '+': push(Tok::Plus, 1); continue;
+                case '-': push(Tok::Minus, 1); continue;
+                case '=': push(Tok::Eq, 1); continue;
+                case '$': push(Tok::Dollar, 1); continue;
+                case '*':
+                    push(operatorContext ? Tok::Multiply : Tok::Star, 1);
+                    continue;
+                case '!':
+                    if (next != '=') syntaxError(xpath, "unexpected '!'", p);
+                    push(Tok::Ne, 2);
+                    continue;
+                case '<':
+                    next == '=' ? push(Tok::Le, 2) : push(Tok::Lt, 1);
+                    continue;
+                case '>':
+                    next == '=' ? push(Tok::Ge, 2) : push(Tok::Gt, 1);
+                    continue;
+                case ':':
+                    if (next != ':') syntaxError(xpath, "unexpected ':'", p);
+                    push(Tok::DoubleColon, 2);
+                    continue;
+                case '"':
+                case '\'': {
+                    const size_t end = xpath.find(c, p + 1);
+                    if (end == std::string::npos) syntaxError(xpath, "unterminated string", p);
+                    push(Tok::Literal, end + 1 - p, xpath.substr(p + 1, end - p - 1));
+                    continue;
+                }
+                default:
+                    break;
+            }
+            if (std::isdigit(static_cast<unsigned char>(c)) || (c == '.' && std::isdigit(static_cast<unsigned char>(next)))) {
+                size_t end = p;
+                while (end < n && std::isdigit(static_cast<unsigned char>(xpath[end]))) end++;
+                if (end < n && xpath[end] == '.') {
+                    end++;
+                    while (end < n && std::isdigit(static_cast<unsigned char>(xpath[end]))) end++;
+                }
+                Token token{Tok::Number, "", 0, p};
+                std::from_chars(xpath.data() + p, xpath.data() + end, token.number);
+                tokens.push_back(std::move(token));
+                p = end;
+                continue;
+            }
+            if (c == '.') {
+                next == '.' ? push(Tok::DoubleDot, 2) : push(Tok::Dot, 1);
+                continue;
+            }
+            if (isNameStart(c)) {
+                size_t end = p;
+                while (end < n) {
+                    if (isNameChar(xpath[end])) {
+                        end++;
+                    } else if (xpath[end] == ':' && end + 1 < n && isNameStart(xpath[end + 1])) {
+                        end += 2; // 带前缀的名称，如 xlink:href
+                    } else {
+                        break;
+                    }
+                }
+                std::string name = xpath.substr(p, end - p);
+                if (operatorContext) {
+                    Tok op;
+                    if (name == "and") op = Tok::And;
+                    else if (name == "or") op = Tok::Or;
+                    else if (name == "div") op = Tok::Div;
+                    else if (name == "mod") op = Tok::Mod;
+                    else syntaxError(xpath, "expected operator but found '" + name + "'", p);
+                    push(op, end - p);
+                } else {
+                    push(Tok::Name, end - p, std::move(name));
+                }
+                continue;
+            }
+            syntaxError(xpath, std::string("unexpected '") + c + "'", p);
+        }
+        tokens.push_back({Tok::End, "", 0, n});
+        return tokens;
+    }
+
+    // ---------------------------------------------------------------- 语法分析
+
+    struct FunctionInfo {
+        size_t minArgs;
+        size_t maxArgs;
+        bool number; // 返回值是否为数字，数字谓词按位置筛选
+    };
+
+    const std::unordered_map<std::string, FunctionInfo> &functions() {
+        constexpr size_t any = std::numeric_limits<size_t>::max();
+        static const std::unordered_map<std::string, FunctionInfo> table = {
+            {"last", {0, 0, true}}, {"position", {0, 0, true}}, {"count", {1, 1, true}},
+            {"string", {0, 1, false}}, {"concat", {2, any, false}}, {"contains", {2, 2, false}},
+            {"starts-with", {2, 2, false}}, {"ends-with", {2, 2, false}}, {"substring", {2, 3, false}},
+            {"substring-before", {2, 2, false}}, {"substring-after", {2, 2, false}},
+            {"string-length", {0, 1, true}}, {"normalize-space", {0, 1, false}}, {"translate", {3, 3, false}},
+            {"not", {1, 1, false}}, {"true", {0, 0, false}}, {"false", {0, 0, false}}, {"boolean", {1, 1, false}},
+            {"number", {0, 1, true}}, {"sum", {1, 1, true}}, {"floor", {1, 1, true}}, {"ceiling", {1, 1, true}},
+            {"round", {1, 1, true}}, {"name", {0, 1, false}}, {"local-name", {0, 1, false}},
+        };
+        return table;
+    }
+
+    // JsoupXpath的取值函数，作为路径的一步
+    bool isFunctionStep(const std::string &name) {
+        return name == "text" || name == "allText" || name == "html" || name == "outerHtml" || name == "num";
+    }
+
+    bool isNodeType(const std::string &name) {
+        return name == "node" || name == "comment" || name == "processing-instruction";
+    }
+
+    /**
+     * 谓词是否与位置有关：结果为数字，或者使用了position()、last()
+     * 与位置无关的 '//x[p]' 可以改写为 descendant::x[p]，不需要先展开全部节点
+     */
+    bool isPositional(const Expr &e) {
+        switch (e.kind) {
+            case Expr::Kind::Number:
+            case Expr::Kind::Add:
+            case Expr::Kind::Sub:
+            case Expr::Kind::Mul:
+            case Expr::Kind::Div:
+            case Expr::Kind::Mod:
+            case Expr::Kind::Neg:
+                return true;
+            case Expr::Kind::Function:
+                if (functions().at(e.str).number) return true;
+                break;
+            default:
+                break;
+        }
+        if (e.kind == Expr::Kind::Function && (e.str == "position" || e.str == "last")) return true;
+        return std::ranges::any_of(e.args, [](const auto &arg) { return isPositional(*arg); });
+    }
+
+    class Parser {
+    public:
+        explicit Parser(const std::string &xpath) : xpath(xpath), tokens(tokenize(xpath)) {
+        }
+
+        std::unique_ptr<Expr> parse() {
+            auto expr = parseOr();
+            if (peek().type != Tok::End) error("unexpected token");
+            return expr;
+        }
+
+    private:
+        const std::string &xpath;
+        std::vector<Token> tokens;
+        size_t pos = 0;
+
+        const Token &peek(const size_t offset = 0) const {
+            return tokens[std::min(pos + offset, tokens.size() - 1)];
+        }
+
+        bool accept(const Tok type) {
+            if (peek().type != type) return false;
+            pos++;
+            return true;
+        }
+
+        void expect(const Tok type, const char *what) {
+            if (!accept(type)) error(std::string("expected ") + what);
+        }
+
+        [[noreturn]] void error(const std::string &message) const {
+            syntaxError(xpath, message, peek().pos);
+        }
+
+        static std::unique_ptr<Expr> binary(const Expr::Kind kind, std::unique_ptr<Expr> left, std::unique_ptr<Expr> right) {
+            auto expr = std::make_unique<Expr>(kind);
+            expr->args.push_back(std::move(left));
+            expr->args.push_back(std::move(right));
+            return expr;
+        }
+
+        std::unique_ptr<Expr> parseOr() {
+            auto left = parseAnd();
+            while (accept(Tok::Or)) left = binary(Expr::Kind::Or, std::move(left), parseAnd());
+            return left;
+        }
+
+        std::unique_ptr<Expr> parseAnd() {
+            auto left = parseEquality();
+            while (accept(Tok::And)) left = binary(Expr::Kind::And, std::move(left), parseEquality());
+            return left;
+        }
+
+        std::unique_ptr<Expr> parseEquality() {
+            auto left = parseRelational();
+            while (true) {
+                if (accept(Tok::Eq)) left = binary(Expr::Kind::Eq, std::move(left), parseRelational());
+                else if (accept(Tok::Ne)) left = binary(Expr::Kind::Ne, std::move(left), parseRelational());
+                else return left;
+            }
+        }
+
+        std::unique_ptr<Expr> parseRelational() {
+            auto left = parseAdditive();
+            while (true) {
+                if (accept(Tok::Lt)) left = binary(Expr::Kind::Lt, std::move(left), parseAdditive());
+                else if (accept(Tok::Le)) left = binary(Expr::Kind::Le, std::move(left), parseAdditive());
+                else if (accept(Tok::Gt)) left = binary(Expr::Kind::Gt, std::move(left), parseAdditive());
+                else if (accept(Tok::Ge)) left = binary(Expr::Kind::Ge, std::move(left), parseAdditive());
+                else return left;
+            }
+        }
+
+        std::unique_ptr<Expr> parseAdditive() {
+            auto left = parseMultiplicative();
+            while (true) {
+                if (accept(Tok::Plus)) left = binary(Expr::Kind::Add, std::move(left), parseMultiplicative());
+                else if (accept(Tok::Minus)) left = binary(Expr::Kind::Sub, std::move(left), parseMultiplicative());
+                else return left;
+            }
+        }
+
+        std::unique_ptr<Expr> parseMultiplicative() {
+            auto left = parseUnary();
+            while (true) {
+                if (accept(Tok::Multiply)) left = binary(Expr::Kind::Mul, std::move(left), parseUnary());
+                else if (accept(Tok::Div)) left = binary(Expr::Kind::Div, std::move(left), parseUnary());
+                else if (accept(Tok::Mod)) left = binary(Expr::Kind::Mod, std::move(left), parseUnary());
+                else return left;
+            }
+        }
+
+        std::unique_ptr<Expr> parseUnary() {
+            if (accept(Tok::Minus)) {
+                auto expr = std::make_unique<Expr>(Expr::Kind::Neg);
+                expr->args.push_back(parseUnary());
+                return expr;
+            }
+            auto left = parsePath();
+            while (accept(Tok::Pipe)) left = binary(Expr::Kind::Union, std::move(left), parsePath());
+            return left;
+        }
+
+        // 当前token是否为FilterExpr的开头：括号、字面量、数字、函数调用
+        bool atPrimary() const {
+            switch (peek().type) {
+                case Tok::LParen:
+                case Tok::Literal:
+                case Tok::Number:
+                case Tok::Dollar:
+                    return true;
+                case Tok::Name:
+                    return peek(1).type == Tok::LParen && !isNodeType(peek().value) && !isFunctionStep(peek().value);
+                default:
+                    return false;
+            }
+        }
+
+        bool atStep() const {
+            switch (peek().type) {
+                case Tok::Dot:
+                case Tok::DoubleDot:
+                case Tok::At:
+                case Tok::Star:
+                case Tok::Name:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        std::unique_ptr<Expr> parsePath() {
+            auto path = std::make_unique<Expr>(Expr::Kind::Path);
+            if (atPrimary()) {
+                auto primary = parsePrimary();
+                if (peek().type != Tok::LBracket && peek().type != Tok::Slash && peek().type != Tok::DoubleSlash) {
+                    return primary;
+                }
+                path->filter = std::move(primary);
+                while (peek().type == Tok::LBracket) path->filterPredicates.push_back(parsePredicate());
+                if (peek().type == Tok::Slash || peek().type == Tok::DoubleSlash) parseRelativePath(*path, false);
+                return path;
+            }
+            if (accept(Tok::Slash)) {
+                path->absolute = true;
+                if (atStep()) parseRelativePath(*path, true);
+                return path;
+            }
+            if (peek().type == Tok::DoubleSlash) {
+                path->absolute = true;
+                parseRelativePath(*path, false);
+                return path;
+            }
+            if (!atStep()) error("expected location step");
+            parseRelativePath(*path, true);
+            if (path->steps.size() == 1 && path->steps[0].axis == Axis::Attribute &&
+                path->steps[0].test == NodeTest::Name && path->steps[0].predicates.empty()) {
+                path->attribute = path->steps[0].name;
+            }
+            return path;
+        }
+
+        /**
+         * 解析相对路径
+         * @param first 是否直接以Step开头，否则以'/'或'//'开头
+         */
+        void parseRelativePath(Expr &path, bool first) {
+            while (true) {
+                bool descendant = false;
+                if (first) {
+                    first = false;
+                } else if (accept(Tok::DoubleSlash)) {
+                    descendant = true;
+                } else if (!accept(Tok::Slash)) {
+                    break;
+                }
+                if (!path.steps.empty() && path.steps.back().test == NodeTest::Function) {
+                    error("value function must be the last step");
+                }
+                addStep(path, parseStep(), descendant);
+            }
+        }
+
+        static void addStep(Expr &path, Step step, const bool afterDoubleSlash) {
+            if (afterDoubleSlash) {
+                const bool positional = std::ranges::any_of(step.predicates, [](const auto &p) { return isPositional(*p); });
+                if (step.axis == Axis::Child && step.test != NodeTest::Function && !positional) {
+                    step.axis = Axis::Descendant;
+                } else if (step.test == NodeTest::Function && step.name == "text") {
+                    step.recursive = true;
+                } else {
+                    Step all;
+                    all.axis = Axis::DescendantOrSelf;
+                    all.test = NodeTest::Node;
+                    path.steps.push_back(std::move(all));
+                }
+            }
+            path.steps.push_back(std::move(step));
+        }
+
+        Step parseStep() {
+            Step step;
+            if (accept(Tok::Dot)) {
+                step.axis = Axis::Self;
+                step.test = NodeTest::Node;
+                return step;
+            }
+            if (accept(Tok::DoubleDot)) {
+                step.axis = Axis::Parent;
+                step.test = NodeTest::Node;
+                return step;
+            }
+            if (accept(Tok::At)) {
+                step.axis = Axis::Attribute;
+            } else if (peek().type == Tok::Name && peek(1).type == Tok::DoubleColon) {
+                static const std::unordered_map<std::string, Axis> axes = {
+                    {"child", Axis::Child}, {"descendant", Axis::Descendant},
+                    {"descendant-or-self", Axis::DescendantOrSelf}, {"self", Axis::Self},
+                    {"parent", Axis::Parent}, {"ancestor", Axis::Ancestor},
+                    {"ancestor-or-self", Axis::AncestorOrSelf}, {"following-sibling", Axis::FollowingSibling},
+                    {"preceding-sibling", Axis::PrecedingSibling}, {"following", Axis::Following},
+                    {"preceding", Axis::Preceding}, {"attribute", Axis::Attribute},
+                };
+                const auto it = axes.find(peek().value);
+                if (it == axes.end()) error("unknown axis '" + peek().value + "'");
+                step.axis = it->second;
+                pos += 2;
+            }
+            if (accept(Tok::Star)) {
+                step.test = NodeTest::Any;
+            } else if (peek().type == Tok::Name) {
+                std::string name = peek().value;
+                pos++;
+                if (accept(Tok::LParen)) {
+                    expect(Tok::RParen, "')'");
+                    if (name == "node") step.test = NodeTest::Node;
+                    else if (name == "comment") step.test = NodeTest::Comment;
+                    else if (isFunctionStep(name)) step.test = NodeTest::Function;
+                    else error("unsupported node test '" + name + "()'");
+                    step.name = std::move(name);
+                } else {
+                    step.test = NodeTest::Name;
+                    step.name = toLower(std::move(name));
+                }
+            } else {
+                error("expected node test");
+            }
+            while (peek().type == Tok::LBracket) {
+                auto predicate = parsePredicate();
+                if (step.test == NodeTest::Function && predicate->kind != Expr::Kind::Number) {
+                    error("only index predicates are supported on value functions");
+                }
+                step.predicates.push_back(std::move(predicate));
+            }
+            return step;
+        }
+
+        std::unique_ptr<Expr> parsePredicate() {
+            expect(Tok::LBracket, "'['");
+            auto expr = parseOr();
+            expect(Tok::RBracket, "']'");
+            return expr;
+        }
+
+        std::unique_ptr<Expr> parsePrimary() {
+            const Token &token = peek();
+            switch (token.type) {
+                case Tok::LParen: {
+                    pos++;
+                    auto expr = parseOr();
+                    expect(Tok::RParen, "')'");
+                    return expr;
+                }
+                case Tok::Literal: {
+                    auto expr = std::make_unique<Expr>(Expr::Kind::Literal);
+                    expr->str = token.value;
+                    pos++;
+                    return expr;
+                }
+                case Tok::Number: {
+                    auto expr = std::make_unique<Expr>(Expr::Kind::Number);
+                    expr->number = token.number;
+                    pos++;
+                    return expr;
+                }
+                case Tok::Dollar:
+                    error("variables are not supported");
+                default:
+                    break;
+            }
+            auto expr = std::make_unique<Expr>(Expr::Kind::Function);
+            expr->str = token.value;
+            const auto it = functions().find(expr->str);
+            if (it == functions().end()) error("unknown function '" + expr->str + "'");
+            pos += 2;
+            if (!accept(Tok::RParen)) {
+                do {
+                    expr->args.push_back(parseOr());
+                } while (accept(Tok::Comma));
+                expect(Tok::RParen, "')'");
+            }
+            if (expr->args.size() < it->second.minArgs || expr->args.size() > it->second.maxArgs) {
+                error("wrong number of arguments for '" + expr->str + "()'");
+            }
+            return expr;
+        }
+    };
+
+    // ---------------------------------------------------------------- 执行
+
+    Value evaluate(const Expr &e, const Context &ctx);
+
+    bool testNode(const Step &step, const Node *node) {
+        switch (step.test) {
+            case NodeTest::Name:
+                return node->type == NodeType::Element && equalsIgnoreCase(node->name, step.name);
+            case NodeTest::Any:
+                return node->type == NodeType::Element;
+            case NodeTest::Node:
+                return true;
+            case NodeTest::Comment:
+                return node->type == NodeType::Comment;
+            case NodeTest::Function:
+                return false;
+        }
+        return false;
+    }
+
+    // 先序遍历root的全部后代（不含root）
+    template<typename F>
+    void forDescendants(const Node *root, F &&f) {
+        const Node *node = root->firstChild;
+        while (node != nullptr) {
+            f(node);
+            if (node->firstChild != nullptr) {
+                node = node->firstChild;
+                continue;
+            }
+            while (node != root && node->next == nullptr) node = node->parent;
+            if (node == root) break;
+            node = node->next;
+        }
+    }
+
+    /**
+     * 按轴的方向收集节点，逆向轴（ancestor、preceding等）按距离由近到远排列，谓词中的位置以此为准
+     */
+    void collectAxis(const Step &step, const Item &item, std::vector<Item> &out) {
+        const Node *node = item.node;
+        auto add = [&](const Node *n) {
+            if (testNode(step, n)) out.push_back({n});
+        };
+        if (item.attr >= 0) {
+            // 属性节点只有self、parent与ancestor
+            switch (step.axis) {
+                case Axis::Self:
+                case Axis::DescendantOrSelf:
+                    if (step.test == NodeTest::Node) out.push_back(item);
+                    return;
+                case Axis::AncestorOrSelf:
+                    if (step.test == NodeTest::Node) out.push_back(item);
+                    [[fallthrough]];
+                case Axis::Ancestor:
+                    for (const Node *n = node; n != nullptr; n = n->parent) add(n);
+                    return;
+                case Axis::Parent:
+                    add(node);
+                    return;
+                default:
+                    return;
+            }
+        }
+        switch (step.axis) {
+            case Axis::Child:
+                for (const Node *c = node->firstChild; c != nullptr; c = c->next) add(c);
+                break;
+            case Axis::DescendantOrSelf:
+                add(node);
+                [[fallthrough]];
+            case Axis::Descendant:
+                forDescendants(node, add);
+                break;
+            case Axis::Self:
+                add(node);
+                break;
+            case Axis::Parent:
+                if (node->parent != nullptr) add(node->parent);
+                break;
+            case Axis::AncestorOrSelf:
+                add(node);
+                [[fallthrough]];
+            case Axis::Ancestor:
+                for (const Node *n = node->parent; n != nullptr; n = n->parent) add(n);
+                break;
+            case Axis::FollowingSibling:
+                for (const Node *s = node->next; s != nullptr; s = s->next) add(s);
+                break;
+            case Axis::PrecedingSibling:
+                for (const Node *s = node->prev; s != nullptr; s = s->prev) add(s);
+                break;
+            case Axis::Following:
+                for (const Node *n = node; n != nullptr; n = n->parent) {
+                    for (const Node *s = n->next; s != nullptr; s = s->next) {
+                        add(s);
+                        forDescendants(s, add);
+                    }
+                }
+                break;
+            case Axis::Preceding:
+                for (const Node *n = node; n != nullptr; n = n->parent) {
+                    for (const Node *s = n->prev; s != nullptr; s = s->prev) {
+                        const size_t begin = out.size();
+                        add(s);
+                        forDescendants(s, add);
+                        std::reverse(out.begin() + static_cast<std::ptrdiff_t>(begin), out.end());
+                    }
+                }
+                break;
+            case Axis::Attribute:
+                if (node->type != NodeType::Element) break;
+                for (uint32_t i = 0; i < node->attributeCount; i++) {
+                    if (step.test == NodeTest::Any || step.test == NodeTest::Node ||
+                        (step.test == NodeTest::Name && equalsIgnoreCase(node->attributes[i].name, step.name))) {
+                        out.push_back({node, static_cast<int32_t>(i)});
+                    }
+                }
+                break;
+        }
+    }
+
+    bool isReverse(const Axis axis) {
+        return axis == Axis::Parent || axis == Axis::Ancestor || axis == Axis::AncestorOrSelf ||
+               axis == Axis::PrecedingSibling || axis == Axis::Preceding;
+    }
+
+    // 依次执行谓词，每个谓词中的位置都基于上一个谓词的结果
+    template<typename T, typename MakeContext>
+    void applyPredicates(const std::vector<std::unique_ptr<Expr> > &predicates, std::vector<T> &items,
+                         MakeContext &&makeContext) {
+        for (const auto &predicate: predicates) {
+            if (items.empty()) return;
+            if (predicate->kind == Expr::Kind::Number) {
+                // [n] 直接按位置选取
+                const double n = predicate->number;
+                if (n >= 1 && n <= static_cast<double>(items.size()) && n == std::floor(n)) {
+                    T kept = std::move(items[static_cast<size_t>(n) - 1]);
+                    items.clear();
+                    items.push_back(std::move(kept));
+                } else {
+                    items.clear();
+                }
+                continue;
+            }
+            std::vector<T> kept;
+            const size_t size = items.size();
+            if constexpr (std::is_same_v<T, Item>) {
+                if (!predicate->attribute.empty()) {
+                    // [@name]
+                    for (size_t i = 0; i < size; i++) {
+                        if (attributeOf(*predicate, makeContext(items[i], i + 1, size)) != nullptr) kept.push_back(items[i]);
+                    }
+                    items = std::move(kept);
+                    continue;
+                }
+            }
+            for (size_t i = 0; i < size; i++) {
+                const Value v = evaluate(*predicate, makeContext(items[i], i + 1, size));
+                if (v.type == Value::Type::Number ? v.number == static_cast<double>(i + 1) : toBoolean(v)) {
+                    kept.push_back(std::move(items[i]));
+                }
+            }
+            items = std::move(kept);
+        }
+    }
+
+    // 取值函数
+    void functionStep(const Step &step, const Item &item, std::vector<std::string> &out) {
+        const Node *node = item.node;
+        std::vector<std::string> values;
+        auto add = [&](std::string s) {
+            if (!s.empty()) values.push_back(std::move(s));
+        };
+        if (item.attr >= 0) {
+            add(std::string(node->attributes[item.attr].value));
+        } else if (step.name == "text") {
+            if (step.recursive) {
+                if (node->type == NodeType::Text) add(std::string(trimSpace(node->textNodeText())));
+                forDescendants(node, [&](const Node *n) {
+                    if (n->type == NodeType::Text) add(std::string(trimSpace(n->textNodeText())));
+                });
+            } else if (node->type == NodeType::Element) {
+                add(node->nameIs("script") ? node->data() : node->ownText());
+            } else if (node->type == NodeType::Text) {
+                add(node->textNodeText());
+            }
+        } else if (node->type != NodeType::Element && node->type != NodeType::Document) {
+            add(std::string(node->value));
+        } else if (step.name == "allText") {
+            add(node->text());
+        } else if (step.name == "html") {
+            add(node->html());
+        } else if (step.name == "outerHtml") {
+            add(node->outerHtml());
+        } else if (step.name == "num") {
+            // 自身文本中的第一个数字
+            const std::string text = node->ownText();
+            const size_t begin = text.find_first_of("0123456789");
+            if (begin != std::string::npos) {
+                size_t end = text.find_first_not_of("0123456789", begin);
+                if (end != std::string::npos && text[end] == '.' && end + 1 < text.size() &&
+                    std::isdigit(static_cast<unsigned char>(text[end + 1]))) {
+                    end = text.find_first_not_of("0123456789", end + 1);
+                }
+                add(text.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+            }
+        }
+        applyPredicates(step.predicates, values, [](const std::string &, size_t, size_t) -> Context {
+            return {}; // 取值函数只支持数字索引，不会执行到这里
+        });
+        std::move(values.begin(), values.end(), std::back_inserter(out));
+    }
+
+    Value applySteps(const std::vector<Step> &steps, std::vector<Item> input, const Node *root) {
+        std::vector<Item> axisNodes;
+        for (const Step &step: steps) {
+            if (step.test == NodeTest::Function) {
+                std::vector<std::string> strings;
+                for (const Item &item: input) functionStep(step, item, strings);
+                return Value::ofStrings(std::move(strings));
+            }
+            std::vector<Item> output;
+            for (const Item &item: input) {
+                axisNodes.clear();
+                collectAxis(step, item, axisNodes);
+                applyPredicates(step.predicates, axisNodes, [&](const Item &it, const size_t position, const size_t size) {
+                    return Context{it, position, size, root};
+                });
+                output.insert(output.end(), axisNodes.begin(), axisNodes.end());
+            }
+            if (isReverse(step.axis) || input.size() > 1) sortUnique(output);
+            input = std::move(output);
+            if (input.empty()) break;
+        }
+        return Value::ofNodes(std::move(input));
+    }
+
+    Value evaluatePath(const Expr &e, const Context &ctx) {
+        std::vector<Item> input;
+        if (e.filter != nullptr) {
+            Value v = evaluate(*e.filter, ctx);
+            if (v.type == Value::Type::Strings) {
+                // 取值函数的结果只能按索引筛选
+                applyPredicates(e.filterPredicates, v.strings, [&](const std::string &, size_t, size_t) {
+                    return ctx;
+                });
+                return v;
+            }
+            if (v.type != Value::Type::Nodes) throw std::invalid_argument("xpath: predicates and steps require a node-set");
+            applyPredicates(e.filterPredicates, v.nodes, [&](const Item &it, const size_t position, const size_t size) {
+                return Context{it, position, size, ctx.root};
+            });
+            input = std::move(v.nodes);
+        } else {
+            input.push_back(e.absolute ? Item{ctx.root} : ctx.item);
+        }
+        return applySteps(e.steps, std::move(input), ctx.root);
+    }
+
+    std::string nameOf(const Item &item) {
+        if (item.attr >= 0) return std::string(item.node->attributes[item.attr].name);
+        return item.node->type == NodeType::Element ? std::string(item.node->name) : "";
+    }
+
+    double roundHalfUp(const double x) {
+        if (std::isnan(x) || std::isinf(x)) return x;
+        return std::floor(x + 0.5);
+    }
+
+    Value callFunction(const Expr &e, const Context &ctx) {
+        const std::string &name = e.str;
+        auto arg = [&](const size_t i) { return evaluate(*e.args[i], ctx); };
+        auto argString = [&](const size_t i) -> std::string {
+            if (i >= e.args.size()) return stringOf(ctx.item);
+            if (!e.args[i]->attribute.empty()) {
+                const auto *attribute = attributeOf(*e.args[i], ctx);
+                return attribute != nullptr ? std::string(attribute->value) : "";
+            }
+            return toString(arg(i));
+        };
+        if (name == "last") return Value::ofNumber(static_cast<double>(ctx.size));
+        if (name == "position") return Value::ofNumber(static_cast<double>(ctx.position));
+        if (name == "count") {
+            const Value v = arg(0);
+            return Value::ofNumber(static_cast<double>(v.type == Value::Type::Strings ? v.strings.size() : v.nodes.size()));
+        }
+        if (name == "string") return Value::ofString(argString(0));
+        if (name == "concat") {
+            std::string result;
+            for (size_t i = 0; i < e.args.size(); i++) result += toString(arg(i));
+            return Value::ofString(std::move(result));
+        }
+        if (name == "contains") return Value::ofBoolean(argString(0).find(argString(1)) != std::string::npos);
+        if (name == "starts-with") return Value::ofBoolean(argString(0).starts_with(argString(1)));
+        if (name == "ends-with") return Value::ofBoolean(argString(0).ends_with(argString(1)));
+        if (name == "substring-before" || name == "substring-after") {
+            const std::string s = argString(0);
+            const std::string sep = argString(1);
+            const size_t p = s.find(sep);
+            if (p == std::string::npos) return Value::ofString("");
+            return Value::ofString(name == "substring-before" ? s.substr(0, p) : s.substr(p + sep.size()));
+        }
+        if (name == "substring") {
+            // 位置从1开始，按字符计算，四舍五入
+            const std::string s = argString(0);
+            const auto chars = splitChars(s);
+            const double start = roundHalfUp(toNumber(arg(1)));
+            const double end = e.args.size() > 2 ? start + roundHalfUp(toNumber(arg(2))) : std::numeric_limits<double>::infinity();
+            std::string result;
+            for (size_t i = 0; i < chars.size(); i++) {
+                const auto p = static_cast<double>(i + 1);
+                if (p >= start && p < end) result += chars[i];
+            }
+            return Value::ofString(std::move(result));
+        }
+        if (name == "string-length") return Value::ofNumber(static_cast<double>(charCount(argString(0))));
+        if (name == "normalize-space") {
+            std::string result;
+            for (const char c: argString(0)) {
+                if (isSpace(c)) {
+                    if (!result.empty() && result.back() != ' ') result += ' ';
+                } else {
+                    result += c;
+                }
+            }
+            if (!result.empty() && result.back() == ' ') result.pop_back();
+            return Value::ofString(std::move(result));
+        }
+        if (name == "translate") {
+            const std::string s = argString(0);
+            const auto from = splitChars(argString(1));
+            const auto to = splitChars(argString(2));
+            std::string result;
+            for (const auto c: splitChars(s)) {
+                const auto it = std::ranges::find(from, c);
+                if (it == from.end()) {
+                    result += c;
+                } else if (const size_t i = it - from.begin(); i < to.size()) {
+                    result += to[i];
+                }
+            }
+            return Value::ofString(std::move(result));
+        }
+        if (name == "not") return Value::ofBoolean(!toBoolean(arg(0)));
+        if (name == "true") return Value::ofBoolean(true);
+        if (name == "false") return Value::ofBoolean(false);
+        if (name == "boolean") return Value::ofBoolean(toBoolean(arg(0)));
+        if (name == "number") {
+            return Value::ofNumber(e.args.empty() ? stringToNumber(stringOf(ctx.item)) : toNumber(arg(0)));
+        }
+        if (name == "sum") {
+            const Value v = arg(0);
+            double sum = 0;
+            anyString(v, [&](const std::string_view s) {
+                sum += stringToNumber(s);
+                return false;
+            });
+            return Value::ofNumber(sum);
+        }
+        if (name == "floor") return Value::ofNumber(std::floor(toNumber(arg(0))));
+        if (name == "ceiling") return Value::ofNumber(std::ceil(toNumber(arg(0))));
+        if (name == "round") return Value::ofNumber(roundHalfUp(toNumber(arg(0))));
+        if (name == "name" || name == "local-name") {
+            if (e.args.empty()) return Value::ofString(nameOf(ctx.item));
+            const Value v = arg(0);
+            if (v.type != Value::Type::Nodes || v.nodes.empty()) return Value::ofString("");
+            std::string result = nameOf(v.nodes.front());
+            if (name == "local-name") {
+                if (const size_t colon = result.find(':'); colon != std::string::npos) result = result.substr(colon + 1);
+            }
+            return Value::ofString(std::move(result));
+        }
+        throw std::invalid_argument("xpath: unknown function '" + name + "'");
+    }
+
+    double arithmetic(const Expr::Kind kind, const double a, const double b) {
+        switch (kind) {
+            case Expr::Kind::Add: return a + b;
+            case Expr::Kind::Sub: return a - b;
+            case Expr::Kind::Mul: return a * b;
+            case Expr::Kind::Div: return a / b;
+            default: return std::fmod(a, b);
+        }
+    }
+
+    Value evaluate(const Expr &e, const Context &ctx) {
+        switch (e.kind) {
+            case Expr::Kind::Or:
+                return Value::ofBoolean(toBoolean(evaluate(*e.args[0], ctx)) || toBoolean(evaluate(*e.args[1], ctx)));
+            case Expr::Kind::And:
+                return Value::ofBoolean(toBoolean(evaluate(*e.args[0], ctx)) && toBoolean(evaluate(*e.args[1], ctx)));
+            case Expr::Kind::Eq:
+            case Expr::Kind::Ne:
+            case Expr::Kind::Lt:
+            case Expr::Kind::Le:
+            case Expr::Kind::Gt:
+            case Expr::Kind::Ge: {
+                // @name与字面量比较，属性不存在时为空集合，结果为假
+                const Expr &left = *e.args[0];
+                const Expr &right = *e.args[1];
+                if (!left.attribute.empty() && right.kind == Expr::Kind::Literal) {
+                    const auto *attribute = attributeOf(left, ctx);
+                    return Value::ofBoolean(attribute != nullptr && compareStrings(attribute->value, right.str, e.kind));
+                }
+                if (!right.attribute.empty() && left.kind == Expr::Kind::Literal) {
+                    const auto *attribute = attributeOf(right, ctx);
+                    return Value::ofBoolean(attribute != nullptr && compareStrings(attribute->value, left.str, swapOperator(e.kind)));
+                }
+                return Value::ofBoolean(compare(evaluate(left, ctx), evaluate(right, ctx), e.kind));
+            }
+            case Expr::Kind::Add:
+            case Expr::Kind::Sub:
+            case Expr::Kind::Mul:
+            case Expr::Kind::Div:
+            case Expr::Kind::Mod:
+                return Value::ofNumber(arithmetic(e.kind, toNumber(evaluate(*e.args[0], ctx)),
+                                                  toNumber(evaluate(*e.args[1], ctx))));
+            case Expr::Kind::Neg:
+                return Value::ofNumber(-toNumber(evaluate(*e.args[0], ctx)));
+            case Expr::Kind::Union: {
+                Value a = evaluate(*e.args[0], ctx);
+                Value b = evaluate(*e.args[1], ctx);
+                if (a.type == Value::Type::Nodes && b.type == Value::Type::Nodes) {
+                    a.nodes.insert(a.nodes.end(), b.nodes.begin(), b.nodes.end());
+                    sortUnique(a.nodes);
+                    return a;
+                }
+                if (a.type == Value::Type::Strings && b.type == Value::Type::Strings) {
+                    std::move(b.strings.begin(), b.strings.end(), std::back_inserter(a.strings));
+                    return a;
+                }
+                throw std::invalid_argument("xpath: '|' requires node-sets");
+            }
+            case Expr::Kind::Literal:
+                return Value::ofString(e.str);
+            case Expr::Kind::Number:
+                return Value::ofNumber(e.number);
+            case Expr::Kind::Function:
+                return callFunction(e, ctx);
+            case Expr::Kind::Path:
+                return evaluatePath(e, ctx);
+        }
+        return {};
+    }
+
+    Value run(const Expr &expr, const Node *root) {
+        if (root == nullptr) return {};
+        return evaluate(expr, Context{Item{root}, 1, 1, root});
+    }
+}
+
+namespace Xpath {
+
+    std::shared_ptr<const Expression> Expression::parse(const std::string &xpath) {
+        return std::make_shared<const Expression>(std::shared_ptr<const Expr>(Parser(xpath).parse()));
+    }
+
+    std::shared_ptr<const Expression> Expression::compile(const std::string &xpath) {
+        static std::mutex mutex;
+        static std::unordered_map<std::string, std::shared_ptr<const Expression> > cache;
+        constexpr size_t maxCacheSize = 4096;
+        {
+            std::lock_guard lock(mutex);
+            if (const auto it = cache.find(xpath); it != cache.end()) return it->second;
+        }
+        std::shared_ptr<const Expression> expression = nullptr;
+        try {
+            expression = parse(xpath);
+        } catch (const std::invalid_argument &) {
+            expression = nullptr;
+        }
+        std::lock_guard lock(mutex);
+        if (cache.size() >= maxCacheSize) cache.clear();
+        cache.emplace(xpath, expression);
+        return expression;
+    }
+
+    Expression::Expression(std::shared_ptr<const Expr> expr) : expr(std::move(expr)) {
+    }
+
+    Elements Expression::selectElements(const Node *root) const {
+        Elements result;
+        const Value v = run(*expr, root);
+        if (v.type != Value::Type::Nodes) return result;
+        for (const Item &item: v.nodes) {
+            if (item.attr < 0 && item.node->isElement()) result.push_back(item.node);
+        }
+        return result;
+    }
+
+    std::vector<std::string> Expression::selectStrings(const Node *root) const {
+        Value v = run(*expr, root);
+        switch (v.type) {
+            case Value::Type::Nodes: {
+                std::vector<std::string> result;
+                result.reserve(v.nodes.size());
+                for (const Item &item: v.nodes) {
+                    if (item.attr >= 0) {
+                        result.emplace_back(item.node->attributes[item.attr].value);
+                    } else if (item.node->type == NodeType::Element) {
+                        result.push_back(item.node->outerHtml());
+                    } else if (item.node->type == NodeType::Document) {
+                        result.push_back(item.node->html());
+                    } else if (item.node->type == NodeType::Text) {
+                        result.push_back(item.node->textNodeText());
+                    } else {
+                        result.emplace_back(item.node->value);
+                    }
+                }
+                return result;
+            }
+            case Value::Type::Strings:
+                return std::move(v.strings);
+            default:
+                return {toString(v)};
+        }
+    }
+}
+
+namespace {
+    std::string trimRule(const std::string &s) {
+        return std::string(trimSpace(s));
+    }
+
+    template<typename T>
+    std::vector<T> mergeResults(std::vector<std::vector<T> > &results, const std::string &elementsType) {
+        std::vector<T> merged;
+        if (results.empty()) return merged;
+        if (elementsType == "%%") {
+            // 交替合并
+            for (size_t i = 0; i < results[0].size(); i++) {
+                for (auto &temp: results) {
+                    if (i < temp.size()) merged.push_back(std::move(temp[i]));
+                }
+            }
+        } else {
+            for (auto &temp: results) {
+                std::move(temp.begin(), temp.end(), std::back_inserter(merged));
+            }
+        }
+        return merged;
+    }
+
+    /**
+     * 按 '&&'、'||'、'%%' 拆分规则，对每一部分执行 single 后合并结果
+     */
+    template<typename T, typename Single>
+    std::vector<T> evaluateRule(const std::string &rule, Single &&single) {
+        if (rule.empty()) return {};
+        RuleAnalyzer ruleAnalyzes(rule);
+        const auto rules = ruleAnalyzes.splitRule({"&&", "||", "%%"});
+        if (rules.size() == 1) return single(trimRule(rules[0]));
+        std::vector<std::vector<T> > results;
+        for (const auto &rl: rules) {
+            auto temp = evaluateRule<T>(rl, single);
+            if (temp.empty()) continue;
+            results.push_back(std::move(temp));
+            if (ruleAnalyzes.elementsType == "||") break;
+        }
+        return mergeResults(results, ruleAnalyzes.elementsType);
+    }
+}
+
+AnalyzeByXPath::AnalyzeByXPath(const std::string &html)
+    : document(Html::Document::parse(html, StringUtils::startsWithIgnoreCase(trimRule(html.substr(0, 64)), "<?xml"))),
+      element(document->root()) {
+}
+
+AnalyzeByXPath::AnalyzeByXPath(std::shared_ptr<const Html::Document> document, const Html::Node *element)
+    : document(std::move(document)), element(element != nullptr ? element : this->document->root()) {
+}
+
+Elements AnalyzeByXPath::getElements(const std::string &rule) const {
+    return evaluateRule<const Node *>(rule, [&](const std::string &xpath) {
+        const auto expression = Xpath::Expression::compile(xpath);
+        return expression != nullptr ? expression->selectElements(element) : Elements{};
+    });
+}
+
+std::optional<std::string> AnalyzeByXPath::getString(const std::string &rule) const {
+    const auto list = getStringList(rule);
+    if (list.empty()) return std::nullopt;
+    std::string result;
+    for (const auto &s: list) {
+        if (!result.empty()) result += '\n';
+        result += s;
+    }
+    return result;
+}
+
+std::vector<std::string> AnalyzeByXPath::getStringList(const std::string &rule) const {
+    return evaluateRule<std::string>(rule, [&](const std::string &xpath) {
+        const auto expression = Xpath::Expression::compile(xpath);
+        return expression != nullptr ? expression->selectStrings(element) : std::vector<std::string>{};
+    });
+}
@@ -0,0 +1,73 @@
+#include <booksource/rule.h>
+#include <booksource/threadpool.h>
+#include <chrono>
+#include <iostream>
+#include "bench_pages.h"
+
+// 100本书的搜索结果页：串行解析与不同线程数的并行解析
+
+template<typename F>
+static double measure(const int rounds, F &&f) {
+    f(); // 预热，同时创建每个线程的js引擎
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) f();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / rounds * 1e3;
+}
+
+static void bench(const std::string &title, BookSource &bookSource, const std::string &page, const int rounds) {
+    RuleData ruleData;
+    AnalyzeUrl analyzeUrl("/search?q={{key}}", "斗破", 1, std::nullopt, std::nullopt, "https://www.example.com");
+    std::string baseUrl = "https://www.example.com/search";
+    size_t count = 0;
+    const double serial = measure(rounds, [&] {
+        count = BookList::analyzeBookList(bookSource, ruleData, analyzeUrl, baseUrl, page).size();
+    });
+    std::cout << title << ": serial " << serial << " ms (" << count << " books)" << std::endl;
+    for (const size_t threads: {1, 2, 4, 8}) {
+        ThreadPool pool(threads);
+        const double parallel = measure(rounds, [&] {
+            count = BookList::analyzeBookList(bookSource, ruleData, analyzeUrl, baseUrl, page,
+                                              true, false, std::nullopt, std::nullopt, &pool).size();
+        });
+        std::cout << "  " << threads << " threads: " << parallel << " ms, speedup " << serial / parallel << std::endl;
+    }
+}
+
+int main() {
+    const std::string page = makeSearchPageItems(100);
+    std::cout << "100 books, " << page.size() / 1024 << " KB, " << std::thread::hardware_concurrency() << " cores"
+            << std::endl;
+
+    auto plain = BookSourceParser::parseBookSource(R"({
+        "bookSourceUrl": "https://www.example.com",
+        "ruleSearch": {
+            "bookList": "class.bookbox",
+            "name": "class.bookname@text",
+            "author": "class.author@text##作者：",
+            "kind": "class.cat@text",
+            "lastChapter": "class.update@a@text",
+            "intro": "class.intro@text",
+            "coverUrl": "tag.img@src",
+            "bookUrl": "class.bookname@a@href"
+        }
+    })");
+    bench("plain rules", plain, page, 20);
+
+    // 书名与作者经过js处理，模拟需要解密的书源
+    auto js = BookSourceParser::parseBookSource(R"json({
+        "bookSourceUrl": "https://www.example.com",
+        "ruleSearch": {
+            "bookList": "class.bookbox",
+            "name": "class.bookname@text@js:var h = 0; for (var i = 0; i < 20000; i++) h = (h * 31 + i) % 1000003; result",
+            "author": "class.author@text@js:var h = 0; for (var i = 0; i < 20000; i++) h = (h * 31 + i) % 1000003; result.replace('作者：', '')",
+            "kind": "class.cat@text",
+            "lastChapter": "class.update@a@text",
+            "intro": "class.intro@text",
+            "coverUrl": "tag.img@src",
+            "bookUrl": "class.bookname@a@href"
+        }
+    })json");
+    bench("js rules", js, page, 5);
+    return 0;
+}
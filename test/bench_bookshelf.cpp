@@ -0,0 +1,71 @@
+#include <booksource/bookshelf.h>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+// 500本书、每本2000章的书架：写入、打开与按范围读取目录的时间
+
+static double since(const std::chrono::steady_clock::time_point start) {
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() * 1e3;
+}
+
+int main() {
+    constexpr int books = 500, chapters = 2000;
+    const auto file = (std::filesystem::temp_directory_path() / "booksource_bench_shelf.db").string();
+    std::filesystem::remove(file);
+    double write = 0;
+    {
+        BookShelf shelf(file);
+        for (int b = 0; b < books; b++) {
+            Book book;
+            book.bookUrl = "https://www.example.com/book/" + std::to_string(b) + "/";
+            book.tocUrl = book.bookUrl + "toc.html";
+            book.origin = "https://www.example.com";
+            book.name = "书" + std::to_string(b);
+            book.author = "作者" + std::to_string(b % 50);
+            std::vector<BookChapter> toc;
+            toc.reserve(chapters);
+            for (int i = 0; i < chapters; i++) {
+                BookChapter chapter("/book/" + std::to_string(b) + "/" + std::to_string(i) + ".html",
+                                    "第" + std::to_string(i + 1) + "章 标题");
+                chapter.baseUrl = book.tocUrl;
+                chapter.bookUrl = book.bookUrl;
+                chapter.index = i;
+                toc.push_back(std::move(chapter));
+            }
+            const auto start = std::chrono::steady_clock::now();
+            shelf.write(BookShelf::Batch().putBook(book).putChapters(book.bookUrl, toc));
+            write += since(start);
+        }
+        std::cout << books << " books, " << books * chapters << " chapters: write " << write << " ms, "
+                << std::filesystem::file_size(file) / 1024 / 1024 << " MB" << std::endl;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    BookShelf shelf(file);
+    std::cout << "open " << since(start) << " ms, " << shelf.bookCount() << " books" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    size_t total = 0;
+    for (int b = 0; b < books; b++) {
+        total += shelf.getChapters("https://www.example.com/book/" + std::to_string(b) + "/", 1000, 1050).size();
+    }
+    std::cout << "range scan of 50 chapters per book: " << since(start) << " ms (" << total << " chapters)"
+            << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    total = shelf.getChapters("https://www.example.com/book/0/").size();
+    std::cout << "full toc of one book: " << since(start) << " ms (" << total << " chapters)" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    total = 0;
+    for (int a = 0; a < 50; a++) {
+        for (int b = a; b < books; b += 50) {
+            total += shelf.getBooks("书" + std::to_string(b), "作者" + std::to_string(a)).size();
+        }
+    }
+    std::cout << "name/author lookups: " << since(start) << " ms (" << total << " books)" << std::endl;
+    std::filesystem::remove(file);
+    return 0;
+}
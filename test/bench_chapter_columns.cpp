@@ -0,0 +1,75 @@
+#include <booksource/bookshelf.h>
+#include <booksource/chaptercolumns.h>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+// 20000章的目录：按列保存与std::vector<BookChapter>的内存、遍历查找与从书架读取的时间
+
+static double since(const std::chrono::steady_clock::time_point start) {
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() * 1e3;
+}
+
+int main() {
+    constexpr int count = 20000, rounds = 20;
+    const std::string bookUrl = "https://www.example.com/book/1/";
+    std::vector<BookChapter> chapters;
+    chapters.reserve(count);
+    for (int i = 0; i < count; i++) {
+        BookChapter chapter("/book/1/" + std::to_string(i) + ".html", "第" + std::to_string(i + 1) + "章 标题");
+        chapter.baseUrl = bookUrl + "toc.html";
+        chapter.bookUrl = bookUrl;
+        chapter.index = i;
+        chapters.push_back(std::move(chapter));
+    }
+    const ChapterList list(chapters);
+
+    size_t vectorBytes = chapters.capacity() * sizeof(BookChapter);
+    for (const auto &chapter: chapters) {
+        for (const auto *s: {&chapter.url, &chapter.title, &chapter.baseUrl, &chapter.bookUrl}) {
+            if (s->capacity() > 15) vectorBytes += s->capacity() + 1;
+        }
+    }
+    std::cout << "memory: vector " << vectorBytes / 1024 << " KB, columns " << list.memoryUsage() / 1024 << " KB"
+            << std::endl;
+
+    // 按标题搜索与按url查找最后一章
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const auto &chapter: chapters) {
+            if (chapter.title.find("99") != std::string::npos) found++;
+        }
+        for (const auto &chapter: chapters) {
+            if (chapter.url == chapters.back().url) {
+                found++;
+                break;
+            }
+        }
+    }
+    const double vectorScan = since(start) / rounds;
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        found += list.search("99").size();
+        found += list.find(list[count - 1].url()).has_value();
+    }
+    const double columnScan = since(start) / rounds;
+    std::cout << "scan: vector " << vectorScan << " ms, columns " << columnScan << " ms (" << found << ")" << std::endl;
+
+    const auto file = (std::filesystem::temp_directory_path() / "booksource_bench_columns.db").string();
+    std::filesystem::remove(file);
+    {
+        BookShelf shelf(file);
+        shelf.putChapters(bookUrl, list);
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) found += shelf.getChapters(bookUrl).size();
+        const double vectorRead = since(start) / rounds;
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) found += shelf.getChapterList(bookUrl).size();
+        const double columnRead = since(start) / rounds;
+        std::cout << "read toc: vector " << vectorRead << " ms, columns " << columnRead << " ms" << std::endl;
+    }
+    std::filesystem::remove(file);
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <booksource/webbook.h>
+#include <chrono>
+#include <iostream>
+#include "toc_site.h"
+
+// 分页目录：本地模拟站点每次响应有固定的延迟，比较逐页下载与线程池中并发、流水线下载
+
+static double measure(BookSource &bookSource, TocSite &site, ThreadPool *pool, size_t &count) {
+    RuleData ruleData;
+    Book book;
+    book.bookUrl = site.getServer().url("/book/1/");
+    book.tocUrl = site.tocUrl();
+    const auto start = std::chrono::steady_clock::now();
+    count = WebBook::getChapterList(bookSource, book, ruleData, pool).size();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() * 1e3;
+}
+
+static void bench(const std::string &title, const std::string &nextTocUrl, TocSite &site) {
+    auto bookSource = BookSourceParser::parseBookSource(R"json({
+        "bookSourceUrl": "https://www.example.com",
+        "ruleToc": {
+            "chapterList": "class.toc@tag.li",
+            "chapterName": "tag.a@text",
+            "chapterUrl": "tag.a@href",
+            "nextTocUrl": ")json" + nextTocUrl + R"json("
+        }
+    })json");
+    size_t count = 0;
+    const double serial = measure(bookSource, site, nullptr, count);
+    std::cout << title << ": serial " << serial << " ms (" << count << " chapters)" << std::endl;
+    for (const size_t threads: {1, 4, 16}) {
+        ThreadPool pool(threads);
+        const double parallel = measure(bookSource, site, &pool, count);
+        std::cout << "  " << threads << " threads: " << parallel << " ms, speedup " << serial / parallel << std::endl;
+    }
+}
+
+// 刷新书架：目录有2个新章节时完整刷新与增量刷新的耗时
+static void benchUpdate(TocSite &site) {
+    auto bookSource = BookSourceParser::parseBookSource(R"json({
+        "bookSourceUrl": "https://www.example.com",
+        "ruleToc": {
+            "chapterList": "class.toc@tag.li",
+            "chapterName": "tag.a@text",
+            "chapterUrl": "tag.a@href",
+            "nextTocUrl": "class.next@href"
+        }
+    })json");
+    RuleData ruleData;
+    Book book;
+    book.bookUrl = site.getServer().url("/book/1/");
+    book.tocUrl = site.tocUrl();
+    BookChapterList::TocFingerprint fingerprint;
+    WebBook::getChapterList(bookSource, book, ruleData, nullptr, &fingerprint);
+    site.grow(2);
+    const auto start = std::chrono::steady_clock::now();
+    const auto update = WebBook::updateChapterList(bookSource, book, ruleData, fingerprint);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    size_t count = 0;
+    const double full = measure(bookSource, site, nullptr, count);
+    std::cout << "refresh with 2 new chapters: full " << full << " ms (" << count << " chapters), incremental "
+            << elapsed.count() * 1e3 << " ms (" << update.chapters.size() << " chapters), speedup "
+            << full / (elapsed.count() * 1e3) << std::endl;
+}
+
+int main() {
+    // 50页，每页100章，每个请求20ms
+    TocSite site(50, 100, std::chrono::milliseconds(20));
+    bench("chained pages", "class.next@href", site);
+    bench("page list", "tag.option@value", site);
+    benchUpdate(site);
+    return 0;
+}
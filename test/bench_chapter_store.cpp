@@ -0,0 +1,110 @@
+#include <booksource/chapterstore.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <sys/stat.h>
+
+// 一本10000章的小说：比较每章一个文件与段文件的写入、随机读取的时间以及占用的磁盘空间
+
+static std::string makeContent(const int chapter) {
+    static const std::vector<std::string> names = {"林动", "萧炎", "韩立", "叶凡", "石昊", "唐三", "小医仙", "云韵"};
+    static const std::vector<std::string> phrases = {
+        "微微一笑，", "眼中闪过一抹精光，", "深吸了一口气，", "缓缓说道：", "体内的灵力疯狂运转，",
+        "只见远处天空中", "一道身影破空而来，", "心中暗道不好，", "脸色顿时变得凝重起来。", "沉默了片刻，",
+        "手中长剑一挥，", "周围的空间都仿佛凝固了，", "嘴角掀起一抹弧度，", "大殿之中一片寂静。"
+    };
+    std::mt19937 random(chapter);
+    std::string text;
+    for (int p = 0; p < 60; p++) {
+        text += "　　";
+        const int sentences = 2 + static_cast<int>(random() % 5);
+        for (int s = 0; s < sentences; s++) {
+            text += names[random() % names.size()] + phrases[random() % phrases.size()];
+        }
+        text += std::to_string(random()) + "\n";
+    }
+    return text;
+}
+
+// 实际占用的磁盘空间
+static size_t diskUsage(const std::filesystem::path &path) {
+    struct stat st{};
+    if (std::filesystem::is_regular_file(path)) {
+        stat(path.c_str(), &st);
+        return st.st_blocks * 512;
+    }
+    size_t total = 0;
+    for (const auto &entry: std::filesystem::directory_iterator(path)) {
+        stat(entry.path().c_str(), &st);
+        total += st.st_blocks * 512;
+    }
+    return total;
+}
+
+static double since(const std::chrono::steady_clock::time_point start) {
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() * 1e3;
+}
+
+int main() {
+    constexpr int chapters = 10000;
+    std::vector<std::string> contents;
+    size_t raw = 0;
+    for (int i = 0; i < chapters; i++) {
+        contents.push_back(makeContent(i));
+        raw += contents.back().size();
+    }
+    std::vector<int> order(chapters);
+    for (int i = 0; i < chapters; i++) order[i] = i;
+    std::ranges::shuffle(order, std::mt19937(1));
+    std::cout << chapters << " chapters, " << raw / 1024 << " KB" << std::endl;
+
+    const auto dir = std::filesystem::temp_directory_path() / "booksource_bench_files";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < chapters; i++) {
+        std::ofstream(dir / (std::to_string(i) + ".txt"), std::ios::binary) << contents[i];
+    }
+    std::cout << "file per chapter: write " << since(start) << " ms";
+    start = std::chrono::steady_clock::now();
+    size_t length = 0;
+    for (const int i: order) {
+        std::ifstream in(dir / (std::to_string(i) + ".txt"), std::ios::binary);
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        length += buffer.str().size();
+    }
+    std::cout << ", random read " << since(start) << " ms, disk " << diskUsage(dir) / 1024 << " KB" << std::endl;
+    std::filesystem::remove_all(dir);
+
+    const auto file = std::filesystem::temp_directory_path() / ChapterStore::fileName("https://www.example.com/book/1/");
+    std::filesystem::remove(file);
+    {
+        ChapterStore store(file.string());
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < chapters; i++) {
+            BookChapter chapter;
+            chapter.url = "/book/1/" + std::to_string(i) + ".html";
+            chapter.index = i;
+            store.put(chapter, contents[i]);
+        }
+        std::cout << "chapter store: write " << since(start) << " ms";
+    }
+    start = std::chrono::steady_clock::now();
+    ChapterStore store(file.string());
+    const double open = since(start);
+    start = std::chrono::steady_clock::now();
+    size_t storeLength = 0;
+    for (const int i: order) {
+        storeLength += store.get("/book/1/" + std::to_string(i) + ".html")->size();
+    }
+    std::cout << ", open " << open << " ms, random read " << since(start) << " ms, disk " << diskUsage(file) / 1024
+            << " KB" << std::endl;
+    if (storeLength != length) std::cout << "length mismatch" << std::endl;
+    std::filesystem::remove(file);
+    return 0;
+}
@@ -0,0 +1,39 @@
+#include <booksource/charset.h>
+#include <chrono>
+#include <iostream>
+
+using Charset::Encoding;
+
+/**
+ * 生成一段模拟网页：html标签为ASCII，正文为中文，大小约为 size 字节
+ */
+static std::string makePage(const size_t size) {
+    const std::string row = "<dd><a href=\"/book/12345/678.html\">第一章 陨落的天才，斗之气三段！</a></dd>\n";
+    std::string page = "<html><head><title>目录</title></head><body><dl>\n";
+    while (page.size() < size) page += row;
+    return page + "</dl></body></html>";
+}
+
+template<typename F>
+static void bench(const std::string &name, const size_t bytes, const int rounds, F &&f) {
+    f(); // 预热
+    const auto start = std::chrono::steady_clock::now();
+    size_t sink = 0;
+    for (int i = 0; i < rounds; i++) sink += f();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const double mb = static_cast<double>(bytes) * rounds / (1024.0 * 1024.0);
+    std::cout << name << ": " << mb / elapsed.count() << " MB/s (" << sink << ")" << std::endl;
+}
+
+int main() {
+    const std::string utf8 = makePage(1 << 20);
+    const std::string gbk = Charset::fromUtf8(utf8, Encoding::GBK);
+    const std::string big5 = Charset::fromUtf8(utf8, Encoding::Big5);
+    constexpr int rounds = 50;
+
+    bench("GBK -> UTF-8", gbk.size(), rounds, [&] { return Charset::toUtf8(gbk, Encoding::GBK).size(); });
+    bench("Big5 -> UTF-8", big5.size(), rounds, [&] { return Charset::toUtf8(big5, Encoding::Big5).size(); });
+    bench("UTF-8 -> GBK", utf8.size(), rounds, [&] { return Charset::fromUtf8(utf8, Encoding::GBK).size(); });
+    bench("detect", gbk.size(), rounds, [&] { return static_cast<size_t>(Charset::detect(gbk)); });
+    return 0;
+}
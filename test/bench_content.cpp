@@ -0,0 +1,44 @@
+#include <booksource/webbook.h>
+#include <chrono>
+#include <iostream>
+#include "content_site.h"
+
+// 分页正文：本地模拟站点每次响应有固定的延迟，比较逐页下载与线程池中并发、流水线下载
+
+static double measure(BookSource &bookSource, ContentSite &site, ThreadPool *pool, size_t &length) {
+    RuleData ruleData;
+    Book book;
+    BookChapter chapter;
+    chapter.url = "/book/1/0.html";
+    chapter.baseUrl = site.getServer().url("/book/1/");
+    const auto start = std::chrono::steady_clock::now();
+    length = WebBook::getContent(bookSource, book, chapter, ruleData, site.chapterUrl(1), pool).size();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() * 1e3;
+}
+
+static void bench(const std::string &title, const std::string &nextContentUrl, ContentSite &site) {
+    auto bookSource = BookSourceParser::parseBookSource(R"json({
+        "bookSourceUrl": "https://www.example.com",
+        "ruleContent": {
+            "content": "id.content@html",
+            "nextContentUrl": ")json" + nextContentUrl + R"json("
+        }
+    })json");
+    size_t length = 0;
+    const double serial = measure(bookSource, site, nullptr, length);
+    std::cout << title << ": serial " << serial << " ms (" << length << " bytes)" << std::endl;
+    for (const size_t threads: {1, 4, 16}) {
+        ThreadPool pool(threads);
+        const double parallel = measure(bookSource, site, &pool, length);
+        std::cout << "  " << threads << " threads: " << parallel << " ms, speedup " << serial / parallel << std::endl;
+    }
+}
+
+int main() {
+    // 每章30页，每页200段
+    ContentSite site(2, 30, 200, std::chrono::milliseconds(20));
+    bench("chained pages", "id.next@href", site);
+    bench("page list", "tag.option@value", site);
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include <booksource/css.h>
+#include <chrono>
+#include <iostream>
+#include "bench_pages.h"
+
+static void bench(const Html::Document &doc, const std::string &css, const int rounds) {
+    const auto selector = Css::Selector::parse(css);
+    size_t count = selector->select(doc.root()).size(); // 预热
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        count = selector->select(doc.root()).size();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << css << ": " << elapsed.count() / rounds * 1e6 << " us (" << count << " results)" << std::endl;
+}
+
+int main() {
+    constexpr int rounds = 200;
+    const auto doc = Html::Document::parse(makeSearchPage(300 * 1024));
+    std::cout << "300 KB search page, " << doc->nodeCount() << " nodes" << std::endl;
+
+    const auto compileStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        Css::Selector::parse("div.search-list li.bookbox h4.bookname > a");
+    }
+    const std::chrono::duration<double> compileElapsed = std::chrono::steady_clock::now() - compileStart;
+    std::cout << "compile: " << compileElapsed.count() / rounds * 1e6 << " us" << std::endl;
+
+    bench(*doc, "li.bookbox", rounds);
+    bench(*doc, "div.search-list li.bookbox h4.bookname > a", rounds);
+    bench(*doc, ".search-list > ul > li:nth-child(2n+1) .author", rounds);
+    // 祖先中不存在.sidebar，布隆过滤器直接跳过
+    bench(*doc, "div.sidebar li a", rounds);
+    bench(*doc, "a[href$=.html]", rounds);
+    return 0;
+}
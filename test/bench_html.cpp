@@ -0,0 +1,78 @@
+#include <booksource/html.h>
+#include <booksource/jsoup.h>
+#include "bench_pages.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+
+// 统计堆分配次数
+static std::atomic<size_t> allocations{0};
+
+void *operator new(const size_t size) {
+    allocations++;
+    if (void *p = std::malloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+static void bench(const std::string &name, const std::string &html, const int rounds) {
+    // 预热
+    size_t nodes = Html::Document::parse(html)->nodeCount();
+    const size_t before = allocations.load();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        nodes = Html::Document::parse(html)->nodeCount();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    // 每轮都会复制一次html，这次分配也计入
+    const double allocsPerParse = static_cast<double>(allocations.load() - before) / rounds;
+    const double mb = static_cast<double>(html.size()) * rounds / (1024.0 * 1024.0);
+    std::cout << name << " (" << html.size() / 1024 << " KB, " << nodes << " nodes): "
+            << mb / elapsed.count() << " MB/s, " << elapsed.count() / rounds * 1e6 << " us/parse, "
+            << allocsPerParse << " allocations/parse" << std::endl;
+
+    const AnalyzeByJSoup jsoup(html);
+    const auto ruleStart = std::chrono::steady_clock::now();
+    size_t count = 0;
+    for (int i = 0; i < rounds; i++) {
+        count += jsoup.getStringList("class.bookbox@class.bookname@tag.a@text").size();
+    }
+    const std::chrono::duration<double> ruleElapsed = std::chrono::steady_clock::now() - ruleStart;
+    std::cout << "  class.bookbox@class.bookname@tag.a@text: " << ruleElapsed.count() / rounds * 1e6
+            << " us (" << count / rounds << " results)" << std::endl;
+}
+
+/**
+ * 用法：bench_html [保存的网页文件...]
+ * 不指定文件时使用生成的搜索结果页
+ */
+int main(const int argc, char *argv[]) {
+    constexpr int rounds = 50;
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            std::ifstream in(argv[i], std::ios::binary);
+            if (!in.is_open()) {
+                std::cerr << "cannot open " << argv[i] << std::endl;
+                continue;
+            }
+            std::stringstream ss;
+            ss << in.rdbuf();
+            bench(argv[i], ss.str(), rounds);
+        }
+        return 0;
+    }
+    bench("search page", makeSearchPage(300 * 1024), rounds);
+    bench("search page", makeSearchPage(2 * 1024 * 1024), rounds / 5);
+    return 0;
+}
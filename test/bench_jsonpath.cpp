@@ -0,0 +1,78 @@
+#include <booksource/jsonpath.h>
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <iostream>
+
+// 与nlohmann::json比较：解析大的接口响应，取出列表后在每一项上执行子规则
+
+static std::string makeResponse(const size_t size) {
+    std::string json = R"({"code":0,"msg":"success","data":{"page":1,"list":[)";
+    int i = 0;
+    while (json.size() < size) {
+        if (i > 0) json += ',';
+        const std::string id = std::to_string(10000 + i++);
+        json += R"({"bookId":)" + id + R"(,"bookName":"斗破苍穹)" + id +
+                R"(","author":"天蚕土豆","cover":"https://img.example.com/cover/)" + id +
+                R"(.jpg","intro":"这里是属于斗气的世界，没有花俏艳丽的魔法，有的，仅仅是繁衍到巅峰的斗气！\n新书等级制度：斗者，斗师，大斗师……",)"
+                R"("category":{"id":1,"name":"玄幻"},"tags":["热血","升级","异火"],"wordCount":5325000,)"
+                R"("lastChapter":{"name":"第一千六百二十三章 结束，也是开始","updateTime":"2024-01-01 12:00:00"},"finished":true})";
+    }
+    return json + "]}}";
+}
+
+template<typename F>
+static double measure(const int rounds, F &&f) {
+    f(); // 预热
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) f();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / rounds * 1e3;
+}
+
+int main() {
+    for (const size_t size: {1024 * 1024, 5 * 1024 * 1024}) {
+        const std::string json = makeResponse(size);
+        const int rounds = size > 2 * 1024 * 1024 ? 5 : 20;
+        std::cout << json.size() / 1024 << " KB response" << std::endl;
+
+        size_t count = 0;
+        const double tapeParse = measure(rounds, [&] { count = JsonPath::Document::parse(json)->tapeSize(); });
+        const double domParse = measure(rounds, [&] { count += nlohmann::json::parse(json).size(); });
+        std::cout << "  parse: tape " << tapeParse << " ms, nlohmann " << domParse << " ms" << std::endl;
+
+        // 书籍列表：取出列表，在每一项上取书名、作者、分类与最新章节
+        std::string sink;
+        const double tapeList = measure(rounds, [&] {
+            const AnalyzeByJSonPath analyzer(json);
+            for (const auto &item: analyzer.getList("$.data.list[*]")) {
+                const AnalyzeByJSonPath sub(analyzer.getDocument(), item);
+                sink = sub.getString("$.bookName").value_or("") + sub.getString("$.author").value_or("") +
+                       sub.getString("$.category.name").value_or("") + sub.getString("$.lastChapter.name").value_or("");
+            }
+        });
+        const double domList = measure(rounds, [&] {
+            const auto doc = nlohmann::json::parse(json);
+            for (const auto &item: doc["data"]["list"]) {
+                sink = item["bookName"].get<std::string>() + item["author"].get<std::string>() +
+                       item["category"]["name"].get<std::string>() + item["lastChapter"]["name"].get<std::string>();
+            }
+        });
+        // 阅读中列表的每一项以字符串形式传给子规则，再重新解析
+        const double domReparse = measure(rounds, [&] {
+            const auto doc = nlohmann::json::parse(json);
+            for (const auto &item: doc["data"]["list"]) {
+                const auto sub = nlohmann::json::parse(item.dump());
+                sink = sub["bookName"].get<std::string>() + sub["author"].get<std::string>() +
+                       sub["category"]["name"].get<std::string>() + sub["lastChapter"]["name"].get<std::string>();
+            }
+        });
+        std::cout << "  book list: tape " << tapeList << " ms, nlohmann " << domList << " ms, nlohmann with re-parse per item "
+                << domReparse << " ms" << std::endl;
+
+        const auto doc = JsonPath::Document::parse(json);
+        const auto path = JsonPath::Path::parse("$..lastChapter.name");
+        const double deepScan = measure(rounds, [&] { count = path->select(doc->root()).size(); });
+        std::cout << "  $..lastChapter.name: " << deepScan << " ms (" << count << " results)" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+
+// 性能测试共用的模拟网页
+
+static const char *SEARCH_PAGE_HEADER = R"(<!DOCTYPE html><html lang="zh-CN"><head><meta charset="utf-8"><title>搜索结果</title>
+<link rel="stylesheet" href="/css/style.css"><script type="text/javascript">var _hmt = _hmt || [];
+(function() { var hm = document.createElement("script"); hm.src = "https://hm.example.com/hm.js?x"; })();</script>
+</head><body><div class="header"><div class="nav"><ul><li><a href="/">首页</a></li><li><a href="/top/">排行榜</a></li>
+<li><a href="/full/">完本</a></li></ul></div></div><div class="container"><div class="search-list"><ul>
+)";
+
+static const char *SEARCH_PAGE_FOOTER = "</ul></div></div><div class=\"footer\">&copy; 2024 example.com</div></body></html>";
+
+inline void appendSearchItem(std::string &page, const int i) {
+    const std::string id = std::to_string(10000 + i);
+    page += R"(<li class="bookbox"><div class="bookimg"><a href="/book/)" + id + R"(/"><img src="/cover/)" + id +
+            R"(.jpg" alt="斗破苍穹" onerror="this.src='/nocover.jpg'"></a></div>
+<div class="bookinfo"><h4 class="bookname"><a href="/book/)" + id + R"(/">斗破苍穹)" + id + R"(</a></h4>
+<div class="author">作者：天蚕土豆</div><div class="cat"><span>分类：</span>玄幻&nbsp;|&nbsp;<span>字数：</span>532.5万字</div>
+<div class="update"><span>最新章节：</span><a href="/book/)" + id + R"(/1648.html">第一千六百二十三章 结束，也是开始</a></div>
+<p class="intro">这里是属于斗气的世界，没有花俏艳丽的魔法，有的，仅仅是繁衍到巅峰的斗气！&hellip;</p></div></li>
+)";
+}
+
+/**
+ * 生成一个模拟的搜索结果页，结构参考常见小说站点，大小约为 size 字节
+ */
+inline std::string makeSearchPage(const size_t size) {
+    std::string page = SEARCH_PAGE_HEADER;
+    int i = 0;
+    while (page.size() < size) {
+        appendSearchItem(page, i++);
+    }
+    return page + SEARCH_PAGE_FOOTER;
+}
+
+// 生成有 count 本书的搜索结果页
+inline std::string makeSearchPageItems(const int count) {
+    std::string page = SEARCH_PAGE_HEADER;
+    for (int i = 0; i < count; i++) {
+        appendSearchItem(page, i);
+    }
+    return page + SEARCH_PAGE_FOOTER;
+}
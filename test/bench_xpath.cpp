@@ -0,0 +1,50 @@
+#include <booksource/xpath.h>
+#include <booksource/css.h>
+#include <chrono>
+#include <iostream>
+#include "bench_pages.h"
+
+// 在同一份文档上比较XPath与等价的css选择器
+template<typename F>
+static double measure(const int rounds, F &&f) {
+    f(); // 预热
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) f();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / rounds * 1e6;
+}
+
+static void bench(const Html::Document &doc, const std::string &xpath, const std::string &css, const int rounds) {
+    const auto expression = Xpath::Expression::parse(xpath);
+    const auto selector = Css::Selector::parse(css);
+    size_t xpathCount = 0;
+    size_t cssCount = 0;
+    const double xpathTime = measure(rounds, [&] { xpathCount = expression->selectElements(doc.root()).size(); });
+    const double cssTime = measure(rounds, [&] { cssCount = selector->select(doc.root()).size(); });
+    std::cout << xpath << ": " << xpathTime << " us (" << xpathCount << " results)" << std::endl;
+    std::cout << "  css " << css << ": " << cssTime << " us (" << cssCount << " results)" << std::endl;
+}
+
+int main() {
+    constexpr int rounds = 200;
+    const auto doc = Html::Document::parse(makeSearchPage(300 * 1024));
+    std::cout << "300 KB search page, " << doc->nodeCount() << " nodes" << std::endl;
+
+    const double compileTime = measure(rounds, [] {
+        Xpath::Expression::parse("//div[@class='search-list']//li[@class='bookbox']//h4[@class='bookname']/a");
+    });
+    std::cout << "compile: " << compileTime << " us" << std::endl;
+
+    bench(*doc, "//li[@class='bookbox']", "li.bookbox", rounds);
+    bench(*doc, "//div[@class='search-list']//li[@class='bookbox']//h4[@class='bookname']/a",
+          "div.search-list li.bookbox h4.bookname > a", rounds);
+    bench(*doc, "//div[contains(@class,'search-list')]/ul/li[position() mod 2 = 1]//div[@class='author']",
+          ".search-list > ul > li:nth-child(2n+1) .author", rounds);
+    bench(*doc, "//a[ends-with(@href,'.html')]", "a[href$=.html]", rounds);
+
+    const auto strings = Xpath::Expression::parse("//li[@class='bookbox']//h4/a/@href");
+    size_t count = 0;
+    const double stringTime = measure(rounds, [&] { count = strings->selectStrings(doc->root()).size(); });
+    std::cout << "//li[@class='bookbox']//h4/a/@href: " << stringTime << " us (" << count << " results)" << std::endl;
+    return 0;
+}
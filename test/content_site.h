@@ -0,0 +1,120 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <booksource/rule.h>
+#include "mock_server.h"
+
+/**
+ * 模拟的分页正文：第chapter章的第一页为/book/1/{chapter}.html，其余为/book/1/{chapter}_{page}.html
+ * 每一页有“下一页”链接，最后一页指向下一章（最后一章指回本章的第一页），第一页还有列出本章全部页面的下拉框
+ */
+class ContentSite {
+public:
+    ContentSite(const int chapters, const int pages, const int paragraphs = 3,
+                const std::chrono::milliseconds latency = std::chrono::milliseconds(0))
+        : chapters(chapters), pages(pages), paragraphs(paragraphs), latency(latency),
+          server([this](const std::string &path) { return page(path); }) {
+    }
+
+    std::string chapterUrl(const int chapter, const int page = 1) const {
+        return server.url(path(chapter, page));
+    }
+
+    static std::string paragraph(const int chapter, const int page, const int i) {
+        return "第" + std::to_string(chapter + 1) + "章第" + std::to_string(page) + "页第" + std::to_string(i + 1) + "段";
+    }
+
+    // 按阅读的格式转换后的正文
+    std::string text(const int chapter) const {
+        std::string text;
+        for (int page = 1; page <= pages; page++) {
+            for (int i = 0; i < paragraphs; i++) {
+                if (!text.empty()) text += '\n';
+                text += "　　" + paragraph(chapter, page, i);
+            }
+        }
+        return text;
+    }
+
+    MockServer &getServer() {
+        return server;
+    }
+
+    // 第index章，url为相对于baseUrl的地址
+    BookChapter bookChapter(const int index) const {
+        BookChapter chapter;
+        chapter.url = path(index, 1);
+        chapter.title = "第" + std::to_string(index + 1) + "章";
+        chapter.baseUrl = server.url("/book/1/");
+        chapter.index = index;
+        return chapter;
+    }
+
+    // 网站的前count章
+    std::vector<BookChapter> bookChapters(const int count) const {
+        std::vector<BookChapter> result;
+        result.reserve(count);
+        for (int i = 0; i < count; i++) result.push_back(bookChapter(i));
+        return result;
+    }
+
+    /**
+     * 按本网站的页面解析正文的书源
+     * @param extra 追加到ruleContent中的字段，以逗号开头
+     * @param content 正文规则，需要按json转义
+     */
+    static BookSource source(const std::string &bookSourceUrl, const std::string &concurrentRate = "",
+                             const std::string &nextContentUrl = "id.next@href", const std::string &extra = "",
+                             const std::string &content = "id.content@html") {
+        return BookSourceParser::parseBookSource(R"json({
+            "bookSourceUrl": ")json" + bookSourceUrl + R"json(",
+            "concurrentRate": ")json" + concurrentRate + R"json(",
+            "ruleContent": {
+                "content": ")json" + content + R"json(",
+                "nextContentUrl": ")json" + nextContentUrl + R"json(")json" + extra + R"json(
+            }
+        })json");
+    }
+
+private:
+    int chapters;
+    int pages;
+    int paragraphs;
+    std::chrono::milliseconds latency;
+    MockServer server;
+
+    static std::string path(const int chapter, const int page) {
+        if (page == 1) return "/book/1/" + std::to_string(chapter) + ".html";
+        return "/book/1/" + std::to_string(chapter) + "_" + std::to_string(page) + ".html";
+    }
+
+    MockServer::Response page(const std::string &requestPath) {
+        if (latency.count() > 0) std::this_thread::sleep_for(latency);
+        int chapter = -1, page = 1;
+        char end = 0;
+        if (std::sscanf(requestPath.c_str(), "/book/1/%d_%d.htm%c", &chapter, &page, &end) != 3 &&
+            std::sscanf(requestPath.c_str(), "/book/1/%d.htm%c", &chapter, &end) != 2) {
+            return {"not found", "text/html", 404};
+        }
+        if (chapter < 0 || chapter >= chapters || page < 1 || page > pages) return {"not found", "text/html", 404};
+        std::string html = "<html><head><title>正文</title></head><body><h1 id=\"title\">第" +
+                           std::to_string(chapter + 1) + "章 标题" + std::to_string(chapter) + "（" +
+                           std::to_string(page) + "/" + std::to_string(pages) + "）</h1>\n<div id=\"content\">\n";
+        for (int i = 0; i < paragraphs; i++) {
+            html += "    " + paragraph(chapter, page, i) + "<br>\n";
+        }
+        html += "</div>\n<div class=\"page\"><a id=\"next\" href=\"" +
+                (page < pages ? path(chapter, page + 1) : path(chapter + 1 < chapters ? chapter + 1 : chapter, 1)) + "\">下一页</a></div>";
+        if (page == 1) {
+            html += "<select>";
+            for (int i = 1; i <= pages; i++) {
+                html += "<option value=\"" + path(chapter, i) + "\">第" + std::to_string(i) + "页</option>";
+            }
+            html += "</select>";
+        }
+        return html + "</body></html>";
+    }
+};
@@ -0,0 +1,200 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * 测试用的本地http服务器，每个连接一个线程，响应后关闭连接
+ * 响应内容可以分块慢速发送，用于测试边下载边解析以及中断传输
+ */
+class MockServer {
+public:
+    struct Response {
+        std::string body;
+        std::string contentType = "text/html; charset=utf-8";
+        int status = 200;
+        std::vector<std::string> headers; // 其余的响应头，如 "Location: /"
+
+        Response(std::string body) : body(std::move(body)) { // NOLINT(*-explicit-constructor)
+        }
+
+        Response(const char *body) : body(body) { // NOLINT(*-explicit-constructor)
+        }
+
+        Response(std::string body, std::string contentType, const int status = 200,
+                 std::vector<std::string> headers = {})
+            : body(std::move(body)), contentType(std::move(contentType)), status(status),
+              headers(std::move(headers)) {
+        }
+    };
+
+    // 参数为请求的路径（含查询参数）
+    using Handler = std::function<Response(const std::string &path)>;
+
+    /**
+     * @param chunkSize 每次发送的字节数，0表示一次发送
+     * @param delay 每次发送之后的等待时间
+     */
+    explicit MockServer(Handler handler, const size_t chunkSize = 0,
+                        const std::chrono::milliseconds delay = std::chrono::milliseconds(0))
+        : handler(std::move(handler)), chunkSize(chunkSize), delay(delay) {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        const int on = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+        listen(listener, 64);
+        socklen_t len = sizeof(addr);
+        getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &len);
+        port = ntohs(addr.sin_port);
+        acceptor = std::thread([this] { run(); });
+    }
+
+    ~MockServer() {
+        stopping = true;
+        acceptor.join();
+        close(listener);
+        std::lock_guard lock(mutex);
+        for (auto &worker: workers) worker.join();
+    }
+
+    std::string url(const std::string &path = "/") const {
+        return "http://127.0.0.1:" + std::to_string(port) + path;
+    }
+
+    // 全部请求已经发送的响应内容的字节数
+    size_t bytesSent() const {
+        return sent;
+    }
+
+    size_t requestCount() const {
+        return requests;
+    }
+
+    // 同时在处理中的请求数的最大值，用于检查请求是否并发
+    size_t maxConcurrency() const {
+        return maxActive;
+    }
+
+    // 按到达顺序记录的请求路径
+    std::vector<std::string> paths() const {
+        std::lock_guard lock(mutex);
+        return requestPaths;
+    }
+
+    // 按到达顺序记录的请求头，与paths()一一对应；name不区分大小写，没有该请求头时为空
+    std::vector<std::string> headers(const std::string &name) const {
+        std::lock_guard lock(mutex);
+        std::vector<std::string> values;
+        for (const auto &request: requestHeaders) {
+            std::string value;
+            for (size_t begin = request.find("\r\n"); begin != std::string::npos;) {
+                begin += 2;
+                const size_t end = request.find("\r\n", begin);
+                const std::string line = request.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+                if (line.size() > name.size() && line[name.size()] == ':' &&
+                    strncasecmp(line.c_str(), name.c_str(), name.size()) == 0) {
+                    value = line.substr(line.find_first_not_of(' ', name.size() + 1));
+                    break;
+                }
+                begin = end;
+            }
+            values.push_back(std::move(value));
+        }
+        return values;
+    }
+
+private:
+    Handler handler;
+    size_t chunkSize;
+    std::chrono::milliseconds delay;
+    int listener = -1;
+    int port = 0;
+    std::atomic<bool> stopping{false};
+    std::atomic<size_t> sent{0};
+    std::atomic<size_t> requests{0};
+    std::atomic<size_t> active{0};
+    std::atomic<size_t> maxActive{0};
+    std::thread acceptor;
+    mutable std::mutex mutex;
+    std::vector<std::thread> workers;
+    std::vector<std::string> requestPaths;
+    std::vector<std::string> requestHeaders;
+
+    void run() {
+        while (!stopping) {
+            pollfd fd{listener, POLLIN, 0};
+            if (poll(&fd, 1, 20) <= 0) continue;
+            const int client = accept(listener, nullptr, nullptr);
+            if (client < 0) continue;
+            std::lock_guard lock(mutex);
+            workers.emplace_back([this, client] {
+                serve(client);
+                close(client);
+            });
+        }
+    }
+
+    void serve(const int client) {
+        // 读取请求头以及Content-Length指定的请求体
+        std::string request;
+        char buf[4096];
+        size_t headerEnd;
+        while ((headerEnd = request.find("\r\n\r\n")) == std::string::npos) {
+            const ssize_t n = recv(client, buf, sizeof(buf), 0);
+            if (n <= 0) return;
+            request.append(buf, n);
+        }
+        size_t contentLength = 0;
+        if (const size_t p = request.find("Content-Length:"); p != std::string::npos && p < headerEnd) {
+            contentLength = std::stoul(request.substr(p + 15));
+        }
+        while (request.size() < headerEnd + 4 + contentLength) {
+            const ssize_t n = recv(client, buf, sizeof(buf), 0);
+            if (n <= 0) break;
+            request.append(buf, n);
+        }
+        const size_t pathBegin = request.find(' ') + 1;
+        const std::string path = request.substr(pathBegin, request.find(' ', pathBegin) - pathBegin);
+        requests++;
+        {
+            std::lock_guard lock(mutex);
+            requestPaths.push_back(path);
+            requestHeaders.push_back(request.substr(0, headerEnd));
+        }
+        const size_t current = ++active;
+        size_t max = maxActive;
+        while (current > max && !maxActive.compare_exchange_weak(max, current)) {
+        }
+        const Response response = handler(path);
+        active--;
+        std::string header = "HTTP/1.1 " + std::to_string(response.status) + " OK\r\nContent-Type: " +
+                                   response.contentType + "\r\nContent-Length: " +
+                                   std::to_string(response.body.size()) + "\r\nConnection: close\r\n";
+        for (const auto &line: response.headers) header += line + "\r\n";
+        header += "\r\n";
+        if (send(client, header.data(), header.size(), MSG_NOSIGNAL) < 0) return;
+        const size_t step = chunkSize == 0 ? response.body.size() : chunkSize;
+        for (size_t pos = 0; pos < response.body.size(); pos += step) {
+            const size_t len = std::min(step, response.body.size() - pos);
+            // 客户端中断传输后发送失败
+            if (send(client, response.body.data() + pos, len, MSG_NOSIGNAL) < 0) return;
+            sent += len;
+            if (delay.count() > 0) std::this_thread::sleep_for(delay);
+        }
+    }
+};
@@ -0,0 +1,13 @@
+#pragma once
+#include <filesystem>
+#include <string>
+
+/**
+ * 系统临时目录中的文件路径，先删除上次运行留下的文件以及整理时的临时文件
+ */
+inline std::string tempFile(const std::string &name) {
+    const std::string file = (std::filesystem::temp_directory_path() / name).string();
+    std::filesystem::remove(file);
+    std::filesystem::remove(file + ".tmp");
+    return file;
+}
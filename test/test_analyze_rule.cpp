@@ -0,0 +1,304 @@
+#include <booksource/rule.h>
+#include <booksource/threadpool.h>
+#include <cassert>
+#include <iostream>
+#include <unordered_set>
+
+const std::string HTML = R"(<html><body>
+<div class="search-list"><ul>
+  <li class="bookbox"><h4 class="bookname"><a href="/book/1.html">斗破苍穹</a></h4>
+    <div class="author">作者：天蚕土豆</div><div class="kind"><span>玄幻</span><span>热血</span></div>
+    <div class="words">5325000</div><img src="/cover/1.jpg"></li>
+  <li class="bookbox"><h4 class="bookname"><a href="https://m.example.com/book/2.html">凡人修仙传</a></h4>
+    <div class="author">作者：忘语</div><div class="kind"><span>仙侠</span></div>
+    <div class="words">7446000</div></li>
+  <li class="bookbox"><h4 class="bookname"><a href="/book/1.html">斗破苍穹</a></h4></li>
+  <li class="bookbox"><h4 class="bookname"><a href="/book/3.html"></a></h4></li>
+</ul></div>
+</body></html>)";
+
+const std::string JSON = R"({"code":0,"data":{"list":[
+  {"name":"遮天","author":"辰东","url":"/book/3","tags":["玄幻","热血"],"words":6354000},
+  {"name":"完美世界","author":"辰东","url":"/book/4","tags":[],"words":6587000}
+]}})";
+
+void test_get_string() {
+    AnalyzeRule analyzeRule;
+    analyzeRule.setContent(std::string(HTML), "https://www.example.com/search");
+    assert(analyzeRule.getString("class.bookname.0@text") == "斗破苍穹");
+    assert(analyzeRule.getString("//li[2]//a/text()") == "凡人修仙传");
+    assert(analyzeRule.getString("class.author.0@text##作者：") == "天蚕土豆");
+    assert(analyzeRule.getString("class.author@text##作者：(.*)##$1###") == "天蚕土豆");
+    assert(analyzeRule.getString("class.bookname.0@a@href", true) == "https://www.example.com/book/1.html");
+    assert(analyzeRule.getString("class.nothing@text", true) == "https://www.example.com/search");
+    assert(analyzeRule.getString("class.nothing@text").empty());
+    assert((analyzeRule.getStringList("class.kind.0@span@text") == std::vector<std::string>{"玄幻", "热血"}));
+    assert((analyzeRule.getStringList("tag.h4@a@href", true) == std::vector<std::string>{
+        "https://www.example.com/book/1.html", "https://m.example.com/book/2.html", "https://www.example.com/book/3.html"
+    }));
+
+    // js
+    assert(analyzeRule.getString("class.bookname.1@text@js:result + '!'") == "凡人修仙传!");
+    assert(analyzeRule.getString("<js>'a' + 'b'</js>") == "ab");
+    // {{ }}拼接的规则，其中的规则在content上执行
+    assert(analyzeRule.getString("书名：{{@@class.bookname.0@text}}，{{1 + 1}}") == "书名：斗破苍穹，2");
+
+    // @put与@get
+    RuleData ruleData;
+    AnalyzeRule withData(&ruleData);
+    withData.setContent(std::string(HTML));
+    assert(withData.getString(R"(class.words.0@text@put:{"firstName":"class.bookname.0@text"})") == "5325000");
+    assert(ruleData.getVariable("firstName") == "斗破苍穹");
+    assert(withData.getString("@get:{firstName}") == "斗破苍穹");
+}
+
+void test_get_elements() {
+    AnalyzeRule analyzeRule;
+    analyzeRule.setContent(std::string(HTML), "https://www.example.com/search");
+    const auto items = analyzeRule.getElements("class.bookbox");
+    assert(items.size() == 4);
+    // 列表中的每一项都指向同一个文档
+    const auto &first = std::get<HtmlContent>(items[0]);
+    assert(std::get<HtmlContent>(items[3]).document == first.document);
+    assert(analyzeRule.getElements("//li[@class='bookbox']").size() == 4);
+    assert(analyzeRule.getElements("class.search-list@tag.li").size() == 4);
+
+    std::vector<std::string> names;
+    for (const auto &item: items) {
+        analyzeRule.setContent(item);
+        names.push_back(analyzeRule.getString("tag.a@text") + "/" + analyzeRule.getString("//div[@class='author']/text()##作者："));
+    }
+    assert((names == std::vector<std::string>{"斗破苍穹/天蚕土豆", "凡人修仙传/忘语", "斗破苍穹/", "/"}));
+
+    // js返回数组时数组的每一项为列表中的一项
+    AnalyzeRule jsRule;
+    jsRule.setContent(std::string(JSON));
+    const auto books = jsRule.getElements("@js:JSON.parse(result).data.list");
+    assert(books.size() == 2);
+    jsRule.setContent(books[1]);
+    assert(jsRule.getString("$.name") == "完美世界");
+}
+
+void test_json() {
+    AnalyzeRule analyzeRule;
+    analyzeRule.setContent(std::string(JSON), "https://api.example.com/search");
+    const auto items = analyzeRule.getElements("$.data.list[*]");
+    assert(items.size() == 2);
+    // 内容为json时，没有标识的规则按JSONPath执行
+    const auto ruleName = analyzeRule.splitSourceRule("name");
+    const auto ruleTags = analyzeRule.splitSourceRule("tags");
+    std::vector<std::string> result;
+    for (const auto &item: items) {
+        analyzeRule.setContent(item);
+        result.push_back(analyzeRule.getString(ruleName) + ":" + std::to_string(analyzeRule.getStringList(ruleTags).size()));
+    }
+    assert((result == std::vector<std::string>{"遮天:2", "完美世界:0"}));
+    analyzeRule.setContent(items[0]);
+    assert(analyzeRule.getString("$.url", true) == "https://api.example.com/book/3");
+    assert(analyzeRule.getString("{{$.author}}·{{$.name}}") == "辰东·遮天");
+    // 不是json时JSONPath规则没有结果
+    analyzeRule.setContent(std::string(HTML));
+    assert(analyzeRule.getString("$.data").empty());
+}
+
+void test_analyze_book_list() {
+    auto bookSource = BookSourceParser::parseBookSource(R"({
+        "bookSourceUrl": "https://www.example.com",
+        "bookSourceName": "示例",
+        "searchUrl": "/search?q={{key}}",
+        "ruleSearch": {
+            "bookList": "class.bookbox",
+            "name": "class.bookname@text",
+            "author": "class.author@text",
+            "kind": "class.kind@span@text",
+            "wordCount": "class.words@text",
+            "coverUrl": "tag.img@src",
+            "bookUrl": "tag.h4@a@href"
+        }
+    })");
+    RuleData ruleData;
+    AnalyzeUrl analyzeUrl("/search?q={{key}}", "斗破", 1, std::nullopt, std::nullopt, "https://www.example.com");
+    std::string baseUrl = "https://www.example.com/search?q=%E6%96%97%E7%A0%B4";
+    auto books = BookList::analyzeBookList(bookSource, ruleData, analyzeUrl, baseUrl, HTML);
+    // 书名为空的被丢弃，重复的只保留第一个
+    assert(books.size() == 2);
+    assert(books[0].name == "斗破苍穹");
+    assert(books[0].author == "天蚕土豆");
+    assert(books[0].kind == "玄幻,热血");
+    assert(books[0].wordCount == "532.5万字");
+    assert(books[0].coverUrl == "https://www.example.com/cover/1.jpg");
+    assert(books[0].bookUrl == "https://www.example.com/book/1.html");
+    assert(books[0].origin == "https://www.example.com");
+    assert(books[1].bookUrl == "https://m.example.com/book/2.html");
+    assert(!books[1].coverUrl.has_value());
+
+    // 反序与中断条件
+    auto reversed = BookSourceParser::parseBookSource(R"({
+        "bookSourceUrl": "https://www.example.com",
+        "ruleSearch": {"bookList": "-$.data.list[*]", "name": "name", "author": "author", "bookUrl": "url"}
+    })");
+    books = BookList::analyzeBookList(reversed, ruleData, analyzeUrl, baseUrl, JSON);
+    assert(books.size() == 2 && books[0].name == "完美世界");
+    books = BookList::analyzeBookList(reversed, ruleData, analyzeUrl, baseUrl, JSON, true, false, std::nullopt,
+                                      [](const int size) { return size >= 1; });
+    assert(books.size() == 1 && books[0].name == "遮天");
+}
+
+void test_parallel_book_list() {
+    std::string page = "<ul>";
+    for (int i = 0; i < 50; i++) {
+        const std::string id = std::to_string(i);
+        page += "<li><a href=\"/book/" + id + ".html\">书" + id + "</a><span>作者" + std::to_string(i % 7) + "</span></li>";
+    }
+    page += "<li><a href=\"/book/3.html\">书3</a></li><li><a href=\"/x\"></a></li></ul>";
+    auto bookSource = BookSourceParser::parseBookSource(R"json({
+        "bookSourceUrl": "https://www.example.com",
+        "ruleSearch": {
+            "bookList": "tag.li",
+            "name": "tag.a@text@js:result + '·' + (1 + 1)",
+            "author": "tag.span@text",
+            "bookUrl": "tag.a@href"
+        }
+    })json");
+    RuleData ruleData;
+    AnalyzeUrl analyzeUrl("/search?q={{key}}", "书", 1, std::nullopt, std::nullopt, "https://www.example.com");
+    std::string baseUrl = "https://www.example.com/search";
+    const auto serial = BookList::analyzeBookList(bookSource, ruleData, analyzeUrl, baseUrl, page);
+    assert(serial.size() == 50);
+    assert(serial[7].name == "书7·2" && serial[7].author == "作者0");
+
+    ThreadPool pool(4);
+    for (int round = 0; round < 3; round++) {
+        const auto parallel = BookList::analyzeBookList(bookSource, ruleData, analyzeUrl, baseUrl, page,
+                                                        true, false, std::nullopt, std::nullopt, &pool);
+        assert(parallel.size() == serial.size());
+        for (size_t i = 0; i < serial.size(); i++) {
+            assert(parallel[i].name == serial[i].name);
+            assert(parallel[i].author == serial[i].author);
+            assert(parallel[i].bookUrl == serial[i].bookUrl);
+        }
+    }
+
+    // shouldBreak在调用线程中按顺序调用，与串行解析的结果相同
+    std::vector<int> sizes;
+    const auto shouldBreak = [&](const int size) {
+        sizes.push_back(size);
+        return size >= 10;
+    };
+    const auto first = BookList::analyzeBookList(bookSource, ruleData, analyzeUrl, baseUrl, page,
+                                                 true, false, std::nullopt, shouldBreak, &pool);
+    assert(first.size() == 10 && first[9].name == "书9·2");
+    assert(sizes.size() == 10 && sizes.back() == 10);
+
+    // 单项的异常在轮到该项时抛出
+    auto broken = BookSourceParser::parseBookSource(R"({
+        "bookSourceUrl": "https://www.example.com",
+        "ruleSearch": {"bookList": "tag.li", "name": "tag.a@text@js:if (result == '书20') throw new Error('bad'); result"}
+    })");
+    bool thrown = false;
+    try {
+        BookList::analyzeBookList(broken, ruleData, analyzeUrl, baseUrl, page, true, false, std::nullopt, std::nullopt, &pool);
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void test_all_in_one() {
+    const std::string page = R"(<ul class="list">
+<li><a href="/book/1.html">斗破苍穹</a><span>天蚕土豆</span><i>玄幻</i></li>
+<li><a href="/book/2.html">凡人修仙传</a><span>忘语</span><i>仙侠</i></li>
+</ul><a href="/about">关于</a>)";
+    AnalyzeRule analyzeRule;
+    analyzeRule.setContent(page, "https://www.example.com/search");
+    const auto items = analyzeRule.getElements(R"re(:<li><a href="([^"]+)">([^<]+)</a><span>(.*?)</span>)re");
+    assert(items.size() == 2);
+    // 每一项共享同一份文本
+    assert(std::get<RegexContent>(items[0]).text == std::get<RegexContent>(items[1]).text);
+    // 之后的字段规则中 $n 为分组的内容，替换规则中的 $n 为替换的分组
+    analyzeRule.setContent(items[1]);
+    assert(analyzeRule.getString("$2") == "凡人修仙传");
+    assert(analyzeRule.getString("$1", true) == "https://www.example.com/book/2.html");
+    assert(analyzeRule.getString("$3·$2") == "忘语·凡人修仙传");
+    assert(analyzeRule.getString("$2##(..)修仙(.)##$2$1") == "传凡人");
+    assert(analyzeRule.getString("$9").empty());
+    assert(analyzeRule.getString("{{'《'}}$2") == "《凡人修仙传");
+
+    // '&&'分隔的多个正则：先取出列表部分，之后的正则在其上执行
+    AnalyzeRule chained;
+    chained.setContent(page);
+    const auto links = chained.getElements(R"re(:<ul[\s\S]*?</ul>&&<a href="([^"]+)">)re");
+    assert(links.size() == 2);
+    chained.setContent(links[0]);
+    assert(chained.getString("$1") == "/book/1.html");
+    assert(chained.getElements(":<table>(.*?)</table>").empty());
+    assert(chained.getElements(":(abc").empty());
+
+    // 书籍列表
+    auto bookSource = BookSourceParser::parseBookSource(R"json({
+        "bookSourceUrl": "https://www.example.com",
+        "ruleSearch": {
+            "bookList": ":<li><a href=\"([^\"]+)\">([^<]+)</a><span>([^<]*)</span><i>(.*?)</i>",
+            "name": "$2",
+            "author": "$3",
+            "kind": "$4",
+            "bookUrl": "$1"
+        }
+    })json");
+    RuleData ruleData;
+    AnalyzeUrl analyzeUrl("/search?q={{key}}", "斗破", 1, std::nullopt, std::nullopt, "https://www.example.com");
+    std::string baseUrl = "https://www.example.com/search";
+    const auto books = BookList::analyzeBookList(bookSource, ruleData, analyzeUrl, baseUrl, page);
+    assert(books.size() == 2);
+    assert(books[0].name == "斗破苍穹" && books[0].author == "天蚕土豆" && books[0].kind == "玄幻");
+    assert(books[1].bookUrl == "https://www.example.com/book/2.html");
+}
+
+void test_distinct_book_list() {
+    const auto make = [](const std::vector<std::string> &urls) {
+        std::vector<SearchBook> books;
+        for (const auto &url: urls) {
+            SearchBook book;
+            book.bookUrl = url;
+            book.name = "书" + url;
+            books.push_back(std::move(book));
+        }
+        return books;
+    };
+    const auto urls = [](const std::vector<SearchBook> &books) {
+        std::vector<std::string> result;
+        for (const auto &book: books) result.push_back(book.bookUrl);
+        return result;
+    };
+    auto books = make({"/a", "/b", "/a", "/c", "/b", "/d"});
+    BookList::distinctBookList(books, false);
+    assert((urls(books) == std::vector<std::string>{"/a", "/b", "/c", "/d"}));
+    assert(books[2].name == "书/c");
+    books = make({"/a", "/b", "/a", "/c"});
+    BookList::distinctBookList(books, true);
+    assert((urls(books) == std::vector<std::string>{"/c", "/b", "/a"}));
+
+    // 超过栈上索引容量时的结果与unordered_set相同
+    std::vector<std::string> many;
+    for (int i = 0; i < 1000; i++) many.push_back("/book/" + std::to_string(i * 7 % 600));
+    books = make(many);
+    BookList::distinctBookList(books, false);
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> expected;
+    for (const auto &url: many) {
+        if (seen.insert(url).second) expected.push_back(url);
+    }
+    assert(urls(books) == expected && books.size() == 600);
+}
+
+int main() {
+    test_get_string();
+    test_get_elements();
+    test_json();
+    test_analyze_book_list();
+    test_parallel_book_list();
+    test_distinct_book_list();
+    test_all_in_one();
+    std::cout << "All analyze rule tests passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <booksource/rule.h>
+#include <booksource/charset.h>
+#include <cassert>
+#include <iostream>
+
+void test_template_string() {
+    const auto t = TemplateString::compile("searchkey={{key}}&page={{ page }}&size={{20}}");
+    const auto &segments = t.getSegments();
+    assert(segments.size() == 6);
+    assert(segments[1].type == TemplateString::SlotType::Key);
+    assert(segments[3].type == TemplateString::SlotType::Page);
+    assert(segments[5].type == TemplateString::SlotType::Js);
+    int jsCount = 0;
+    const auto out = t.render("斗破", 2, [&](const std::string &code) {
+        jsCount++;
+        return code;
+    });
+    assert(out == "searchkey=斗破&page=2&size=20");
+    assert(jsCount == 1);
+    assert(TemplateString::compile("a=1").isLiteral());
+}
+
+void test_url_option() {
+    const std::string optionStr =
+        R"({"method":"post","charset":"gbk","body":"q={{key}}","headers":{"Referer":"https://a.com"},"retry":"2"})";
+    const auto option = UrlOption::compile(optionStr);
+    assert(option != nullptr);
+    assert(option->method == POST);
+    assert(option->charset == "gbk");
+    assert(option->retry == 2);
+    assert(option->headers.size() == 1 && option->headers[0].second == "https://a.com");
+    // 同一个模板只解析一次
+    assert(UrlOption::compile(optionStr) == option);
+    assert(UrlOption::compile("{not json") == nullptr);
+    // retry不是数字时忽略，其余的参数仍然有效
+    const auto badRetry = UrlOption::compile(R"({"method":"POST","body":"q=1","retry":"abc"})");
+    assert(badRetry != nullptr && badRetry->method == POST && badRetry->retry == 0);
+    assert(badRetry->body.has_value());
+
+    assert(UrlOption::findOptionStart("https://a.com/s?q={{key}},{\"method\":\"POST\"}") == 25);
+    assert(UrlOption::findOptionStart("https://a.com/s?a=1,{{page}}") == std::string::npos);
+}
+
+void test_analyze_url() {
+    // POST：body中的{{key}}在请求时填充，并按书源字符集编码
+    AnalyzeUrl post(
+        R"(/modules/article/search.php, {"method":"POST","charset":"gbk","body":"searchkey={{key}}&page={{page}}"})",
+        "斗破", 1, std::nullopt, std::nullopt, "https://www.example.com"
+    );
+    assert(post.url == "https://www.example.com/modules/article/search.php");
+    assert(post.getMethod() == POST);
+    assert(post.getBody() == "searchkey=斗破&page=1");
+    assert(post.getCharset() == "gbk");
+
+    // GET：查询参数按字符集编码
+    AnalyzeUrl get(
+        R"(https://www.example.com/s?q={{key}},{"charset":"gbk","headers":{"X-Test":"1"}})",
+        "斗破", 1
+    );
+    assert(get.url == "https://www.example.com/s?q=%B6%B7%C6%C6");
+    assert(get.getMethod() == GET);
+    assert(get.headerMap.at("X-Test") == "1");
+}
+
+void test_url_template() {
+    const auto t = UrlTemplate::compile(R"(/list/{{key}}/<1,2 ,3>.html?size={{page*10}},{"method":"POST"})");
+    assert(!t->hasJs());
+    assert(t->getOption() != nullptr && t->getOption()->method == POST);
+    int jsCount = 0;
+    auto evalJs = [&](const std::string &code) {
+        jsCount++;
+        return code == "page*10" ? std::string("50") : code;
+    };
+    assert(t->render("xuanhuan", 2, evalJs) == "/list/xuanhuan/2.html?size=50");
+    assert(t->render("xuanhuan", 5, evalJs) == "/list/xuanhuan/3.html?size=50");
+    assert(jsCount == 2);
+
+    // 纯 {{key}}/{{page}} 不经过js引擎
+    jsCount = 0;
+    const auto fast = UrlTemplate::compile("https://www.example.com/s?q={{key}}&p={{page}}");
+    assert(fast->render("a", 3, evalJs) == "https://www.example.com/s?q=a&p=3");
+    assert(jsCount == 0);
+
+    assert(UrlTemplate::compile("@js:'https://a.com/s?q=' + key")->hasJs());
+
+    // 书源的searchUrl与发现页的url只编译一次，书源拷贝后共享缓存
+    BookSource source;
+    source.searchUrl = "https://a.com/s?q={{key}}";
+    source.exploreUrl = "玄幻::/list/xuanhuan/{{page}}.html\n都市::/list/dushi/{{page}}.html";
+    const auto first = source.getUrlTemplate("https://a.com/s?q={{key}}");
+    BookSource copy = source;
+    assert(copy.getUrlTemplate("https://a.com/s?q={{key}}") == first);
+    const auto explore = source.getUrlTemplate("/list/dushi/{{page}}.html");
+    assert(source.getUrlTemplate("/list/dushi/{{page}}.html") == explore);
+    // 章节等其余的url不进入缓存
+    const auto chapter = source.getUrlTemplate("/book/1/2.html");
+    assert(source.getUrlTemplate("/book/1/2.html") != chapter);
+
+    AnalyzeUrl paged("/top/<a,b,c>.html", std::nullopt, 2, std::nullopt, std::nullopt,
+                     "https://www.example.com", &source);
+    assert(paged.url == "https://www.example.com/top/b.html");
+}
+
+void test_header_map() {
+    BookSource source;
+    source.bookSourceUrl = "https://www.example.com";
+    source.header = R"(@js:JSON.stringify({"X-Rand": String(Math.random())}))";
+    const auto first = source.getHeaderMap();
+    assert(first.contains(Constants::UA_KEY));
+    // 确定性的header只计算一次
+    assert(source.getHeaderMap().at("X-Rand") == first.at("X-Rand"));
+
+    // header改变后缓存失效
+    source.header = R"({"User-Agent": "test"})";
+    assert(source.getHeaderMap().at("User-Agent") == "test");
+
+    // 登录头覆盖同名请求头，登录状态改变后缓存失效
+    source.putLoginHeader(R"({"User-Agent": "login", "Cookie": "a=1"})");
+    assert(source.getHeaderMap(true).at("User-Agent") == "login");
+    assert(source.getHeaderMap(false).at("User-Agent") == "test");
+    source.removeLoginHeader();
+    assert(!source.getHeaderMap(true).contains("Cookie"));
+
+    // 声明为动态的header每次都重新计算
+    source.header = R"(@js:dynamicHeader = true; JSON.stringify({"X-Rand": String(Math.random())}))";
+    assert(source.getHeaderMap().at("X-Rand") != source.getHeaderMap().at("X-Rand"));
+}
+
+int main() {
+    test_template_string();
+    test_url_option();
+    test_analyze_url();
+    test_url_template();
+    test_header_map();
+    std::cout << "analyze url tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <booksource/bigvariable.h>
+#include <booksource/rule.h>
+#include <cassert>
+#include <filesystem>
+#include <iostream>
+#include "temp_file.h"
+
+static std::string bigValue(const std::string &prefix) {
+    std::string value;
+    while (value.size() < 20000) value += prefix + std::to_string(value.size()) + "，";
+    return value;
+}
+
+void test_put_get() {
+    const std::string file = tempFile("booksource_big_variable.seg");
+    const auto store = std::make_shared<ChapterStore>(file);
+    DiskRuleData a(store, "https://www.example.com/book/1/");
+    DiskRuleData b(store, "https://www.example.com/book/2/");
+
+    // 小变量不写入文件
+    a.putVariable("small", "value");
+    assert(a.getVariable("small") == "value");
+    assert(store->size() == 0);
+
+    // 大变量写入文件，同名变量按所有者区分
+    a.putVariable("page", bigValue("甲"));
+    b.putVariable("page", bigValue("乙"));
+    assert(store->size() == 2);
+    assert(a.getVariable("page") == bigValue("甲"));
+    assert(b.getVariable("page") == bigValue("乙"));
+    assert(store->fileSize() < bigValue("甲").size() + bigValue("乙").size());
+
+    // 变为小变量时删除文件中的大变量
+    b.putVariable("page", "small");
+    assert(b.getVariable("page") == "small" && store->size() == 1);
+    a.putVariable("page", std::nullopt);
+    assert(a.getVariable("page").empty() && store->size() == 0);
+    std::filesystem::remove(file);
+}
+
+void test_reopen() {
+    const std::string file = tempFile("booksource_big_variable_reopen.seg");
+    {
+        DiskRuleData ruleData(std::make_shared<ChapterStore>(file), "source");
+        ruleData.putVariable("token", bigValue("token"));
+    }
+    DiskRuleData ruleData(std::make_shared<ChapterStore>(file), "source");
+    assert(ruleData.getVariable("token") == bigValue("token"));
+    std::filesystem::remove(file);
+}
+
+void test_analyze_rule() {
+    // 规则中的@put与@get
+    const std::string file = tempFile("booksource_big_variable_rule.seg");
+    const auto store = std::make_shared<ChapterStore>(file);
+    DiskRuleData ruleData(store, "https://www.example.com/book/1/");
+    const std::string text = bigValue("正文");
+    AnalyzeRule analyzeRule(&ruleData);
+    analyzeRule.setContent("<html><body><h1>书名</h1><div id=\"page\">" + text + "</div></body></html>");
+    assert(analyzeRule.getString(R"(tag.h1@text@put:{"page":"id.page@text"})") == "书名");
+    assert(store->size() == 1);
+    assert(analyzeRule.getString("@get:{page}") == text);
+    std::filesystem::remove(file);
+}
+
+int main() {
+    test_put_get();
+    test_reopen();
+    test_analyze_rule();
+    std::cout << "All big variable tests passed." << std::endl;
+    return 0;
+}
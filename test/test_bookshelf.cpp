@@ -0,0 +1,240 @@
+#include <booksource/bookshelf.h>
+#include <booksource/rule.h>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include "temp_file.h"
+
+static Book makeBook(const int i, const std::string &origin) {
+    Book book;
+    book.bookUrl = "https://" + origin + "/book/" + std::to_string(i) + "/";
+    book.tocUrl = book.bookUrl + "toc.html";
+    book.origin = "https://" + origin;
+    book.originName = origin;
+    book.name = "书" + std::to_string(i % 3);
+    book.author = "作者";
+    book.group = 1L << 40;
+    book.durChapterIndex = i;
+    book.canUpdate = i % 2 == 0;
+    book.readConfig.reverseToc = true;
+    book.readConfig.startDate = DateUtils::generateLocalDate(2024, 2, 29);
+    book.infoHtml = "<html>不保存</html>";
+    return book;
+}
+
+static std::vector<BookChapter> makeChapters(const std::string &bookUrl, const int count) {
+    std::vector<BookChapter> chapters;
+    for (int i = count - 1; i >= 0; i--) {
+        BookChapter chapter("/chapter/" + std::to_string(i) + ".html", "第" + std::to_string(i + 1) + "章");
+        chapter.baseUrl = bookUrl + "toc.html";
+        chapter.bookUrl = bookUrl;
+        chapter.index = i;
+        chapter.isVip = i % 10 == 0;
+        if (i % 7 == 0) chapter.tag = "标签";
+        if (i == 5) {
+            chapter.start = 100;
+            chapter.end = 200;
+            chapter.resourceUrl = "https://cdn.example.com/5";
+            chapter.putVariable("key", "value");
+        }
+        chapters.push_back(std::move(chapter));
+    }
+    return chapters;
+}
+
+void test_books() {
+    const std::string file = tempFile("booksource_shelf_books.db");
+    {
+        BookShelf shelf(file);
+        for (int i = 0; i < 6; i++) shelf.putBook(makeBook(i, i < 4 ? "a.com" : "b.com"));
+        assert(shelf.bookCount() == 6);
+        const auto book = shelf.getBook("https://a.com/book/1/");
+        assert(book.has_value() && book->name == "书1" && book->group == 1L << 40 && !book->canUpdate);
+        assert(book->readConfig.reverseToc && book->readConfig.startDate == DateUtils::generateLocalDate(2024, 2, 29));
+        assert(book->infoHtml.empty());
+        assert(shelf.getBooksByOrigin("https://a.com").size() == 4);
+        assert(shelf.getBooks("书1", "作者").size() == 2);
+        assert(shelf.getBooks("书1", "其他").empty());
+
+        // 替换后索引随之更新
+        Book moved = makeBook(1, "b.com");
+        moved.bookUrl = "https://a.com/book/1/";
+        shelf.putBook(moved);
+        assert(shelf.bookCount() == 6);
+        assert(shelf.getBooksByOrigin("https://a.com").size() == 3);
+        assert(shelf.getBooksByOrigin("https://b.com").size() == 3);
+        shelf.removeBook("https://a.com/book/0/");
+        assert(shelf.bookCount() == 5 && !shelf.getBook("https://a.com/book/0/").has_value());
+
+        SearchBook searchBook;
+        searchBook.bookUrl = "https://c.com/book/1/";
+        searchBook.origin = "https://c.com";
+        searchBook.name = "书1";
+        searchBook.author = "作者";
+        searchBook.coverUrl = "https://c.com/cover.jpg";
+        searchBook.respondTime = 120;
+        shelf.putSearchBook(searchBook);
+    }
+    BookShelf shelf(file);
+    assert(shelf.bookCount() == 5);
+    assert(shelf.getBooks().front().bookUrl == "https://a.com/book/1/");
+    assert(shelf.getBooksByOrigin("https://b.com").size() == 3);
+    const auto searchBooks = shelf.getSearchBooks("书1", "作者");
+    assert(searchBooks.size() == 1 && searchBooks[0].coverUrl == "https://c.com/cover.jpg");
+    assert(searchBooks[0].respondTime == 120 && !searchBooks[0].intro.has_value());
+    assert(shelf.getSearchBooksByOrigin("https://c.com").size() == 1);
+    std::filesystem::remove(file);
+}
+
+void test_search_book_variable() {
+    // 搜索规则@put的变量随搜索结果保存
+    auto bookSource = BookSourceParser::parseBookSource(R"({
+        "bookSourceUrl": "https://www.example.com",
+        "ruleSearch": {
+            "bookList": "class.book",
+            "name": "tag.a@text@put:{\"bid\":\"tag.a@href\"}",
+            "bookUrl": "tag.a@href"
+        }
+    })");
+    RuleData ruleData;
+    AnalyzeUrl analyzeUrl("/search", std::nullopt, 1, std::nullopt, std::nullopt, "https://www.example.com");
+    std::string baseUrl = "https://www.example.com/search";
+    const auto books = BookList::analyzeBookList(bookSource, ruleData, analyzeUrl, baseUrl,
+                                                 R"(<div class="book"><a href="/book/1.html">书1</a></div>)");
+    assert(books.size() == 1 && books[0].getVariable("bid") == "/book/1.html");
+
+    const std::string file = tempFile("booksource_shelf_search.db");
+    {
+        BookShelf shelf(file);
+        shelf.putSearchBook(books[0]);
+    }
+    BookShelf shelf(file);
+    const auto saved = shelf.getSearchBook(books[0].bookUrl);
+    assert(saved.has_value() && saved->getVariable("bid") == "/book/1.html");
+    assert(saved->getVariableString() == books[0].getVariableString());
+    std::filesystem::remove(file);
+}
+
+void test_chapters() {
+    const std::string file = tempFile("booksource_shelf_chapters.db");
+    const Book book = makeBook(1, "a.com");
+    {
+        BookShelf shelf(file);
+        // 书籍与目录在一个事务中写入
+        shelf.write(BookShelf::Batch().putBook(book).putChapters(book.bookUrl, makeChapters(book.bookUrl, 1000)));
+    }
+    BookShelf shelf(file);
+    assert(shelf.chapterCount(book.bookUrl) == 1000);
+    const auto range = shelf.getChapters(book.bookUrl, 100, 110);
+    assert(range.size() == 10);
+    for (int i = 0; i < 10; i++) {
+        assert(range[i].index == 100 + i && range[i].title == "第" + std::to_string(101 + i) + "章");
+        assert(range[i].bookUrl == book.bookUrl && range[i].baseUrl == book.tocUrl);
+    }
+    assert(range[0].isVip && !range[1].isVip && range[5].tag == "标签" && !range[6].tag.has_value());
+    const auto chapter = shelf.getChapter(book.bookUrl, 5);
+    assert(chapter.has_value() && chapter->start == 100 && chapter->end == 200);
+    assert(chapter->resourceUrl == "https://cdn.example.com/5" && chapter->getVariable("key") == "value");
+    assert(!shelf.getChapter(book.bookUrl, 1000).has_value());
+    assert(!shelf.getChapter(book.bookUrl, std::numeric_limits<int>::max()).has_value());
+    assert(shelf.getChapters(book.bookUrl, 995).size() == 5);
+    assert(shelf.getChapters("https://none/").empty());
+
+    // 整个目录被替换
+    shelf.putChapters(book.bookUrl, makeChapters(book.bookUrl, 10));
+    assert(shelf.chapterCount(book.bookUrl) == 10 && shelf.garbageSize() > 0);
+    // 删除书籍时删除目录
+    shelf.removeBook(book.bookUrl);
+    assert(shelf.chapterCount(book.bookUrl) == 0);
+    std::filesystem::remove(file);
+}
+
+void test_torn_write() {
+    const std::string file = tempFile("booksource_shelf_torn.db");
+    const Book a = makeBook(1, "a.com"), b = makeBook(2, "a.com");
+    size_t complete;
+    {
+        BookShelf shelf(file);
+        shelf.write(BookShelf::Batch().putBook(a).putChapters(a.bookUrl, makeChapters(a.bookUrl, 100)));
+        complete = shelf.fileSize();
+        shelf.write(BookShelf::Batch().putBook(b).putChapters(b.bookUrl, makeChapters(b.bookUrl, 100)));
+    }
+    // 第二个事务只写入了一部分
+    std::filesystem::resize_file(file, std::filesystem::file_size(file) - 100);
+    {
+        BookShelf shelf(file);
+        assert(shelf.fileSize() == complete);
+        assert(shelf.getBook(a.bookUrl).has_value() && shelf.chapterCount(a.bookUrl) == 100);
+        assert(!shelf.getBook(b.bookUrl).has_value() && shelf.chapterCount(b.bookUrl) == 0);
+        shelf.putBook(b);
+    }
+    BookShelf shelf(file);
+    assert(shelf.bookCount() == 2);
+
+    // 不是最后一帧的目录越界：整帧丢弃，之后的帧照常读取
+    std::filesystem::remove(file);
+    {
+        BookShelf shelf(file);
+        shelf.putChapters(a.bookUrl, makeChapters(a.bookUrl, 10));
+        shelf.putBook(b);
+    }
+    {
+        // 文件头8字节、帧头24字节、操作头5字节，之后是bookUrl、章节数、字符串堆的字节数
+        std::fstream stream(file, std::ios::in | std::ios::out | std::ios::binary);
+        stream.seekp(static_cast<std::streamoff>(8 + 24 + 5 + 4 + a.bookUrl.size() + 4));
+        const uint32_t heapSize = 0x7fffffff;
+        stream.write(reinterpret_cast<const char *>(&heapSize), sizeof(heapSize));
+    }
+    {
+        BookShelf corrupt(file);
+        assert(corrupt.chapterCount(a.bookUrl) == 0 && corrupt.getChapters(a.bookUrl).empty());
+        assert(corrupt.getBook(b.bookUrl).has_value() && corrupt.garbageSize() > 0);
+    }
+
+    std::ofstream(file, std::ios::trunc) << "not a bookshelf";
+    bool thrown = false;
+    try {
+        BookShelf broken(file);
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::filesystem::remove(file);
+}
+
+void test_compact() {
+    const std::string file = tempFile("booksource_shelf_compact.db");
+    BookShelf::Options options;
+    options.compactMinSize = 0;
+    const Book book = makeBook(1, "a.com");
+    {
+        BookShelf shelf(file, options);
+        shelf.putBook(book);
+        shelf.putBook(makeBook(2, "a.com"));
+        shelf.putChapters(book.bookUrl, makeChapters(book.bookUrl, 200));
+        // 刷新目录时替换整个目录，失效的数据超过一半时自动整理
+        for (int i = 0; i < 5; i++) shelf.putChapters(book.bookUrl, makeChapters(book.bookUrl, 200 + i));
+        assert(shelf.garbageSize() * 2 <= shelf.fileSize());
+        shelf.compact();
+        assert(shelf.garbageSize() == 0);
+        assert(shelf.chapterCount(book.bookUrl) == 204);
+        assert(shelf.getChapter(book.bookUrl, 203)->title == "第204章");
+    }
+    BookShelf shelf(file, options);
+    assert(shelf.bookCount() == 2 && shelf.chapterCount(book.bookUrl) == 204);
+    assert(shelf.getChapters(book.bookUrl, 0, 3)[2].title == "第3章");
+    assert(!std::filesystem::exists(file + ".tmp"));
+    std::filesystem::remove(file);
+}
+
+int main() {
+    test_books();
+    test_search_book_variable();
+    test_chapters();
+    test_torn_write();
+    test_compact();
+    std::cout << "All bookshelf tests passed." << std::endl;
+    return 0;
+}
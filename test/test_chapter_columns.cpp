@@ -0,0 +1,134 @@
+#include <booksource/bookshelf.h>
+#include <booksource/chapterlist.h>
+#include <booksource/chaptercolumns.h>
+#include <cassert>
+#include <filesystem>
+#include <iostream>
+
+static std::vector<BookChapter> makeChapters(const int count) {
+    std::vector<BookChapter> chapters;
+    for (int i = 0; i < count; i++) {
+        BookChapter chapter("/chapter/" + std::to_string(i) + ".html", "第" + std::to_string(i + 1) + "章");
+        chapter.baseUrl = i < count / 2 ? "https://a.com/toc.html" : "https://a.com/toc_2.html";
+        chapter.bookUrl = "https://a.com/book/";
+        chapter.index = i;
+        chapter.isVolume = i % 100 == 0;
+        chapter.isVip = i % 10 == 0;
+        chapter.isPay = i % 20 == 0;
+        if (i == 7) {
+            chapter.tag = "标签";
+            chapter.start = 100;
+            chapter.titleMD5 = "md5";
+            chapter.putVariable("key", "value");
+        }
+        chapters.push_back(std::move(chapter));
+    }
+    return chapters;
+}
+
+static void assertSame(const BookChapter &a, const BookChapter &b) {
+    assert(a.url == b.url && a.title == b.title && a.baseUrl == b.baseUrl && a.bookUrl == b.bookUrl);
+    assert(a.index == b.index && a.isVolume == b.isVolume && a.isVip == b.isVip && a.isPay == b.isPay);
+    assert(a.tag == b.tag && a.start == b.start && a.end == b.end && a.titleMD5 == b.titleMD5);
+    assert(a.getVariableString() == b.getVariableString());
+}
+
+void test_views() {
+    const auto chapters = makeChapters(1000);
+    const ChapterList list(chapters);
+    assert(list.size() == 1000 && !list.empty());
+    const auto view = list[123];
+    assert(view.index() == 123 && view.url() == "/chapter/123.html" && view.title() == "第124章");
+    assert(view.baseUrl() == "https://a.com/toc.html" && view.bookUrl() == "https://a.com/book/");
+    assert(list[600].baseUrl() == "https://a.com/toc_2.html");
+    assert(list[100].isVolume() && list[100].isVip() && list[100].isPay() && !list[101].isVip());
+    assert(list[7].hasExtra() && !list[8].hasExtra());
+    assert(list[7].toChapter().getVariable("key") == "value");
+
+    const auto converted = list.toChapters();
+    assert(converted.size() == chapters.size());
+    for (size_t i = 0; i < chapters.size(); i++) assertSame(converted[i], chapters[i]);
+
+    size_t count = 0;
+    for (const auto chapter: list) {
+        assert(chapter.index() == static_cast<int>(count));
+        count++;
+    }
+    assert(count == 1000);
+
+    ChapterList empty;
+    assert(empty.empty() && empty.begin() == empty.end() && !empty.find("/chapter/1.html").has_value());
+}
+
+void test_find() {
+    const ChapterList list(makeChapters(1000));
+    assert(list.find("/chapter/999.html") == 999);
+    assert(!list.find("/chapter/1000.html").has_value());
+    const auto found = list.search("第99");
+    assert(found.size() == 11 && found[0] == 98 && found[1] == 989 && found.back() == 998);
+    assert(list.search("第").size() == 1000);
+    assert(list.search("不存在").empty());
+}
+
+void test_memory() {
+    const auto chapters = makeChapters(10000);
+    const ChapterList list(chapters);
+    size_t vectorBytes = chapters.capacity() * sizeof(BookChapter);
+    for (const auto &chapter: chapters) {
+        for (const auto *s: {&chapter.url, &chapter.title, &chapter.baseUrl, &chapter.bookUrl}) {
+            if (s->capacity() > 15) vectorBytes += s->capacity() + 1;
+        }
+    }
+    assert(list.memoryUsage() * 4 < vectorBytes);
+
+    // 较少使用的字段在堆上的字符串也计入
+    ChapterList extra;
+    BookChapter chapter("/chapter/0.html", "第1章");
+    extra.push_back(chapter);
+    const size_t before = extra.memoryUsage();
+    chapter.resourceUrl = std::string(1000, 'a');
+    extra.push_back(chapter);
+    assert(extra.memoryUsage() >= before + 1000);
+}
+
+void test_fingerprint() {
+    const auto chapters = makeChapters(500);
+    const BookChapterList::TocFingerprint a(chapters), b{ChapterList(chapters)};
+    assert(a.size() == b.size() && a.lastPageUrl() == b.lastPageUrl());
+    assert(b.find("/chapter/321.html") == 321 && b.sameTitle(321, "第322章"));
+    BookChapterList::TocFingerprint c;
+    c.append(ChapterList(std::vector(chapters.begin(), chapters.begin() + 200)));
+    c.append(ChapterList(std::vector(chapters.begin() + 200, chapters.end())));
+    assert(c.size() == 500 && c.find("/chapter/499.html") == 499 && c.lastPageUrl() == a.lastPageUrl());
+}
+
+void test_bookshelf() {
+    const std::string file = (std::filesystem::temp_directory_path() / "booksource_columns.db").string();
+    std::filesystem::remove(file);
+    const auto chapters = makeChapters(300);
+    {
+        BookShelf shelf(file);
+        // 倒序的目录按index排列后保存
+        ChapterList reversed;
+        for (auto it = chapters.rbegin(); it != chapters.rend(); ++it) reversed.push_back(*it);
+        shelf.write(BookShelf::Batch().putChapters("https://a.com/book/", reversed));
+    }
+    BookShelf shelf(file);
+    assert(shelf.chapterCount("https://a.com/book/") == 300);
+    assertSame(*shelf.getChapter("https://a.com/book/", 7), chapters[7]);
+    const ChapterList list = shelf.getChapterList("https://a.com/book/");
+    assert(list.size() == 300);
+    for (size_t i = 0; i < chapters.size(); i++) assertSame(list[i].toChapter(), chapters[i]);
+    assert(shelf.getChapterList("https://none/").empty());
+    std::filesystem::remove(file);
+}
+
+int main() {
+    test_views();
+    test_find();
+    test_memory();
+    test_fingerprint();
+    test_bookshelf();
+    std::cout << "All chapter columns tests passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,238 @@
+#include <booksource/webbook.h>
+#include <cassert>
+#include <iostream>
+#include "toc_site.h"
+
+static BookSource makeSource(const std::string &chapterList, const std::string &nextTocUrl,
+                             const std::string &extra = "") {
+    return BookSourceParser::parseBookSource(R"json({
+        "bookSourceUrl": "https://www.example.com",
+        "ruleToc": {
+            "chapterList": ")json" + chapterList + R"json(",
+            "chapterName": "tag.a@text",
+            "chapterUrl": "tag.a@href",
+            "nextTocUrl": ")json" + nextTocUrl + R"json(")json" + extra + R"json(
+        }
+    })json");
+}
+
+static Book makeBook(TocSite &site) {
+    Book book;
+    book.bookUrl = site.getServer().url("/book/1/");
+    book.tocUrl = site.tocUrl();
+    return book;
+}
+
+static void checkChapters(const std::vector<BookChapter> &chapters, TocSite &site) {
+    assert(chapters.size() == static_cast<size_t>(site.chapterCount()));
+    for (int i = 0; i < site.chapterCount(); i++) {
+        assert(chapters[i].index == i);
+        assert(chapters[i].title == TocSite::chapterTitle(i));
+        assert(chapters[i].url == TocSite::chapterPath(i));
+    }
+}
+
+void test_chained() {
+    TocSite site(6, 20);
+    auto bookSource = makeSource("class.toc@tag.li", "class.next@href");
+    for (const size_t threads: {size_t{0}, size_t{3}}) {
+        std::optional<ThreadPool> pool;
+        if (threads > 0) pool.emplace(threads);
+        const size_t before = site.getServer().requestCount();
+        RuleData ruleData;
+        Book book = makeBook(site);
+        const auto chapters = WebBook::getChapterList(bookSource, book, ruleData, pool ? &*pool : nullptr);
+        checkChapters(chapters, site);
+        // 最后一页的下一页指回第一页，每一页只请求一次
+        assert(site.getServer().requestCount() - before == 6);
+        assert(chapters[45].baseUrl == site.tocUrl(3));
+        assert(book.totalChapterNum == 120 && book.lastCheckCount == 120);
+        assert(book.latestChapterTitle == TocSite::chapterTitle(119));
+        assert(book.durChapterTitle == TocSite::chapterTitle(0));
+    }
+}
+
+void test_url_list() {
+    TocSite site(8, 15, std::chrono::milliseconds(30));
+    // 第一页列出全部目录页，去掉第一页自身后一起下载，不再获取这些页面的下一页
+    auto bookSource = makeSource("class.toc@tag.li", "tag.option@value");
+    for (const size_t threads: {size_t{0}, size_t{4}}) {
+        std::optional<ThreadPool> pool;
+        if (threads > 0) pool.emplace(threads);
+        const size_t before = site.getServer().requestCount();
+        RuleData ruleData;
+        Book book = makeBook(site);
+        const auto chapters = WebBook::getChapterList(bookSource, book, ruleData, pool ? &*pool : nullptr);
+        checkChapters(chapters, site);
+        assert(site.getServer().requestCount() - before == 8);
+        // 没有线程池时逐个下载，有线程池时7个目录页并发下载
+        assert(threads > 0 ? site.getServer().maxConcurrency() > 1 : site.getServer().maxConcurrency() == 1);
+    }
+}
+
+void test_order() {
+    TocSite site(3, 10);
+    // 倒序的列表规则
+    auto reversed = makeSource("-class.toc@tag.li", "class.next@href");
+    RuleData ruleData;
+    Book book = makeBook(site);
+    auto chapters = WebBook::getChapterList(reversed, book, ruleData);
+    assert(chapters.size() == 30 && chapters[0].title == TocSite::chapterTitle(29) && chapters[29].index == 29);
+
+    // 按书籍设置倒序显示目录
+    auto bookSource = makeSource("class.toc@tag.li", "class.next@href");
+    book = makeBook(site);
+    book.readConfig.reverseToc = true;
+    book.totalChapterNum = 25;
+    chapters = WebBook::getChapterList(bookSource, book, ruleData);
+    assert(chapters[0].title == TocSite::chapterTitle(29) && chapters[0].index == 0);
+    assert(book.lastCheckCount == 5 && book.totalChapterNum == 30);
+
+    // 同一url的章节只保留一个，与阅读一致保留最后出现的
+    auto duplicated = makeSource("class.toc@tag.li&&class.toc@tag.li.0", "");
+    book = makeBook(site);
+    chapters = WebBook::getChapterList(duplicated, book, ruleData);
+    assert(chapters.size() == 10);
+    assert(chapters[0].url == TocSite::chapterPath(1) && chapters[9].url == TocSite::chapterPath(0));
+
+    // 目录为空
+    auto empty = makeSource("class.none@tag.li", "");
+    bool thrown = false;
+    try {
+        WebBook::getChapterList(empty, book, ruleData);
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void test_format_js() {
+    TocSite site(2, 5);
+    auto bookSource = makeSource("class.toc@tag.li", "class.next@href",
+                                 R"json(, "formatJs": "index + '. ' + title.replace(/^第\\d+章 /, '')",
+            "isVolume": "tag.a@text@js:result.endsWith('0')")json");
+    RuleData ruleData;
+    Book book = makeBook(site);
+    const auto chapters = WebBook::getChapterList(bookSource, book, ruleData);
+    assert(chapters.size() == 10);
+    assert(chapters[0].title == "1. 标题0" && chapters[9].title == "10. 标题9");
+    assert(chapters[0].isVolume && !chapters[1].isVolume);
+    assert(BookChapterList::isTrue(" True ") && !BookChapterList::isTrue("0") && !BookChapterList::isTrue("null"));
+}
+
+void test_put_variable() {
+    TocSite site(4, 10);
+    // 章节规则中的@put保存到各自的章节，多个目录页并发解析时也不写入共享的规则数据
+    auto bookSource = makeSource("class.toc@tag.li", "tag.option@value",
+                                 R"json(, "updateTime": "tag.a@text@put:{\"cid\":\"tag.a@href\"}")json");
+    for (const size_t threads: {size_t{0}, size_t{4}}) {
+        std::optional<ThreadPool> pool;
+        if (threads > 0) pool.emplace(threads);
+        RuleData ruleData;
+        Book book = makeBook(site);
+        BookChapterList::TocFingerprint fingerprint;
+        const auto chapters = WebBook::getChapterList(bookSource, book, ruleData, pool ? &*pool : nullptr,
+                                                      &fingerprint);
+        checkChapters(chapters, site);
+        for (const auto &chapter: chapters) {
+            assert(chapter.getVariable("cid") == chapter.url);
+        }
+        assert(ruleData.getVariable("cid").empty());
+
+        // 增量刷新得到的新章节同样保留各自的变量
+        site.grow(15);
+        book = makeBook(site);
+        const auto update = WebBook::updateChapterList(bookSource, book, ruleData, fingerprint,
+                                                       pool ? &*pool : nullptr);
+        assert(update.incremental && update.chapters.size() == 15);
+        for (const auto &chapter: update.chapters) {
+            assert(chapter.getVariable("cid") == chapter.url);
+        }
+        assert(ruleData.getVariable("cid").empty());
+    }
+}
+
+// 上次的目录加上增量刷新的结果与完整刷新的结果相同
+static void checkUpdate(BookSource &bookSource, TocSite &site, BookChapterList::TocFingerprint &fingerprint,
+                        const int known, const size_t requests) {
+    RuleData ruleData;
+    Book book = makeBook(site);
+    book.totalChapterNum = known;
+    const size_t before = site.getServer().requestCount();
+    const auto update = WebBook::updateChapterList(bookSource, book, ruleData, fingerprint);
+    assert(update.incremental);
+    assert(site.getServer().requestCount() - before == requests);
+    assert(update.chapters.size() == static_cast<size_t>(site.chapterCount() - known));
+    for (size_t i = 0; i < update.chapters.size(); i++) {
+        const int index = known + static_cast<int>(i);
+        assert(update.chapters[i].index == index);
+        assert(update.chapters[i].title == TocSite::chapterTitle(index));
+        assert(update.chapters[i].url == TocSite::chapterPath(index));
+    }
+    assert(fingerprint.size() == static_cast<size_t>(site.chapterCount()));
+    assert(book.totalChapterNum == site.chapterCount() && book.lastCheckCount == site.chapterCount() - known);
+    if (!update.chapters.empty()) assert(book.latestChapterTitle == update.chapters.back().title);
+}
+
+void test_incremental() {
+    // 串联的目录页：从上次的最后一页开始，最后一页的下一页指回第一页时停止
+    TocSite site(5, 20);
+    auto bookSource = makeSource("class.toc@tag.li", "class.next@href");
+    RuleData ruleData;
+    Book book = makeBook(site);
+    BookChapterList::TocFingerprint fingerprint;
+    WebBook::getChapterList(bookSource, book, ruleData, nullptr, &fingerprint);
+    assert(fingerprint.size() == 100 && fingerprint.lastPageUrl() == site.tocUrl(5) && !fingerprint.isPageList());
+    checkUpdate(bookSource, site, fingerprint, 100, 1);
+    site.grow(3);
+    checkUpdate(bookSource, site, fingerprint, 100, 2);
+    assert(fingerprint.lastPageUrl() == site.tocUrl(6));
+    site.grow(45);
+    checkUpdate(bookSource, site, fingerprint, 103, 3);
+
+    // 第一页列出全部目录页：需要第一页的列表，只下载上次的最后一页及之后的页面
+    TocSite listed(4, 10);
+    auto listSource = makeSource("class.toc@tag.li", "tag.option@value");
+    book = makeBook(listed);
+    WebBook::getChapterList(listSource, book, ruleData, nullptr, &fingerprint);
+    assert(fingerprint.size() == 40 && fingerprint.isPageList());
+    listed.grow(25);
+    checkUpdate(listSource, listed, fingerprint, 40, 5);
+    ThreadPool pool(3);
+    listed.grow(12);
+    book = makeBook(listed);
+    const auto update = WebBook::updateChapterList(listSource, book, ruleData, fingerprint, &pool);
+    assert(update.incremental && update.chapters.size() == 12 && update.chapters[11].index == 76);
+
+    // 倒序的目录：最新的章节在第一页，遇到已知的章节时停止
+    TocSite newest(3, 10, std::chrono::milliseconds(0), true);
+    auto reversed = makeSource("-class.toc@tag.li", "class.next@href");
+    book = makeBook(newest);
+    WebBook::getChapterList(reversed, book, ruleData, nullptr, &fingerprint);
+    newest.grow(4);
+    checkUpdate(reversed, newest, fingerprint, 30, 1);
+    newest.grow(15);
+    checkUpdate(reversed, newest, fingerprint, 34, 2);
+
+    // 最新章节的标题改变、倒序显示目录时完整刷新
+    newest.rename(48, "第49章 新标题");
+    book = makeBook(newest);
+    auto full = WebBook::updateChapterList(reversed, book, ruleData, fingerprint);
+    assert(!full.incremental && full.chapters.size() == 49 && full.chapters[48].title == "第49章 新标题");
+    assert(fingerprint.size() == 49);
+    checkUpdate(reversed, newest, fingerprint, 49, 1);
+    book.readConfig.reverseToc = true;
+    full = WebBook::updateChapterList(reversed, book, ruleData, fingerprint);
+    assert(!full.incremental && full.chapters.size() == 49);
+}
+
+int main() {
+    test_chained();
+    test_url_list();
+    test_order();
+    test_format_js();
+    test_put_variable();
+    test_incremental();
+    std::cout << "All chapter list tests passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,182 @@
+#include <booksource/chapterstore.h>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include "temp_file.h"
+
+// 模拟小说正文：由固定的人名与短语随机组成，不同章节之间有大量相同的片段
+static std::string makeContent(const int chapter, const int paragraphs = 40) {
+    static const std::vector<std::string> names = {"林动", "萧炎", "韩立", "叶凡", "石昊", "唐三"};
+    static const std::vector<std::string> phrases = {
+        "微微一笑，", "眼中闪过一抹精光，", "深吸了一口气，", "缓缓说道：", "体内的灵力疯狂运转，",
+        "只见远处天空中", "一道身影破空而来，", "心中暗道不好，", "脸色顿时变得凝重起来。", "沉默了片刻，"
+    };
+    std::mt19937 random(chapter);
+    std::string text = "第" + std::to_string(chapter + 1) + "章\n";
+    for (int p = 0; p < paragraphs; p++) {
+        text += "　　";
+        const int sentences = 3 + static_cast<int>(random() % 4);
+        for (int s = 0; s < sentences; s++) {
+            text += names[random() % names.size()] + phrases[random() % phrases.size()];
+        }
+        text += std::to_string(random() % 1000) + "\n";
+    }
+    return text;
+}
+
+static BookChapter makeChapter(const int index) {
+    BookChapter chapter;
+    chapter.url = "https://www.example.com/book/1/" + std::to_string(index) + ".html";
+    chapter.index = index;
+    return chapter;
+}
+
+void test_put_get() {
+    const std::string file = tempFile("booksource_store_basic.seg");
+    size_t raw = 0;
+    {
+        ChapterStore store(file);
+        for (int i = 0; i < 50; i++) {
+            const std::string content = makeContent(i);
+            raw += content.size();
+            store.put(makeChapter(i), content);
+        }
+        assert(store.size() == 50);
+        assert(store.hasDictionary());
+        for (int i = 0; i < 50; i++) {
+            assert(store.get(makeChapter(i)) == makeContent(i));
+        }
+        assert(!store.get(makeChapter(50)).has_value());
+        assert(!store.contains(makeChapter(50).url));
+        // 空正文
+        store.put(makeChapter(100), "");
+        assert(store.get(makeChapter(100)) == "");
+        assert(store.remove(makeChapter(100).url) && !store.remove(makeChapter(100).url));
+        assert(!store.get(makeChapter(100)).has_value());
+
+        const auto chapters = store.chapters();
+        assert(chapters.size() == 50);
+        for (int i = 0; i < 50; i++) {
+            assert(chapters[i].index == i && chapters[i].url == makeChapter(i).url);
+            assert(chapters[i].size == makeContent(i).size() && chapters[i].compressedSize < chapters[i].size);
+        }
+        // 各章有大量相同的片段
+        assert(store.fileSize() * 3 < raw);
+    }
+
+    // 重新打开后从记录头恢复索引与字典
+    ChapterStore store(file);
+    assert(store.size() == 50 && store.hasDictionary());
+    for (int i = 0; i < 50; i += 7) {
+        assert(store.get(makeChapter(i)) == makeContent(i));
+    }
+    store.put(makeChapter(50), makeContent(50));
+    assert(store.get(makeChapter(50)) == makeContent(50));
+    std::filesystem::remove(file);
+}
+
+void test_dictionary() {
+    // 字典让单章的压缩率更高
+    const std::string withDict = tempFile("booksource_store_dict.seg");
+    const std::string withoutDict = tempFile("booksource_store_nodict.seg");
+    ChapterStore a(withDict, {4, 16 * 1024});
+    ChapterStore b(withoutDict, {1000, 16 * 1024});
+    for (int i = 0; i < 30; i++) {
+        const std::string content = makeContent(i, 5);
+        a.put(makeChapter(i), content);
+        b.put(makeChapter(i), content);
+    }
+    assert(a.hasDictionary() && !b.hasDictionary());
+    assert(a.fileSize() < b.fileSize());
+    // 整理时用字典重新压缩训练字典之前的章节
+    const size_t before = a.fileSize();
+    a.compact();
+    assert(a.fileSize() < before);
+    for (int i = 0; i < 30; i++) {
+        assert(a.get(makeChapter(i)) == makeContent(i, 5));
+        assert(b.get(makeChapter(i)) == makeContent(i, 5));
+    }
+    std::filesystem::remove(withDict);
+    std::filesystem::remove(withoutDict);
+}
+
+void test_compact() {
+    const std::string file = tempFile("booksource_store_compact.seg");
+    ChapterStore::Options options;
+    options.compactMinSize = 0;
+    {
+        ChapterStore store(file, options);
+        for (int i = 0; i < 20; i++) store.put(makeChapter(i), makeContent(i));
+        const size_t size = store.fileSize();
+        // 重新下载的章节替换旧的记录
+        for (int i = 0; i < 5; i++) store.put(makeChapter(i), makeContent(i + 100));
+        assert(store.size() == 20 && store.garbageSize() > 0);
+        for (int i = 0; i < 5; i++) assert(store.get(makeChapter(i)) == makeContent(i + 100));
+
+        // 失效的记录超过一半时自动整理
+        for (int round = 0; round < 3; round++) {
+            for (int i = 0; i < 20; i++) store.put(makeChapter(i), makeContent(i + round));
+        }
+        assert(store.garbageSize() * 2 <= store.fileSize());
+        assert(store.fileSize() < size * 2);
+        store.compact();
+        assert(store.garbageSize() == 0);
+        for (int i = 0; i < 20; i++) assert(store.get(makeChapter(i)) == makeContent(i + 2));
+    }
+    ChapterStore store(file, options);
+    assert(store.size() == 20 && store.garbageSize() == 0);
+    for (int i = 0; i < 20; i++) assert(store.get(makeChapter(i)) == makeContent(i + 2));
+    assert(!std::filesystem::exists(file + ".tmp"));
+    std::filesystem::remove(file);
+}
+
+void test_truncated() {
+    const std::string file = tempFile("booksource_store_truncated.seg");
+    size_t complete;
+    {
+        ChapterStore store(file);
+        for (int i = 0; i < 10; i++) store.put(makeChapter(i), makeContent(i));
+        complete = store.fileSize();
+        store.put(makeChapter(10), makeContent(10));
+    }
+    // 最后一条记录写入中断
+    std::filesystem::resize_file(file, complete + 30);
+    {
+        ChapterStore store(file);
+        assert(store.size() == 10 && store.fileSize() == complete);
+        assert(!store.get(makeChapter(10)).has_value());
+        store.put(makeChapter(10), makeContent(10));
+    }
+    // 文件长度正确，但最后一条记录的数据没有写入
+    {
+        const size_t size = std::filesystem::file_size(file);
+        std::fstream out(file, std::ios::in | std::ios::out | std::ios::binary);
+        out.seekp(static_cast<std::streamoff>(size - 20));
+        out.write(std::string(20, '\0').data(), 20);
+    }
+    ChapterStore store(file);
+    assert(store.size() == 10 && store.fileSize() == complete);
+    for (int i = 0; i < 10; i++) assert(store.get(makeChapter(i)) == makeContent(i));
+
+    // 不是段文件
+    std::ofstream(file, std::ios::trunc) << "not a chapter store";
+    bool thrown = false;
+    try {
+        ChapterStore broken(file);
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::filesystem::remove(file);
+}
+
+int main() {
+    test_put_get();
+    test_dictionary();
+    test_compact();
+    test_truncated();
+    std::cout << "All chapter store tests passed." << std::endl;
+    return 0;
+}
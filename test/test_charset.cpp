@@ -0,0 +1,108 @@
+#include <booksource/charset.h>
+#include <cassert>
+#include <iostream>
+
+using Charset::Encoding;
+
+void test_detect() {
+    assert(Charset::fromName("GB2312") == Encoding::GBK);
+    assert(Charset::fromName("utf8") == Encoding::UTF8);
+    assert(!Charset::fromName("koi8-r").has_value());
+    assert(Charset::fromContentType("text/html; charset=\"GBK\"") == Encoding::GBK);
+    assert(Charset::fromMeta(R"(<html><head><meta charset="big5"></head>)") == Encoding::Big5);
+    assert(Charset::fromMeta(
+        R"(<meta http-equiv="Content-Type" content="text/html; charset=gb18030" />)") == Encoding::GB18030);
+    size_t bomLength;
+    assert(Charset::fromBom("\xEF\xBB\xBF" "abc", bomLength) == Encoding::UTF8 && bomLength == 3);
+    // 优先级：指定的字符集 > BOM > Content-Type > meta
+    assert(Charset::detect("<meta charset=big5>", "text/html; charset=gbk") == Encoding::GBK);
+    assert(Charset::detect("<meta charset=big5>", "text/html", std::string("utf-8")) == Encoding::UTF8);
+    // 都没有时，非法的 UTF-8 按 GB18030 处理
+    assert(Charset::detect("\xD6\xD0\xCE\xC4") == Encoding::GB18030);
+    assert(Charset::detect("中文") == Encoding::UTF8);
+}
+
+void test_decode() {
+    assert(Charset::toUtf8("abc\xD6\xD0\xCE\xC4xyz", Encoding::GBK) == "abc中文xyz");
+    assert(Charset::toUtf8("\xA4\xA4\xA4\xE5", Encoding::Big5) == "中文");
+    assert(Charset::toUtf8("\x80", Encoding::GBK) == "€");
+    // GB18030 四字节：U+0080 与 U+10000
+    assert(Charset::toUtf8("\x81\x30\x81\x30", Encoding::GB18030) == "\xC2\x80");
+    assert(Charset::toUtf8("\x90\x30\x81\x30", Encoding::GB18030) == "\xF0\x90\x80\x80");
+    // 非法字节替换为 U+FFFD，且后面的 ASCII 不会被吞掉
+    assert(Charset::toUtf8("\xD6" "!", Encoding::GBK) == "\xEF\xBF\xBD" "!");
+    assert(Charset::toUtf8("\xEF\xBB\xBFok", Encoding::UTF8) == "ok");
+    assert(Charset::toUtf8(std::string("\xFF\xFE\x2D\x4E", 4), Encoding::UTF16LE) == "中");
+
+    // 长文本跨越 SIMD 分块边界
+    std::string gbk, utf8;
+    for (int i = 0; i < 100; i++) {
+        gbk += "0123456789abcdefg\xD6\xD0";
+        utf8 += "0123456789abcdefg中";
+    }
+    assert(Charset::toUtf8(gbk, Encoding::GBK) == utf8);
+}
+
+void test_encode() {
+    assert(Charset::fromUtf8("中文a", Encoding::GBK) == "\xD6\xD0\xCE\xC4" "a");
+    assert(Charset::fromUtf8("中文", Encoding::Big5) == "\xA4\xA4\xA4\xE5");
+    assert(Charset::fromUtf8("\xF0\x90\x80\x80", Encoding::GB18030) == "\x90\x30\x81\x30");
+    assert(Charset::fromUtf8("\xC2\x80", Encoding::GB18030) == "\x81\x30\x81\x30");
+    assert(Charset::urlEncode("斗破 a", Encoding::GBK) == "%B6%B7%C6%C6%20a");
+    assert(Charset::urlEncode("斗破 a", Encoding::UTF8, true) == "%E6%96%97%E7%A0%B4+a");
+    assert(Charset::urlEncode("%B6%B7", Encoding::GBK) == "%B6%B7");
+    assert(Charset::encodeParams("searchkey=斗破&page=1", Encoding::GBK, true) == "searchkey=%B6%B7%C6%C6&page=1");
+
+    // 往返转换
+    const std::string text = "《斗破苍穹》第一章 陨落的天才 €";
+    assert(Charset::toUtf8(Charset::fromUtf8(text, Encoding::GB18030), Encoding::GB18030) == text);
+    assert(Charset::toUtf8(Charset::fromUtf8(text, Encoding::GBK), Encoding::GBK) == text);
+}
+
+// 分段转码的结果与完整转码相同
+static bool decodeStream(const std::string &data, const size_t chunk, const std::string_view contentType = {}) {
+    Charset::StreamDecoder decoder(contentType);
+    std::string out;
+    for (size_t i = 0; i < data.size(); i += chunk) {
+        out += decoder.feed(std::string_view(data).substr(i, chunk));
+    }
+    out += decoder.finish();
+    assert(decoder.supported());
+    return !decoder.mismatched() && out == Charset::toUtf8(data, Charset::detect(data, contentType));
+}
+
+void test_stream() {
+    std::string gbk = "<html><head><meta charset=gbk></head><body>";
+    std::string plain = "<p>";
+    std::string utf8 = "<p>";
+    for (int i = 0; i < 500; i++) {
+        gbk += "<p>\xB5\xDA" + std::to_string(i) + "\xD5\xC2 \x81\x30\x81\x30</p>";
+        plain += "\xB5\xDA" + std::to_string(i) + "\xD5\xC2<br>";
+        utf8 += "第" + std::to_string(i) + "章<br>";
+    }
+    for (const size_t chunk: {size_t{1}, size_t{3}, size_t{100}, size_t{5000}}) {
+        assert(decodeStream(gbk, chunk));
+        assert(decodeStream(plain, chunk));
+        assert(decodeStream(utf8, chunk));
+        assert(decodeStream(plain, chunk, "text/html; charset=gbk"));
+        assert(decodeStream("\xEF\xBB\xBF" + utf8, chunk));
+    }
+    // 前 4KB 是合法的 UTF-8，之后出现 GBK 字节，推测的编码与完整内容的检测结果不同
+    const std::string late = std::string(5000, 'a') + "\xB5\xDA";
+    Charset::StreamDecoder decoder;
+    for (size_t i = 0; i < late.size(); i += 1000) decoder.feed(std::string_view(late).substr(i, 1000));
+    decoder.finish();
+    assert(decoder.mismatched());
+    // UTF-16 不支持分段转码
+    Charset::StreamDecoder utf16;
+    assert(utf16.feed(std::string("\xFF\xFE\x2D\x4E", 4)).empty() && !utf16.supported());
+}
+
+int main() {
+    test_detect();
+    test_decode();
+    test_encode();
+    test_stream();
+    std::cout << "charset tests passed" << std::endl;
+    return 0;
+}
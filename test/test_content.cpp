@@ -0,0 +1,124 @@
+#include <booksource/webbook.h>
+#include <cassert>
+#include <iostream>
+#include "content_site.h"
+
+void test_format() {
+    const std::string html = "<p>第一段</p><p>  第二段&nbsp;&nbsp;尾 </p><!-- 注释 -->\n"
+                             "<span class=\"x\">第三段</span>&lt;br&gt;<br><img class=\"a\" src=\"/a.jpg\">"
+                             "<h2>第四\xE2\x80\x8D段</h2><pre>第五段</pre>";
+    assert(BookContent::formatHtml(html, "https://www.example.com/book/1.html") ==
+        "　　第一段\n　　第二段 尾\n　　第三段<br>\n　　<img src=\"https://www.example.com/a.jpg\">\n　　第四段\n　　第五段");
+    // 开头没有空白时不缩进，结尾的空白去掉
+    assert(BookContent::formatHtml("a <b>b</b>\n\n c \n") == "a b\n　　c");
+    assert(BookContent::formatHtml("<div>\n</div>").empty());
+    assert(BookContent::formatHtml("1 < 2 &amp;&amp; 3 > 2") == "1 < 2 && 3 > 2");
+}
+
+void test_chained() {
+    ContentSite site(3, 4);
+    auto bookSource = ContentSite::source("https://www.example.com", "", "id.next@href");
+    for (const size_t threads: {size_t{0}, size_t{3}}) {
+        std::optional<ThreadPool> pool;
+        if (threads > 0) pool.emplace(threads);
+        RuleData ruleData;
+        Book book;
+        BookChapter chapter = site.bookChapter(1);
+        const BookChapter next = site.bookChapter(2);
+        const size_t before = site.getServer().requestCount();
+        const std::string content = WebBook::getContent(bookSource, book, chapter, ruleData, next.getAbsoluteURL(),
+                                                        pool ? &*pool : nullptr);
+        assert(content == site.text(1));
+        // 最后一页的下一页是下一章，不再请求
+        assert(site.getServer().requestCount() - before == 4);
+    }
+
+    // 不知道下一章时，下一页回到已经访问过的页面时停止
+    ContentSite single(1, 3);
+    RuleData ruleData;
+    Book book;
+    BookChapter chapter = single.bookChapter(0);
+    assert(WebBook::getContent(bookSource, book, chapter, ruleData) == single.text(0));
+    assert(single.getServer().requestCount() == 3);
+}
+
+void test_url_list() {
+    ContentSite site(2, 8, 2, std::chrono::milliseconds(30));
+    // 第一页列出本章全部页面，去掉第一页自身后一起下载
+    auto bookSource = ContentSite::source("https://www.example.com", "", "tag.option@value");
+    for (const size_t threads: {size_t{0}, size_t{4}}) {
+        std::optional<ThreadPool> pool;
+        if (threads > 0) pool.emplace(threads);
+        RuleData ruleData;
+        Book book;
+        BookChapter chapter = site.bookChapter(0);
+        const size_t before = site.getServer().requestCount();
+        const std::string content = WebBook::getContent(bookSource, book, chapter, ruleData, std::nullopt,
+                                                        pool ? &*pool : nullptr);
+        assert(content == site.text(0));
+        assert(site.getServer().requestCount() - before == 8);
+        // 没有线程池时逐个下载，有线程池时7个正文页并发下载
+        assert(threads > 0 ? site.getServer().maxConcurrency() > 1 : site.getServer().maxConcurrency() == 1);
+    }
+}
+
+void test_url_list_put() {
+    ContentSite site(1, 6, 2);
+    // 每一页的正文规则都@put同一个变量，并发时按地址的顺序合并，最后一页的值保留
+    auto bookSource = ContentSite::source("https://www.example.com", "", "tag.option@value", "",
+                                          R"(id.content@html@put:{\"page\":\"id.title@text\"})");
+    for (const size_t threads: {size_t{0}, size_t{4}}) {
+        std::optional<ThreadPool> pool;
+        if (threads > 0) pool.emplace(threads);
+        RuleData ruleData;
+        Book book;
+        BookChapter chapter = site.bookChapter(0);
+        chapter.putVariable("kept", "1");
+        const std::string content = WebBook::getContent(bookSource, book, chapter, ruleData, std::nullopt,
+                                                        pool ? &*pool : nullptr);
+        assert(content == site.text(0));
+        assert(chapter.getVariable("page") == "第1章 标题0（6/6）");
+        assert(chapter.getVariable("kept") == "1");
+        assert(JsonUtils::jsonStringToMap(chapter.getVariableString().value()).size() == 2);
+        assert(ruleData.getVariable("page").empty());
+    }
+}
+
+void test_title_replace() {
+    ContentSite site(2, 2, 2);
+    auto bookSource = ContentSite::source("https://www.example.com", "", "id.next@href",
+                                          R"json(, "title": "id.title@text##（.*）",
+            "replaceRegex": "##第(\\d)章第(\\d)页##$2-")json");
+    RuleData ruleData;
+    Book book;
+    BookChapter chapter = site.bookChapter(0);
+    const BookChapter next = site.bookChapter(1);
+    const std::string content = WebBook::getContent(bookSource, book, chapter, ruleData, next.getAbsoluteURL());
+    assert(chapter.title == "第1章 标题0");
+    assert(content == "　　1-第1段\n　　1-第2段\n　　2-第1段\n　　2-第2段");
+
+    // 没有正文规则时返回章节地址；与详情页相同的章节使用已有的详情页内容
+    auto empty = BookSourceParser::parseBookSource(R"({"bookSourceUrl": "https://www.example.com"})");
+    assert(WebBook::getContent(empty, book, chapter, ruleData) == chapter.url);
+    auto noNext = ContentSite::source("https://www.example.com", "", "");
+    book.bookUrl = chapter.getAbsoluteURL();
+    book.tocHtml = "<div id=\"content\">详情页的正文</div>";
+    const size_t before = site.getServer().requestCount();
+    assert(WebBook::getContent(noNext, book, chapter, ruleData) == "　　详情页的正文");
+    assert(site.getServer().requestCount() == before);
+
+    // 章节地址的请求参数
+    BookChapter withOption = site.bookChapter(1);
+    withOption.url += " , {\"method\": \"POST\"}";
+    assert(withOption.getAbsoluteURL() == site.chapterUrl(1) + ",{\"method\": \"POST\"}");
+}
+
+int main() {
+    test_format();
+    test_chained();
+    test_url_list();
+    test_url_list_put();
+    test_title_replace();
+    std::cout << "All content tests passed." << std::endl;
+    return 0;
+}
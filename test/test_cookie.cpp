@@ -0,0 +1,105 @@
+#include <booksource/cookie.h>
+#include <booksource/rule.h>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "mock_server.h"
+#include "temp_file.h"
+
+void test_match() {
+    CookieJar jar;
+    jar.saveFromResponse("https://www.example.com/book/1", "sid=abc; Path=/; HttpOnly");
+    jar.saveFromResponse("https://www.example.com/book/1", "token=t1; Domain=.example.com; Path=/");
+    jar.saveFromResponse("https://www.example.com/book/1", "last=9; Path=/book");
+    jar.saveFromResponse("https://www.example.com/book/1", "pay=1; Secure");
+
+    // host-only 的cookie不会发送给子域名
+    assert(jar.getCookie("https://m.example.com/") == "token=t1");
+    // 没有Path属性时默认为请求路径的目录：/book，path更长的排在前面
+    assert(jar.getCookie("https://www.example.com/book/2") == "last=9; pay=1; sid=abc; token=t1");
+    assert(jar.getCookie("http://www.example.com/") == "sid=abc; token=t1");
+    assert(jar.getCookie("https://www.example.com/bookshelf").find("last=9") == std::string::npos);
+    assert(jar.getCookie("https://other.com/").empty());
+
+    // 不允许为其他域名设置cookie
+    jar.saveFromResponse("https://www.example.com/", "evil=1; Domain=other.com");
+    assert(jar.getCookie("https://other.com/").empty());
+
+    // 同名替换，过期即删除
+    jar.saveFromResponse("https://www.example.com/", "sid=def; Path=/");
+    assert(jar.getCookie("http://www.example.com/") == "sid=def; token=t1");
+    jar.saveFromResponse("https://www.example.com/", "sid=; Max-Age=0; Path=/");
+    jar.saveFromResponse("https://www.example.com/", "token=; Domain=example.com; Expires=Thu, 01 Jan 1970 00:00:00 GMT");
+    assert(jar.getCookie("http://www.example.com/").empty());
+
+    jar.setCookie("https://www.example.com/", "a=1; b=2");
+    assert(jar.getCookie("https://m.example.com/") == "a=1; b=2");
+    jar.removeCookie("https://m.example.com/");
+    assert(jar.getCookie("https://www.example.com/").empty());
+}
+
+void test_persist() {
+    const std::string file = tempFile("booksource_test.cookie");
+    {
+        CookieJar jar(file);
+        jar.saveFromResponse("https://www.example.com/", "sid=abc; Max-Age=3600; HttpOnly");
+        jar.saveFromResponse("https://www.example.com/", "token=t1; Domain=example.com; Secure");
+        jar.saveFromResponse("https://www.example.com/", "old=1; Max-Age=-1");
+        assert(jar.flush());
+        // 析构时没有修改，不会再次写入
+    }
+    {
+        CookieJar jar(file);
+        assert(jar.size() == 2);
+        assert(jar.getCookie("https://www.example.com/") == "sid=abc; token=t1");
+        assert(jar.getCookie("https://m.example.com/") == "token=t1");
+    }
+    // 过期时间不是数字的行跳过，其余的cookie照常读取
+    std::ofstream(file, std::ios::app) << "www.example.com\tFALSE\t/\tFALSE\tnever\tbad\t1\n";
+    {
+        CookieJar jar(file);
+        assert(jar.getCookie("https://www.example.com/") == "sid=abc; token=t1");
+    }
+    std::filesystem::remove(file);
+}
+
+void test_registry() {
+    const auto a = CookieJar::forSource("https://www.example.com");
+    const auto b = CookieJar::forSource("https://www.example.com");
+    const auto c = CookieJar::forSource("https://other.com");
+    assert(a == b && a != c);
+    a->setCookie("https://www.example.com/", "k=v");
+    assert(b->getCookie("https://www.example.com/") == "k=v");
+    assert(c->getCookie("https://www.example.com/").empty());
+}
+
+void test_redirect() {
+    // 登录：POST之后302设置cookie，重定向后的请求带上该cookie
+    MockServer server([](const std::string &path) -> MockServer::Response {
+        if (path == "/login") {
+            return {"登录成功，正在跳转", "text/html", 302, {"Set-Cookie: sid=abc; Path=/", "Location: /home"}};
+        }
+        return "home";
+    });
+    auto source = BookSourceParser::parseBookSource(R"({"bookSourceUrl": ")" + server.url("/") +
+                                                    R"(", "enabledCookieJar": true, "header": "{\"Cookie\": \"h=1\"}"})");
+    AnalyzeUrl analyzeUrl(server.url("/login") + R"(,{"method": "POST", "body": "user=a"})", std::nullopt,
+                          std::nullopt, std::nullopt, std::nullopt, server.url("/"), &source);
+    const StrResponse res = analyzeUrl.getStrResponse();
+    // 重定向响应的内容不属于结果
+    assert(res.body == "home");
+    assert((server.paths() == std::vector<std::string>{"/login", "/home"}));
+    const auto cookies = server.headers("Cookie");
+    assert(cookies[0] == "h=1" && cookies[1] == "h=1; sid=abc");
+    assert(source.getCookieJar()->getCookie(server.url("/")) == "sid=abc");
+}
+
+int main() {
+    test_match();
+    test_persist();
+    test_registry();
+    test_redirect();
+    std::cout << "cookie tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <booksource/css.h>
+#include <booksource/jsoup.h>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+using Html::Document;
+using Css::Selector;
+
+const std::string PAGE = R"(<html><body>
+<div id="main" class="wrap">
+  <ul class="list">
+    <li class="item hot" data-id="1"><a href="/book/1.html" title="Doupo">斗破苍穹</a><span>天蚕土豆</span></li>
+    <li class="item" data-id="2"><a href="/book/2.html">凡人修仙传</a><span>忘语</span></li>
+    <li class="item" data-id="3"><a href="https://m.example.com/book/3.html">遮天</a><span>辰东</span></li>
+    <li class="item ad" data-id="4"><em>广告</em></li>
+  </ul>
+  <p></p>
+  <p>尾部 <b>加粗</b></p>
+</div>
+<div class="footer"><a href="/about">关于</a></div>
+</body></html>)";
+
+static std::vector<std::string> texts(const Html::Elements &elements) {
+    std::vector<std::string> result;
+    for (const auto *e: elements) result.push_back(e->text());
+    return result;
+}
+
+static std::vector<std::string> select(const Document &doc, const std::string &css) {
+    return texts(Selector::parse(css)->select(doc.root()));
+}
+
+void test_basic() {
+    const auto doc = Document::parse(PAGE);
+    assert(select(*doc, "li.item a").size() == 3);
+    assert(select(*doc, "#main .list > li.hot > a") == std::vector<std::string>{"斗破苍穹"});
+    assert(select(*doc, "div.wrap a, .footer a").size() == 4);
+    // 结果按文档顺序，且不重复
+    assert((select(*doc, "span, a") ==
+        std::vector<std::string>{"斗破苍穹", "天蚕土豆", "凡人修仙传", "忘语", "遮天", "辰东", "关于"}));
+    assert(select(*doc, "li.item:not(.ad) span").size() == 3);
+    assert(select(*doc, "li + li a") == (std::vector<std::string>{"凡人修仙传", "遮天"}));
+    assert(select(*doc, "li.hot ~ li em") == std::vector<std::string>{"广告"});
+    assert(select(*doc, "UL LI.HOT A").size() == 1);
+}
+
+void test_attribute() {
+    const auto doc = Document::parse(PAGE);
+    assert(select(*doc, "a[title]").size() == 1);
+    assert(select(*doc, "a[href^=/book]").size() == 2);
+    assert(select(*doc, "a[href$='.HTML']").size() == 3);
+    assert(select(*doc, "a[href*=example]") == std::vector<std::string>{"遮天"});
+    assert(select(*doc, "li[data-id=\"2\"] a") == std::vector<std::string>{"凡人修仙传"});
+    assert(select(*doc, "[^data-] span").size() == 3);
+    assert(select(*doc, "a[href~=^/book/\\d\\.html$]").size() == 2);
+}
+
+void test_pseudo() {
+    const auto doc = Document::parse(PAGE);
+    assert(select(*doc, "li:nth-child(2) a") == std::vector<std::string>{"凡人修仙传"});
+    assert(select(*doc, "li:nth-child(odd) a") == (std::vector<std::string>{"斗破苍穹", "遮天"}));
+    assert(select(*doc, "li:nth-child(-n+2) span") == (std::vector<std::string>{"天蚕土豆", "忘语"}));
+    assert(select(*doc, "li:nth-last-child(1) em") == std::vector<std::string>{"广告"});
+    assert(select(*doc, "li:first-child a") == std::vector<std::string>{"斗破苍穹"});
+    assert(select(*doc, "#main > p:last-of-type") == std::vector<std::string>{"尾部 加粗"});
+    assert(select(*doc, "p:empty").size() == 1);
+    assert(select(*doc, "li:has(em)").size() == 1);
+    assert(select(*doc, "li:contains(凡人)") == std::vector<std::string>{"凡人修仙传忘语"});
+    assert(select(*doc, "a:containsOwn(DOUPO)").empty());
+    assert(select(*doc, "li:matches(^遮) span") == std::vector<std::string>{"辰东"});
+    assert(select(*doc, "li:eq(0) span") == std::vector<std::string>{"天蚕土豆"});
+    assert(select(*doc, "li:gt(1) a") == std::vector<std::string>{"遮天"});
+    assert(select(*doc, "li:lt(1) a") == std::vector<std::string>{"斗破苍穹"});
+    assert(select(*doc, "html:root").size() == 1);
+}
+
+void test_scope() {
+    const auto doc = Document::parse(PAGE);
+    const auto list = Selector::parse("ul.list")->selectFirst(doc->root());
+    assert(list != nullptr);
+    // root之外的祖先不参与匹配
+    assert(Selector::parse("div li")->select(list).empty());
+    assert(Selector::parse("ul li")->select(list).size() == 4);
+    assert(Selector::parse("li")->matches(list->firstElementChild(), list));
+
+    // 语法错误
+    bool thrown = false;
+    try {
+        Selector::parse("li:unknown");
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(Selector::compile("div[") == nullptr);
+    assert(Selector::compile("li.item") == Selector::compile("li.item"));
+
+    // 通过规则使用
+    const AnalyzeByJSoup jsoup(doc);
+    assert(jsoup.getString("@CSS:li.item:nth-child(3) > a@href") == "https://m.example.com/book/3.html");
+    assert(jsoup.getString("li.hot@tag.span@text") == "天蚕土豆");
+}
+
+int main() {
+    test_basic();
+    test_attribute();
+    test_pseudo();
+    test_scope();
+    std::cout << "css tests passed" << std::endl;
+    return 0;
+}
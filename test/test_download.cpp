@@ -0,0 +1,110 @@
+#include <booksource/download.h>
+#include <cassert>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include "content_site.h"
+
+using namespace std::chrono_literals;
+
+static Book makeBook(ContentSite &site) {
+    Book book;
+    book.bookUrl = site.getServer().url("/book/1/");
+    return book;
+}
+
+// 下载结果：书籍地址 -> 章节序号 -> 正文
+using Results = std::map<std::string, std::map<int, std::string> >;
+
+void test_sources() {
+    // 慢的书源：同一时间只有一个请求，相邻请求间隔50毫秒
+    ContentSite slow(6, 2);
+    ContentSite fast1(10, 2), fast2(10, 2);
+    auto slowSource = ContentSite::source("https://slow.example.com", "50");
+    auto fastSource = ContentSite::source("https://fast.example.com");
+    RuleData ruleData;
+    std::mutex mutex;
+    Results results;
+    BatchDownloader downloader([&](const Book &book, const BookChapter &chapter, const std::string &content) {
+        std::lock_guard lock(mutex);
+        results[book.bookUrl][chapter.index] = content;
+    }, {3, std::nullopt});
+    downloader.addBook(slowSource, makeBook(slow), slow.bookChapters(6), ruleData);
+    downloader.addBook(fastSource, makeBook(fast1), fast1.bookChapters(10), ruleData);
+    downloader.addBook(fastSource, makeBook(fast2), fast2.bookChapters(10), ruleData);
+    downloader.run();
+
+    assert(downloader.completedCount() == 26);
+    for (auto *site: {&slow, &fast1, &fast2}) {
+        const auto &chapters = results[site->getServer().url("/book/1/")];
+        assert(chapters.size() == (site == &slow ? 6 : 10));
+        for (const auto &[index, content]: chapters) {
+            assert(content == site->text(index));
+        }
+    }
+    // 每章两页，正文页不会重复下载
+    assert(slow.getServer().requestCount() == 12 && fast1.getServer().requestCount() == 20);
+
+    const auto stats = downloader.stats();
+    assert(stats.size() == 2);
+    assert(stats[0].source == "https://slow.example.com" && stats[0].chapters == 6 && stats[0].failures == 0);
+    assert(stats[1].chapters == 20 && stats[1].bytes > 0);
+    // 12个请求至少间隔550毫秒；快的书源不需要等待慢的书源
+    assert(stats[0].seconds >= 0.5);
+    assert(stats[1].seconds < stats[0].seconds / 2);
+    assert(stats[1].chaptersPerSecond() > stats[0].chaptersPerSecond());
+}
+
+void test_resume() {
+    ContentSite site(20, 1);
+    auto bookSource = ContentSite::source("https://resume.example.com");
+    const std::string file = (std::filesystem::temp_directory_path() / "booksource_download_checkpoint").string();
+    std::filesystem::remove(file);
+    RuleData ruleData;
+    std::mutex mutex;
+    Results first, second;
+
+    // 第一次运行在完成5章后中断
+    {
+        std::optional<BatchDownloader> downloader;
+        downloader.emplace([&](const Book &book, const BookChapter &chapter, const std::string &content) {
+            std::lock_guard lock(mutex);
+            first[book.bookUrl][chapter.index] = content;
+            if (first[book.bookUrl].size() == 5) downloader->cancel();
+        }, BatchDownloader::Options{2, file});
+        downloader->addBook(bookSource, makeBook(site), site.bookChapters(20), ruleData);
+        downloader->run();
+        assert(downloader->completedCount() >= 5 && downloader->completedCount() < 20);
+    }
+
+    // 再次运行只下载剩余的章节
+    BatchDownloader downloader([&](const Book &book, const BookChapter &chapter, const std::string &content) {
+        std::lock_guard lock(mutex);
+        second[book.bookUrl][chapter.index] = content;
+    }, {2, file});
+    downloader.addBook(bookSource, makeBook(site), site.bookChapters(20), ruleData);
+    const size_t resumed = downloader.completedCount();
+    assert(resumed == first.begin()->second.size());
+    downloader.run();
+    assert(downloader.completedCount() == 20);
+    const auto &before = first.begin()->second;
+    const auto &after = second.begin()->second;
+    assert(before.size() + after.size() == 20);
+    for (int i = 0; i < 20; i++) {
+        assert(before.contains(i) != after.contains(i));
+        assert((before.contains(i) ? before.at(i) : after.at(i)) == site.text(i));
+    }
+
+    // 全部完成后不再下载
+    const size_t requests = site.getServer().requestCount();
+    downloader.run();
+    assert(site.getServer().requestCount() == requests);
+    std::filesystem::remove(file);
+}
+
+int main() {
+    test_sources();
+    test_resume();
+    std::cout << "All download tests passed." << std::endl;
+    return 0;
+}
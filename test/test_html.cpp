@@ -0,0 +1,174 @@
+#include <booksource/html.h>
+#include <booksource/jsoup.h>
+#include <cassert>
+#include <iostream>
+#include <optional>
+
+using Html::Document;
+
+const std::string PAGE = R"(<!DOCTYPE html>
+<html><head><title>搜索 &amp; 结果</title>
+<script>var a = "<div class='bookname'>x</div>";</script>
+<style>.bookname { color: red }</style></head>
+<body>
+<div id="list">
+  <UL class="items">
+    <li class="item first"><span class="bookname"><a href="/book/1/">斗破苍穹</a></span><span class="author">天蚕土豆</span><p>简介一<br>第二行</li>
+    <li class="item"><span class="bookname"><a href="/book/2/">凡人修仙传</a></span><span class="author">忘语</span>
+    <li class="item"><span class="bookname"><a href='/book/3/' title=遮天>遮天</a></span><span class="author">辰东</span>
+  </UL>
+</div>
+<div id="content">&nbsp;&nbsp;第一段<br/>
+  &nbsp;&nbsp;第二段<!-- ad --><br>
+  <p>第三段&#x4E2D;&#20013;</p>
+</div>
+</body></html>)";
+
+void test_parse() {
+    const auto doc = Document::parse(PAGE);
+    const auto *root = doc->root();
+    assert(root->firstElementChild()->name == "html");
+    // 未闭合的li与p被隐式闭合，大写标签名转为小写
+    AnalyzeByJSoup jsoup(doc);
+    const auto items = jsoup.getElements("class.item");
+    assert(items.size() == 3);
+    assert(items[0]->parent->name == "ul");
+    assert(items[1]->parent == items[0]->parent);
+    assert(items[0]->hasClass("first") && items[0]->hasClass("ITEM"));
+    // 实体解码与空白合并
+    assert(jsoup.getString("tag.title@text") == "搜索 & 结果");
+    assert(jsoup.getString("class.item.0@tag.p@text") == "简介一 第二行");
+    // script中的内容不解析为标签
+    assert(jsoup.getElements("class.bookname").size() == 3);
+    assert(jsoup.getString0("tag.a.2@title") == "遮天");
+    // 属性值不以引号包围时也能解析；相对地址保持原样
+    assert(jsoup.getString0("id.list@tag.a.-1@href") == "/book/3/");
+    // 第一块内存就能容纳整个文档
+    assert(doc->getArena().blockCount() == 1);
+}
+
+void test_rule() {
+    const AnalyzeByJSoup jsoup(PAGE);
+    assert((jsoup.getStringList("class.bookname@tag.a@text") ==
+        std::vector<std::string>{"斗破苍穹", "凡人修仙传", "遮天"}));
+    assert((jsoup.getStringList("class.item!0@class.author@text") == std::vector<std::string>{"忘语", "辰东"}));
+    assert((jsoup.getStringList("class.item[-1:0]@class.author@text") ==
+        std::vector<std::string>{"辰东", "忘语", "天蚕土豆"}));
+    assert((jsoup.getStringList("class.item[!1]@class.author@text") == std::vector<std::string>{"天蚕土豆", "辰东"}));
+    assert((jsoup.getStringList("class.item.0:2@class.author@text") == std::vector<std::string>{"天蚕土豆", "辰东"}));
+    // %% 交替合并，|| 取第一个有结果的规则
+    assert((jsoup.getStringList("class.bookname@text%%class.author@text") ==
+        std::vector<std::string>{"斗破苍穹", "天蚕土豆", "凡人修仙传", "忘语", "遮天", "辰东"}));
+    assert(jsoup.getString("class.none@text||class.author.0@text") == "天蚕土豆");
+    assert(jsoup.getString("class.author.0@text&&class.author.1@text") == "天蚕土豆\n忘语");
+    // text.xx 按自身文本查找；children 取子元素
+    assert(jsoup.getString("text.凡人@href") == "/book/2/");
+    assert(jsoup.getString("id.list@tag.ul@children.1@class.author@text") == "忘语");
+    // css
+    assert(jsoup.getString("@CSS:#list li.first .author@text") == "天蚕土豆");
+    assert(jsoup.getString("@CSS:span[class=author]@text") == "天蚕土豆\n忘语\n辰东");
+    // textNodes、ownText、html
+    assert(jsoup.getString("id.content@textNodes") == "第一段\n第二段");
+    assert(jsoup.getString("id.content@ownText") == "第一段 第二段");
+    assert(jsoup.getString("id.content@tag.p@html") == "<p>第三段中中</p>");
+    // script与style被去掉，只留下它们之间的换行
+    assert(jsoup.getString("tag.head@html") == "<head><title>搜索 &amp; 结果</title>\n\n</head>");
+    assert(jsoup.getElements("tag.script")[0]->data().starts_with("var a"));
+
+    const auto items = jsoup.getElements("class.item");
+    const AnalyzeByJSoup item(jsoup.getDocument(), items[1]);
+    assert(item.getString("class.bookname@text") == "凡人修仙传");
+    assert(item.getString("tag.a@href") == "/book/2/");
+}
+
+void test_malformed() {
+    const AnalyzeByJSoup jsoup("<div><b>粗<i>斜</b>后</i><p>一<p>二</div></span>尾<a href=x>&copy 2024&unknown;");
+    assert(jsoup.getString("tag.div@text") == "粗斜后 一 二");
+    assert((jsoup.getStringList("tag.p@text") == std::vector<std::string>{"一", "二"}));
+    assert(jsoup.getString("tag.a@text") == "© 2024&unknown;");
+    // 属性中的旧式实体后面跟着'='时不解码
+    assert(Html::decodeEntities("?a=1&copy=2", true) == "?a=1&copy=2");
+    assert(Html::decodeEntities("&lt;&#60;&#x3c;&nbsp;") == "<<<\xC2\xA0");
+
+    const AnalyzeByJSoup xml(R"(<?xml version="1.0"?><rss><Item><Title>A</Title></Item><Item><Title>B</Title></Item></rss>)");
+    assert((xml.getStringList("tag.Title@text") == std::vector<std::string>{"A", "B"}));
+}
+
+// 先序遍历全部元素
+static void collectElements(const Html::Node *node, std::vector<const Html::Node *> &out) {
+    for (const Html::Node *child = node->firstChild; child != nullptr; child = child->next) {
+        if (!child->isElement()) continue;
+        out.push_back(child);
+        collectElements(child, out);
+    }
+}
+
+// 增量解析得到的每个元素的范围单独解析后，与完整解析的结果相同
+static void checkStream(const std::string &html) {
+    const auto doc = Document::parse(html);
+    std::vector<const Html::Node *> elements;
+    collectElements(doc->root(), elements);
+    for (const size_t chunk: {size_t{1}, size_t{7}, size_t{64}, html.size()}) {
+        std::vector<std::pair<size_t, size_t> > ranges;
+        std::vector<size_t> open;
+        Html::StreamParser parser(
+            [&](const Html::Node &element, const size_t depth, const size_t begin) {
+                assert(depth == open.size() + 1);
+                assert(element.name == elements[ranges.size()]->name);
+                open.push_back(ranges.size());
+                ranges.emplace_back(begin, 0);
+            },
+            [&](const size_t depth, const size_t end) {
+                assert(depth == open.size());
+                ranges[open.back()].second = end;
+                open.pop_back();
+            });
+        for (size_t i = 0; i < html.size(); i += chunk) {
+            parser.feed(std::string_view(html).substr(i, chunk));
+        }
+        parser.finish();
+        assert(open.empty() && ranges.size() == elements.size());
+        for (size_t i = 0; i < ranges.size(); i++) {
+            const auto fragment = Document::parse(html.substr(ranges[i].first, ranges[i].second - ranges[i].first));
+            assert(fragment->root()->firstChild->outerHtml() == elements[i]->outerHtml());
+        }
+    }
+}
+
+void test_stream() {
+    checkStream(PAGE);
+    checkStream("<div><b>粗<i>斜</b>后</i><p>一<p>二</div></span>尾<a href=x>&copy 2024&unknown;");
+    checkStream("<table><tr><td>1<td>2<tr><th>3</table><select><option>a<optgroup><option>b</select><p>x</br>y<dl><dt>t<dd>d</dl>");
+    checkStream("<textarea><b>不是标签</textarea ><script>if (a</b) {}</script><!-- <li> --><![CDATA[<p>]]><img src=1/>");
+
+    // 只保留尚未闭合的元素之后的内容
+    std::optional<size_t> itemBegin;
+    std::string items;
+    Html::StreamParser *self = nullptr;
+    Html::StreamParser parser(
+        [&](const Html::Node &element, size_t, const size_t begin) {
+            if (element.nameIs("li")) itemBegin = begin;
+        },
+        [&](size_t, const size_t end) {
+            if (itemBegin.has_value()) {
+                items += self->slice(*itemBegin, end);
+                items += '|';
+                self->release(end);
+                itemBegin.reset();
+            }
+        });
+    self = &parser;
+    for (int i = 0; i < 1000; i++) parser.feed("<li>" + std::to_string(i) + "</li>");
+    parser.finish();
+    assert(items.starts_with("<li>0</li>|<li>1</li>|") && items.ends_with("|<li>999</li>|"));
+    assert(parser.size() == 10 + 90 * 2 + 900 * 3 + 1000 * 9);
+}
+
+int main() {
+    test_parse();
+    test_rule();
+    test_malformed();
+    test_stream();
+    std::cout << "html tests passed" << std::endl;
+    return 0;
+}
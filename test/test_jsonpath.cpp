@@ -0,0 +1,214 @@
+#include <booksource/jsonpath.h>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+using JsonPath::Document;
+using JsonPath::Path;
+using JsonPath::Value;
+
+const std::string JSON = R"({
+  "code": 0,
+  "msg": "ok",
+  "data": {
+    "total": 3,
+    "list": [
+      {"name": "斗破苍穹", "author": "天蚕土豆", "words": 5325000, "tags": ["玄幻", "热血"], "finished": true,
+       "url": "/book/1", "cover": null},
+      {"name": "凡人修仙传", "author": "忘语", "words": 7446000, "tags": ["仙侠"], "finished": true,
+       "url": "/book/2"},
+      {"name": "遮天★", "author": "辰东", "words": 6354000, "tags": [], "finished": false,
+       "url": "/book/3", "intro": "冰冷与黑暗并存的宇宙深处，\"九具\"庞大的龙尸\n拉着一口青铜古棺"}
+    ]
+  },
+  "a.b": {"weird \"key\"": 1}
+})";
+
+static std::vector<std::string> strings(const std::vector<Value> &values) {
+    std::vector<std::string> result;
+    for (const auto &v: values) result.push_back(v.getString());
+    return result;
+}
+
+static std::vector<std::string> select(const Document &doc, const std::string &path) {
+    return strings(Path::parse(path)->select(doc.root()));
+}
+
+void test_document() {
+    const auto doc = Document::parse(JSON);
+    const Value root = doc->root();
+    assert(root.isObject());
+    assert(root.size() == 4);
+    assert(root["code"].getNumber() == 0);
+    assert(root["msg"].getString() == "ok");
+    assert(!root["missing"].valid());
+    const Value list = root["data"]["list"];
+    assert(list.isArray() && list.size() == 3);
+    assert(list.at(-1)["author"].getString() == "辰东");
+    assert(!list.at(3).valid());
+    assert(list.at(0)["cover"].isNull());
+    assert(list.at(0)["tags"].toJson() == R"(["玄幻","热血"])");
+    assert(list.at(2)["name"].getString() == "遮天★");
+    assert(list.at(2)["intro"].getString() == "冰冷与黑暗并存的宇宙深处，\"九具\"庞大的龙尸\n拉着一口青铜古棺");
+    assert(root["a.b"]["weird \"key\""].getNumber() == 1);
+    assert(JsonPath::unescape(R"(\ud83d\ude00\t\/)") == "\xF0\x9F\x98\x80\t/");
+
+    std::vector<std::string> keys;
+    list.at(1).forEach([&](const std::string_view key, const Value) {
+        keys.emplace_back(key);
+        return keys.size() < 3;
+    });
+    assert((keys == std::vector<std::string>{"name", "author", "words"}));
+
+    for (const char *bad: {"", "{", "[1,]", "{\"a\" 1}", "tru", "01", "\"abc", "[1] 2", "{\"a\":1,}", "-", "1.e5"}) {
+        bool thrown = false;
+        try {
+            Document::parse(bad);
+        } catch (const std::invalid_argument &) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+    assert(Document::parse(" [1, -2.5e3, \"x\", true, false, null, {}] ")->root().size() == 7);
+}
+
+void test_path() {
+    const auto doc = Document::parse(JSON);
+    assert(select(*doc, "$.msg") == std::vector<std::string>{"ok"});
+    assert(select(*doc, "msg") == std::vector<std::string>{"ok"});
+    assert(select(*doc, "$.data.list[*].author") == (std::vector<std::string>{"天蚕土豆", "忘语", "辰东"}));
+    assert(select(*doc, "$['data']['list'][0]['name']") == std::vector<std::string>{"斗破苍穹"});
+    assert(select(*doc, "$.data.list[-1].url") == std::vector<std::string>{"/book/3"});
+    assert(select(*doc, "$.data.list[0,2].url") == (std::vector<std::string>{"/book/1", "/book/3"}));
+    assert(select(*doc, "$.data.list[1:].url") == (std::vector<std::string>{"/book/2", "/book/3"}));
+    assert(select(*doc, "$.data.list[:-1].url") == (std::vector<std::string>{"/book/1", "/book/2"}));
+    assert(select(*doc, "$.data.list[::2].url") == (std::vector<std::string>{"/book/1", "/book/3"}));
+    assert(select(*doc, "$..author") == (std::vector<std::string>{"天蚕土豆", "忘语", "辰东"}));
+    assert(select(*doc, "$..tags[0]") == (std::vector<std::string>{"玄幻", "仙侠"}));
+    assert(select(*doc, "$.data.list[0].*").size() == 7);
+    assert(select(*doc, "$.data.list[0]['name','url']") == (std::vector<std::string>{"斗破苍穹", "/book/1"}));
+    assert(select(*doc, "$['a.b']['weird \\\"key\\\"']") == std::vector<std::string>{"1"});
+    assert(select(*doc, "$.data.list.name").empty());
+    assert(select(*doc, "$.data.none[*]").empty());
+
+    assert(Path::parse("$.data.list")->isDefinite());
+    assert(Path::parse("$.data.list[0].name")->isDefinite());
+    assert(!Path::parse("$.data.list[*]")->isDefinite());
+    assert(!Path::parse("$..name")->isDefinite());
+}
+
+void test_filter() {
+    const auto doc = Document::parse(JSON);
+    assert(select(*doc, "$.data.list[?(@.finished == true)].name") == (std::vector<std::string>{"斗破苍穹", "凡人修仙传"}));
+    assert(select(*doc, "$.data.list[?(@.words > 6000000)].author") == (std::vector<std::string>{"忘语", "辰东"}));
+    assert(select(*doc, "$.data.list[?(@.words > 6000000 && !@.cover && @.finished == false)].author") == std::vector<std::string>{"辰东"});
+    assert(select(*doc, "$.data.list[?(@.author == '忘语' || @.url == \"/book/1\")].url").size() == 2);
+    assert(select(*doc, "$.data.list[?(@.intro)].url") == std::vector<std::string>{"/book/3"});
+    assert(select(*doc, "$.data.list[?(@.url =~ /.*\\/BOOK\\/[12]$/i)].name").size() == 2);
+    assert(select(*doc, "$.data.list[?(@.author in ['辰东', '忘语'])].url") == (std::vector<std::string>{"/book/2", "/book/3"}));
+    assert(select(*doc, "$.data.list[?(@.author nin ['辰东', '忘语'])].url") == std::vector<std::string>{"/book/1"});
+    assert(select(*doc, "$.data.list[?(@.words >= $.data.total)].url").size() == 3);
+    assert(select(*doc, "$.data.list[?(@.tags[0] == '仙侠')].name") == std::vector<std::string>{"凡人修仙传"});
+    assert(select(*doc, "$.data.list[?(@.cover == null)].url") == std::vector<std::string>{"/book/1"});
+    assert(select(*doc, "$.data.list[?((@.words < 6000000) || (@.name == '遮天★'))].url").size() == 2);
+}
+
+void test_error() {
+    for (const char *path: {"$.", "$[", "$.a[?(@.b ==)]", "$.a[1:2:0]", "$.a.length()", "$.a[?(@.b =~ 'x')]", "$['a"}) {
+        bool thrown = false;
+        try {
+            Path::parse(path);
+        } catch (const std::invalid_argument &) {
+            thrown = true;
+        }
+        assert(thrown);
+        assert(Path::compile(path) == nullptr);
+    }
+    assert(Path::compile("$.data.list[*]") == Path::compile("$.data.list[*]"));
+}
+
+void test_analyze() {
+    const AnalyzeByJSonPath analyzer(JSON);
+    assert(analyzer.getString("$.msg") == "ok");
+    assert(analyzer.getString("$.missing") == std::nullopt);
+    // 确定路径的结果为数组时，结果为数组的元素
+    assert((analyzer.getStringList("$.data.list[0].tags") == std::vector<std::string>{"玄幻", "热血"}));
+    assert(analyzer.getString("$.data.list[0].tags") == "玄幻\n热血");
+    assert(analyzer.getString("$.data.list[*].tags") == "[\"玄幻\",\"热血\"]\n[\"仙侠\"]\n[]");
+    assert(analyzer.getString("$.data.list[0].cover") == std::nullopt);
+    assert(analyzer.getString("$.missing || $.msg") == "ok");
+    assert(analyzer.getString("$.code && $.msg") == "0\nok");
+    assert((analyzer.getStringList("$.data.list[*].name %% $.data.list[*].author") ==
+        std::vector<std::string>{"斗破苍穹", "天蚕土豆", "凡人修仙传", "忘语", "遮天★", "辰东"}));
+    assert(analyzer.getString("{$.data.total}本，{$.msg}") == "3本，ok");
+    assert(analyzer.getObject("$.data.list[1]")["author"].getString() == "忘语");
+    assert(!analyzer.getObject("$.nothing").valid());
+
+    // 列表中的每一项在同一个文档上继续执行规则
+    const auto items = analyzer.getList("$.data.list");
+    assert(items.size() == 3);
+    std::vector<std::string> names;
+    for (const auto &item: items) {
+        const AnalyzeByJSonPath sub(analyzer.getDocument(), item);
+        names.push_back(sub.getString("$.name").value_or("") + "/" + sub.getString("author").value_or(""));
+    }
+    assert((names == std::vector<std::string>{"斗破苍穹/天蚕土豆", "凡人修仙传/忘语", "遮天★/辰东"}));
+    assert(analyzer.getList("$.data.list[?(@.finished)] || $.data.list").size() == 3);
+    assert(analyzer.getList("$.data").size() == 1);
+}
+
+// 分段扫描得到的列表项
+static std::vector<std::string> scan(const std::string &json, std::vector<std::string> keys, const bool members,
+                                     const size_t chunk, bool &failed) {
+    std::vector<std::string> items;
+    JsonPath::StreamScanner *self = nullptr;
+    JsonPath::StreamScanner scanner(std::move(keys), members, [&](const size_t begin, const size_t end) {
+        items.push_back(Document::parse(std::string(self->slice(begin, end)))->root().toJson());
+        self->release(end);
+    });
+    self = &scanner;
+    for (size_t i = 0; i < json.size(); i += chunk) {
+        scanner.feed(std::string_view(json).substr(i, chunk));
+    }
+    scanner.finish();
+    failed = scanner.failed();
+    return items;
+}
+
+void test_stream() {
+    const auto doc = Document::parse(JSON);
+    std::vector<std::string> expected;
+    for (const auto &v: Path::parse("$.data.list[*]")->select(doc->root())) expected.push_back(v.toJson());
+    bool failed;
+    for (const size_t chunk: {size_t{1}, size_t{5}, size_t{64}, JSON.size()}) {
+        assert(scan(JSON, {"data", "list"}, false, chunk, failed) == expected && !failed);
+        assert(scan(JSON, {"data", "list"}, true, chunk, failed) == expected && !failed);
+        // 对象的成员值，成员名称中的转义字符
+        assert((scan(JSON, {"data"}, true, chunk, failed) ==
+            std::vector<std::string>{"3", doc->root()["data"]["list"].toJson()}) && !failed);
+        assert((scan(JSON, {"a.b"}, true, chunk, failed) == std::vector<std::string>{"1"}) && !failed);
+    }
+    // 路径对应的是对象但不取成员值，结果是对象本身
+    scan(JSON, {"data"}, false, 7, failed);
+    assert(failed);
+    assert(scan(JSON, {"data", "none"}, false, 7, failed).empty() && !failed);
+    // 根节点为数组
+    assert((scan(R"([1, "a\"]", {"b": null}, [true]])", {}, false, 3, failed) ==
+        std::vector<std::string>{"1", R"("a\"]")", R"({"b":null})", "[true]"}) && !failed);
+    // 不完整或者不合法
+    scan(R"({"list": [1, 2)", {"list"}, false, 4, failed);
+    assert(failed);
+    scan(R"({"list": [1, 2}})", {"list"}, false, 4, failed);
+    assert(failed);
+}
+
+int main() {
+    test_document();
+    test_path();
+    test_filter();
+    test_error();
+    test_analyze();
+    test_stream();
+    std::cout << "All jsonpath tests passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include <booksource/liststream.h>
+#include <booksource/webbook.h>
+#include <cassert>
+#include <iostream>
+#include "bench_pages.h"
+#include "mock_server.h"
+
+const std::string JSON = R"json({"code":0,"data":{"list":[
+  {"name":"遮天","author":"辰东","url":"/book/3","tags":["玄幻","热血"]},
+  {"name":"完美世界","author":"辰东","url":"/book/4","tags":[]},
+  {"name":"圣墟","author":"辰东","url":"/book/5","tags":["玄幻"]}
+]}})json";
+
+static BookSource makeSource(const std::string &bookList, const std::string &url = "https://www.example.com") {
+    return BookSourceParser::parseBookSource(R"json({
+        "bookSourceUrl": ")json" + url + R"json(",
+        "searchUrl": "/search?q={{key}}",
+        "ruleSearch": {
+            "bookList": ")json" + bookList + R"json(",
+            "name": "class.bookname@text||name",
+            "author": "class.author@text##作者：||author",
+            "bookUrl": "class.bookname@a@href||url"
+        }
+    })json");
+}
+
+// 分段交给ListStream，每一项按书籍规则解析
+static std::vector<SearchBook> streamBooks(BookSource &bookSource, const std::string &content, const size_t chunk,
+                                           bool &failed, const size_t limit = SIZE_MAX) {
+    RuleData ruleData;
+    const std::string baseUrl = "https://www.example.com/search";
+    AnalyzeRule analyzeRule(&ruleData, &bookSource);
+    analyzeRule.setBaseUrl(baseUrl);
+    const BookListRule bookListRule = BookList::getBookListRule(bookSource, true);
+    bool reverse;
+    const std::string ruleList = BookList::splitListOrder(bookListRule, reverse);
+    std::optional<BookList::SearchItemRules> itemRules;
+    std::vector<SearchBook> books;
+    std::unique_ptr<ListStream> stream;
+    stream = ListStream::create(ruleList, std::nullopt, [&](RuleContent &&item) {
+        if (!itemRules.has_value()) {
+            analyzeRule.setContent(std::string(stream->isJson() ? "[]" : ""));
+            itemRules.emplace(analyzeRule, bookListRule);
+        }
+        if (auto book = itemRules->getSearchItem(bookSource, analyzeRule, item, baseUrl)) books.push_back(*book);
+        return books.size() < limit;
+    });
+    assert(stream != nullptr);
+    for (size_t i = 0; i < content.size(); i += chunk) {
+        if (!stream->feed(std::string_view(content).substr(i, chunk), "text/html")) break;
+    }
+    stream->finish();
+    failed = stream->failed();
+    BookList::distinctBookList(books, reverse);
+    return books;
+}
+
+static std::vector<SearchBook> fullBooks(BookSource &bookSource, const std::string &content) {
+    RuleData ruleData;
+    AnalyzeUrl analyzeUrl("/search", std::nullopt, 1, std::nullopt, std::nullopt, "https://www.example.com");
+    std::string baseUrl = "https://www.example.com/search";
+    return BookList::analyzeBookList(bookSource, ruleData, analyzeUrl, baseUrl, content);
+}
+
+static bool sameBooks(const std::vector<SearchBook> &a, const std::vector<SearchBook> &b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].name != b[i].name || a[i].author != b[i].author || a[i].bookUrl != b[i].bookUrl) return false;
+    }
+    return true;
+}
+
+void test_rules() {
+    const std::string page = makeSearchPageItems(30);
+    bool failed;
+    for (const std::string rule: {"class.bookbox", "class.search-list@tag.li", "-tag.ul@class.bookbox",
+                                  "@CSS:div.search-list > ul > li.bookbox", "li[class=bookbox]", "@@class.bookbox"}) {
+        auto bookSource = makeSource(rule);
+        const auto expected = fullBooks(bookSource, page);
+        assert(expected.size() == 30);
+        for (const size_t chunk: {size_t{1}, size_t{100}, size_t{4096}, page.size()}) {
+            assert(sameBooks(streamBooks(bookSource, page, chunk, failed), expected) && !failed);
+        }
+    }
+    for (const std::string rule: {"$.data.list[*]", "data.list", "@Json:$.data.list", "-$.data.list.*"}) {
+        auto bookSource = makeSource(rule);
+        const auto expected = fullBooks(bookSource, JSON);
+        assert(expected.size() == 3);
+        for (const size_t chunk: {size_t{1}, size_t{10}, JSON.size()}) {
+            assert(sameBooks(streamBooks(bookSource, JSON, chunk, failed), expected) && !failed);
+        }
+    }
+
+    // 不支持的规则
+    for (const std::string rule: {"//li", "class.bookbox.0", "class.bookbox!0", "tag.li[1:3]", "children.0",
+                                  "class.bookbox@js:result", "class.a&&class.b", ":<li>(.*?)</li>", "li:nth-child(2)",
+                                  "ul + li", "@XPath://li", "text.斗破"}) {
+        assert(ListStream::create(rule, std::nullopt, [](RuleContent &&) { return true; }) == nullptr);
+    }
+
+    // 结果与完整解析不同时失败，由调用方按完整内容解析
+    auto nested = makeSource("tag.div@tag.a");
+    assert(streamBooks(nested, page, 512, failed).empty() && failed);
+    auto jsonOnHtml = makeSource("$.data.list");
+    streamBooks(jsonOnHtml, page, 512, failed);
+    assert(failed);
+    auto object = makeSource("$.data");
+    streamBooks(object, JSON, 16, failed);
+    assert(failed);
+    auto html = makeSource("class.bookbox");
+    streamBooks(html, R"(<?xml version="1.0"?><rss><item class="bookbox"></item></rss>)", 16, failed);
+    assert(failed);
+
+    // 回调要求停止后不再解析
+    const auto first = streamBooks(html, page, 256, failed, 3);
+    assert(first.size() == 3 && first[2].name == "斗破苍穹10002" && !failed);
+}
+
+void test_search_abort() {
+    const std::string page = makeSearchPageItems(400);
+    MockServer server([&](const std::string &) { return page; }, 2048, std::chrono::milliseconds(2));
+    auto bookSource = makeSource("class.bookbox", server.url(""));
+    const auto expected = fullBooks(bookSource, page);
+
+    std::vector<int> sizes;
+    const auto books = WebBook::searchBook(bookSource, "斗破", 1, std::nullopt, [&](const int size) {
+        sizes.push_back(size);
+        return size >= 5;
+    });
+    assert(books.size() == 5);
+    for (size_t i = 0; i < books.size(); i++) {
+        assert(books[i].name == expected[i].name && books[i].bookUrl == server.url(expected[i].bookUrl.substr(23)));
+    }
+    assert(sizes.size() == 5);
+    // 满足条件后中断传输，剩余的网页不再下载
+    assert(server.bytesSent() < page.size() / 4);
+
+    // 不支持流式解析的规则下载完整的网页后解析
+    auto xpath = makeSource("//li[@class='bookbox']", server.url(""));
+    const auto all = WebBook::searchBook(xpath, "斗破", 1, std::nullopt, [](const int size) { return size >= 5; });
+    assert(all.size() == 5 && all[4].name == expected[4].name);
+    assert(server.requestCount() == 2);
+    // 多级规则的结果会重复时，下载完成后按完整的网页解析
+    auto nested = makeSource("tag.div@class.bookbox", server.url(""));
+    const auto deduped = WebBook::searchBook(nested, "斗破", 1, std::nullopt, [](const int size) { return size >= 5; });
+    assert(deduped.size() == 5 && deduped[4].name == expected[4].name);
+    assert(server.requestCount() == 3);
+}
+
+void test_search_gbk() {
+    // 编码由meta标签确定，内容分段到达
+    std::string gbk = "<html><head><meta charset=gbk></head><body><ul>";
+    for (int i = 0; i < 50; i++) {
+        gbk += "<li class=\"bookbox\"><h4 class=\"bookname\"><a href=\"/b/" + std::to_string(i) +
+                "\">\xB5\xDA" + std::to_string(i) + "</a></h4></li>";
+    }
+    gbk += "</ul></body></html>";
+    MockServer server([&](const std::string &) { return MockServer::Response(gbk, "text/html"); }, 100);
+    auto bookSource = makeSource("class.bookbox", server.url(""));
+    const auto books = WebBook::searchBook(bookSource, "key", 1, std::nullopt, [](const int size) { return size >= 60; });
+    assert(books.size() == 50);
+    assert(books[7].name == "第7" && books[7].bookUrl == server.url("/b/7"));
+}
+
+int main() {
+    test_rules();
+    test_search_abort();
+    test_search_gbk();
+    std::cout << "All list stream tests passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include <booksource/prefetch.h>
+#include <booksource/ratelimiter.h>
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <thread>
+#include "content_site.h"
+
+using namespace std::chrono_literals;
+
+static bool waitCached(ContentPrefetcher &prefetcher, const std::vector<int> &indexes) {
+    for (int i = 0; i < 200; i++) {
+        if (std::ranges::all_of(indexes, [&](const int index) { return prefetcher.isCached(index); })) return true;
+        std::this_thread::sleep_for(10ms);
+    }
+    return false;
+}
+
+static bool requested(ContentSite &site, const int chapter) {
+    const auto paths = site.getServer().paths();
+    return std::ranges::find(paths, "/book/1/" + std::to_string(chapter) + ".html") != paths.end();
+}
+
+void test_rate_limiter() {
+    // 次数/毫秒数：每个时间窗口内最多开始2个请求
+    const auto limiter = ConcurrentRateLimiter::forSource("test_rate_limiter");
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 3; i++) {
+        assert(limiter->acquire("2/200"));
+        limiter->release("2/200");
+    }
+    assert(std::chrono::steady_clock::now() - start >= 190ms);
+
+    // 毫秒数：同一时间只有一个请求，等待中的前台请求先于后台请求开始
+    const auto interval = ConcurrentRateLimiter::forSource("test_rate_limiter_interval");
+    assert(interval->acquire("100"));
+    std::mutex mutex;
+    std::vector<std::string> order;
+    std::thread background([&] {
+        const ConcurrentRateLimiter::RequestScope scope(ConcurrentRateLimiter::Background);
+        assert(interval->acquire("100"));
+        std::lock_guard lock(mutex);
+        order.emplace_back("background");
+        interval->release("100");
+    });
+    std::this_thread::sleep_for(20ms);
+    std::thread foreground([&] {
+        assert(interval->acquire("100"));
+        std::lock_guard lock(mutex);
+        order.emplace_back("foreground");
+        interval->release("100");
+    });
+    std::this_thread::sleep_for(30ms);
+    interval->release("100");
+    background.join();
+    foreground.join();
+    assert((order == std::vector<std::string>{"foreground", "background"}));
+
+    // 等待中取消
+    assert(interval->acquire("100"));
+    std::atomic<bool> cancelled = false;
+    std::thread waiting([&] {
+        const ConcurrentRateLimiter::RequestScope scope(ConcurrentRateLimiter::Background, &cancelled);
+        assert(!interval->acquire("100"));
+    });
+    std::this_thread::sleep_for(30ms);
+    cancelled = true;
+    waiting.join();
+    interval->release("100");
+
+    // 不限制
+    assert(limiter->acquire("") && limiter->acquire("0") && limiter->acquire("abc"));
+}
+
+void test_prefetch() {
+    ContentSite site(12, 2, 3, 10ms);
+    auto bookSource = ContentSite::source("https://prefetch.example.com/");
+    RuleData ruleData;
+    ContentPrefetcher prefetcher(bookSource, Book(), site.bookChapters(12), ruleData, {3, true, 2});
+    prefetcher.moveTo(0);
+    assert(prefetcher.getContent(0) == site.text(0));
+    assert(prefetcher.missCount() == 1);
+    assert(waitCached(prefetcher, {1, 2, 3}));
+    // 打开下一章时命中缓存，不再请求
+    const size_t before = site.getServer().requestCount();
+    prefetcher.moveTo(1);
+    assert(prefetcher.getContent(1) == site.text(1));
+    assert(prefetcher.hitCount() == 1 && prefetcher.missCount() == 1);
+    assert(waitCached(prefetcher, {0, 2, 3, 4}));
+    // 只预读了新进入范围的第5章
+    assert(site.getServer().requestCount() - before == 2);
+
+    // 跳到范围外：缓存被丢弃，重新预读
+    prefetcher.moveTo(8);
+    assert(!prefetcher.isCached(1) && !prefetcher.isCached(4));
+    assert(prefetcher.getContent(8) == site.text(8));
+    assert(waitCached(prefetcher, {7, 9, 10, 11}));
+    assert(prefetcher.getContent(10) == site.text(10));
+}
+
+void test_cancel() {
+    ContentSite site(12, 2, 3);
+    // 同一时间只有一个请求，相邻请求间隔100毫秒
+    auto bookSource = ContentSite::source("https://prefetch.example.com/100", "100");
+    RuleData ruleData;
+    {
+        ContentPrefetcher prefetcher(bookSource, Book(), site.bookChapters(12), ruleData, {3, false, 2});
+        prefetcher.moveTo(0);
+        // 立即跳走，等待中与排队中的预读被取消
+        prefetcher.moveTo(8);
+        assert(prefetcher.getContent(8) == site.text(8));
+    }
+    // 前台请求优先于第10~12章的预读，先于它们发出
+    const auto paths = site.getServer().paths();
+    const auto first = [&](const int chapter) {
+        return std::ranges::find(paths, "/book/1/" + std::to_string(chapter) + ".html") - paths.begin();
+    };
+    assert(first(8) < first(9) && first(8) < first(10) && first(8) < first(11));
+    // 两个预读线程中只有先开始的一个发出了请求，排队中的第4章没有开始
+    assert(!(requested(site, 1) && requested(site, 2)) && !requested(site, 3));
+    assert(requested(site, 8));
+}
+
+int main() {
+    test_rate_limiter();
+    test_prefetch();
+    test_cancel();
+    std::cout << "All prefetch tests passed." << std::endl;
+    return 0;
+}
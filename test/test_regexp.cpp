@@ -0,0 +1,184 @@
+#include <booksource/regexp.h>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+
+using Regexp::Match;
+using Regexp::Pattern;
+
+static std::string first(const std::string &pattern, const std::string &text, const size_t group = 0) {
+    Match match;
+    if (!Pattern::parse(pattern)->search(text, 0, match)) return "<none>";
+    return std::string(match.group(text, group));
+}
+
+static std::vector<std::string> all(const std::string &pattern, const std::string &text, const size_t group = 0) {
+    std::vector<std::string> result;
+    for (const auto &match: Pattern::parse(pattern)->findAll(text)) {
+        result.emplace_back(match.group(text, group));
+    }
+    return result;
+}
+
+void test_search() {
+    assert(first("a(b+)c", "xxabbbcd", 1) == "bbb");
+    assert(first("<li>(.*?)</li>", "<li>1</li><li>2</li>", 1) == "1");
+    assert(first("<li>(.*)</li>", "<li>1</li><li>2</li>", 1) == "1</li><li>2");
+    // 分支与量词按优先级选择，与回溯引擎的结果相同
+    assert(first("a|ab", "ab") == "a");
+    assert(first("(a|ab)(c|bcd)", "abcd", 2) == "bcd");
+    assert(first("(a+?)(a*)", "aaa", 1) == "a");
+    assert(first("x(a|b)*y", "xababy", 1) == "b");
+    assert(first("(a)|b", "b", 1).empty());
+    assert(first("\\d{2,3}", "a1b1234") == "123");
+    assert(first(">([^<>]+)<", "<b>粗体</b>", 1) == "粗体");
+    assert(first("[a-c\\d]+", "xyzab12cd") == "ab12c");
+    assert(first("[\\w-]+", "  foo-bar_1 ") == "foo-bar_1");
+    assert(first("(?i)<DIV class=\"(\\w+)\">", "<div class=\"Content\">", 1) == "Content");
+    assert(first("(?i:a)b", "AbAB") == "Ab");
+    assert(first("[^abc]", "ABCabcd") == "A");
+    assert(first("(?i)[^abc]", "ABCabcd") == "d");
+    assert(first("a{2}", "aaaa") == "aa");
+    assert(first("a{,2}", "a{,2}") == "a{,2}");
+    assert(first("\\Q(a+)\\E+", "(a+)))") == "(a+)))");
+    assert(first("(?<id>\\d+)", "id=42", 1) == "42");
+    assert(first("\\x41\\u0042\\x{43}\\t", "ABC\t") == "ABC\t");
+
+    // 多字节字符按一个字符匹配
+    assert(first("第(\\d+)章.(.)", "第12章 开始", 2) == "开");
+    assert(first("[章节]+", "第一章节") == "章节");
+    assert(first("[一-龥]+", "abc汉字def") == "汉字");
+    assert(first("\\p{Han}+", "《斗破苍穹》") == "斗破苍穹");
+    assert(first("\\P{Han}+", "斗破abc苍穹") == "abc");
+
+    // 锚点
+    assert(first("^\\s*(\\S+)", "  第一行\n第二行", 1) == "第一行");
+    assert(first("\\S+$", "a b\nc d") == "d");
+    assert(first("\\S+$", "a b\n") == "b");
+    assert(first("(?m)^\\S+$", "a b\ncd\n") == "cd");
+    assert(first("\\bcat\\b", "concat cat") == "cat");
+    assert(first("\\Bcat", "cat concat") == "cat");
+    assert(first(".+", "a\nb") == "a");
+    assert(first("(?s).+", "a\nb") == "a\nb");
+
+    Match match;
+    const auto anchored = Pattern::parse("^ab");
+    assert(anchored->search("abab", 0, match) && !anchored->search("abab", 1, match));
+    assert(Pattern::parse("b")->search("abab", 2, match) && match.begin() == 3);
+    assert(!Pattern::parse("x")->search("abab", 0, match));
+}
+
+void test_find_all() {
+    assert((all("<a href=\"([^\"]+)\">", R"(<a href="/1"><a href="/2"><a>)", 1) == std::vector<std::string>{"/1", "/2"}));
+    // 空的匹配之后前进一个字符
+    const auto matches = Pattern::parse("a*")->findAll("baa");
+    assert(matches.size() == 3);
+    assert(matches[0].begin() == 0 && matches[0].end() == 0);
+    assert(matches[1].begin() == 1 && matches[1].end() == 3);
+    assert(matches[2].begin() == 3 && matches[2].end() == 3);
+    assert(Pattern::parse("")->findAll("汉字").size() == 3);
+}
+
+void test_replace() {
+    const auto digits = Pattern::parse("(\\d+)");
+    assert(digits->groupCount() == 1);
+    assert(digits->replace("第12章第3节", "[$1]") == "第[12]章第[3]节");
+    assert(digits->replace("第12章第3节", "[$1]", true) == "第[12]章第3节");
+    assert(digits->replace("a1", "$&$$\\$$0") == "a1$$1");
+    // 分组序号不超过分组数量，$12为$1之后的'2'
+    assert(digits->replace("a7", "$12") == "a72");
+    assert(Pattern::parse("(?<num>\\d)")->replace("a1b2", "<${num}>") == "a<1>b<2>");
+    assert(Pattern::parse("x*")->replace("abc", "-") == "-a-b-c-");
+    assert(Pattern::parse("\\s+")->replace("  a \n b  ", "") == "ab");
+    assert(Pattern::parse("<br\\s*/?>")->replace("a<br>b<br/>c", "\n") == "a\nb\nc");
+}
+
+void test_alternatives() {
+    // 字面文本的分支与其余分支的优先级与单个NFA相同
+    assert(first("ab|a", "ab") == "ab");
+    assert(first("abc|b|a\\w+", "xabd") == "abd");
+    assert(first("a\\w+|abc", "abcd") == "abcd");
+    assert(first("cd|b\\w", "abcd") == "bc");
+    assert(first("(\\d+)元|价格", "价格12元", 1).empty());
+    assert(first("(\\d+)元|价格", "售12元价格", 1) == "12");
+    assert(all("he|she|hers|his", "ushers his") == (std::vector<std::string>{"she", "his"}));
+    assert(all("a|aa|b", "aab") == (std::vector<std::string>{"a", "a", "b"}));
+    assert(first("x|(?i)y", "aY") == "Y");
+
+    // 净化规则：大量的字面文本与少量正则，与逐个分支组成的NFA结果相同
+    std::string rule = "<br\\s*/?>";
+    std::vector<std::string> words;
+    for (int i = 0; i < 300; i++) {
+        words.push_back("广告" + std::to_string(i * 7));
+        rule += "|" + words.back();
+    }
+    rule += "|请收藏本站[:：]\\S+|本章未完";
+    std::string text;
+    for (int i = 0; i < 2000; i++) {
+        text += "第" + std::to_string(i) + "段" + words[i * 13 % words.size()] + "<br/>";
+        if (i % 50 == 0) text += "请收藏本站：www.example.com 本章未完";
+    }
+    const auto purify = Pattern::parse(rule);
+    const auto nfa = Pattern::parse("(" + rule + ")");
+    const auto expected = nfa->replace(text, "");
+    assert(purify->replace(text, "") == expected);
+    assert(expected.find("广告") == std::string::npos && expected.find("本章未完") == std::string::npos);
+    assert(purify->findAll(text).size() == nfa->findAll(text).size());
+
+    // 全部是字面文本
+    const auto words2 = Pattern::parse("本站|广告");
+    assert(words2->replace("本站有广告", "*") == "*有*");
+    assert(words2->replace("本站有广告", "<$&>", true) == "<本站>有广告");
+    assert(words2->groupCount() == 0 && words2->isLinear());
+}
+
+void test_fallback() {
+    // 环视与反向引用退回到 std::regex
+    const auto lookahead = Pattern::parse("\\d+(?=元)");
+    assert(!lookahead->isLinear());
+    assert(first("\\d+(?=元)", "12个 34元") == "34");
+    assert(lookahead->replace("34元", "[$&]") == "[34]元");
+    assert(first("(\\w)\\1", "abccd", 1) == "c");
+    assert(Pattern::parse("a(b)c")->isLinear());
+
+    // 语法错误
+    for (const std::string pattern: {"(abc", "abc)", "[abc", "*a", "a**", "a{3,1}", "a{1001}", "\\"}) {
+        bool thrown = false;
+        try {
+            Pattern::parse(pattern);
+        } catch (const std::invalid_argument &) {
+            thrown = true;
+        }
+        assert(thrown);
+        assert(Pattern::compile(pattern) == nullptr);
+    }
+    assert(Pattern::compile("a(b)c") == Pattern::compile("a(b)c"));
+}
+
+void test_linear() {
+    // 回溯引擎在这些输入上是指数级的，或者递归过深导致栈溢出
+    const auto start = std::chrono::steady_clock::now();
+    const std::string as(100000, 'a');
+    Match match;
+    assert(!Pattern::parse("(a*)*b")->search(as, 0, match));
+    assert(!Pattern::parse("(x+x+)+y")->search(std::string(5000, 'x'), 0, match));
+    assert(!Pattern::parse("(.*?,){11}P")->search(std::string(20000, ','), 0, match));
+    std::string page;
+    for (int i = 0; i < 20000; i++) page += i % 2 == 0 ? "ab" : "ba";
+    assert(Pattern::parse("(a|b)*")->search(page, 0, match) && match.end() == page.size());
+    assert(Pattern::parse("([\\s\\S]*?)$")->search(page, 0, match) && match.group(page, 1).size() == page.size());
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "linear cases: " << elapsed.count() << "ms" << std::endl;
+    assert(elapsed.count() < 10000);
+}
+
+int main() {
+    test_search();
+    test_find_all();
+    test_replace();
+    test_alternatives();
+    test_fallback();
+    test_linear();
+    std::cout << "All regexp tests passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <booksource/ruledata.h>
+#include <booksource/utils.h>
+#include <cassert>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+void test_chapter_variable() {
+    BookChapter chapter;
+    assert(!chapter.getVariableString().has_value());
+    for (int i = 0; i < 100; i++) {
+        chapter.putVariable("key" + std::to_string(i), std::to_string(i));
+    }
+    assert(chapter.getVariable("key42") == "42");
+    // 多次put之后只生成一次
+    const auto map = JsonUtils::jsonStringToMap(chapter.getVariableString().value());
+    assert(map.size() == 100 && map.at("key99") == "99");
+    assert(&chapter.getVariableString() == &chapter.getVariableString());
+
+    chapter.putVariable("key0", std::nullopt);
+    assert(JsonUtils::jsonStringToMap(chapter.getVariableString().value()).size() == 99);
+    // 没有修改时不改变
+    chapter.putVariable("missing", std::nullopt);
+    assert(JsonUtils::jsonStringToMap(chapter.getVariableString().value()).size() == 99);
+
+    // 复制的章节各自生成
+    BookChapter copy = chapter;
+    copy.putVariable("copy", "1");
+    assert(JsonUtils::jsonStringToMap(copy.getVariableString().value()).size() == 100);
+    assert(JsonUtils::jsonStringToMap(chapter.getVariableString().value()).size() == 99);
+}
+
+void test_saved_variable() {
+    // 保存的变量在构造时读回，之后的修改在它的基础上进行
+    BookChapter chapter("/1.html", "第一章", false, "", "", 0, false, false, std::nullopt, std::nullopt,
+                        std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt,
+                        R"({"a":"1","b":"2"})");
+    assert(chapter.getVariable("a") == "1");
+    chapter.putVariable("c", "3");
+    const auto map = JsonUtils::jsonStringToMap(chapter.getVariableString().value());
+    assert(map.size() == 3 && map.at("b") == "2" && map.at("c") == "3");
+}
+
+void test_book_variable() {
+    BaseBook book;
+    assert(!book.getVariableString().has_value());
+    book.putCustomVariable("自定义");
+    book.putVariable("page", std::string(20000, 'x'));
+    assert(book.getCustomVariable() == "自定义");
+    const auto map = JsonUtils::jsonStringToMap(book.getVariableString().value());
+    assert(map.size() == 2 && map.at("page").size() == 20000);
+}
+
+void test_saved_book_variable() {
+    // 保存的变量替换现有的全部变量，之后的修改在它的基础上进行
+    BaseBook book;
+    book.putVariable("old", "0");
+    book.setVariableString(R"({"a":"1","b":"2"})");
+    assert(book.getVariable("a") == "1" && book.getVariable("old").empty());
+    assert(book.getVariableString() == R"({"a":"1","b":"2"})");
+    book.putVariable("c", "3");
+    const auto map = JsonUtils::jsonStringToMap(book.getVariableString().value());
+    assert(map.size() == 3 && map.at("b") == "2" && map.at("c") == "3");
+
+    book.setVariableString(std::nullopt);
+    assert(!book.getVariableString().has_value() && book.getVariable("a").empty());
+}
+
+void test_concurrent_read() {
+    // 多个线程同时读取同一个const章节，只生成一次
+    BookChapter chapter;
+    for (int i = 0; i < 100; i++) {
+        chapter.putVariable("key" + std::to_string(i), std::to_string(i));
+    }
+    const BookChapter &shared = chapter;
+    std::vector<const std::optional<std::string> *> results(8);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < results.size(); t++) {
+        threads.emplace_back([&shared, &results, t] { results[t] = &shared.getVariableString(); });
+    }
+    for (auto &thread: threads) thread.join();
+    for (const auto *result: results) {
+        assert(result == &chapter.getVariableString());
+        assert(JsonUtils::jsonStringToMap(result->value()).size() == 100);
+    }
+}
+
+int main() {
+    test_chapter_variable();
+    test_saved_variable();
+    test_book_variable();
+    test_saved_book_variable();
+    test_concurrent_read();
+    std::cout << "All rule data tests passed." << std::endl;
+    return 0;
+}
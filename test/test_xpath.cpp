@@ -0,0 +1,175 @@
+#include <booksource/xpath.h>
+#include <booksource/css.h>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+using Html::Document;
+using Xpath::Expression;
+
+const std::string PAGE = R"(<html><body>
+<div id="main" class="wrap">
+  <ul class="list">
+    <li class="item hot" data-id="1"><a href="/book/1.html" title="Doupo">斗破苍穹</a><span>天蚕土豆</span></li>
+    <li class="item" data-id="2"><a href="/book/2.html">凡人修仙传</a><span>忘语</span></li>
+    <li class="item" data-id="3"><a href="https://m.example.com/book/3.html">遮天</a><span>辰东</span></li>
+    <li class="item ad" data-id="4"><em>广告</em></li>
+  </ul>
+  <p>尾部 <b>加粗</b> 结束</p>
+</div>
+<div class="footer"><a href="/about">关于</a></div>
+</body></html>)";
+
+static std::vector<std::string> texts(const Html::Elements &elements) {
+    std::vector<std::string> result;
+    for (const auto *e: elements) result.push_back(e->text());
+    return result;
+}
+
+static std::vector<std::string> select(const Document &doc, const std::string &xpath) {
+    return texts(Expression::parse(xpath)->selectElements(doc.root()));
+}
+
+static std::vector<std::string> strings(const Document &doc, const std::string &xpath) {
+    return Expression::parse(xpath)->selectStrings(doc.root());
+}
+
+static std::string string(const Document &doc, const std::string &xpath) {
+    const auto list = strings(doc, xpath);
+    return list.empty() ? "" : list[0];
+}
+
+void test_path() {
+    const auto doc = Document::parse(PAGE);
+    assert(select(*doc, "//li/a").size() == 3);
+    assert(select(*doc, "/html/body/div/ul/li").size() == 4);
+    assert(select(*doc, "//div[@id='main']//a").size() == 3);
+    assert(select(*doc, "//ul/*").size() == 4);
+    assert(select(*doc, "//li[@class='item']/a") == (std::vector<std::string>{"凡人修仙传", "遮天"}));
+    assert(select(*doc, "//a | //span").size() == 7);
+    // 结果按文档顺序
+    assert(select(*doc, "//span | //li/a")[1] == "天蚕土豆");
+    assert(select(*doc, "//em/..")[0] == "广告");
+    assert(select(*doc, "//em/ancestor::div/@id").empty());
+    assert(select(*doc, "//em/ancestor::div")[0].starts_with("斗破苍穹"));
+    assert(select(*doc, "//li[1]/following-sibling::li/a") == (std::vector<std::string>{"凡人修仙传", "遮天"}));
+    assert(select(*doc, "//li[last()]/preceding-sibling::li[1]/a") == std::vector<std::string>{"遮天"});
+    assert(select(*doc, "//em/preceding::a[1]") == std::vector<std::string>{"遮天"});
+    assert(select(*doc, "//ul/following::a") == std::vector<std::string>{"关于"});
+    assert(select(*doc, "//LI/A").size() == 3);
+    assert(select(*doc, "//descendant::span[2]") == std::vector<std::string>{"忘语"});
+    assert(select(*doc, "//li/self::li[@data-id='4']") == std::vector<std::string>{"广告"});
+}
+
+void test_predicate() {
+    const auto doc = Document::parse(PAGE);
+    // '//li[1]'为每个父元素的第一个li，'(//li)[1]'为整个文档中的第一个
+    assert(select(*doc, "//li[1]/a") == std::vector<std::string>{"斗破苍穹"});
+    assert(select(*doc, "(//a)[last()]") == std::vector<std::string>{"关于"});
+    assert(select(*doc, "(//a)[position() > 1 and position() < 4]") == (std::vector<std::string>{"凡人修仙传", "遮天"}));
+    assert(select(*doc, "//li[a][last()]/a") == std::vector<std::string>{"遮天"});
+    assert(select(*doc, "//li[not(a)]") == std::vector<std::string>{"广告"});
+    assert(select(*doc, "//li[contains(@class, 'hot')]/span") == std::vector<std::string>{"天蚕土豆"});
+    assert(select(*doc, "//a[starts-with(@href, 'https')]") == std::vector<std::string>{"遮天"});
+    assert(select(*doc, "//a[ends-with(@href, '.html')]").size() == 3);
+    assert(select(*doc, "//li[@data-id >= 2][@data-id < 4]/a") == (std::vector<std::string>{"凡人修仙传", "遮天"}));
+    assert(select(*doc, "//li[@data-id mod 2 = 0]/span") == std::vector<std::string>{"忘语"});
+    assert(select(*doc, "//a[text()='遮天']/../span") == std::vector<std::string>{"辰东"});
+    assert(select(*doc, "//a[.='关于']") == std::vector<std::string>{"关于"});
+    assert(select(*doc, "//li[span='忘语']/a") == std::vector<std::string>{"凡人修仙传"});
+    assert(select(*doc, "//ul[count(li) = 4]").size() == 1);
+    assert(select(*doc, "//a[@title or @href='/about']") == (std::vector<std::string>{"斗破苍穹", "关于"}));
+    assert(select(*doc, "//li[position() = last() - 1]/a") == std::vector<std::string>{"遮天"});
+    assert(select(*doc, "//a[string-length(text()) = 2]") == (std::vector<std::string>{"遮天", "关于"}));
+}
+
+void test_value() {
+    const auto doc = Document::parse(PAGE);
+    assert((strings(*doc, "//li/a/@href") ==
+        std::vector<std::string>{"/book/1.html", "/book/2.html", "https://m.example.com/book/3.html"}));
+    assert(strings(*doc, "//li/@*").size() == 8);
+    assert(string(*doc, "//li[2]/a/text()") == "凡人修仙传");
+    // text()为元素自身的文本，与JsoupXpath一致
+    assert(string(*doc, "//div[@id='main']/p/text()") == "尾部 结束");
+    assert((strings(*doc, "//p//text()") == std::vector<std::string>{"尾部", "加粗", "结束"}));
+    assert(string(*doc, "//p/allText()") == "尾部 加粗 结束");
+    assert(string(*doc, "//p/html()") == "尾部 <b>加粗</b> 结束");
+    assert(string(*doc, "//li[4]/em/outerHtml()") == "<em>广告</em>");
+    assert(string(*doc, "//li[3]/a/@href/num()") == "https://m.example.com/book/3.html");
+    assert(string(*doc, "//li[2]/a/num()").empty());
+    assert(string(*doc, "//li[1]/span") == "<span>天蚕土豆</span>");
+    assert(string(*doc, "count(//li)") == "4");
+    assert(string(*doc, "sum(//li/@data-id) div 4") == "2.5");
+    assert(string(*doc, "concat(//li[1]/a, '-', //li[1]/span)") == "斗破苍穹-天蚕土豆");
+    assert(string(*doc, "substring-after(//li[3]/a/@href, '//')") == "m.example.com/book/3.html");
+    assert(string(*doc, "substring-before(//li[1]/a/@href, '.html')") == "/book/1");
+    assert(string(*doc, "substring(//li[2]/a, 3)") == "修仙传");
+    assert(string(*doc, "substring(//li[2]/a, 1.5, 2)") == "人修");
+    assert(string(*doc, "normalize-space('  a \n b  ')") == "a b");
+    assert(string(*doc, "translate('abc', 'abc', 'AB')") == "AB");
+    assert(string(*doc, "name(//li[1]/a/@title)") == "title");
+    assert(string(*doc, "boolean(//table)") == "false");
+    assert(string(*doc, "-(1 + 2) * 3") == "-9");
+    assert(string(*doc, "floor(2.7) + ceiling(2.1) + round(2.5)") == "8");
+}
+
+void test_scope() {
+    const auto doc = Document::parse(PAGE);
+    const auto items = Css::Selector::parse("li.item")->select(doc->root());
+    // 在子元素上执行时，绝对路径从该元素开始
+    const auto expr = Expression::parse("//a/@href");
+    assert(expr->selectStrings(items[1]) == std::vector<std::string>{"/book/2.html"});
+    assert(Expression::parse("span")->selectElements(items[2])[0]->text() == "辰东");
+    assert(Expression::parse("./a/text()")->selectStrings(items[0]) == std::vector<std::string>{"斗破苍穹"});
+    assert(Expression::parse("//a")->selectElements(items[3]).empty());
+}
+
+void test_error() {
+    for (const char *xpath: {"", "//", "//a[", "//a[@href='x]", "//a/foo()", "//a/text()/b", "$x", "//a[1]]", "//a[@href=]"}) {
+        bool thrown = false;
+        try {
+            Expression::parse(xpath);
+        } catch (const std::invalid_argument &) {
+            thrown = true;
+        }
+        assert(thrown);
+        assert(Expression::compile(xpath) == nullptr);
+    }
+    // 编译结果被缓存
+    assert(Expression::compile("//li/a") == Expression::compile("//li/a"));
+}
+
+void test_analyze() {
+    const AnalyzeByXPath analyzer(PAGE);
+    assert(analyzer.getElements("//li[@class='item']").size() == 2);
+    assert(analyzer.getElements("//em && //b").size() == 2);
+    assert(analyzer.getElements("//table || //em").size() == 1);
+    assert((analyzer.getStringList("//li/a/text() %% //li/span/text()") ==
+        std::vector<std::string>{"斗破苍穹", "天蚕土豆", "凡人修仙传", "忘语", "遮天", "辰东"}));
+    assert(analyzer.getString("//li[1]/a/text() || //li[2]/a/text()") == "斗破苍穹");
+    assert(analyzer.getString("//li/span/text()") == "天蚕土豆\n忘语\n辰东");
+    assert(analyzer.getString("//table/text()") == std::nullopt);
+    assert(analyzer.getString("//a[") == std::nullopt);
+
+    // 与JSoup规则共享同一个文档
+    const auto doc = analyzer.getDocument();
+    for (const auto *item: analyzer.getElements("//li[a]")) {
+        const AnalyzeByXPath sub(doc, item);
+        assert(sub.getString("//a/@href").has_value());
+        assert(sub.getElements("//span").size() == 1);
+    }
+
+    const AnalyzeByXPath xml(R"(<?xml version="1.0"?><rss><channel><Item><Title>第一章</Title></Item></channel></rss>)");
+    assert(xml.getString("//item/title/text()") == "第一章");
+}
+
+int main() {
+    test_path();
+    test_predicate();
+    test_value();
+    test_scope();
+    test_error();
+    test_analyze();
+    std::cout << "All xpath tests passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "mock_server.h"
+
+/**
+ * 模拟的分页目录：/book/1/index_{page}.html，每页perPage个章节
+ * 每一页有“下一页”链接（最后一页指回第一页），第一页还有列出全部目录页的下拉框
+ * 可以追加章节、修改标题，newestFirst为 true 时目录倒序排列，最新的章节在第一页的最前面
+ */
+class TocSite {
+public:
+    TocSite(const int pages, const int perPage, const std::chrono::milliseconds latency = std::chrono::milliseconds(0),
+            const bool newestFirst = false)
+        : perPage(perPage), count(pages * perPage), latency(latency), newestFirst(newestFirst),
+          server([this](const std::string &path) { return page(path); }) {
+    }
+
+    std::string tocUrl(const int page = 1) const {
+        return server.url(path(page));
+    }
+
+    int chapterCount() const {
+        return count;
+    }
+
+    int pageCount() const {
+        return (count + perPage - 1) / perPage;
+    }
+
+    // 在目录最后追加章节
+    void grow(const int chapters) {
+        count += chapters;
+    }
+
+    void rename(const int chapter, const std::string &title) {
+        std::lock_guard lock(mutex);
+        renamed[chapter] = title;
+    }
+
+    MockServer &getServer() {
+        return server;
+    }
+
+    static std::string chapterTitle(const int i) {
+        return "第" + std::to_string(i + 1) + "章 标题" + std::to_string(i);
+    }
+
+    static std::string chapterPath(const int i) {
+        return "/book/1/" + std::to_string(i) + ".html";
+    }
+
+private:
+    int perPage;
+    std::atomic<int> count;
+    std::chrono::milliseconds latency;
+    bool newestFirst;
+    std::mutex mutex;
+    std::map<int, std::string> renamed;
+    MockServer server;
+
+    static std::string path(const int page) {
+        return "/book/1/index_" + std::to_string(page) + ".html";
+    }
+
+    MockServer::Response page(const std::string &requestPath) {
+        if (latency.count() > 0) std::this_thread::sleep_for(latency);
+        const int total = count;
+        const int pages = pageCount();
+        int page = 0;
+        for (int i = 1; i <= pages; i++) {
+            if (requestPath == path(i)) page = i;
+        }
+        if (page == 0) return {"not found", "text/html", 404};
+        std::string html = "<html><head><title>目录</title></head><body><div class=\"toc\"><ul>\n";
+        for (int pos = (page - 1) * perPage; pos < std::min(page * perPage, total); pos++) {
+            const int i = newestFirst ? total - 1 - pos : pos;
+            std::string title = chapterTitle(i);
+            {
+                std::lock_guard lock(mutex);
+                if (const auto it = renamed.find(i); it != renamed.end()) title = it->second;
+            }
+            html += "<li><a href=\"" + chapterPath(i) + "\">" + title + "</a></li>\n";
+        }
+        html += "</ul></div><div class=\"page\"><a class=\"next\" href=\"" + path(page % pages + 1) +
+                "\">下一页</a></div>";
+        if (page == 1) {
+            html += "<select>";
+            for (int i = 1; i <= pages; i++) {
+                html += "<option value=\"" + path(i) + "\">第" + std::to_string(i) + "页</option>";
+            }
+            html += "</select>";
+        }
+        return html + "</body></html>";
+    }
+};